@@ -0,0 +1,24 @@
+/* minimal stub for syntax checking */
+#include <SDL3/SDL.h>
+typedef struct { int num_windows; SDL_Renderer **renderers; } SDLTest_CommonState;
+typedef int (SDLCALL *SDLTest_TestCaseFp)(void *arg);
+typedef struct { SDLTest_TestCaseFp testCase; const char *name; const char *description; int enabled; } SDLTest_TestCaseReference;
+typedef struct { const char *name; void *setUp; const SDLTest_TestCaseReference **testCases; void *tearDown; } SDLTest_TestSuiteReference;
+typedef struct SDLTest_TestSuiteRunner SDLTest_TestSuiteRunner;
+#define TEST_ENABLED 1
+#define TEST_ABORTED -1
+#define TEST_STARTED 0
+#define TEST_COMPLETED 0
+#define TEST_SKIPPED 2
+int SDLTest_AssertCheck(int c, SDL_PRINTF_FORMAT_STRING const char *fmt, ...) SDL_PRINTF_VARARG_FUNC(2);
+void SDLTest_Assert(int c, SDL_PRINTF_FORMAT_STRING const char *fmt, ...) SDL_PRINTF_VARARG_FUNC(2);
+void SDLTest_AssertPass(SDL_PRINTF_FORMAT_STRING const char *fmt, ...) SDL_PRINTF_VARARG_FUNC(1);
+void SDLTest_Log(SDL_PRINTF_FORMAT_STRING const char *fmt, ...) SDL_PRINTF_VARARG_FUNC(1);
+int SDLTest_CompareSurfaces(SDL_Surface *s, SDL_Surface *r, int e);
+SDLTest_CommonState *SDLTest_CommonCreateState(char **argv, SDL_InitFlags flags);
+SDLTest_TestSuiteRunner *SDLTest_CreateTestSuiteRunner(SDLTest_CommonState *s, SDLTest_TestSuiteReference *suites[]);
+bool SDLTest_CommonDefaultArgs(SDLTest_CommonState *s, int argc, char **argv);
+bool SDLTest_CommonInit(SDLTest_CommonState *s);
+int SDLTest_ExecuteTestSuiteRunner(SDLTest_TestSuiteRunner *r);
+void SDLTest_CommonEvent(SDLTest_CommonState *s, SDL_Event *e, int *done);
+void SDLTest_CommonQuit(SDLTest_CommonState *s);
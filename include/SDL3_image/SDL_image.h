@@ -95,6 +95,12 @@ extern SDL_DECLSPEC int SDLCALL IMG_Version(void);
  * need an i/o abstraction to provide data from anywhere instead of a simple
  * filesystem read; that function is IMG_Load_IO().
  *
+ * Regular files are mapped into memory where the platform allows it, so
+ * decoders can read them in place. If another process truncates the file
+ * while it is being loaded, this can crash with SIGBUS on POSIX systems; use
+ * IMG_LoadWithProperties() with `IMG_PROP_LOAD_MAP_FILE_BOOLEAN` set to false
+ * to read such files instead.
+ *
  * If you are using SDL's 2D rendering API, there is an equivalent call to
  * load images directly into an SDL_Texture for use by the GPU without using a
  * software surface: call IMG_LoadTexture() instead.
@@ -211,6 +217,11 @@ extern SDL_DECLSPEC SDL_Surface * SDLCALL IMG_Load_IO(SDL_IOStream *src, bool cl
  * load images directly into an SDL_Texture for use by the GPU without using a
  * software surface: call IMG_LoadTextureTyped_IO() instead.
  *
+ * `src` doesn't need to be seekable, so images can be loaded from pipes and
+ * sockets. The start of the data is kept in memory to detect the format, and
+ * formats that can't be decoded in a single pass (anything other than GIF,
+ * JPEG, PNG, PNM, QOI and TGA) are read entirely into memory first.
+ *
  * When done with the returned surface, the app should dispose of it with a
  * call to SDL_DestroySurface().
  *
@@ -228,6 +239,342 @@ extern SDL_DECLSPEC SDL_Surface * SDLCALL IMG_Load_IO(SDL_IOStream *src, bool cl
  */
 extern SDL_DECLSPEC SDL_Surface * SDLCALL IMG_LoadTyped_IO(SDL_IOStream *src, bool closeio, const char *type);
 
+/**
+ * Load an image from an SDL data source, scaled down to fit within a maximum
+ * size.
+ *
+ * The image keeps its aspect ratio and is never scaled up, so the result is
+ * the largest size that fits within `max_w` by `max_h` pixels. This is meant
+ * for thumbnails: where the codec supports it, the image is decoded at a
+ * reduced resolution (JPEG DCT scaling, WebP decoder scaling, SVG
+ * rasterization scale), so the full size image is never allocated. Other
+ * formats are decoded at full size and reduced with a box filter.
+ *
+ * SVG images are rendered to fit the maximum size, which may scale them up.
+ *
+ * The format of the returned surface may differ from the one that
+ * IMG_Load_IO() would return for the same image.
+ *
+ * If `closeio` is true, `src` will be closed before returning, whether this
+ * function succeeds or not. SDL_image reads everything it needs from `src`
+ * during this call in any case.
+ *
+ * When done with the returned surface, the app should dispose of it with a
+ * call to SDL_DestroySurface().
+ *
+ * \param src an SDL_IOStream that data will be read from.
+ * \param closeio true to close/free the SDL_IOStream before returning, false
+ *                to leave it open.
+ * \param max_w the maximum width of the loaded image, in pixels.
+ * \param max_h the maximum height of the loaded image, in pixels.
+ * \returns a new SDL surface, or NULL on error; call SDL_GetError() for more
+ *          information.
+ *
+ * \since This function is available since SDL_image 3.6.0.
+ *
+ * \sa IMG_Load_IO
+ * \sa IMG_LoadSizedSVG_IO
+ */
+extern SDL_DECLSPEC SDL_Surface * SDLCALL IMG_LoadScaled_IO(SDL_IOStream *src, bool closeio, int max_w, int max_h);
+
+/**
+ * Load an image using a set of properties.
+ *
+ * These are the supported properties:
+ *
+ * - `IMG_PROP_LOAD_FILENAME_STRING`: the file to load, if
+ *   `IMG_PROP_LOAD_IOSTREAM_POINTER` isn't set.
+ * - `IMG_PROP_LOAD_MAP_FILE_BOOLEAN`: true to map
+ *   `IMG_PROP_LOAD_FILENAME_STRING` into memory where possible, defaults to
+ *   true. Set this to false for files that may be truncated while they are
+ *   loaded, which crashes with SIGBUS on POSIX systems when they are mapped.
+ * - `IMG_PROP_LOAD_IOSTREAM_POINTER`: an SDL_IOStream containing the image
+ *   data, if `IMG_PROP_LOAD_FILENAME_STRING` isn't set.
+ * - `IMG_PROP_LOAD_IOSTREAM_AUTOCLOSE_BOOLEAN`: true if closing the image
+ *   should also close the associated SDL_IOStream, defaults to false.
+ * - `IMG_PROP_LOAD_TYPE_STRING`: a hint for the image type, as in
+ *   IMG_LoadTyped_IO(). This defaults to the extension of
+ *   `IMG_PROP_LOAD_FILENAME_STRING`, if it is set.
+ * - `IMG_PROP_LOAD_CROP_X_NUMBER`, `IMG_PROP_LOAD_CROP_Y_NUMBER`,
+ *   `IMG_PROP_LOAD_CROP_WIDTH_NUMBER`, `IMG_PROP_LOAD_CROP_HEIGHT_NUMBER`:
+ *   the region of the image to load, in pixels. The region is clipped to the
+ *   image, and the whole image is loaded if the width or height is 0.
+ * - `IMG_PROP_LOAD_MAX_WIDTH_NUMBER`, `IMG_PROP_LOAD_MAX_HEIGHT_NUMBER`: the
+ *   maximum size of the loaded image, as in IMG_LoadScaled_IO(). The crop
+ *   region is applied first. A maximum of 0 leaves that dimension unlimited.
+ * - `IMG_PROP_LOAD_SURFACE_POINTER`: an SDL_Surface to load the image into,
+ *   as in IMG_LoadInto_IO(). If this is set, the returned surface is this
+ *   surface, with an added reference that SDL_DestroySurface() releases.
+ * - `IMG_PROP_LOAD_FORMAT_NUMBER`: the SDL_PixelFormat of the returned
+ *   surface. The JPEG, PNG, QOI and WebP codecs decode directly to common 8-bit
+ *   RGB formats such as SDL_PIXELFORMAT_RGBA32, SDL_PIXELFORMAT_BGRA32 and
+ *   SDL_PIXELFORMAT_RGB24, and other images are converted after loading. This
+ *   defaults to the format of `IMG_PROP_LOAD_SURFACE_POINTER` if that is set,
+ *   and otherwise to the format the codec produces.
+ * - `IMG_PROP_LOAD_PREMULTIPLIED_ALPHA_BOOLEAN`: true to premultiply the color
+ *   channels by the alpha channel, defaults to false. The WebP codec does this
+ *   during decoding.
+ * - `IMG_PROP_LOAD_THREAD_COUNT_NUMBER`: the number of threads that may be
+ *   used to decode the image, defaults to 1. Baseline JPEG images with restart
+ *   markers are decoded in bands of rows on this many threads when the whole
+ *   image is loaded. Other images are decoded on the calling thread.
+ * - `IMG_PROP_LOAD_TRUSTED_INPUT_BOOLEAN`: true if the image data is known to
+ *   be valid, for example because it comes from a signed asset bundle,
+ *   defaults to false. The libpng codec then skips verifying chunk CRCs and
+ *   zlib checksums. Corrupt data may decode to garbage instead of failing.
+ * - `IMG_PROP_LOAD_COMPACT_BOOLEAN`: true to keep PNG images in a compact
+ *   pixel format instead of expanding them to RGBA, defaults to false. When
+ *   no pixel format or surface is requested, greyscale and RGB images with a
+ *   transparent color are loaded as SDL_PIXELFORMAT_INDEX8 or
+ *   SDL_PIXELFORMAT_RGB24 with a color key, and 8-bit greyscale images with
+ *   alpha that have 256 or fewer combinations of grey and alpha are loaded as
+ *   SDL_PIXELFORMAT_INDEX8 with a translucent palette.
+ *
+ * JPEG, TIFF and WebP images decode only the requested region where the
+ * codec allows it, so large images can be loaded piece by piece without
+ * allocating the full size image. Other formats are decoded at full size and
+ * then cropped.
+ *
+ * When done with the returned surface, the app should dispose of it with a
+ * call to SDL_DestroySurface().
+ *
+ * \param props the properties to use.
+ * \returns a new SDL surface, or NULL on error; call SDL_GetError() for more
+ *          information.
+ *
+ * \since This function is available since SDL_image 3.6.0.
+ *
+ * \sa IMG_Load_IO
+ * \sa IMG_LoadScaled_IO
+ */
+extern SDL_DECLSPEC SDL_Surface * SDLCALL IMG_LoadWithProperties(SDL_PropertiesID props);
+
+#define IMG_PROP_LOAD_FILENAME_STRING               "SDL_image.load.filename"
+#define IMG_PROP_LOAD_MAP_FILE_BOOLEAN              "SDL_image.load.map_file"
+#define IMG_PROP_LOAD_IOSTREAM_POINTER              "SDL_image.load.iostream"
+#define IMG_PROP_LOAD_IOSTREAM_AUTOCLOSE_BOOLEAN    "SDL_image.load.iostream.autoclose"
+#define IMG_PROP_LOAD_TYPE_STRING                   "SDL_image.load.type"
+#define IMG_PROP_LOAD_CROP_X_NUMBER                 "SDL_image.load.crop.x"
+#define IMG_PROP_LOAD_CROP_Y_NUMBER                 "SDL_image.load.crop.y"
+#define IMG_PROP_LOAD_CROP_WIDTH_NUMBER             "SDL_image.load.crop.width"
+#define IMG_PROP_LOAD_CROP_HEIGHT_NUMBER            "SDL_image.load.crop.height"
+#define IMG_PROP_LOAD_MAX_WIDTH_NUMBER              "SDL_image.load.max_width"
+#define IMG_PROP_LOAD_MAX_HEIGHT_NUMBER             "SDL_image.load.max_height"
+#define IMG_PROP_LOAD_SURFACE_POINTER               "SDL_image.load.surface"
+#define IMG_PROP_LOAD_FORMAT_NUMBER                 "SDL_image.load.format"
+#define IMG_PROP_LOAD_PREMULTIPLIED_ALPHA_BOOLEAN   "SDL_image.load.premultiplied_alpha"
+#define IMG_PROP_LOAD_THREAD_COUNT_NUMBER           "SDL_image.load.thread_count"
+#define IMG_PROP_LOAD_TRUSTED_INPUT_BOOLEAN         "SDL_image.load.trusted_input"
+#define IMG_PROP_LOAD_COMPACT_BOOLEAN               "SDL_image.load.compact"
+
+/**
+ * Load an image from an SDL data source into an existing surface.
+ *
+ * This is meant for applications that manage their own pixel memory, for
+ * example pooled or pinned buffers wrapped with SDL_CreateSurfaceFrom(). The
+ * surface must be the same size as the image, and this function fails rather
+ * than allocating a new surface if it isn't.
+ *
+ * If the surface has the pixel format the codec produces, the image is decoded
+ * directly into its pixels. This is the case for JPEG (SDL_PIXELFORMAT_RGB24),
+ * PNG, PNM, QOI (SDL_PIXELFORMAT_RGBA32), TGA and WebP
+ * (SDL_PIXELFORMAT_RGB24 or SDL_PIXELFORMAT_RGBA32) images. Otherwise the
+ * image is loaded as with IMG_Load_IO() and converted into the surface.
+ *
+ * The palette, color key and blend mode of the surface are set from the
+ * image.
+ *
+ * If `closeio` is true, `src` will be closed before returning, whether this
+ * function succeeds or not. SDL_image reads everything it needs from `src`
+ * during this call in any case.
+ *
+ * \param src an SDL_IOStream that data will be read from.
+ * \param closeio true to close/free the SDL_IOStream before returning, false
+ *                to leave it open.
+ * \param dst the surface to load the image into.
+ * \returns true on success or false on failure; call SDL_GetError() for more
+ *          information.
+ *
+ * \since This function is available since SDL_image 3.6.0.
+ *
+ * \sa IMG_GetImageInfo_IO
+ * \sa IMG_Load_IO
+ * \sa IMG_LoadWithProperties
+ */
+extern SDL_DECLSPEC bool SDLCALL IMG_LoadInto_IO(SDL_IOStream *src, bool closeio, SDL_Surface *dst);
+
+/**
+ * Load several images at once, decoding them in parallel on worker threads.
+ *
+ * Each image is loaded as with IMG_LoadWithProperties(), using the properties
+ * in `props` with the file or stream of that image added. Either `files` or
+ * `streams` should be set, and a NULL entry fails to load.
+ * `IMG_PROP_LOAD_SURFACE_POINTER` is ignored, and the streams are left open
+ * unless `IMG_PROP_LOAD_IOSTREAM_AUTOCLOSE_BOOLEAN` is true.
+ *
+ * This property is also supported:
+ *
+ * - `IMG_PROP_LOAD_BATCH_THREAD_COUNT_NUMBER`: the number of threads that
+ *   load images, including the calling thread. This defaults to the number of
+ *   logical CPU cores, and 1 loads every image on the calling thread.
+ *
+ * Every image is attempted even if some fail to load. If `errors` is not
+ * NULL, it is filled in with a copy of the error message for each image that
+ * failed and NULL for each image that loaded, and the messages should be freed
+ * with SDL_free().
+ *
+ * When done with the returned surfaces, the app should dispose of them with
+ * SDL_DestroySurface().
+ *
+ * \param files an array of `count` image files to load, or NULL.
+ * \param streams an array of `count` SDL_IOStreams to load images from, or
+ *                NULL. Each stream is read by a single thread.
+ * \param count the number of images to load.
+ * \param surfaces an array of `count` pointers that is filled in with the
+ *                 loaded surfaces, or NULL for images that failed to load.
+ * \param errors an array of `count` pointers that is filled in with error
+ *               messages, or NULL.
+ * \param props the properties to load the images with, or 0.
+ * \returns true if every image was loaded or false if any failed; call
+ *          SDL_GetError() for more information.
+ *
+ * \since This function is available since SDL_image 3.6.0.
+ *
+ * \sa IMG_LoadWithProperties
+ */
+extern SDL_DECLSPEC bool SDLCALL IMG_LoadBatch(const char * const *files, SDL_IOStream * const *streams, int count, SDL_Surface **surfaces, char **errors, SDL_PropertiesID props);
+
+#define IMG_PROP_LOAD_BATCH_THREAD_COUNT_NUMBER     "SDL_image.load.batch.thread_count"
+
+/**
+ * An image being loaded on a background thread.
+ *
+ * \since This struct is available since SDL_image 3.6.0.
+ *
+ * \sa IMG_LoadAsync
+ * \sa IMG_LoadAsync_IO
+ */
+typedef struct IMG_AsyncLoad IMG_AsyncLoad;
+
+/**
+ * A callback that is called when an asynchronous load finishes.
+ *
+ * This is called on the background thread that loaded the image, so it
+ * should be quick and must not use APIs that are restricted to the main
+ * thread. It must not wait for other asynchronous loads, since they may need
+ * the same thread to run.
+ *
+ * \param userdata the pointer that was passed to IMG_LoadAsync() or
+ *                 IMG_LoadAsync_IO().
+ * \param surface the loaded surface, which the callback should dispose of
+ *                with SDL_DestroySurface(), or NULL if the load failed or was
+ *                cancelled; call SDL_GetError() for more information.
+ *
+ * \since This datatype is available since SDL_image 3.6.0.
+ *
+ * \sa IMG_LoadAsync
+ */
+typedef void (SDLCALL *IMG_AsyncLoadCallback)(void *userdata, SDL_Surface *surface);
+
+/**
+ * Load an image from a filesystem path on a background thread.
+ *
+ * The image is loaded as with IMG_Load(). When it finishes, `callback` is
+ * called on the background thread with the surface, if it isn't NULL.
+ * Otherwise the surface is returned by IMG_WaitAsyncLoad().
+ *
+ * Loads run on a small pool of background threads shared by all asynchronous
+ * loads, and loads that are started while every thread is busy wait in a
+ * queue until one is free.
+ *
+ * Every load must be finished by calling IMG_WaitAsyncLoad(), which frees
+ * the load. To stop a load early, call IMG_CancelAsyncLoad() first.
+ *
+ * \param file a path on the filesystem to load an image from.
+ * \param callback a function to call when the load finishes, or NULL.
+ * \param userdata a pointer that is passed to `callback`.
+ * \returns the load, or NULL on error; call SDL_GetError() for more
+ *          information.
+ *
+ * \since This function is available since SDL_image 3.6.0.
+ *
+ * \sa IMG_CancelAsyncLoad
+ * \sa IMG_IsAsyncLoadDone
+ * \sa IMG_LoadAsync_IO
+ * \sa IMG_WaitAsyncLoad
+ */
+extern SDL_DECLSPEC IMG_AsyncLoad * SDLCALL IMG_LoadAsync(const char *file, IMG_AsyncLoadCallback callback, void *userdata);
+
+/**
+ * Load an image from an SDL data source on a background thread.
+ *
+ * The image is loaded as with IMG_Load_IO(), and `src` must not be used by
+ * the app until the load has finished. If `closeio` is true, `src` will be
+ * closed when the load finishes, whether it succeeds or not, and also if this
+ * function fails.
+ *
+ * \param src an SDL_IOStream that data will be read from.
+ * \param closeio true to close/free the SDL_IOStream when the load finishes,
+ *                false to leave it open.
+ * \param callback a function to call when the load finishes, or NULL.
+ * \param userdata a pointer that is passed to `callback`.
+ * \returns the load, or NULL on error; call SDL_GetError() for more
+ *          information.
+ *
+ * \since This function is available since SDL_image 3.6.0.
+ *
+ * \sa IMG_CancelAsyncLoad
+ * \sa IMG_IsAsyncLoadDone
+ * \sa IMG_LoadAsync
+ * \sa IMG_WaitAsyncLoad
+ */
+extern SDL_DECLSPEC IMG_AsyncLoad * SDLCALL IMG_LoadAsync_IO(SDL_IOStream *src, bool closeio, IMG_AsyncLoadCallback callback, void *userdata);
+
+/**
+ * Ask an asynchronous load to stop.
+ *
+ * This returns immediately. A load that is still waiting in the queue
+ * finishes without being started, and the JPEG, PNG and GIF decoders stop
+ * between rows; either way the load then finishes with a NULL surface. A load
+ * that has already finished is unaffected.
+ *
+ * \param load the load to cancel.
+ *
+ * \since This function is available since SDL_image 3.6.0.
+ *
+ * \sa IMG_WaitAsyncLoad
+ */
+extern SDL_DECLSPEC void SDLCALL IMG_CancelAsyncLoad(IMG_AsyncLoad *load);
+
+/**
+ * Check whether an asynchronous load has finished, without blocking.
+ *
+ * \param load the load to check.
+ * \returns true if the load has finished and its callback has returned, false
+ *          otherwise.
+ *
+ * \since This function is available since SDL_image 3.6.0.
+ *
+ * \sa IMG_WaitAsyncLoad
+ */
+extern SDL_DECLSPEC bool SDLCALL IMG_IsAsyncLoadDone(IMG_AsyncLoad *load);
+
+/**
+ * Wait for an asynchronous load to finish and free it.
+ *
+ * `load` is no longer valid after this call.
+ *
+ * \param load the load to wait for.
+ * \returns the loaded surface if the load had no callback, or NULL if it had
+ *          a callback or failed; call SDL_GetError() for more information.
+ *
+ * \since This function is available since SDL_image 3.6.0.
+ *
+ * \sa IMG_LoadAsync
+ * \sa IMG_LoadAsync_IO
+ */
+extern SDL_DECLSPEC SDL_Surface * SDLCALL IMG_WaitAsyncLoad(IMG_AsyncLoad *load);
+
 /**
  * Load an image from a filesystem path into a texture.
  *
@@ -504,6 +851,93 @@ extern SDL_DECLSPEC SDL_GPUTexture * SDLCALL IMG_LoadGPUTextureTyped_IO(SDL_GPUD
  */
 extern SDL_DECLSPEC SDL_Surface * SDLCALL IMG_GetClipboardImage(void);
 
+/**
+ * Detect the format of image data on a readable/seekable SDL_IOStream.
+ *
+ * This function reads a single header window (a few kilobytes at most) from
+ * `src` and matches it against the signatures of every format SDL_image
+ * knows about, so it is much cheaper than calling each IMG_isTYPE function
+ * in turn on slow or network-backed streams.
+ *
+ * The result is a filename extension that can be passed to
+ * IMG_LoadTyped_IO(), like "PNG" or "JPG". Formats without a signature, like
+ * TGA, are never detected. Detection is based on the data alone, so this may
+ * return a format that this build of SDL_image is not able to load.
+ *
+ * This function will always attempt to seek `src` back to where it started
+ * when this function was called.
+ *
+ * \param src a seekable/readable SDL_IOStream to provide image data.
+ * \returns the detected format on success or NULL on failure; call
+ *          SDL_GetError() for more information. This string is static and
+ *          should not be freed.
+ *
+ * \since This function is available since SDL_image 3.6.0.
+ *
+ * \sa IMG_LoadTyped_IO
+ * \sa IMG_LoadAnimationTyped_IO
+ */
+extern SDL_DECLSPEC const char * SDLCALL IMG_DetectFormat_IO(SDL_IOStream *src);
+
+/**
+ * Get information about an image without decoding it.
+ *
+ * This function parses only the header of the image, reading no more than a
+ * few kilobytes for most files, so it is much cheaper than loading the image
+ * when all that's needed is its size or layout.
+ *
+ * The image format is detected as with IMG_DetectFormat_IO(), so formats
+ * without a signature, like TGA, aren't supported.
+ *
+ * These are the properties that are set in the returned property set:
+ *
+ * - `IMG_PROP_IMAGE_INFO_FORMAT_STRING`: the detected image format, as
+ *   returned by IMG_DetectFormat_IO().
+ * - `IMG_PROP_IMAGE_INFO_WIDTH_NUMBER`: the width of the image, in pixels.
+ * - `IMG_PROP_IMAGE_INFO_HEIGHT_NUMBER`: the height of the image, in pixels.
+ * - `IMG_PROP_IMAGE_INFO_BIT_DEPTH_NUMBER`: the number of bits per color
+ *   component, or per pixel for indexed images, if known.
+ * - `IMG_PROP_IMAGE_INFO_HAS_ALPHA_BOOLEAN`: true if the image has an alpha
+ *   channel or transparent color.
+ * - `IMG_PROP_IMAGE_INFO_PIXEL_FORMAT_NUMBER`: the SDL_PixelFormat that most
+ *   closely matches the image data, if there is one.
+ * - `IMG_PROP_IMAGE_INFO_ORIENTATION_NUMBER`: the EXIF orientation of the
+ *   image, from 1 to 8, if the image contains orientation metadata.
+ * - `IMG_PROP_IMAGE_INFO_ANIMATED_BOOLEAN`: true if the image is an
+ *   animation.
+ * - `IMG_PROP_IMAGE_INFO_FRAME_COUNT_NUMBER`: the number of frames or pages
+ *   in the image, if it can be found cheaply. This isn't set if the file has
+ *   too many frames or pages to count without reading much of it.
+ *
+ * For icons and cursors, the information describes the image that
+ * IMG_Load_IO() would return.
+ *
+ * If `closeio` is false, this function will always attempt to seek `src`
+ * back to where it started when this function was called.
+ *
+ * \param src a seekable/readable SDL_IOStream to provide image data.
+ * \param closeio true to close/free the SDL_IOStream before returning, false
+ *                to leave it open.
+ * \returns a valid property ID on success or 0 on failure; call
+ *          SDL_GetError() for more information. The properties should be
+ *          destroyed with SDL_DestroyProperties() when no longer needed.
+ *
+ * \since This function is available since SDL_image 3.6.0.
+ *
+ * \sa IMG_DetectFormat_IO
+ */
+extern SDL_DECLSPEC SDL_PropertiesID SDLCALL IMG_GetImageInfo_IO(SDL_IOStream *src, bool closeio);
+
+#define IMG_PROP_IMAGE_INFO_FORMAT_STRING               "SDL_image.image_info.format"
+#define IMG_PROP_IMAGE_INFO_WIDTH_NUMBER                "SDL_image.image_info.width"
+#define IMG_PROP_IMAGE_INFO_HEIGHT_NUMBER               "SDL_image.image_info.height"
+#define IMG_PROP_IMAGE_INFO_BIT_DEPTH_NUMBER            "SDL_image.image_info.bit_depth"
+#define IMG_PROP_IMAGE_INFO_HAS_ALPHA_BOOLEAN           "SDL_image.image_info.has_alpha"
+#define IMG_PROP_IMAGE_INFO_PIXEL_FORMAT_NUMBER         "SDL_image.image_info.pixel_format"
+#define IMG_PROP_IMAGE_INFO_ORIENTATION_NUMBER          "SDL_image.image_info.orientation"
+#define IMG_PROP_IMAGE_INFO_ANIMATED_BOOLEAN            "SDL_image.image_info.animated"
+#define IMG_PROP_IMAGE_INFO_FRAME_COUNT_NUMBER          "SDL_image.image_info.frame_count"
+
 /**
  * Detect ANI animated cursor data on a readable/seekable SDL_IOStream.
  *
@@ -2336,9 +2770,71 @@ extern SDL_DECLSPEC bool SDLCALL IMG_SaveJPG(SDL_Surface *surface, const char *f
  * \since This function is available since SDL_image 3.0.0.
  *
  * \sa IMG_SaveJPG
+ * \sa IMG_SaveJPGWithProperties
  */
 extern SDL_DECLSPEC bool SDLCALL IMG_SaveJPG_IO(SDL_Surface *surface, SDL_IOStream *dst, bool closeio, int quality);
 
+/**
+ * Save an SDL_Surface into JPEG image data using a set of properties.
+ *
+ * These are the supported properties:
+ *
+ * - `IMG_PROP_SAVE_FILENAME_STRING`: the file to save, if
+ *   `IMG_PROP_SAVE_IOSTREAM_POINTER` isn't set. If the file already exists,
+ *   it will be overwritten.
+ * - `IMG_PROP_SAVE_IOSTREAM_POINTER`: an SDL_IOStream to save the image data
+ *   to, if `IMG_PROP_SAVE_FILENAME_STRING` isn't set.
+ * - `IMG_PROP_SAVE_IOSTREAM_AUTOCLOSE_BOOLEAN`: true if the SDL_IOStream
+ *   should be closed before returning, whether this function succeeds or not,
+ *   defaults to false.
+ * - `IMG_PROP_SAVE_QUALITY_NUMBER`: the compression quality from 0 to 100,
+ *   defaults to 90.
+ * - `IMG_PROP_SAVE_JPG_PROGRESSIVE_BOOLEAN`: true to write a progressive
+ *   JPEG, defaults to false.
+ * - `IMG_PROP_SAVE_JPG_OPTIMIZE_CODING_BOOLEAN`: true to compute optimal
+ *   Huffman tables for the image, which makes it smaller but takes longer to
+ *   save, defaults to false.
+ * - `IMG_PROP_SAVE_JPG_SUBSAMPLING_STRING`: the chroma subsampling, "4:4:4",
+ *   "4:2:2" or "4:2:0", defaults to "4:2:0".
+ * - `IMG_PROP_SAVE_JPG_DCT_METHOD_STRING`: the DCT method, "islow", "ifast"
+ *   or "float", defaults to "islow".
+ * - `IMG_PROP_SAVE_JPG_RESTART_INTERVAL_NUMBER`: the number of MCUs between
+ *   restart markers, or 0 for none, defaults to 0. An interval that evenly
+ *   divides the number of MCUs in a row lets IMG_LoadWithProperties() decode
+ *   the image on several threads.
+ * - `IMG_PROP_SAVE_THREAD_COUNT_NUMBER`: the number of threads that may be
+ *   used to encode the image, defaults to 1. Baseline images without
+ *   optimized Huffman tables or a restart interval are encoded in strips of
+ *   rows on this many threads, with a restart marker at the start of every
+ *   MCU row.
+ *
+ * If SDL_image uses its built-in encoder because libjpeg isn't available,
+ * only the quality is used, and the image is always a baseline 4:4:4 JPEG
+ * encoded on the calling thread.
+ *
+ * \param surface the SDL surface to save.
+ * \param props the properties to use.
+ * \returns true on success or false on failure; call SDL_GetError() for more
+ *          information.
+ *
+ * \since This function is available since SDL_image 3.6.0.
+ *
+ * \sa IMG_SaveJPG
+ * \sa IMG_SaveJPG_IO
+ */
+extern SDL_DECLSPEC bool SDLCALL IMG_SaveJPGWithProperties(SDL_Surface *surface, SDL_PropertiesID props);
+
+#define IMG_PROP_SAVE_FILENAME_STRING               "SDL_image.save.filename"
+#define IMG_PROP_SAVE_IOSTREAM_POINTER              "SDL_image.save.iostream"
+#define IMG_PROP_SAVE_IOSTREAM_AUTOCLOSE_BOOLEAN    "SDL_image.save.iostream.autoclose"
+#define IMG_PROP_SAVE_QUALITY_NUMBER                "SDL_image.save.quality"
+#define IMG_PROP_SAVE_THREAD_COUNT_NUMBER           "SDL_image.save.thread_count"
+#define IMG_PROP_SAVE_JPG_PROGRESSIVE_BOOLEAN       "SDL_image.save.jpg.progressive"
+#define IMG_PROP_SAVE_JPG_OPTIMIZE_CODING_BOOLEAN   "SDL_image.save.jpg.optimize_coding"
+#define IMG_PROP_SAVE_JPG_SUBSAMPLING_STRING        "SDL_image.save.jpg.subsampling"
+#define IMG_PROP_SAVE_JPG_DCT_METHOD_STRING         "SDL_image.save.jpg.dct_method"
+#define IMG_PROP_SAVE_JPG_RESTART_INTERVAL_NUMBER   "SDL_image.save.jpg.restart_interval"
+
 /**
  * Save an SDL_Surface into a PNG image file.
  *
@@ -2373,9 +2869,67 @@ extern SDL_DECLSPEC bool SDLCALL IMG_SavePNG(SDL_Surface *surface, const char *f
  * \since This function is available since SDL_image 3.0.0.
  *
  * \sa IMG_SavePNG
+ * \sa IMG_SavePNGWithProperties
  */
 extern SDL_DECLSPEC bool SDLCALL IMG_SavePNG_IO(SDL_Surface *surface, SDL_IOStream *dst, bool closeio);
 
+/**
+ * Save an SDL_Surface into PNG image data using a set of properties.
+ *
+ * These are the supported properties:
+ *
+ * - `IMG_PROP_SAVE_FILENAME_STRING`: the file to save, if
+ *   `IMG_PROP_SAVE_IOSTREAM_POINTER` isn't set. If the file already exists,
+ *   it will be overwritten.
+ * - `IMG_PROP_SAVE_IOSTREAM_POINTER`: an SDL_IOStream to save the image data
+ *   to, if `IMG_PROP_SAVE_FILENAME_STRING` isn't set.
+ * - `IMG_PROP_SAVE_IOSTREAM_AUTOCLOSE_BOOLEAN`: true if the SDL_IOStream
+ *   should be closed before returning, whether this function succeeds or not,
+ *   defaults to false.
+ * - `IMG_PROP_SAVE_PNG_COMPRESSION_LEVEL_NUMBER`: the zlib compression level
+ *   from 0 (no compression) to 9 (smallest), defaults to 6.
+ * - `IMG_PROP_SAVE_PNG_FILTER_STRING`: a comma separated list of the filters
+ *   that may be applied to each row, from "none", "sub", "up", "average",
+ *   "paeth" and "adaptive" for all of them. The filter that predicts each
+ *   row best is used. This defaults to "none" for images with a palette and
+ *   "adaptive" for other images.
+ * - `IMG_PROP_SAVE_PNG_STRATEGY_STRING`: the zlib compression strategy,
+ *   "default", "filtered", "huffman", "rle" or "fixed", defaults to
+ *   "default". "rle" with the "none" or "sub" filters and a low compression
+ *   level is fast, and "filtered" with adaptive filtering and level 9 gives
+ *   small files.
+ * - `IMG_PROP_SAVE_PNG_REDUCE_COLORS_BOOLEAN`: true to save images without a
+ *   palette in the smallest PNG color type that holds them losslessly: with a
+ *   palette if they have 256 or fewer colors, as greyscale if their red,
+ *   green and blue channels are equal, and without alpha if they're opaque.
+ *   The image is loaded back in the matching pixel format rather than the
+ *   format it was saved from. This defaults to false.
+ * - `IMG_PROP_SAVE_THREAD_COUNT_NUMBER`: the number of threads that may be
+ *   used to compress the image, defaults to 1. Large images are filtered and
+ *   compressed in independent blocks of rows on this many threads, and the
+ *   blocks are joined into a single standard PNG data stream.
+ *
+ * If zlib can't be found when libpng is loaded dynamically, the image is
+ * compressed on the calling thread. If SDL_image is built without libpng,
+ * only the file and SDL_IOStream properties are used.
+ *
+ * \param surface the SDL surface to save.
+ * \param props the properties to use.
+ * \returns true on success or false on failure; call SDL_GetError() for more
+ *          information.
+ *
+ * \since This function is available since SDL_image 3.6.0.
+ *
+ * \sa IMG_SavePNG
+ * \sa IMG_SavePNG_IO
+ */
+extern SDL_DECLSPEC bool SDLCALL IMG_SavePNGWithProperties(SDL_Surface *surface, SDL_PropertiesID props);
+
+#define IMG_PROP_SAVE_PNG_COMPRESSION_LEVEL_NUMBER  "SDL_image.save.png.compression_level"
+#define IMG_PROP_SAVE_PNG_FILTER_STRING             "SDL_image.save.png.filter"
+#define IMG_PROP_SAVE_PNG_STRATEGY_STRING           "SDL_image.save.png.strategy"
+#define IMG_PROP_SAVE_PNG_REDUCE_COLORS_BOOLEAN     "SDL_image.save.png.reduce_colors"
+
 /**
  * Save an SDL_Surface into a TGA image file.
  *
@@ -2473,6 +3027,9 @@ typedef struct IMG_Animation
 /**
  * Load an animation from a file.
  *
+ * The file is mapped into memory where the platform allows it, as with
+ * IMG_Load().
+ *
  * When done with the returned animation, the app should dispose of it with a
  * call to IMG_FreeAnimation().
  *
@@ -3174,6 +3731,10 @@ extern SDL_DECLSPEC IMG_AnimationDecoder * SDLCALL IMG_CreateAnimationDecoder_IO
  * - `IMG_PROP_ANIMATION_DECODER_CREATE_TYPE_STRING`: the input file type,
  *   e.g. "webp", defaults to the file extension if
  *   `IMG_PROP_ANIMATION_DECODER_CREATE_FILENAME_STRING` is set.
+ * - `IMG_PROP_ANIMATION_DECODER_CREATE_MAP_FILE_BOOLEAN`: true to map
+ *   `IMG_PROP_ANIMATION_DECODER_CREATE_FILENAME_STRING` into memory where the
+ *   platform allows it, as IMG_Load() does, or false to read it instead,
+ *   defaults to true.
  *
  * \param props the properties of the animation decoder.
  * \returns a new IMG_AnimationDecoder, or NULL on failure; call
@@ -3193,6 +3754,7 @@ extern SDL_DECLSPEC IMG_AnimationDecoder * SDLCALL IMG_CreateAnimationDecoderWit
 #define IMG_PROP_ANIMATION_DECODER_CREATE_IOSTREAM_POINTER               "SDL_image.animation_decoder.create.iostream"
 #define IMG_PROP_ANIMATION_DECODER_CREATE_IOSTREAM_AUTOCLOSE_BOOLEAN     "SDL_image.animation_decoder.create.iostream.autoclose"
 #define IMG_PROP_ANIMATION_DECODER_CREATE_TYPE_STRING                    "SDL_image.animation_decoder.create.type"
+#define IMG_PROP_ANIMATION_DECODER_CREATE_MAP_FILE_BOOLEAN               "SDL_image.animation_decoder.create.map_file"
 #define IMG_PROP_ANIMATION_DECODER_CREATE_TIMEBASE_NUMERATOR_NUMBER      "SDL_image.animation_decoder.create.timebase.numerator"
 #define IMG_PROP_ANIMATION_DECODER_CREATE_TIMEBASE_DENOMINATOR_NUMBER    "SDL_image.animation_decoder.create.timebase.denominator"
 
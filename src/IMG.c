@@ -23,10 +23,25 @@
 
 #include <SDL3_image/SDL_image.h>
 
+#include "IMG.h"
+#include "IMG_utils.h"
+
 #ifdef __EMSCRIPTEN__
 #include <emscripten/emscripten.h>
 #endif
 
+#if defined(SDL_PLATFORM_WINDOWS) && !defined(SDL_PLATFORM_GDK)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#define HAVE_MAPPED_FILES
+#elif defined(SDL_PLATFORM_UNIX) && !defined(SDL_PLATFORM_EMSCRIPTEN)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define HAVE_MAPPED_FILES
+#endif
+
 #ifndef SDL_PROP_SURFACE_FLIP_NUMBER
 #define SDL_PROP_SURFACE_FLIP_NUMBER    "SDL.surface.flip"
 #endif
@@ -40,174 +55,3114 @@ SDL_COMPILE_TIME_ASSERT(SDL_BUILD_MICRO_VERSION,
                         SDL_IMAGE_MICRO_VERSION == SDL_BUILD_MICRO_VERSION);
 #endif
 
-/* Limited by its encoding in SDL_VERSIONNUM */
-SDL_COMPILE_TIME_ASSERT(SDL_IMAGE_MAJOR_VERSION_min, SDL_IMAGE_MAJOR_VERSION >= 0);
-SDL_COMPILE_TIME_ASSERT(SDL_IMAGE_MAJOR_VERSION_max, SDL_IMAGE_MAJOR_VERSION <= 10);
-SDL_COMPILE_TIME_ASSERT(SDL_IMAGE_MINOR_VERSION_min, SDL_IMAGE_MINOR_VERSION >= 0);
-SDL_COMPILE_TIME_ASSERT(SDL_IMAGE_MINOR_VERSION_max, SDL_IMAGE_MINOR_VERSION <= 999);
-SDL_COMPILE_TIME_ASSERT(SDL_IMAGE_MICRO_VERSION_min, SDL_IMAGE_MICRO_VERSION >= 0);
-SDL_COMPILE_TIME_ASSERT(SDL_IMAGE_MICRO_VERSION_max, SDL_IMAGE_MICRO_VERSION <= 999);
+/* Limited by its encoding in SDL_VERSIONNUM */
+SDL_COMPILE_TIME_ASSERT(SDL_IMAGE_MAJOR_VERSION_min, SDL_IMAGE_MAJOR_VERSION >= 0);
+SDL_COMPILE_TIME_ASSERT(SDL_IMAGE_MAJOR_VERSION_max, SDL_IMAGE_MAJOR_VERSION <= 10);
+SDL_COMPILE_TIME_ASSERT(SDL_IMAGE_MINOR_VERSION_min, SDL_IMAGE_MINOR_VERSION >= 0);
+SDL_COMPILE_TIME_ASSERT(SDL_IMAGE_MINOR_VERSION_max, SDL_IMAGE_MINOR_VERSION <= 999);
+SDL_COMPILE_TIME_ASSERT(SDL_IMAGE_MICRO_VERSION_min, SDL_IMAGE_MICRO_VERSION >= 0);
+SDL_COMPILE_TIME_ASSERT(SDL_IMAGE_MICRO_VERSION_max, SDL_IMAGE_MICRO_VERSION <= 999);
+
+/* The amount of data read from the start of an image to detect its format */
+#define IMG_DETECT_SIZE 4096
+
+/* The amount of data kept from the start of a non-seekable stream so it can be rewound */
+#define IMG_REWIND_SIZE (64 * 1024)
+
+static bool DetectAVIFBrand(const Uint8 *brand)
+{
+    return (SDL_memcmp(brand, "avif", 4) == 0 ||
+            SDL_memcmp(brand, "avis", 4) == 0 ||
+            SDL_memcmp(brand, "avio", 4) == 0);
+}
+
+static bool DetectAVIF(const Uint8 *data, size_t size)
+{
+    Uint64 box_size;
+    size_t offset = 8;
+    size_t i;
+
+    if (size < 16 || SDL_memcmp(&data[4], "ftyp", 4) != 0) {
+        return false;
+    }
+
+    box_size = (((Uint64)data[0] << 24) |
+                ((Uint64)data[1] << 16) |
+                ((Uint64)data[2] << 8)  |
+                ((Uint64)data[3] << 0));
+    if (box_size == 1) {
+        /* 64-bit box size */
+        if (size < 24) {
+            return false;
+        }
+        box_size = 0;
+        for (i = 8; i < 16; ++i) {
+            box_size = (box_size << 8) | data[i];
+        }
+        offset = 16;
+    }
+    if (box_size < offset + 8) {
+        return false;
+    }
+    if (box_size > size) {
+        box_size = size;
+    }
+
+    /* Check the major brand, then the compatible brands after the minor version */
+    if (DetectAVIFBrand(&data[offset])) {
+        return true;
+    }
+    for (i = offset + 8; i + 4 <= (size_t)box_size; i += 4) {
+        if (DetectAVIFBrand(&data[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool DetectICOCUR(const Uint8 *data, size_t size, Uint8 type)
+{
+    return (size >= 6 &&
+            data[0] == 0 && data[1] == 0 &&
+            data[2] == type && data[3] == 0 &&
+            (data[4] != 0 || data[5] != 0));
+}
+
+static bool DetectCUR(const Uint8 *data, size_t size)
+{
+    return DetectICOCUR(data, size, 2);
+}
+
+static bool DetectICO(const Uint8 *data, size_t size)
+{
+    return DetectICOCUR(data, size, 1);
+}
+
+static bool DetectBMP(const Uint8 *data, size_t size)
+{
+    return (size >= 2 && data[0] == 'B' && data[1] == 'M');
+}
+
+static bool DetectGIF(const Uint8 *data, size_t size)
+{
+    return (size >= 6 &&
+            SDL_memcmp(data, "GIF", 3) == 0 &&
+            (SDL_memcmp(&data[3], "87a", 3) == 0 ||
+             SDL_memcmp(&data[3], "89a", 3) == 0));
+}
+
+static bool DetectJPG(const Uint8 *data, size_t size)
+{
+    size_t i;
+
+    if (size < 2 || data[0] != 0xFF || data[1] != 0xD8) {
+        return false;
+    }
+
+    /* Walk the markers up to the start of scan, as far as the header window allows */
+    i = 2;
+    while (i + 2 <= size) {
+        Uint8 marker = data[i + 1];
+
+        if (data[i] != 0xFF) {
+            return false;
+        }
+        if (marker == 0xFF) {
+            /* Extra padding in JPEG (legal) */
+            ++i;
+        } else if (marker == 0xD9) {
+            /* Got to end of good JPEG */
+            return true;
+        } else if (marker >= 0xD0 && marker < 0xD9) {
+            /* These have nothing else */
+            i += 2;
+        } else {
+            size_t length;
+
+            if (i + 4 > size) {
+                break;
+            }
+            length = ((size_t)data[i + 2] << 8) | data[i + 3];
+            if (length < 2) {
+                return false;
+            }
+            if (marker == 0xDA) {
+                /* Now comes the actual JPEG meat */
+                return true;
+            }
+            i += 2 + length;
+        }
+    }
+
+    /* A consistent marker chain that runs past the window is a JPEG,
+     * one that runs past the end of the data is truncated.
+     */
+    return (size == IMG_DETECT_SIZE);
+}
+
+static bool DetectJXL(const Uint8 *data, size_t size)
+{
+    static const Uint8 container[12] = {
+        0x00, 0x00, 0x00, 0x0C, 'J', 'X', 'L', ' ', 0x0D, 0x0A, 0x87, 0x0A
+    };
+
+    if (size >= 2 && data[0] == 0xFF && data[1] == 0x0A) {
+        /* This is a JXL codestream */
+        return true;
+    }
+    return (size >= sizeof(container) && SDL_memcmp(data, container, sizeof(container)) == 0);
+}
+
+static bool DetectLBM(const Uint8 *data, size_t size)
+{
+    return (size >= 12 &&
+            SDL_memcmp(data, "FORM", 4) == 0 &&
+            (SDL_memcmp(&data[8], "PBM ", 4) == 0 ||
+             SDL_memcmp(&data[8], "ILBM", 4) == 0));
+}
+
+static bool DetectPCX(const Uint8 *data, size_t size)
+{
+    /* ZSoft manufacturer, PC Paintbrush version 5, uncompressed or RLE encoding,
+     * and at least a full 128 byte header.
+     */
+    return (size >= 128 && data[0] == 10 && data[1] == 5 && (data[2] == 0 || data[2] == 1));
+}
+
+static bool DetectPNG(const Uint8 *data, size_t size)
+{
+    return (size >= 4 && data[0] == 0x89 && data[1] == 'P' && data[2] == 'N' && data[3] == 'G');
+}
+
+static bool DetectPNM(const Uint8 *data, size_t size)
+{
+    return (size >= 2 && data[0] == 'P' && data[1] >= '1' && data[1] <= '6');
+}
+
+static bool DetectSVG(const Uint8 *data, size_t size)
+{
+    size_t i;
+
+    /* Stop at the first NUL byte, as a string search of the header would */
+    for (i = 0; i + 4 <= size && data[i] != '\0'; ++i) {
+        if (data[i] == '<' && SDL_memcmp(&data[i + 1], "svg", 3) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool DetectTIF(const Uint8 *data, size_t size)
+{
+    return (size >= 4 &&
+            ((data[0] == 'I' && data[1] == 'I' && data[2] == 0x2a && data[3] == 0x00) ||
+             (data[0] == 'M' && data[1] == 'M' && data[2] == 0x00 && data[3] == 0x2a)));
+}
+
+static bool DetectXCF(const Uint8 *data, size_t size)
+{
+    return (size >= 14 && SDL_memcmp(data, "gimp xcf ", 9) == 0);
+}
+
+static bool DetectXPM(const Uint8 *data, size_t size)
+{
+    return (size >= 9 && SDL_memcmp(data, "/* XPM */", 9) == 0);
+}
+
+static bool DetectXV(const Uint8 *data, size_t size)
+{
+    size_t start, end;
+    bool dimensions = false;
+
+    if (size < 6 || SDL_memcmp(data, "P7 332", 6) != 0) {
+        return false;
+    }
+
+    /* Skip the magic line and look for the image size after the comments */
+    for (start = 0; start < size; start = end + 1) {
+        for (end = start; end < size && data[end] != '\n'; ++end) {
+        }
+        if (end == size) {
+            break;
+        }
+        if (start == 0) {
+            continue;
+        }
+        if (dimensions) {
+            char line[64];
+            int w = -1, h = -1;
+
+            SDL_memcpy(line, &data[start], SDL_min(end - start, sizeof(line) - 1));
+            line[SDL_min(end - start, sizeof(line) - 1)] = '\0';
+            SDL_sscanf(line, "%d %d", &w, &h);
+            return (w >= 0 && h >= 0);
+        }
+        if (end - start >= 9 && SDL_memcmp(&data[start], "#BUILTIN:", 9) == 0) {
+            /* Builtin image, no data */
+            return false;
+        }
+        if (end - start >= 16 && SDL_memcmp(&data[start], "#END_OF_COMMENTS", 16) == 0) {
+            dimensions = true;
+        }
+    }
+
+    /* The header continues past the window */
+    return (size == IMG_DETECT_SIZE);
+}
+
+static bool DetectWEBP(const Uint8 *data, size_t size)
+{
+    return (size >= 20 &&
+            SDL_memcmp(data, "RIFF", 4) == 0 &&
+            SDL_memcmp(&data[8], "WEBPVP8", 7) == 0 &&
+            (data[15] == ' ' || data[15] == 'X' || data[15] == 'L'));
+}
+
+static bool DetectQOI(const Uint8 *data, size_t size)
+{
+    return (size >= 4 && SDL_memcmp(data, "qoif", 4) == 0);
+}
+
+static bool DetectANI(const Uint8 *data, size_t size)
+{
+    return (size >= 12 &&
+            SDL_memcmp(data, "RIFF", 4) == 0 &&
+            SDL_memcmp(&data[8], "ACON", 4) == 0);
+}
+
+/* Table of image signatures, in the order they should be matched */
+static const struct {
+    const char *format;
+    bool (*detect)(const Uint8 *data, size_t size);
+} signatures[] = {
+    { "AVIF", DetectAVIF },
+    { "CUR",  DetectCUR  },
+    { "ICO",  DetectICO  },
+    { "BMP",  DetectBMP  },
+    { "GIF",  DetectGIF  },
+    { "JPG",  DetectJPG  },
+    { "JXL",  DetectJXL  },
+    { "LBM",  DetectLBM  },
+    { "PCX",  DetectPCX  },
+    { "PNG",  DetectPNG  },
+    { "PNM",  DetectPNM  },
+    { "SVG",  DetectSVG  },
+    { "TIF",  DetectTIF  },
+    { "XCF",  DetectXCF  },
+    { "XPM",  DetectXPM  },
+    { "XV",   DetectXV   },
+    { "WEBP", DetectWEBP },
+    { "QOI",  DetectQOI  },
+    { "ANI",  DetectANI  },
+};
+
+static const char *DetectFormat(const Uint8 *data, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < SDL_arraysize(signatures); ++i) {
+        if (signatures[i].detect(data, size)) {
+            return signatures[i].format;
+        }
+    }
+    SDL_SetError("Unsupported image format");
+    return NULL;
+}
+
+/* Read until the buffer is full or the stream ends, since streams such as
+   pipes and sockets may return less than was asked for */
+static size_t ReadFully(SDL_IOStream *src, void *buf, size_t len)
+{
+    size_t total = 0;
+
+    while (total < len) {
+        size_t amount = SDL_ReadIO(src, (Uint8 *)buf + total, len - total);
+
+        if (amount == 0) {
+            /* End of file, an error, or a non-blocking stream with no more data yet */
+            break;
+        }
+        total += amount;
+    }
+    return total;
+}
+
+/* The number of reads past the header window that a parser may make, so
+   walking the chunks, frames or pages of a large file stays cheap */
+#define IMG_INFO_MAX_READS  64
+
+/* The header window of an image, with bounded reads of the data past it */
+typedef struct
+{
+    SDL_IOStream *src;
+    Sint64 start;
+    size_t size;
+    int reads_left;
+    bool exhausted;     /* a read failed because there were none left */
+    Uint8 data[IMG_DETECT_SIZE];
+} IMG_ImageHeader;
+
+static bool ReadImageHeader(IMG_ImageHeader *header, Uint64 offset, void *buf, size_t len)
+{
+    if (offset <= header->size && len <= header->size - offset) {
+        SDL_memcpy(buf, &header->data[offset], len);
+        return true;
+    }
+    if (header->size < IMG_DETECT_SIZE) {
+        /* The whole image is in the window */
+        return false;
+    }
+    if (header->reads_left <= 0) {
+        header->exhausted = true;
+        return false;
+    }
+    --header->reads_left;
+    if (offset > (Uint64)(SDL_MAX_SINT64 - header->start) ||
+        SDL_SeekIO(header->src, header->start + (Sint64)offset, SDL_IO_SEEK_SET) < 0) {
+        return false;
+    }
+    return (ReadFully(header->src, buf, len) == len);
+}
+
+static Uint16 GetLE16(const Uint8 *data)
+{
+    return (Uint16)((data[1] << 8) | data[0]);
+}
+
+static Uint32 GetLE32(const Uint8 *data)
+{
+    return (((Uint32)data[3] << 24) | ((Uint32)data[2] << 16) | ((Uint32)data[1] << 8) | data[0]);
+}
+
+static Uint16 GetBE16(const Uint8 *data)
+{
+    return (Uint16)((data[0] << 8) | data[1]);
+}
+
+static Uint32 GetBE32(const Uint8 *data)
+{
+    return (((Uint32)data[0] << 24) | ((Uint32)data[1] << 16) | ((Uint32)data[2] << 8) | data[3]);
+}
+
+static SDL_PixelFormat GetRGBPixelFormat(int bit_depth, bool has_alpha)
+{
+    if (bit_depth <= 8) {
+        return has_alpha ? SDL_PIXELFORMAT_RGBA32 : SDL_PIXELFORMAT_RGB24;
+    } else if (bit_depth <= 16) {
+        return has_alpha ? SDL_PIXELFORMAT_RGBA64 : SDL_PIXELFORMAT_RGB48;
+    } else {
+        return has_alpha ? SDL_PIXELFORMAT_RGBA128_FLOAT : SDL_PIXELFORMAT_RGB96_FLOAT;
+    }
+}
+
+static bool SetImageInfo(SDL_PropertiesID props, Sint64 width, Sint64 height, int bit_depth, bool has_alpha, SDL_PixelFormat format)
+{
+    if (width <= 0 || height <= 0) {
+        return SDL_SetError("Invalid image dimensions %" SDL_PRIs64 "x%" SDL_PRIs64, width, height);
+    }
+
+    SDL_SetNumberProperty(props, IMG_PROP_IMAGE_INFO_WIDTH_NUMBER, width);
+    SDL_SetNumberProperty(props, IMG_PROP_IMAGE_INFO_HEIGHT_NUMBER, height);
+    if (bit_depth > 0) {
+        SDL_SetNumberProperty(props, IMG_PROP_IMAGE_INFO_BIT_DEPTH_NUMBER, bit_depth);
+    }
+    SDL_SetBooleanProperty(props, IMG_PROP_IMAGE_INFO_HAS_ALPHA_BOOLEAN, has_alpha);
+    if (format != SDL_PIXELFORMAT_UNKNOWN) {
+        SDL_SetNumberProperty(props, IMG_PROP_IMAGE_INFO_PIXEL_FORMAT_NUMBER, format);
+    }
+    return true;
+}
+
+static void SetImageOrientation(SDL_PropertiesID props, int orientation)
+{
+    if (orientation >= 1 && orientation <= 8) {
+        SDL_SetNumberProperty(props, IMG_PROP_IMAGE_INFO_ORIENTATION_NUMBER, orientation);
+    }
+}
+
+static void SetImageFrames(SDL_PropertiesID props, bool animated, Uint32 frame_count)
+{
+    SDL_SetBooleanProperty(props, IMG_PROP_IMAGE_INFO_ANIMATED_BOOLEAN, animated);
+    if (frame_count > 0) {
+        SDL_SetNumberProperty(props, IMG_PROP_IMAGE_INFO_FRAME_COUNT_NUMBER, frame_count);
+    }
+}
+
+/* The fields of the first image file directory of a TIFF structure */
+typedef struct
+{
+    Uint32 width;
+    Uint32 height;
+    Uint32 bits_per_sample;
+    Uint32 samples_per_pixel;
+    Uint32 extra_samples;
+    Uint32 orientation;
+    Uint32 pages;
+} IMG_TIFFInfo;
+
+#define TIFF_MAX_ENTRIES    256
+#define TIFF_MAX_PAGES      65535
+
+static Uint16 GetTIFF16(const Uint8 *data, bool big_endian)
+{
+    return big_endian ? GetBE16(data) : GetLE16(data);
+}
+
+static Uint32 GetTIFF32(const Uint8 *data, bool big_endian)
+{
+    return big_endian ? GetBE32(data) : GetLE32(data);
+}
+
+static bool GetTIFFValue(IMG_ImageHeader *header, Uint64 base, const Uint8 *entry, bool big_endian, Uint32 *value)
+{
+    Uint16 type = GetTIFF16(&entry[2], big_endian);
+    Uint32 count = GetTIFF32(&entry[4], big_endian);
+    Uint8 data[2];
+
+    switch (type) {
+    case 3: /* SHORT */
+        if (count > 2) {
+            /* The values don't fit in the entry, use the first one */
+            if (!ReadImageHeader(header, base + GetTIFF32(&entry[8], big_endian), data, sizeof(data))) {
+                return false;
+            }
+            *value = GetTIFF16(data, big_endian);
+        } else {
+            *value = GetTIFF16(&entry[8], big_endian);
+        }
+        return true;
+    case 4: /* LONG */
+        *value = GetTIFF32(&entry[8], big_endian);
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool GetTIFFInfo(IMG_ImageHeader *header, Uint64 base, bool count_pages, IMG_TIFFInfo *info)
+{
+    Uint8 data[8];
+    Uint8 entries[TIFF_MAX_ENTRIES * 12];
+    bool big_endian;
+    Uint64 ifd;
+    Uint16 num_entries, count, i;
+
+    SDL_zerop(info);
+
+    if (!ReadImageHeader(header, base, data, 8)) {
+        return false;
+    }
+    if (data[0] == 'I' && data[1] == 'I' && data[2] == 0x2a && data[3] == 0x00) {
+        big_endian = false;
+    } else if (data[0] == 'M' && data[1] == 'M' && data[2] == 0x00 && data[3] == 0x2a) {
+        big_endian = true;
+    } else {
+        return false;
+    }
+
+    ifd = GetTIFF32(&data[4], big_endian);
+    if (!ReadImageHeader(header, base + ifd, data, 2)) {
+        return false;
+    }
+    num_entries = GetTIFF16(data, big_endian);
+    count = num_entries;
+    if (count > TIFF_MAX_ENTRIES) {
+        count = TIFF_MAX_ENTRIES;
+    }
+    if (!ReadImageHeader(header, base + ifd + 2, entries, count * 12)) {
+        return false;
+    }
+
+    for (i = 0; i < count; ++i) {
+        const Uint8 *entry = &entries[i * 12];
+
+        switch (GetTIFF16(entry, big_endian)) {
+        case 256: /* ImageWidth */
+            GetTIFFValue(header, base, entry, big_endian, &info->width);
+            break;
+        case 257: /* ImageLength */
+            GetTIFFValue(header, base, entry, big_endian, &info->height);
+            break;
+        case 258: /* BitsPerSample */
+            GetTIFFValue(header, base, entry, big_endian, &info->bits_per_sample);
+            break;
+        case 274: /* Orientation */
+            GetTIFFValue(header, base, entry, big_endian, &info->orientation);
+            break;
+        case 277: /* SamplesPerPixel */
+            GetTIFFValue(header, base, entry, big_endian, &info->samples_per_pixel);
+            break;
+        case 338: /* ExtraSamples */
+            info->extra_samples = GetTIFF32(&entry[4], big_endian);
+            break;
+        default:
+            break;
+        }
+    }
+    info->pages = 1;
+
+    if (count_pages) {
+        /* Follow the chain of directories, reading only their offsets */
+        Uint64 next = ifd + 2 + (Uint64)num_entries * 12;
+
+        while (info->pages < TIFF_MAX_PAGES && ReadImageHeader(header, base + next, data, 4)) {
+            ifd = GetTIFF32(data, big_endian);
+            if (ifd == 0 || !ReadImageHeader(header, base + ifd, data, 2)) {
+                break;
+            }
+            ++info->pages;
+            next = ifd + 2 + (Uint64)GetTIFF16(data, big_endian) * 12;
+        }
+        if (header->exhausted) {
+            /* There are too many pages to count cheaply */
+            info->pages = 0;
+        }
+    }
+    return true;
+}
+
+static int GetExifOrientation(IMG_ImageHeader *header, Uint64 offset, Uint64 size)
+{
+    IMG_TIFFInfo info;
+    Uint8 data[6];
+
+    /* The Exif identifier is optional in PNG and WebP, and required in JPEG */
+    if (size >= 6 && ReadImageHeader(header, offset, data, 6) && SDL_memcmp(data, "Exif\0\0", 6) == 0) {
+        offset += 6;
+    }
+    if (!GetTIFFInfo(header, offset, false, &info)) {
+        return 0;
+    }
+    return (int)info.orientation;
+}
+
+static bool GetAVIFBox(IMG_ImageHeader *header, Uint64 offset, Uint64 end, const char *type, Uint64 *box_offset, Uint64 *box_end)
+{
+    Uint8 data[16];
+
+    while (offset + 8 <= end && ReadImageHeader(header, offset, data, 8)) {
+        Uint64 size = GetBE32(data);
+        Uint64 data_offset = offset + 8;
+
+        if (size == 1) {
+            /* 64-bit box size */
+            if (!ReadImageHeader(header, offset + 8, &data[8], 8)) {
+                return false;
+            }
+            size = ((Uint64)GetBE32(&data[8]) << 32) | GetBE32(&data[12]);
+            data_offset += 8;
+        } else if (size == 0) {
+            /* The box extends to the end of the file */
+            size = end - offset;
+        }
+        if (size < data_offset - offset || size > end - offset) {
+            return false;
+        }
+        if (SDL_memcmp(&data[4], type, 4) == 0) {
+            *box_offset = data_offset;
+            *box_end = offset + size;
+            return true;
+        }
+        offset += size;
+    }
+    return false;
+}
+
+static bool GetAVIFInfo(IMG_ImageHeader *header, SDL_PropertiesID props)
+{
+    Uint8 data[16];
+    Uint64 offset, end;
+    Uint64 meta, meta_end, iprp, iprp_end, ipco, ipco_end;
+    Sint64 width = 0, height = 0;
+    int bit_depth = 0;
+    bool has_alpha = false;
+    bool animated = false;
+
+    /* The image sequence brand marks an animation */
+    if (GetAVIFBox(header, 0, SDL_MAX_UINT64, "ftyp", &offset, &end)) {
+        for ( ; offset + 4 <= end && ReadImageHeader(header, offset, data, 4); offset += 4) {
+            if (SDL_memcmp(data, "avis", 4) == 0) {
+                animated = true;
+                break;
+            }
+        }
+    }
+
+    /* The item properties are in meta/iprp/ipco */
+    if (!GetAVIFBox(header, 0, SDL_MAX_UINT64, "meta", &meta, &meta_end) ||
+        !GetAVIFBox(header, meta + 4, meta_end, "iprp", &iprp, &iprp_end) ||
+        !GetAVIFBox(header, iprp, iprp_end, "ipco", &ipco, &ipco_end)) {
+        return SDL_SetError("Couldn't find AVIF item properties");
+    }
+
+    offset = ipco;
+    while (GetAVIFBox(header, offset, ipco_end, "ispe", &offset, &end)) {
+        if (!ReadImageHeader(header, offset, data, 12)) {
+            break;
+        }
+        if (width == 0) {
+            width = GetBE32(&data[4]);
+            height = GetBE32(&data[8]);
+        }
+        offset = end;
+    }
+
+    if (GetAVIFBox(header, ipco, ipco_end, "pixi", &offset, &end) &&
+        ReadImageHeader(header, offset, data, 6) && data[4] > 0) {
+        bit_depth = data[5];
+    }
+
+    offset = ipco;
+    while (GetAVIFBox(header, offset, ipco_end, "auxC", &offset, &end)) {
+        char aux_type[64];
+        size_t len = (size_t)SDL_min(end - offset - 4, sizeof(aux_type) - 1);
+
+        if (end - offset > 4 && ReadImageHeader(header, offset + 4, aux_type, len)) {
+            aux_type[len] = '\0';
+            if (SDL_strstr(aux_type, ":alpha") != NULL) {
+                has_alpha = true;
+                break;
+            }
+        }
+        offset = end;
+    }
+
+    if (!SetImageInfo(props, width, height, bit_depth, has_alpha, bit_depth > 0 ? GetRGBPixelFormat(bit_depth, has_alpha) : SDL_PIXELFORMAT_UNKNOWN)) {
+        return false;
+    }
+    SetImageFrames(props, animated, 0);
+    return true;
+}
+
+static bool GetICOCURInfo(IMG_ImageHeader *header, Uint64 base, Uint8 type, SDL_PropertiesID props)
+{
+    Uint8 data[16];
+    Uint16 count, i;
+    int width = 0, height = 0, bit_count = 0;
+
+    if (!ReadImageHeader(header, base, data, 6) || data[2] != type) {
+        return SDL_SetError("Couldn't read icon directory");
+    }
+
+    count = GetLE16(&data[4]);
+    for (i = 0; i < count; ++i) {
+        int w, h;
+
+        if (!ReadImageHeader(header, base + 6 + i * 16, data, 16)) {
+            break;
+        }
+        w = data[0] ? data[0] : 256;
+        h = data[1] ? data[1] : 256;
+        if (i == 0 || (type == 2 && w == 32 && h == 32)) {
+            /* Windows defaults to 32x32 pixel cursors, otherwise the first icon is used */
+            width = w;
+            height = h;
+            bit_count = (type == 1) ? GetLE16(&data[6]) : 0;
+        }
+    }
+
+    return SetImageInfo(props, width, height, (bit_count > 0 && bit_count <= 8) ? bit_count : 8, true, SDL_PIXELFORMAT_ARGB8888);
+}
+
+static bool GetCURInfo(IMG_ImageHeader *header, SDL_PropertiesID props)
+{
+    return GetICOCURInfo(header, 0, 2, props);
+}
+
+static bool GetICOInfo(IMG_ImageHeader *header, SDL_PropertiesID props)
+{
+    return GetICOCURInfo(header, 0, 1, props);
+}
+
+static bool GetBMPInfo(IMG_ImageHeader *header, SDL_PropertiesID props)
+{
+    Uint8 data[70];
+    Uint32 header_size, compression = 0;
+    Sint64 width, height;
+    int bit_count;
+    bool has_alpha = false;
+    SDL_PixelFormat format;
+
+    if (!ReadImageHeader(header, 0, data, 26)) {
+        return SDL_SetError("Couldn't read BMP header");
+    }
+
+    header_size = GetLE32(&data[14]);
+    if (header_size == 12) {
+        /* OS/2 BMP header */
+        width = GetLE16(&data[18]);
+        height = GetLE16(&data[20]);
+        bit_count = GetLE16(&data[24]);
+    } else if (header_size >= 40) {
+        size_t len = (header_size >= 56) ? 70 : 54;
+
+        if (!ReadImageHeader(header, 0, data, len)) {
+            return SDL_SetError("Couldn't read BMP header");
+        }
+        width = (Sint32)GetLE32(&data[18]);
+        height = (Sint32)GetLE32(&data[22]);
+        if (height < 0) {
+            /* Top-down bitmap */
+            height = -height;
+        }
+        bit_count = GetLE16(&data[28]);
+        compression = GetLE32(&data[30]);
+        if (bit_count == 32) {
+            if (header_size >= 56) {
+                has_alpha = (GetLE32(&data[66]) != 0);
+            } else {
+                has_alpha = (compression == 0);
+            }
+        }
+    } else {
+        return SDL_SetError("Unsupported BMP header size %" SDL_PRIu32, header_size);
+    }
+
+    switch (bit_count) {
+    case 1:
+        format = SDL_PIXELFORMAT_INDEX1MSB;
+        break;
+    case 4:
+        format = SDL_PIXELFORMAT_INDEX4MSB;
+        break;
+    case 8:
+        format = SDL_PIXELFORMAT_INDEX8;
+        break;
+    case 16:
+        format = SDL_PIXELFORMAT_XRGB1555;
+        break;
+    case 24:
+        format = SDL_PIXELFORMAT_BGR24;
+        break;
+    case 32:
+        format = has_alpha ? SDL_PIXELFORMAT_ARGB8888 : SDL_PIXELFORMAT_XRGB8888;
+        break;
+    default:
+        format = SDL_PIXELFORMAT_UNKNOWN;
+        break;
+    }
+    if (compression == 3 && bit_count == 16) {
+        /* The bitfields could describe any 16-bit layout */
+        format = SDL_PIXELFORMAT_UNKNOWN;
+    }
+
+    return SetImageInfo(props, width, height, (bit_count <= 8) ? bit_count : (bit_count == 16) ? 5 : 8, has_alpha, format);
+}
+
+static bool GetGIFInfo(IMG_ImageHeader *header, SDL_PropertiesID props)
+{
+    Uint8 data[16];
+    Uint64 offset;
+    int width, height, bit_depth;
+    bool has_alpha = false;
+    bool animated = false;
+    bool complete = false;
+    Uint32 frame_count = 0;
+
+    if (!ReadImageHeader(header, 0, data, 13)) {
+        return SDL_SetError("Couldn't read GIF header");
+    }
+
+    width = GetLE16(&data[6]);
+    height = GetLE16(&data[8]);
+    bit_depth = (data[10] & 0x07) + 1;
+    offset = 13;
+    if (data[10] & 0x80) {
+        /* Skip the global color table */
+        offset += 3 * (1 << bit_depth);
+    }
+
+    /* Walk the blocks to the trailer, counting the images */
+    while (ReadImageHeader(header, offset, data, 1)) {
+        if (data[0] == 0x3B) {
+            /* Trailer */
+            complete = true;
+            break;
+        } else if (data[0] == 0x2C) {
+            /* Image descriptor, followed by the color table and the image data */
+            Uint8 flags;
+
+            if (!ReadImageHeader(header, offset, data, 10)) {
+                break;
+            }
+            flags = data[9];
+            offset += 10;
+            if (flags & 0x80) {
+                offset += 3 * (1 << ((flags & 0x07) + 1));
+            }
+            ++offset;
+            ++frame_count;
+        } else if (data[0] != 0x21 || !ReadImageHeader(header, offset, data, 2)) {
+            break;
+        } else {
+            Uint8 label = data[1];
+
+            offset += 2;
+            if (label == 0xF9) {
+                /* Graphic control extension, the transparency of the first image is what's loaded */
+                if (frame_count == 0 && ReadImageHeader(header, offset, data, 2) && data[0] >= 1 && (data[1] & 0x01)) {
+                    has_alpha = true;
+                }
+            } else if (label == 0xFF) {
+                /* Application extension */
+                if (ReadImageHeader(header, offset, data, 12) && data[0] == 11 &&
+                    (SDL_memcmp(&data[1], "NETSCAPE2.0", 11) == 0 ||
+                     SDL_memcmp(&data[1], "ANIMEXTS1.0", 11) == 0)) {
+                    animated = true;
+                }
+            }
+        }
+
+        /* Skip the data sub-blocks */
+        while (ReadImageHeader(header, offset, data, 1) && data[0] != 0) {
+            offset += 1 + data[0];
+        }
+        ++offset;
+    }
+    if (!complete) {
+        /* The file is truncated or has too many frames to count cheaply */
+        frame_count = 0;
+    }
+
+    if (!SetImageInfo(props, width, height, bit_depth, has_alpha, SDL_PIXELFORMAT_INDEX8)) {
+        return false;
+    }
+    SetImageFrames(props, (animated || frame_count > 1), frame_count);
+    return true;
+}
+
+static bool GetJPGInfo(IMG_ImageHeader *header, SDL_PropertiesID props)
+{
+    Uint8 data[8];
+    Uint64 offset = 2;
+    int orientation = 0;
+
+    /* Walk the markers up to the start of frame */
+    while (ReadImageHeader(header, offset, data, 2) && data[0] == 0xFF) {
+        Uint8 marker = data[1];
+        Uint16 length;
+
+        if (marker == 0xFF) {
+            /* Extra padding in JPEG (legal) */
+            ++offset;
+            continue;
+        }
+        if (marker == 0xD9 || marker == 0xDA) {
+            /* End of image or start of scan without a frame header */
+            break;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker < 0xD9)) {
+            /* These have nothing else */
+            offset += 2;
+            continue;
+        }
+
+        if (!ReadImageHeader(header, offset + 2, data, 2)) {
+            break;
+        }
+        length = GetBE16(data);
+        if (length < 2) {
+            break;
+        }
+
+        if (marker == 0xE1 && orientation == 0) {
+            /* APP1, possibly with Exif data */
+            orientation = GetExifOrientation(header, offset + 4, length - 2);
+        } else if (marker >= 0xC0 && marker <= 0xCF &&
+                   marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            /* Start of frame */
+            if (length < 8 || !ReadImageHeader(header, offset + 4, data, 6)) {
+                break;
+            }
+            if (!SetImageInfo(props, GetBE16(&data[3]), GetBE16(&data[1]), data[0], false, SDL_PIXELFORMAT_RGB24)) {
+                return false;
+            }
+            SetImageOrientation(props, orientation);
+            return true;
+        }
+        offset += 2 + length;
+    }
+    return SDL_SetError("Couldn't find JPEG frame header");
+}
+
+static bool GetJXLInfo(IMG_ImageHeader *header, SDL_PropertiesID props)
+{
+    int width, height, bit_depth, orientation;
+    bool has_alpha, animated;
+
+    if (!IMG_GetJXLInfo(header->data, header->size, &width, &height, &bit_depth, &has_alpha, &orientation, &animated)) {
+        return false;
+    }
+    if (!SetImageInfo(props, width, height, bit_depth, has_alpha, GetRGBPixelFormat(bit_depth, has_alpha))) {
+        return false;
+    }
+    SetImageOrientation(props, orientation);
+    SetImageFrames(props, animated, 0);
+    return true;
+}
+
+static bool GetLBMInfo(IMG_ImageHeader *header, SDL_PropertiesID props)
+{
+    Uint8 data[20];
+    Uint64 offset = 12;
+
+    /* Walk the chunks up to the bitmap header */
+    while (ReadImageHeader(header, offset, data, 8)) {
+        Uint32 size = GetBE32(&data[4]);
+
+        if (SDL_memcmp(data, "BMHD", 4) == 0) {
+            int planes;
+
+            if (size < 20 || !ReadImageHeader(header, offset + 8, data, 20)) {
+                break;
+            }
+            planes = data[8];
+            return SetImageInfo(props, GetBE16(&data[0]), GetBE16(&data[2]),
+                                (planes == 24) ? 8 : planes, false,
+                                (planes == 24) ? SDL_PIXELFORMAT_RGB24 : SDL_PIXELFORMAT_INDEX8);
+        }
+        offset += 8 + size + (size & 1);
+    }
+    return SDL_SetError("Couldn't find LBM bitmap header");
+}
+
+static bool GetPCXInfo(IMG_ImageHeader *header, SDL_PropertiesID props)
+{
+    const Uint8 *data = header->data;
+    Sint64 width = (Sint64)GetLE16(&data[8]) - GetLE16(&data[4]) + 1;
+    Sint64 height = (Sint64)GetLE16(&data[10]) - GetLE16(&data[6]) + 1;
+    int bits = data[3] * data[65];
+
+    /* The header was checked for its full size during detection */
+    return SetImageInfo(props, width, height, data[3], false,
+                        (bits == 24) ? SDL_PIXELFORMAT_RGB24 : SDL_PIXELFORMAT_INDEX8);
+}
+
+static bool GetPNGInfo(IMG_ImageHeader *header, SDL_PropertiesID props)
+{
+    Uint8 data[16];
+    Uint64 offset = 8;
+    bool found_header = false;
+    int width = 0, height = 0, bit_depth = 0, color_type = 0;
+    bool has_alpha = false;
+    Uint32 frame_count = 0;
+    int orientation = 0;
+    SDL_PixelFormat format;
+
+    /* Walk the chunks up to the image data */
+    while (ReadImageHeader(header, offset, data, 8)) {
+        Uint32 length = GetBE32(data);
+
+        if (SDL_memcmp(&data[4], "IHDR", 4) == 0) {
+            if (length < 13 || !ReadImageHeader(header, offset + 8, data, 13)) {
+                break;
+            }
+            width = (int)GetBE32(&data[0]);
+            height = (int)GetBE32(&data[4]);
+            bit_depth = data[8];
+            color_type = data[9];
+            found_header = true;
+        } else if (SDL_memcmp(&data[4], "acTL", 4) == 0) {
+            if (length >= 8 && ReadImageHeader(header, offset + 8, data, 4)) {
+                frame_count = GetBE32(data);
+            }
+        } else if (SDL_memcmp(&data[4], "tRNS", 4) == 0) {
+            has_alpha = true;
+        } else if (SDL_memcmp(&data[4], "eXIf", 4) == 0) {
+            orientation = GetExifOrientation(header, offset + 8, length);
+        } else if (SDL_memcmp(&data[4], "IDAT", 4) == 0 ||
+                   SDL_memcmp(&data[4], "IEND", 4) == 0) {
+            break;
+        }
+        offset += 12 + (Uint64)length;
+    }
+
+    if (!found_header) {
+        return SDL_SetError("Couldn't find PNG image header");
+    }
+
+    switch (color_type) {
+    case 0: /* Gray */
+        format = (bit_depth <= 8) ? SDL_PIXELFORMAT_INDEX8 : SDL_PIXELFORMAT_UNKNOWN;
+        break;
+    case 2: /* RGB */
+    case 6: /* RGB + alpha */
+        if (color_type == 6) {
+            has_alpha = true;
+        }
+        format = GetRGBPixelFormat(bit_depth, has_alpha);
+        break;
+    case 3: /* Palette */
+        switch (bit_depth) {
+        case 1:
+            format = SDL_PIXELFORMAT_INDEX1MSB;
+            break;
+        case 2:
+            format = SDL_PIXELFORMAT_INDEX2MSB;
+            break;
+        case 4:
+            format = SDL_PIXELFORMAT_INDEX4MSB;
+            break;
+        default:
+            format = SDL_PIXELFORMAT_INDEX8;
+            break;
+        }
+        break;
+    case 4: /* Gray + alpha */
+        has_alpha = true;
+        format = SDL_PIXELFORMAT_UNKNOWN;
+        break;
+    default:
+        format = SDL_PIXELFORMAT_UNKNOWN;
+        break;
+    }
+
+    if (!SetImageInfo(props, width, height, bit_depth, has_alpha, format)) {
+        return false;
+    }
+    SetImageOrientation(props, orientation);
+    SetImageFrames(props, (frame_count > 1), frame_count);
+    return true;
+}
+
+/* Read the next whitespace separated token of a text header, skipping comments */
+static bool GetTextHeaderNumber(const Uint8 *data, size_t size, size_t *offset, int *value)
+{
+    size_t i = *offset;
+    int number = 0;
+
+    for ( ; ; ) {
+        while (i < size && SDL_isspace(data[i])) {
+            ++i;
+        }
+        if (i < size && data[i] == '#') {
+            while (i < size && data[i] != '\n' && data[i] != '\r') {
+                ++i;
+            }
+            continue;
+        }
+        break;
+    }
+
+    if (i >= size || !SDL_isdigit(data[i])) {
+        return false;
+    }
+    while (i < size && SDL_isdigit(data[i])) {
+        if (number > (SDL_MAX_SINT32 - 9) / 10) {
+            return false;
+        }
+        number = number * 10 + (data[i] - '0');
+        ++i;
+    }
+    *offset = i;
+    *value = number;
+    return true;
+}
+
+static bool GetPNMInfo(IMG_ImageHeader *header, SDL_PropertiesID props)
+{
+    char kind = (char)header->data[1];
+    size_t offset = 2;
+    int width, height, maxval = 1;
+    int bit_depth;
+
+    if (!GetTextHeaderNumber(header->data, header->size, &offset, &width) ||
+        !GetTextHeaderNumber(header->data, header->size, &offset, &height) ||
+        (kind != '1' && kind != '4' &&
+         !GetTextHeaderNumber(header->data, header->size, &offset, &maxval))) {
+        return SDL_SetError("Couldn't read PNM header");
+    }
+
+    bit_depth = (maxval <= 1) ? 1 : (maxval <= 255) ? 8 : 16;
+    if (kind == '3' || kind == '6') {
+        return SetImageInfo(props, width, height, bit_depth, false, GetRGBPixelFormat(bit_depth, false));
+    }
+    return SetImageInfo(props, width, height, bit_depth, false, SDL_PIXELFORMAT_INDEX8);
+}
+
+static bool GetQOIInfo(IMG_ImageHeader *header, SDL_PropertiesID props)
+{
+    Uint8 data[14];
+
+    if (!ReadImageHeader(header, 0, data, sizeof(data))) {
+        return SDL_SetError("Couldn't read QOI header");
+    }
+    return SetImageInfo(props, GetBE32(&data[4]), GetBE32(&data[8]), 8, (data[12] == 4),
+                        (data[12] == 4) ? SDL_PIXELFORMAT_RGBA32 : SDL_PIXELFORMAT_RGB24);
+}
+
+/* Parse an SVG length in pixels, ignoring lengths in other units */
+static bool GetSVGLength(const char *text, float *value)
+{
+    char *end;
+
+    *value = (float)SDL_strtod(text, &end);
+    if (end == text || *value <= 0.0f) {
+        return false;
+    }
+    return (*end == '"' || *end == '\'' || SDL_strncmp(end, "px", 2) == 0);
+}
+
+/* Find the value of an attribute in an SVG tag */
+static const char *GetSVGAttribute(const char *tag, const char *name)
+{
+    size_t len = SDL_strlen(name);
+    const char *attr;
+
+    for (attr = SDL_strstr(tag, name); attr; attr = SDL_strstr(attr + len, name)) {
+        if (SDL_isspace(attr[-1]) && attr[len] == '=' && (attr[len + 1] == '"' || attr[len + 1] == '\'')) {
+            return &attr[len + 2];
+        }
+    }
+    return NULL;
+}
+
+static bool GetSVGInfo(IMG_ImageHeader *header, SDL_PropertiesID props)
+{
+    char text[IMG_DETECT_SIZE + 1];
+    char *tag, *end;
+    const char *attr;
+    float width = 0.0f, height = 0.0f;
+
+    SDL_memcpy(text, header->data, header->size);
+    text[header->size] = '\0';
+
+    /* The detection guarantees the start of the svg tag is in the window */
+    for (tag = text; (size_t)(tag - text) < header->size; ++tag) {
+        if (SDL_strncmp(tag, "<svg", 4) == 0) {
+            break;
+        }
+    }
+    end = SDL_strchr(tag, '>');
+    if ((size_t)(tag - text) >= header->size || !end) {
+        return SDL_SetError("Couldn't read SVG header");
+    }
+    *end = '\0';
+
+    if ((attr = GetSVGAttribute(tag, "width")) != NULL) {
+        GetSVGLength(attr, &width);
+    }
+    if ((attr = GetSVGAttribute(tag, "height")) != NULL) {
+        GetSVGLength(attr, &height);
+    }
+    if ((width <= 0.0f || height <= 0.0f) && (attr = GetSVGAttribute(tag, "viewBox")) != NULL) {
+        float x, y, w, h;
+
+        if (SDL_sscanf(attr, "%f%*[ ,]%f%*[ ,]%f%*[ ,]%f", &x, &y, &w, &h) == 4) {
+            width = w;
+            height = h;
+        }
+    }
+
+    return SetImageInfo(props, (Sint64)SDL_ceilf(width), (Sint64)SDL_ceilf(height), 8, true, SDL_PIXELFORMAT_RGBA32);
+}
+
+static bool GetTIFInfo(IMG_ImageHeader *header, SDL_PropertiesID props)
+{
+    IMG_TIFFInfo info;
+    bool has_alpha;
+    SDL_PixelFormat format = SDL_PIXELFORMAT_UNKNOWN;
+
+    if (!GetTIFFInfo(header, 0, true, &info)) {
+        return SDL_SetError("Couldn't read TIFF directory");
+    }
+
+    if (info.bits_per_sample == 0) {
+        info.bits_per_sample = 1;
+    }
+    if (info.samples_per_pixel == 0) {
+        info.samples_per_pixel = 1;
+    }
+    has_alpha = (info.extra_samples > 0);
+    if (info.samples_per_pixel >= 3) {
+        format = GetRGBPixelFormat((int)info.bits_per_sample, has_alpha);
+    }
+
+    if (!SetImageInfo(props, info.width, info.height, (int)info.bits_per_sample, has_alpha, format)) {
+        return false;
+    }
+    SetImageOrientation(props, (int)info.orientation);
+    SetImageFrames(props, false, info.pages);
+    return true;
+}
+
+static bool GetXCFInfo(IMG_ImageHeader *header, SDL_PropertiesID props)
+{
+    Uint8 data[8];
+
+    if (!ReadImageHeader(header, 14, data, sizeof(data))) {
+        return SDL_SetError("Couldn't read XCF header");
+    }
+    return SetImageInfo(props, GetBE32(&data[0]), GetBE32(&data[4]), 0, true, SDL_PIXELFORMAT_UNKNOWN);
+}
+
+static bool GetXPMInfo(IMG_ImageHeader *header, SDL_PropertiesID props)
+{
+    const Uint8 *data = header->data;
+    size_t offset;
+
+    /* The values are in the first string of the image array */
+    for (offset = 9; offset < header->size && data[offset] != '"'; ++offset) {
+        if (data[offset] == '/' && offset + 1 < header->size && data[offset + 1] == '*') {
+            /* Skip comments, which may contain quotes */
+            for (offset += 2; offset + 1 < header->size; ++offset) {
+                if (data[offset] == '*' && data[offset + 1] == '/') {
+                    ++offset;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (offset < header->size) {
+        int width, height;
+
+        ++offset;
+        if (GetTextHeaderNumber(data, header->size, &offset, &width) &&
+            GetTextHeaderNumber(data, header->size, &offset, &height)) {
+            return SetImageInfo(props, width, height, 0, false, SDL_PIXELFORMAT_UNKNOWN);
+        }
+    }
+    return SDL_SetError("Couldn't read XPM header");
+}
+
+static bool GetXVInfo(IMG_ImageHeader *header, SDL_PropertiesID props)
+{
+    const Uint8 *data = header->data;
+    size_t offset = 0;
+    bool found = false;
+    int width, height;
+
+    /* The image size follows the end of the comments */
+    while (offset + 16 <= header->size) {
+        if (SDL_memcmp(&data[offset], "#END_OF_COMMENTS", 16) == 0) {
+            found = true;
+            break;
+        }
+        ++offset;
+    }
+    offset += 16;
+
+    if (!found ||
+        !GetTextHeaderNumber(data, header->size, &offset, &width) ||
+        !GetTextHeaderNumber(data, header->size, &offset, &height)) {
+        return SDL_SetError("Couldn't read XV header");
+    }
+    return SetImageInfo(props, width, height, 0, false, SDL_PIXELFORMAT_RGB332);
+}
+
+static bool GetWEBPInfo(IMG_ImageHeader *header, SDL_PropertiesID props)
+{
+    const Uint8 *data = header->data;
+    Sint64 width, height;
+    bool has_alpha = false;
+    bool animated = false;
+    Uint32 frame_count = 0;
+    int orientation = 0;
+
+    if (data[15] == 'X') {
+        Uint8 flags;
+        Uint64 offset;
+        Uint8 chunk[8];
+
+        /* Extended format, with the canvas size in the VP8X chunk */
+        if (header->size < 30) {
+            return SDL_SetError("Couldn't read WEBP header");
+        }
+        flags = data[20];
+        has_alpha = (flags & 0x10) ? true : false;
+        animated = (flags & 0x02) ? true : false;
+        width = 1 + (Sint64)(data[24] | (data[25] << 8) | (data[26] << 16));
+        height = 1 + (Sint64)(data[27] | (data[28] << 8) | (data[29] << 16));
+
+        if (animated || (flags & 0x08)) {
+            /* Walk the chunk headers to count the frames and find the Exif data */
+            offset = 12;
+            while (ReadImageHeader(header, offset, chunk, sizeof(chunk))) {
+                Uint32 size = GetLE32(&chunk[4]);
+
+                if (SDL_memcmp(chunk, "ANMF", 4) == 0) {
+                    ++frame_count;
+                } else if (SDL_memcmp(chunk, "EXIF", 4) == 0) {
+                    orientation = GetExifOrientation(header, offset + 8, size);
+                }
+                offset += 8 + (Uint64)size + (size & 1);
+            }
+            if (header->exhausted) {
+                /* There are too many frames to count cheaply */
+                frame_count = 0;
+            }
+        }
+    } else if (data[15] == 'L') {
+        /* Lossless format, with the size in the bitstream header */
+        Uint32 bits;
+
+        if (header->size < 25 || data[20] != 0x2f) {
+            return SDL_SetError("Couldn't read WEBP header");
+        }
+        bits = GetLE32(&data[21]);
+        width = 1 + (Sint64)(bits & 0x3FFF);
+        height = 1 + (Sint64)((bits >> 14) & 0x3FFF);
+        has_alpha = ((bits >> 28) & 1) ? true : false;
+    } else {
+        /* Lossy format, with the size in the key frame header */
+        if (header->size < 30 || data[23] != 0x9d || data[24] != 0x01 || data[25] != 0x2a) {
+            return SDL_SetError("Couldn't read WEBP header");
+        }
+        width = GetLE16(&data[26]) & 0x3FFF;
+        height = GetLE16(&data[28]) & 0x3FFF;
+    }
+
+    if (!SetImageInfo(props, width, height, 8, has_alpha, has_alpha ? SDL_PIXELFORMAT_RGBA32 : SDL_PIXELFORMAT_RGB24)) {
+        return false;
+    }
+    SetImageOrientation(props, orientation);
+    SetImageFrames(props, animated, frame_count);
+    return true;
+}
+
+static bool GetANIInfo(IMG_ImageHeader *header, SDL_PropertiesID props)
+{
+    Uint8 data[36];
+    Uint64 offset = 12;
+    Uint32 steps = 0;
+    bool found_header = false;
+
+    /* Walk the chunks for the animation header and the first icon */
+    while (ReadImageHeader(header, offset, data, 12)) {
+        Uint32 size = GetLE32(&data[4]);
+
+        if (SDL_memcmp(data, "anih", 4) == 0) {
+            if (size < 36 || !ReadImageHeader(header, offset + 8, data, 36)) {
+                break;
+            }
+            steps = GetLE32(&data[8]);
+            found_header = true;
+        } else if (SDL_memcmp(data, "LIST", 4) == 0 && SDL_memcmp(&data[8], "fram", 4) == 0) {
+            if (!found_header || !ReadImageHeader(header, offset + 12, data, 8) ||
+                SDL_memcmp(data, "icon", 4) != 0) {
+                break;
+            }
+            if (!GetICOCURInfo(header, offset + 20, 2, props) &&
+                !GetICOCURInfo(header, offset + 20, 1, props)) {
+                return false;
+            }
+            SetImageFrames(props, true, steps);
+            return true;
+        }
+        offset += 8 + (Uint64)size + (size & 1);
+    }
+    return SDL_SetError("Couldn't read ANI header");
+}
+
+/* Table of image header parsers, by detected format */
+static const struct {
+    const char *format;
+    bool (*get_info)(IMG_ImageHeader *header, SDL_PropertiesID props);
+} image_info[] = {
+    { "AVIF", GetAVIFInfo },
+    { "CUR",  GetCURInfo  },
+    { "ICO",  GetICOInfo  },
+    { "BMP",  GetBMPInfo  },
+    { "GIF",  GetGIFInfo  },
+    { "JPG",  GetJPGInfo  },
+    { "JXL",  GetJXLInfo  },
+    { "LBM",  GetLBMInfo  },
+    { "PCX",  GetPCXInfo  },
+    { "PNG",  GetPNGInfo  },
+    { "PNM",  GetPNMInfo  },
+    { "SVG",  GetSVGInfo  },
+    { "TIF",  GetTIFInfo  },
+    { "XCF",  GetXCFInfo  },
+    { "XPM",  GetXPMInfo  },
+    { "XV",   GetXVInfo   },
+    { "WEBP", GetWEBPInfo },
+    { "QOI",  GetQOIInfo  },
+    { "ANI",  GetANIInfo  },
+};
+
+/* Table of image loading functions, by detected format */
+static struct {
+    const char *type;
+    const char *format;
+    SDL_Surface *(SDLCALL *load)(SDL_IOStream *src);
+} supported[] = {
+    /* keep magicless formats first */
+    { "TGA", NULL,   IMG_LoadTGA_IO },
+    { "AVIF", "AVIF", IMG_LoadAVIF_IO },
+    { "CUR", "CUR",  IMG_LoadCUR_IO },
+    { "ICO", "ICO",  IMG_LoadICO_IO },
+    { "BMP", "BMP",  IMG_LoadBMP_IO },
+    { "GIF", "GIF",  IMG_LoadGIF_IO },
+    { "JPG", "JPG",  IMG_LoadJPG_IO },
+    { "JXL", "JXL",  IMG_LoadJXL_IO },
+    { "LBM", "LBM",  IMG_LoadLBM_IO },
+    { "PCX", "PCX",  IMG_LoadPCX_IO },
+    { "PNG", "PNG",  IMG_LoadPNG_IO },
+    { "PNM", "PNM",  IMG_LoadPNM_IO }, /* P[BGP]M share code */
+    { "SVG", "SVG",  IMG_LoadSVG_IO },
+    { "TIF", "TIF",  IMG_LoadTIF_IO },
+    { "XCF", "XCF",  IMG_LoadXCF_IO },
+    { "XPM", "XPM",  IMG_LoadXPM_IO },
+    { "XV",  "XV",   IMG_LoadXV_IO  },
+    { "WEBP", "WEBP", IMG_LoadWEBP_IO },
+    { "QOI", "QOI",  IMG_LoadQOI_IO },
+};
+
+/* Table of animation loading functions, by detected format */
+static struct {
+    const char *type;
+    const char *format;
+    IMG_Animation *(SDLCALL *load)(SDL_IOStream *src);
+} supported_anims[] = {
+    { "GIF", "GIF",    IMG_LoadGIFAnimation_IO   },
+    { "WEBP", "WEBP",  IMG_LoadWEBPAnimation_IO  },
+    { "APNG", "PNG",   IMG_LoadAPNGAnimation_IO  },
+    { "AVIFS", "AVIF", IMG_LoadAVIFAnimation_IO  },
+    { "ANI", "ANI",    IMG_LoadANIAnimation_IO   },
+};
+
+int IMG_Version(void)
+{
+    return SDL_IMAGE_VERSION;
+}
+
+/* Detect the format of an image from its header */
+const char *IMG_DetectFormat_IO(SDL_IOStream *src)
+{
+    Uint8 data[IMG_DETECT_SIZE];
+    Sint64 start;
+    size_t size;
+
+    if (!src) {
+        SDL_InvalidParamError("src");
+        return NULL;
+    }
+
+    /* Read the header window once and match every signature against it */
+    start = SDL_TellIO(src);
+    size = ReadFully(src, data, sizeof(data));
+    if (SDL_SeekIO(src, start, SDL_IO_SEEK_SET) < 0) {
+        return NULL;
+    }
+    return DetectFormat(data, size);
+}
+
+/* Get information about an image from its header */
+SDL_PropertiesID IMG_GetImageInfo_IO(SDL_IOStream *src, bool closeio)
+{
+    IMG_ImageHeader *header;
+    const char *format;
+    SDL_PropertiesID props = 0;
+    size_t i;
+
+    if (!src) {
+        SDL_InvalidParamError("src");
+        return 0;
+    }
+
+    header = (IMG_ImageHeader *)SDL_malloc(sizeof(*header));
+    if (!header) {
+        goto done;
+    }
+    header->src = src;
+    header->start = SDL_TellIO(src);
+    header->size = ReadFully(src, header->data, sizeof(header->data));
+    header->reads_left = IMG_INFO_MAX_READS;
+    header->exhausted = false;
+
+    format = DetectFormat(header->data, header->size);
+    if (!format) {
+        goto done;
+    }
+
+    props = SDL_CreateProperties();
+    if (!props) {
+        goto done;
+    }
+    SDL_SetStringProperty(props, IMG_PROP_IMAGE_INFO_FORMAT_STRING, format);
+
+    for (i = 0; i < SDL_arraysize(image_info); ++i) {
+        if (SDL_strcmp(image_info[i].format, format) == 0) {
+            if (!image_info[i].get_info(header, props)) {
+                SDL_DestroyProperties(props);
+                props = 0;
+            }
+            break;
+        }
+    }
+
+done:
+    if (header) {
+        if (!closeio) {
+            SDL_SeekIO(src, header->start, SDL_IO_SEEK_SET);
+        }
+        SDL_free(header);
+    }
+    if (closeio) {
+        SDL_CloseIO(src);
+    }
+    return props;
+}
+
+#ifdef HAVE_MAPPED_FILES
+/* A read-only stream over a memory mapped file */
+typedef struct
+{
+    Uint8 *base;
+    Sint64 size;
+    Sint64 offset;
+} IMG_MappedFile;
+
+static void UnmapFile(Uint8 *base, Sint64 size)
+{
+#ifdef SDL_PLATFORM_WINDOWS
+    (void)size;
+    UnmapViewOfFile(base);
+#else
+    munmap(base, (size_t)size);
+#endif
+}
+
+static Sint64 SDLCALL MappedFileSize(void *userdata)
+{
+    IMG_MappedFile *mapping = (IMG_MappedFile *)userdata;
+
+    return mapping->size;
+}
+
+static Sint64 SDLCALL MappedFileSeek(void *userdata, Sint64 offset, SDL_IOWhence whence)
+{
+    IMG_MappedFile *mapping = (IMG_MappedFile *)userdata;
+
+    switch (whence) {
+    case SDL_IO_SEEK_SET:
+        break;
+    case SDL_IO_SEEK_CUR:
+        offset += mapping->offset;
+        break;
+    case SDL_IO_SEEK_END:
+        offset += mapping->size;
+        break;
+    default:
+        SDL_SetError("Unknown value for 'whence'");
+        return -1;
+    }
+    mapping->offset = SDL_clamp(offset, 0, mapping->size);
+    return mapping->offset;
+}
+
+static size_t SDLCALL MappedFileRead(void *userdata, void *ptr, size_t size, SDL_IOStatus *status)
+{
+    IMG_MappedFile *mapping = (IMG_MappedFile *)userdata;
+    size_t available = (size_t)(mapping->size - mapping->offset);
+
+    if (size > available) {
+        size = available;
+    }
+    if (size == 0) {
+        *status = SDL_IO_STATUS_EOF;
+        return 0;
+    }
+    SDL_memcpy(ptr, mapping->base + mapping->offset, size);
+    mapping->offset += size;
+    return size;
+}
+
+static bool SDLCALL MappedFileClose(void *userdata)
+{
+    IMG_MappedFile *mapping = (IMG_MappedFile *)userdata;
+
+    UnmapFile(mapping->base, mapping->size);
+    SDL_free(mapping);
+    return true;
+}
+
+/* Map a regular file into memory, returning NULL if it can't be mapped.
+   If the file is truncated by another process while it's mapped, reading past
+   the new end raises SIGBUS on POSIX systems, so callers that load files that
+   may change underneath them can turn mapping off. */
+static SDL_IOStream *OpenMappedFile(const char *file)
+{
+    IMG_MappedFile *mapping;
+    SDL_IOStreamInterface iface;
+    SDL_IOStream *stream;
+    SDL_PropertiesID props;
+    Uint8 *base = NULL;
+    Sint64 size = 0;
+
+#ifdef SDL_PLATFORM_WINDOWS
+    WCHAR *wfile;
+    HANDLE handle, map;
+    LARGE_INTEGER filesize;
+    int len;
+
+    len = MultiByteToWideChar(CP_UTF8, 0, file, -1, NULL, 0);
+    if (len <= 0) {
+        return NULL;
+    }
+    wfile = (WCHAR *)SDL_malloc(len * sizeof(*wfile));
+    if (!wfile) {
+        return NULL;
+    }
+    MultiByteToWideChar(CP_UTF8, 0, file, -1, wfile, len);
+    handle = CreateFileW(wfile, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    SDL_free(wfile);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+    if (GetFileType(handle) == FILE_TYPE_DISK &&
+        GetFileSizeEx(handle, &filesize) && filesize.QuadPart > 0 && (Uint64)filesize.QuadPart <= SDL_SIZE_MAX) {
+        map = CreateFileMappingW(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (map) {
+            /* The view keeps the mapping and the file open */
+            base = (Uint8 *)MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(map);
+        }
+        size = filesize.QuadPart;
+
+        /* Don't use the mapping if the file changed size while it was mapped */
+        if (base && (!GetFileSizeEx(handle, &filesize) || filesize.QuadPart != size)) {
+            UnmapFile(base, size);
+            base = NULL;
+        }
+    }
+    CloseHandle(handle);
+#else
+    struct stat st;
+    int flags = O_RDONLY;
+    int fd;
+
+#ifdef O_CLOEXEC
+    flags |= O_CLOEXEC;
+#endif
+    fd = open(file, flags);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 && (Uint64)st.st_size <= SDL_SIZE_MAX) {
+        base = (Uint8 *)mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (base == (Uint8 *)MAP_FAILED) {
+            base = NULL;
+        }
+        size = (Sint64)st.st_size;
+
+        /* Don't use the mapping if the file changed size while it was mapped */
+        if (base && (fstat(fd, &st) != 0 || (Sint64)st.st_size != size)) {
+            UnmapFile(base, size);
+            base = NULL;
+        }
+    }
+    close(fd);
+#endif
+
+    if (!base) {
+        return NULL;
+    }
+
+    mapping = (IMG_MappedFile *)SDL_calloc(1, sizeof(*mapping));
+    if (!mapping) {
+        UnmapFile(base, size);
+        return NULL;
+    }
+    mapping->base = base;
+    mapping->size = size;
+
+    SDL_INIT_INTERFACE(&iface);
+    iface.size = MappedFileSize;
+    iface.seek = MappedFileSeek;
+    iface.read = MappedFileRead;
+    iface.close = MappedFileClose;
+    stream = SDL_OpenIO(&iface, mapping);
+    if (!stream) {
+        MappedFileClose(mapping);
+        return NULL;
+    }
+
+    /* Advertise the mapping the same way SDL_IOFromConstMem() does */
+    props = SDL_GetIOProperties(stream);
+    SDL_SetPointerProperty(props, SDL_PROP_IOSTREAM_MEMORY_POINTER, base);
+    SDL_SetNumberProperty(props, SDL_PROP_IOSTREAM_MEMORY_SIZE_NUMBER, size);
+    return stream;
+}
+#endif /* HAVE_MAPPED_FILES */
+
+/* Open a file for loading, mapping it into memory if allowed and possible so decoders can read it in place */
+SDL_IOStream *IMG_OpenImageFile(const char *file, bool map)
+{
+    SDL_IOStream *src = NULL;
+
+#ifdef HAVE_MAPPED_FILES
+    if (map) {
+        src = OpenMappedFile(file);
+    }
+#else
+    (void)map;
+#endif
+    if (!src) {
+        src = SDL_IOFromFile(file, "rb");
+    }
+    return src;
+}
+
+const Uint8 *IMG_ReadIOData(SDL_IOStream *src, size_t size, size_t *datasize, bool *allocated)
+{
+    SDL_PropertiesID props = SDL_GetIOProperties(src);
+    const Uint8 *base = (const Uint8 *)SDL_GetPointerProperty(props, SDL_PROP_IOSTREAM_MEMORY_POINTER, NULL);
+    Uint8 *data;
+
+    *allocated = false;
+
+    if (base) {
+        Sint64 total = SDL_GetNumberProperty(props, SDL_PROP_IOSTREAM_MEMORY_SIZE_NUMBER, 0);
+        Sint64 offset = SDL_TellIO(src);
+
+        if (offset >= 0 && offset <= total) {
+            size_t available = (size_t)(total - offset);
+
+            if (size == 0) {
+                size = available;
+            } else if (size > available) {
+                SDL_SetError("Unexpected end of data");
+                return NULL;
+            }
+            if (SDL_SeekIO(src, offset + (Sint64)size, SDL_IO_SEEK_SET) < 0) {
+                return NULL;
+            }
+            if (datasize) {
+                *datasize = size;
+            }
+            return base + offset;
+        }
+    }
+
+    if (size == 0) {
+        data = (Uint8 *)SDL_LoadFile_IO(src, datasize, false);
+        if (!data) {
+            return NULL;
+        }
+    } else {
+        data = (Uint8 *)SDL_malloc(size);
+        if (!data) {
+            return NULL;
+        }
+        if (SDL_ReadIO(src, data, size) != size) {
+            SDL_free(data);
+            SDL_SetError("Unexpected end of data");
+            return NULL;
+        }
+        if (datasize) {
+            *datasize = size;
+        }
+    }
+    *allocated = true;
+    return data;
+}
+
+void IMG_FreeIOData(const Uint8 *data, bool allocated)
+{
+    if (allocated) {
+        SDL_free((void *)data);
+    }
+}
+
+/* A stream over a non-seekable data source that keeps the start of the data
+ * so it can be rewound after the format has been detected.
+ *
+ * Everything read from the source is kept until the limit is reached, after
+ * which the stream can only be read forward. Formats that need to seek around
+ * have the rest of the source read into memory by SpoolRewindStream() first.
+ */
+typedef struct
+{
+    SDL_IOStream *src;
+    bool closeio;
+    Uint8 *data;        /* The start of the source, data[0] is position 0 */
+    size_t size;        /* The amount of the source kept in data */
+    size_t capacity;
+    size_t limit;       /* The most of the source that will be kept */
+    Sint64 offset;      /* The current position in the stream */
+    Sint64 src_offset;  /* The amount read from the source */
+    bool spooled;       /* Whether the whole source is in data */
+} IMG_RewindStream;
+
+#define IMG_REWIND_STREAM_POINTER "SDL_image.rewind_stream"
+
+static bool GrowRewindStream(IMG_RewindStream *rw, size_t size)
+{
+    size_t capacity;
+    Uint8 *data;
+
+    if (size <= rw->capacity) {
+        return true;
+    }
+    capacity = rw->capacity ? rw->capacity : IMG_DETECT_SIZE;
+    while (capacity < size) {
+        capacity *= 2;
+    }
+    if (capacity > rw->limit) {
+        capacity = SDL_max(rw->limit, size);
+    }
+    data = (Uint8 *)SDL_realloc(rw->data, capacity);
+    if (!data) {
+        return false;
+    }
+    rw->data = data;
+    rw->capacity = capacity;
+    return true;
+}
+
+/* Read from the source, keeping what falls within the limit */
+static size_t ReadRewindSource(IMG_RewindStream *rw, Uint8 *ptr, size_t size)
+{
+    size_t amount = SDL_ReadIO(rw->src, ptr, size);
+
+    if (amount > 0 && rw->size < rw->limit) {
+        size_t keep = SDL_min(amount, rw->limit - rw->size);
+
+        if (GrowRewindStream(rw, rw->size + keep)) {
+            SDL_memcpy(rw->data + rw->size, ptr, keep);
+            rw->size += keep;
+        } else {
+            /* Carry on without the ability to rewind */
+            rw->limit = rw->size;
+        }
+    }
+    rw->src_offset += amount;
+    return amount;
+}
+
+static Sint64 SDLCALL RewindStreamSize(void *userdata)
+{
+    IMG_RewindStream *rw = (IMG_RewindStream *)userdata;
+
+    if (!rw->spooled) {
+        SDL_Unsupported();
+        return -1;
+    }
+    return (Sint64)rw->size;
+}
+
+static Sint64 SDLCALL RewindStreamSeek(void *userdata, Sint64 offset, SDL_IOWhence whence)
+{
+    IMG_RewindStream *rw = (IMG_RewindStream *)userdata;
+
+    switch (whence) {
+    case SDL_IO_SEEK_SET:
+        break;
+    case SDL_IO_SEEK_CUR:
+        offset += rw->offset;
+        break;
+    case SDL_IO_SEEK_END:
+        if (!rw->spooled) {
+            SDL_SetError("Can't seek from the end of a non-seekable data source");
+            return -1;
+        }
+        offset += (Sint64)rw->size;
+        break;
+    default:
+        SDL_SetError("Unknown value for 'whence'");
+        return -1;
+    }
+    if (offset < 0) {
+        SDL_SetError("Can't seek before the start of the data source");
+        return -1;
+    }
+    if (offset < rw->src_offset && rw->src_offset > (Sint64)rw->size) {
+        SDL_SetError("Can't seek back past the start of a non-seekable data source");
+        return -1;
+    }
+
+    /* Seeking forward past what has been read is done when reading */
+    rw->offset = offset;
+    return offset;
+}
+
+static size_t SDLCALL RewindStreamRead(void *userdata, void *ptr, size_t size, SDL_IOStatus *status)
+{
+    IMG_RewindStream *rw = (IMG_RewindStream *)userdata;
+    Uint8 *dst = (Uint8 *)ptr;
+    size_t total = 0;
+
+    while (total < size) {
+        size_t amount;
+
+        if (rw->offset < (Sint64)rw->size) {
+            amount = SDL_min(size - total, rw->size - (size_t)rw->offset);
+            SDL_memcpy(dst + total, rw->data + rw->offset, amount);
+        } else if (rw->spooled) {
+            *status = SDL_IO_STATUS_EOF;
+            break;
+        } else if (rw->offset > rw->src_offset) {
+            Uint8 skip[IMG_DETECT_SIZE];
+
+            if (ReadRewindSource(rw, skip, (size_t)SDL_min(rw->offset - rw->src_offset, (Sint64)sizeof(skip))) == 0) {
+                *status = SDL_GetIOStatus(rw->src);
+                break;
+            }
+            continue;
+        } else {
+            amount = ReadRewindSource(rw, dst + total, size - total);
+            if (amount == 0) {
+                *status = SDL_GetIOStatus(rw->src);
+                break;
+            }
+        }
+        rw->offset += amount;
+        total += amount;
+    }
+    return total;
+}
+
+static bool SDLCALL RewindStreamClose(void *userdata)
+{
+    IMG_RewindStream *rw = (IMG_RewindStream *)userdata;
+    bool result = true;
+
+    if (rw->closeio) {
+        result = SDL_CloseIO(rw->src);
+    }
+    SDL_free(rw->data);
+    SDL_free(rw);
+    return result;
+}
+
+/* Wrap a non-seekable data source so the start of it can be rewound */
+static SDL_IOStream *OpenRewindStream(SDL_IOStream *src, bool closeio)
+{
+    IMG_RewindStream *rw;
+    SDL_IOStreamInterface iface;
+    SDL_IOStream *stream;
+
+    rw = (IMG_RewindStream *)SDL_calloc(1, sizeof(*rw));
+    if (!rw) {
+        if (closeio) {
+            SDL_CloseIO(src);
+        }
+        return NULL;
+    }
+    rw->src = src;
+    rw->closeio = closeio;
+    rw->limit = IMG_REWIND_SIZE;
+
+    SDL_INIT_INTERFACE(&iface);
+    iface.size = RewindStreamSize;
+    iface.seek = RewindStreamSeek;
+    iface.read = RewindStreamRead;
+    iface.close = RewindStreamClose;
+    stream = SDL_OpenIO(&iface, rw);
+    if (!stream) {
+        RewindStreamClose(rw);
+        return NULL;
+    }
+    SDL_SetPointerProperty(SDL_GetIOProperties(stream), IMG_REWIND_STREAM_POINTER, rw);
+    return stream;
+}
+
+/* Read the rest of a stream opened by OpenRewindStream() into memory, so it can seek anywhere */
+static bool SpoolRewindStream(SDL_IOStream *stream)
+{
+    IMG_RewindStream *rw = (IMG_RewindStream *)SDL_GetPointerProperty(SDL_GetIOProperties(stream), IMG_REWIND_STREAM_POINTER, NULL);
+
+    if (!rw || rw->spooled) {
+        return true;
+    }
+    if (rw->src_offset > (Sint64)rw->size) {
+        return SDL_SetError("Can't rewind a non-seekable data source to load this format");
+    }
+
+    rw->limit = SDL_SIZE_MAX;
+    for (;;) {
+        size_t amount;
+
+        if (!GrowRewindStream(rw, rw->size + IMG_DETECT_SIZE)) {
+            return false;
+        }
+        amount = SDL_ReadIO(rw->src, rw->data + rw->size, rw->capacity - rw->size);
+        if (amount == 0) {
+            break;
+        }
+        rw->size += amount;
+        rw->src_offset += amount;
+    }
+    switch (SDL_GetIOStatus(rw->src)) {
+    case SDL_IO_STATUS_EOF:
+        break;
+    case SDL_IO_STATUS_ERROR:
+        return false;
+    default:
+        return SDL_SetError("Couldn't read all of a non-seekable data source");
+    }
+    rw->spooled = true;
+    return true;
+}
+
+/* Whether a format can be loaded from a stream that can only be rewound to near the start */
+static bool IsStreamingFormat(const char *type)
+{
+#if defined(__APPLE__) && !defined(SDL_IMAGE_USE_COMMON_BACKEND)
+    /* The ImageIO data provider rewinds to the start of the data */
+    (void)type;
+    return false;
+#else
+    static const char *streaming_formats[] = {
+        "GIF", "JPG", "PNG", "PNM", "QOI", "TGA"
+    };
+    size_t i;
+
+    for (i = 0; type && i < SDL_arraysize(streaming_formats); ++i) {
+        if (SDL_strcasecmp(type, streaming_formats[i]) == 0) {
+            return true;
+        }
+    }
+    return false;
+#endif
+}
+
+#if !defined(__APPLE__) || defined(SDL_IMAGE_USE_COMMON_BACKEND)
+/* Load an image from a file */
+SDL_Surface *IMG_Load(const char *file)
+{
+#ifdef __EMSCRIPTEN__
+    int w, h;
+    char *data;
+    SDL_Surface *surf;
+
+    data = emscripten_get_preloaded_image_data(file, &w, &h);
+    if (data != NULL) {
+        surf = SDL_CreateSurface(w, h, SDL_PIXELFORMAT_RGBA32);
+        if (surf != NULL) {
+            SDL_memcpy(surf->pixels, data, w * h * 4);
+        }
+        free(data); /* This should NOT be SDL_free() */
+        return surf;
+    }
+#endif
+
+    SDL_IOStream *src = IMG_OpenImageFile(file, true);
+    if (!src) {
+        /* The error message has been set in SDL_IOFromFile */
+        return NULL;
+    }
+
+    const char *ext = SDL_strrchr(file, '.');
+    if (ext) {
+        ext++;
+    }
+    return IMG_LoadTyped_IO(src, true, ext);
+}
+#endif
+
+/* Load an image from an SDL datasource (for compatibility) */
+SDL_Surface *IMG_Load_IO(SDL_IOStream *src, bool closeio)
+{
+    return IMG_LoadTyped_IO(src, closeio, NULL);
+}
+
+/* Load an image from an SDL datasource, optionally specifying the type */
+SDL_Surface *IMG_LoadTyped_IO(SDL_IOStream *src, bool closeio, const char *type)
+{
+    size_t i;
+    const char *format;
+    SDL_Surface *image;
+
+    /* Make sure there is something to do.. */
+    if (!src) {
+        SDL_InvalidParamError("src");
+        return NULL;
+    }
+
+    /* Keep the start of data sources that can't seek, so the format can be detected */
+    if (SDL_SeekIO(src, 0, SDL_IO_SEEK_CUR) < 0) {
+        src = OpenRewindStream(src, closeio);
+        if (!src) {
+            return NULL;
+        }
+        closeio = true;
+    }
+
+#ifdef __EMSCRIPTEN__
+    /*load through preloadedImages*/
+    FILE *fp = (FILE *)SDL_GetPointerProperty(SDL_GetIOProperties(src), SDL_PROP_IOSTREAM_STDIO_FILE_POINTER, NULL);
+    if (fp) {
+        int w, h;
+        char *data;
+
+        data = emscripten_get_preloaded_image_data_from_FILE(fp, &w, &h);
+        if (data) {
+            image = SDL_CreateSurface(w, h, SDL_PIXELFORMAT_RGBA32);
+            if (image != NULL) {
+                SDL_memcpy(image->pixels, data, w * h * 4);
+            }
+            free(data); /* This should NOT be SDL_free() */
+
+            if (closeio) {
+                SDL_CloseIO(src);
+            }
+
+            /* If SDL_CreateSurface returns NULL, it has set the error message for us */
+            return image;
+        }
+    }
+#endif
+
+    /* Magicless formats are only loaded when the caller asks for them */
+    for (i = 0; i < SDL_arraysize(supported); ++i) {
+        if (!supported[i].format && type && SDL_strcasecmp(type, supported[i].type) == 0) {
+            break;
+        }
+    }
+
+    /* Detect the type of image being loaded */
+    if (i == SDL_arraysize(supported)) {
+        format = IMG_DetectFormat_IO(src);
+        if (format) {
+            for (i = 0; i < SDL_arraysize(supported); ++i) {
+                if (supported[i].format && SDL_strcmp(format, supported[i].format) == 0) {
+                    break;
+                }
+            }
+        }
+    }
+
+    if (i < SDL_arraysize(supported)) {
+#ifdef DEBUG_IMGLIB
+        SDL_Log("IMGLIB: Loading image as %s\n", supported[i].type);
+#endif
+        if (IsStreamingFormat(supported[i].type) || SpoolRewindStream(src)) {
+            image = supported[i].load(src);
+        } else {
+            image = NULL;
+        }
+        if (closeio) {
+            SDL_CloseIO(src);
+        }
+        return image;
+    }
+
+    if (closeio) {
+        SDL_CloseIO(src);
+    }
+    SDL_SetError("Unsupported image format");
+    return NULL;
+}
+
+/* Get the largest size with the same aspect ratio that fits within a maximum size */
+void IMG_GetScaledSize(int width, int height, int max_w, int max_h, int *scaled_w, int *scaled_h)
+{
+    /* A maximum of 0 leaves that dimension unlimited */
+    if (max_w <= 0) {
+        max_w = SDL_MAX_SINT32;
+    }
+    if (max_h <= 0) {
+        max_h = SDL_MAX_SINT32;
+    }
+
+    if (width <= max_w && height <= max_h) {
+        *scaled_w = width;
+        *scaled_h = height;
+    } else if ((Sint64)width * max_h > (Sint64)height * max_w) {
+        *scaled_w = max_w;
+        *scaled_h = (int)SDL_max((Sint64)height * max_w / width, 1);
+    } else {
+        *scaled_w = (int)SDL_max((Sint64)width * max_h / height, 1);
+        *scaled_h = max_h;
+    }
+}
+
+/* Reduce a surface with a box filter, averaging each block of source pixels.
+   Colors are weighted by alpha, so transparent pixels don't bleed into the edges. */
+static SDL_Surface *ReduceSurface(SDL_Surface *surface, int width, int height)
+{
+    SDL_Surface *converted = NULL;
+    SDL_Surface *reduced = NULL;
+    SDL_BlendMode blend = SDL_BLENDMODE_NONE;
+    Uint64 *sums = NULL;
+    int *columns = NULL;
+    int bpp, alpha = -1, x, y, c;
+
+    SDL_GetSurfaceBlendMode(surface, &blend);
+
+    /* The filter works on any format with 8-bit components */
+    if (SDL_SurfaceHasColorKey(surface)) {
+        /* Turn the color key into alpha, so the key color isn't averaged into visible pixels */
+        converted = SDL_ConvertSurface(surface, SDL_PIXELFORMAT_RGBA32);
+        blend = SDL_BLENDMODE_BLEND;
+        if (!converted) {
+            return NULL;
+        }
+        surface = converted;
+    } else if (!(SDL_ISPIXELFORMAT_ARRAY(surface->format) && SDL_PIXELTYPE(surface->format) == SDL_PIXELTYPE_ARRAYU8) &&
+               !(SDL_ISPIXELFORMAT_PACKED(surface->format) && SDL_PIXELLAYOUT(surface->format) == SDL_PACKEDLAYOUT_8888)) {
+        if (SDL_ISPIXELFORMAT_ALPHA(surface->format)) {
+            converted = SDL_ConvertSurface(surface, SDL_PIXELFORMAT_RGBA32);
+        } else {
+            converted = SDL_ConvertSurface(surface, SDL_PIXELFORMAT_RGB24);
+        }
+        if (!converted) {
+            return NULL;
+        }
+        surface = converted;
+    }
+    bpp = SDL_BYTESPERPIXEL(surface->format);
+
+    /* Find the byte holding alpha in memory */
+    if (SDL_ISPIXELFORMAT_ALPHA(surface->format)) {
+        const SDL_PixelFormatDetails *details = SDL_GetPixelFormatDetails(surface->format);
+
+        if (!details) {
+            goto done;
+        }
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+        alpha = details->Ashift / 8;
+#else
+        alpha = 3 - details->Ashift / 8;
+#endif
+    }
+
+    reduced = SDL_CreateSurface(width, height, surface->format);
+    sums = (Uint64 *)SDL_malloc((size_t)width * bpp * sizeof(*sums));
+    columns = (int *)SDL_malloc((width + 1) * sizeof(*columns));
+    if (!reduced || !sums || !columns || !SDL_LockSurface(surface)) {
+        SDL_DestroySurface(reduced);
+        reduced = NULL;
+        goto done;
+    }
+
+    for (x = 0; x <= width; ++x) {
+        columns[x] = (int)((Sint64)x * surface->w / width);
+    }
+
+    for (y = 0; y < height; ++y) {
+        int y0 = (int)((Sint64)y * surface->h / height);
+        int y1 = (int)((Sint64)(y + 1) * surface->h / height);
+        Uint8 *dst = (Uint8 *)reduced->pixels + y * reduced->pitch;
+        int sy;
+
+        /* Accumulate the source rows covered by this row */
+        SDL_memset(sums, 0, (size_t)width * bpp * sizeof(*sums));
+        for (sy = y0; sy < y1; ++sy) {
+            const Uint8 *src = (const Uint8 *)surface->pixels + sy * surface->pitch;
+            Uint64 *sum = sums;
+
+            for (x = 0; x < width; ++x) {
+                const Uint8 *pixel = src + columns[x] * bpp;
+                const Uint8 *end = src + columns[x + 1] * bpp;
+
+                if (alpha >= 0) {
+                    /* Sum premultiplied colors */
+                    for ( ; pixel < end; pixel += bpp) {
+                        for (c = 0; c < bpp; ++c) {
+                            sum[c] += (c == alpha) ? pixel[c] : (Uint64)pixel[c] * pixel[alpha];
+                        }
+                    }
+                } else {
+                    for ( ; pixel < end; pixel += bpp) {
+                        for (c = 0; c < bpp; ++c) {
+                            sum[c] += pixel[c];
+                        }
+                    }
+                }
+                sum += bpp;
+            }
+        }
+
+        for (x = 0; x < width; ++x) {
+            Uint64 count = (Uint64)(columns[x + 1] - columns[x]) * (y1 - y0);
+            const Uint64 *sum = &sums[x * bpp];
+
+            for (c = 0; c < bpp; ++c) {
+                if (alpha < 0 || c == alpha) {
+                    dst[x * bpp + c] = (Uint8)((sum[c] + count / 2) / count);
+                } else if (sum[alpha] == 0) {
+                    /* The block is fully transparent */
+                    dst[x * bpp + c] = 0;
+                } else {
+                    /* Divide by the total alpha to remove the premultiplication */
+                    dst[x * bpp + c] = (Uint8)((sum[c] + sum[alpha] / 2) / sum[alpha]);
+                }
+            }
+        }
+    }
+    SDL_UnlockSurface(surface);
+    SDL_SetSurfaceBlendMode(reduced, blend);
+
+done:
+    SDL_free(columns);
+    SDL_free(sums);
+    SDL_DestroySurface(converted);
+    return reduced;
+}
+
+/* Return whether a codec output of this size and format can go directly into the destination surface */
+static bool IsLoadDestination(IMG_LoadOptions *options, int width, int height, SDL_PixelFormat format)
+{
+    SDL_Surface *dst = options ? options->dst : NULL;
+
+    /* The output isn't final if the caller still has to crop it */
+    return dst && dst->w == width && dst->h == height && dst->format == format &&
+           !SDL_MUSTLOCK(dst) && (SDL_RectEmpty(&options->crop) || options->cropped);
+}
+
+/* Create the output surface for a codec, using the destination surface if it matches */
+SDL_Surface *IMG_CreateLoadSurface(IMG_LoadOptions *options, int width, int height, SDL_PixelFormat format)
+{
+    if (IsLoadDestination(options, width, height, format)) {
+        ++options->dst->refcount;
+        return options->dst;
+    }
+    return SDL_CreateSurface(width, height, format);
+}
+
+/* Create the output surface for a codec from pixels it allocated with SDL_malloc(), taking ownership of them */
+SDL_Surface *IMG_CreateLoadSurfaceFrom(IMG_LoadOptions *options, int width, int height, SDL_PixelFormat format, void *pixels, int pitch)
+{
+    SDL_Surface *surface;
+
+    if (IsLoadDestination(options, width, height, format)) {
+        surface = options->dst;
+        if (!SDL_ConvertPixels(width, height, format, pixels, pitch, format, surface->pixels, surface->pitch)) {
+            return NULL;
+        }
+        SDL_free(pixels);
+        ++surface->refcount;
+        return surface;
+    }
+
+    surface = SDL_CreateSurfaceFrom(width, height, format, pixels, pitch);
+    if (surface) {
+        /* Let SDL manage the memory now */
+        surface->flags &= ~SDL_SURFACE_PREALLOCATED;
+    }
+    return surface;
+}
+
+/* Copy a loaded image into the destination surface, converting it if needed */
+static bool CopyIntoSurface(SDL_Surface *image, SDL_Surface *dst)
+{
+    SDL_Surface *converted = image;
+    SDL_Palette *palette;
+    SDL_BlendMode blend_mode;
+    Uint32 colorkey;
+    bool result = false;
+
+    if (image->w != dst->w || image->h != dst->h) {
+        return SDL_SetError("Image size %dx%d doesn't match the destination surface size %dx%d",
+                            image->w, image->h, dst->w, dst->h);
+    }
+
+    if (image->format != dst->format) {
+        converted = SDL_ConvertSurface(image, dst->format);
+        if (!converted) {
+            return false;
+        }
+    }
+
+    /* Keep the palette and transparency of the image */
+    palette = SDL_GetSurfacePalette(converted);
+    if (palette) {
+        SDL_Palette *copy = SDL_CreateSurfacePalette(dst);
+        if (!copy || !SDL_SetPaletteColors(copy, palette->colors, 0, palette->ncolors)) {
+            goto done;
+        }
+    }
+    if (SDL_GetSurfaceColorKey(converted, &colorkey)) {
+        SDL_SetSurfaceColorKey(dst, true, colorkey);
+        SDL_SetSurfaceColorKey(converted, false, 0);
+    }
+    if (SDL_GetSurfaceBlendMode(converted, &blend_mode)) {
+        SDL_SetSurfaceBlendMode(dst, blend_mode);
+    }
+
+    /* Copy the pixels exactly, including the alpha channel */
+    SDL_SetSurfaceBlendMode(converted, SDL_BLENDMODE_NONE);
+    result = SDL_BlitSurface(converted, NULL, dst, NULL);
+
+done:
+    if (converted != image) {
+        SDL_DestroySurface(converted);
+    }
+    return result;
+}
+
+/* Copy a region of a surface into a new surface of the same format */
+static SDL_Surface *CropSurface(SDL_Surface *surface, const SDL_Rect *crop)
+{
+    SDL_Surface *cropped;
+    SDL_Palette *palette;
+    Uint32 colorkey;
+    SDL_Rect rect = *crop;
+
+    cropped = SDL_CreateSurface(crop->w, crop->h, surface->format);
+    if (!cropped) {
+        return NULL;
+    }
+
+    palette = SDL_GetSurfacePalette(surface);
+    if (palette) {
+        SDL_Palette *copy = SDL_CreateSurfacePalette(cropped);
+        if (!copy || !SDL_SetPaletteColors(copy, palette->colors, 0, palette->ncolors)) {
+            SDL_DestroySurface(cropped);
+            return NULL;
+        }
+    }
+    if (SDL_GetSurfaceColorKey(surface, &colorkey)) {
+        SDL_SetSurfaceColorKey(cropped, true, colorkey);
+        SDL_SetSurfaceColorKey(surface, false, 0);
+    }
+
+    /* Copy the pixels exactly, including the alpha channel */
+    SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+    if (!SDL_BlitSurface(surface, &rect, cropped, NULL)) {
+        SDL_DestroySurface(cropped);
+        return NULL;
+    }
+    return cropped;
+}
+
+static SDL_Surface *LoadSVGWithOptions(SDL_IOStream *src, IMG_LoadOptions *options)
+{
+    /* The sized loader rasterizes the whole image, so only use it without a crop */
+    if (SDL_RectEmpty(&options->crop)) {
+        return IMG_LoadSizedSVG_IO(src, options->max_w, options->max_h);
+    }
+    return IMG_LoadSVG_IO(src);
+}
+
+/* Table of image loading functions with native cropping, reduced size decoding
+   or decoding into a destination surface */
+static struct {
+    const char *type;
+    const char *format;
+    SDL_Surface *(*load)(SDL_IOStream *src, IMG_LoadOptions *options);
+} supported_options[] = {
+    /* keep magicless formats first */
+    { "TGA", NULL,    IMG_LoadTGAWithOptions_IO },
+    { "JPG", "JPG",   IMG_LoadJPGWithOptions_IO },
+    { "PNG", "PNG",   IMG_LoadPNGWithOptions_IO },
+    { "PNM", "PNM",   IMG_LoadPNMWithOptions_IO },
+    { "QOI", "QOI",   IMG_LoadQOIWithOptions_IO },
+    { "SVG", "SVG",   LoadSVGWithOptions },
+    { "TIF", "TIF",   IMG_LoadTIFWithOptions_IO },
+    { "WEBP", "WEBP", IMG_LoadWEBPWithOptions_IO },
+};
+
+/* Load an image, cropped and then scaled down to fit within a maximum size */
+static SDL_Surface *LoadWithOptions(SDL_IOStream *src, bool closeio, const char *type, IMG_LoadOptions *options)
+{
+    size_t i;
+    const char *format;
+    SDL_Surface *image = NULL;
+    int width, height;
+
+    /* Keep the start of data sources that can't seek, so the format can be detected */
+    if (SDL_SeekIO(src, 0, SDL_IO_SEEK_CUR) < 0) {
+        src = OpenRewindStream(src, closeio);
+        if (!src) {
+            return NULL;
+        }
+        closeio = true;
+    }
+
+    /* Decode to the format of the destination surface unless asked otherwise */
+    if (options->dst && options->format == SDL_PIXELFORMAT_UNKNOWN) {
+        options->format = options->dst->format;
+    }
+
+    /* Magicless formats are only loaded when the caller asks for them */
+    for (i = 0; i < SDL_arraysize(supported_options); ++i) {
+        if (!supported_options[i].format && type && SDL_strcasecmp(type, supported_options[i].type) == 0) {
+            break;
+        }
+    }
+
+    /* Crop and decode at a reduced size if the format supports it */
+    if (i == SDL_arraysize(supported_options)) {
+        format = IMG_DetectFormat_IO(src);
+        for (i = 0; format && i < SDL_arraysize(supported_options); ++i) {
+            if (supported_options[i].format && SDL_strcmp(format, supported_options[i].format) == 0) {
+                break;
+            }
+        }
+    }
+    if (i < SDL_arraysize(supported_options)) {
+        if (IsStreamingFormat(supported_options[i].type) || SpoolRewindStream(src)) {
+            image = supported_options[i].load(src, options);
+        }
+    } else {
+        image = IMG_LoadTyped_IO(src, false, type);
+    }
+
+    /* Crop the image if the codec didn't */
+    if (image && !SDL_RectEmpty(&options->crop) && !options->cropped) {
+        SDL_Rect bounds = { 0, 0, image->w, image->h };
+        SDL_Rect crop;
+
+        if (!SDL_GetRectIntersection(&options->crop, &bounds, &crop)) {
+            SDL_SetError("Crop rectangle is outside the image");
+            SDL_DestroySurface(image);
+            image = NULL;
+        } else if (crop.w != image->w || crop.h != image->h) {
+            SDL_Surface *cropped = CropSurface(image, &crop);
+
+            SDL_DestroySurface(image);
+            image = cropped;
+        }
+    }
+
+    /* Finish the reduction with a box filter */
+    if (image) {
+        IMG_GetScaledSize(image->w, image->h, options->max_w, options->max_h, &width, &height);
+        if (width != image->w || height != image->h) {
+            SDL_Surface *reduced = ReduceSurface(image, width, height);
+
+            SDL_DestroySurface(image);
+            image = reduced;
+        }
+    }
+
+    /* Convert the image to the requested format if the codec didn't */
+    if (image && options->format != SDL_PIXELFORMAT_UNKNOWN && image->format != options->format) {
+        SDL_Surface *converted = SDL_ConvertSurface(image, options->format);
+
+        SDL_DestroySurface(image);
+        image = converted;
+    }
+    if (image && options->premultiply_alpha && !options->premultiplied && SDL_ISPIXELFORMAT_ALPHA(image->format)) {
+        if (!SDL_PremultiplySurfaceAlpha(image, false)) {
+            SDL_DestroySurface(image);
+            image = NULL;
+        }
+    }
+
+    /* Copy the image into the destination surface if the codec didn't decode into it */
+    if (image && options->dst && image != options->dst) {
+        if (CopyIntoSurface(image, options->dst)) {
+            SDL_DestroySurface(image);
+            image = options->dst;
+            ++image->refcount;
+        } else {
+            SDL_DestroySurface(image);
+            image = NULL;
+        }
+    }
+
+    if (closeio) {
+        SDL_CloseIO(src);
+    }
+    return image;
+}
+
+/* Load an image from an SDL datasource, scaled down to fit within a maximum size */
+SDL_Surface *IMG_LoadScaled_IO(SDL_IOStream *src, bool closeio, int max_w, int max_h)
+{
+    IMG_LoadOptions options;
+
+    if (!src) {
+        SDL_InvalidParamError("src");
+        return NULL;
+    }
+    if (max_w <= 0 || max_h <= 0) {
+        SDL_SetError("Invalid maximum size %dx%d", max_w, max_h);
+        if (closeio) {
+            SDL_CloseIO(src);
+        }
+        return NULL;
+    }
+
+    SDL_zero(options);
+    options.max_w = max_w;
+    options.max_h = max_h;
+    return LoadWithOptions(src, closeio, NULL, &options);
+}
+
+/* Load an image from an SDL datasource, decoding it to a pixel format where the codec supports it */
+SDL_Surface *IMG_LoadFormatted_IO(SDL_IOStream *src, bool closeio, const char *type, SDL_PixelFormat format)
+{
+    IMG_LoadOptions options;
+
+    if (!src) {
+        SDL_InvalidParamError("src");
+        return NULL;
+    }
+
+    SDL_zero(options);
+    options.format = format;
+    return LoadWithOptions(src, closeio, type, &options);
+}
+
+/* Load an image from an SDL datasource into an existing surface */
+bool IMG_LoadInto_IO(SDL_IOStream *src, bool closeio, SDL_Surface *dst)
+{
+    IMG_LoadOptions options;
+    SDL_Surface *image;
+
+    if (!src) {
+        return SDL_InvalidParamError("src");
+    }
+    if (!dst) {
+        SDL_InvalidParamError("dst");
+        if (closeio) {
+            SDL_CloseIO(src);
+        }
+        return false;
+    }
+
+    SDL_zero(options);
+    options.dst = dst;
+    image = LoadWithOptions(src, closeio, NULL, &options);
+    if (!image) {
+        return false;
+    }
+
+    /* Release the reference added for the caller */
+    SDL_DestroySurface(image);
+    return true;
+}
+
+/* Load an image using a set of properties */
+SDL_Surface *IMG_LoadWithProperties(SDL_PropertiesID props)
+{
+    IMG_LoadOptions options;
+
+    if (!props) {
+        SDL_InvalidParamError("props");
+        return NULL;
+    }
+
+    const char *file = SDL_GetStringProperty(props, IMG_PROP_LOAD_FILENAME_STRING, NULL);
+    SDL_IOStream *src = SDL_GetPointerProperty(props, IMG_PROP_LOAD_IOSTREAM_POINTER, NULL);
+    bool closeio = SDL_GetBooleanProperty(props, IMG_PROP_LOAD_IOSTREAM_AUTOCLOSE_BOOLEAN, false);
+    const char *type = SDL_GetStringProperty(props, IMG_PROP_LOAD_TYPE_STRING, NULL);
+    bool map = SDL_GetBooleanProperty(props, IMG_PROP_LOAD_MAP_FILE_BOOLEAN, true);
+
+    SDL_zero(options);
+    options.crop.x = (int)SDL_GetNumberProperty(props, IMG_PROP_LOAD_CROP_X_NUMBER, 0);
+    options.crop.y = (int)SDL_GetNumberProperty(props, IMG_PROP_LOAD_CROP_Y_NUMBER, 0);
+    options.crop.w = (int)SDL_GetNumberProperty(props, IMG_PROP_LOAD_CROP_WIDTH_NUMBER, 0);
+    options.crop.h = (int)SDL_GetNumberProperty(props, IMG_PROP_LOAD_CROP_HEIGHT_NUMBER, 0);
+    options.max_w = (int)SDL_GetNumberProperty(props, IMG_PROP_LOAD_MAX_WIDTH_NUMBER, 0);
+    options.max_h = (int)SDL_GetNumberProperty(props, IMG_PROP_LOAD_MAX_HEIGHT_NUMBER, 0);
+    options.dst = (SDL_Surface *)SDL_GetPointerProperty(props, IMG_PROP_LOAD_SURFACE_POINTER, NULL);
+    options.format = (SDL_PixelFormat)SDL_GetNumberProperty(props, IMG_PROP_LOAD_FORMAT_NUMBER, SDL_PIXELFORMAT_UNKNOWN);
+    options.premultiply_alpha = SDL_GetBooleanProperty(props, IMG_PROP_LOAD_PREMULTIPLIED_ALPHA_BOOLEAN, false);
+    options.threads = (int)SDL_GetNumberProperty(props, IMG_PROP_LOAD_THREAD_COUNT_NUMBER, 1);
+    options.trusted = SDL_GetBooleanProperty(props, IMG_PROP_LOAD_TRUSTED_INPUT_BOOLEAN, false);
+    options.compact = SDL_GetBooleanProperty(props, IMG_PROP_LOAD_COMPACT_BOOLEAN, false);
+
+    if (!type || !*type) {
+        if (file) {
+            type = SDL_strrchr(file, '.');
+            if (type) {
+                // Skip the '.' in the file extension
+                ++type;
+            }
+        }
+    }
+
+    if (!src) {
+        if (!file) {
+            SDL_SetError("No input properties set");
+            return NULL;
+        }
+
+        src = IMG_OpenImageFile(file, map);
+        if (!src) {
+            return NULL;
+        }
+        closeio = true;
+    }
+
+    if (options.crop.x < 0 || options.crop.y < 0 || options.crop.w < 0 || options.crop.h < 0) {
+        SDL_SetError("Invalid crop rectangle");
+        goto error;
+    }
+
+    return LoadWithOptions(src, closeio, type, &options);
+
+error:
+    if (closeio) {
+        SDL_CloseIO(src);
+    }
+    return NULL;
+}
+
+typedef struct
+{
+    const char * const *files;
+    SDL_IOStream * const *streams;
+    int count;
+    SDL_Surface **surfaces;
+    char **errors;
+    SDL_PropertiesID props;
+    SDL_AtomicInt next;
+    SDL_AtomicInt failed;
+} IMG_LoadBatchState;
+
+static SDL_Surface *LoadBatchItem(IMG_LoadBatchState *batch, int index)
+{
+    SDL_PropertiesID props;
+    SDL_Surface *surface = NULL;
+
+    props = SDL_CreateProperties();
+    if (!props) {
+        return NULL;
+    }
+    if (!batch->props || SDL_CopyProperties(batch->props, props)) {
+        SDL_ClearProperty(props, IMG_PROP_LOAD_SURFACE_POINTER);
+        if (batch->files) {
+            SDL_ClearProperty(props, IMG_PROP_LOAD_IOSTREAM_POINTER);
+            SDL_SetStringProperty(props, IMG_PROP_LOAD_FILENAME_STRING, batch->files[index]);
+        } else {
+            SDL_ClearProperty(props, IMG_PROP_LOAD_FILENAME_STRING);
+            SDL_SetPointerProperty(props, IMG_PROP_LOAD_IOSTREAM_POINTER, batch->streams[index]);
+        }
+        surface = IMG_LoadWithProperties(props);
+    }
+    SDL_DestroyProperties(props);
+    return surface;
+}
+
+/* Load images from the batch until there are none left */
+static void LoadBatchItems(IMG_LoadBatchState *batch)
+{
+    for (;;) {
+        int index = SDL_AddAtomicInt(&batch->next, 1);
+        if (index >= batch->count) {
+            break;
+        }
+
+        batch->surfaces[index] = LoadBatchItem(batch, index);
+        if (!batch->surfaces[index]) {
+            SDL_AddAtomicInt(&batch->failed, 1);
+        }
+        if (batch->errors) {
+            batch->errors[index] = batch->surfaces[index] ? NULL : SDL_strdup(SDL_GetError());
+        }
+    }
+}
+
+static int SDLCALL LoadBatchThread(void *data)
+{
+    LoadBatchItems((IMG_LoadBatchState *)data);
+    return 0;
+}
+
+bool IMG_LoadBatch(const char * const *files, SDL_IOStream * const *streams, int count, SDL_Surface **surfaces, char **errors, SDL_PropertiesID props)
+{
+    IMG_LoadBatchState batch;
+    SDL_Thread **threads = NULL;
+    int num_threads, failed, i;
+
+    if (!files && !streams) {
+        return SDL_InvalidParamError("files");
+    }
+    if (count < 0) {
+        return SDL_InvalidParamError("count");
+    }
+    if (!surfaces && count > 0) {
+        return SDL_InvalidParamError("surfaces");
+    }
+
+    SDL_zero(batch);
+    batch.files = files;
+    batch.streams = streams;
+    batch.count = count;
+    batch.surfaces = surfaces;
+    batch.errors = errors;
+    batch.props = props;
+
+    num_threads = (int)SDL_GetNumberProperty(props, IMG_PROP_LOAD_BATCH_THREAD_COUNT_NUMBER, 0);
+    if (num_threads <= 0) {
+        num_threads = SDL_GetNumLogicalCPUCores();
+    }
+    num_threads = SDL_min(num_threads, count);
+
+    /* The calling thread loads images too, and any threads that can't be created are done without */
+    if (num_threads > 1) {
+        threads = (SDL_Thread **)SDL_calloc(num_threads - 1, sizeof(*threads));
+        if (threads) {
+            for (i = 0; i < num_threads - 1; ++i) {
+                threads[i] = SDL_CreateThread(LoadBatchThread, "SDL_image load", &batch);
+            }
+        }
+    }
+    LoadBatchItems(&batch);
+    if (threads) {
+        for (i = 0; i < num_threads - 1; ++i) {
+            if (threads[i]) {
+                SDL_WaitThread(threads[i], NULL);
+            }
+        }
+        SDL_free(threads);
+    }
+
+    failed = SDL_GetAtomicInt(&batch.failed);
+    if (failed > 0) {
+        return SDL_SetError("%d of %d images failed to load", failed, count);
+    }
+    return true;
+}
 
-/* Table of image detection and loading functions */
-static struct {
-    const char *type;
-    bool (SDLCALL *is)(SDL_IOStream *src);
-    SDL_Surface *(SDLCALL *load)(SDL_IOStream *src);
-} supported[] = {
-    /* keep magicless formats first */
-    { "TGA", NULL,      IMG_LoadTGA_IO },
-    { "AVIF",IMG_isAVIF,IMG_LoadAVIF_IO },
-    { "CUR", IMG_isCUR, IMG_LoadCUR_IO },
-    { "ICO", IMG_isICO, IMG_LoadICO_IO },
-    { "BMP", IMG_isBMP, IMG_LoadBMP_IO },
-    { "GIF", IMG_isGIF, IMG_LoadGIF_IO },
-    { "JPG", IMG_isJPG, IMG_LoadJPG_IO },
-    { "JXL", IMG_isJXL, IMG_LoadJXL_IO },
-    { "LBM", IMG_isLBM, IMG_LoadLBM_IO },
-    { "PCX", IMG_isPCX, IMG_LoadPCX_IO },
-    { "PNG", IMG_isPNG, IMG_LoadPNG_IO },
-    { "PNM", IMG_isPNM, IMG_LoadPNM_IO }, /* P[BGP]M share code */
-    { "SVG", IMG_isSVG, IMG_LoadSVG_IO },
-    { "TIF", IMG_isTIF, IMG_LoadTIF_IO },
-    { "XCF", IMG_isXCF, IMG_LoadXCF_IO },
-    { "XPM", IMG_isXPM, IMG_LoadXPM_IO },
-    { "XV",  IMG_isXV,  IMG_LoadXV_IO  },
-    { "WEBP", IMG_isWEBP, IMG_LoadWEBP_IO },
-    { "QOI", IMG_isQOI, IMG_LoadQOI_IO },
+struct IMG_AsyncLoad
+{
+    IMG_AsyncLoad *next;    /* the next load in the queue */
+    char *file;
+    SDL_IOStream *src;
+    bool closeio;
+    IMG_AsyncLoadCallback callback;
+    void *userdata;
+    SDL_AtomicInt cancelled;
+    SDL_AtomicInt done;
+    SDL_Surface *surface;
+    char *error;    /* the error from the load thread, if the load failed */
 };
 
-/* Table of animation detection and loading functions */
-static struct {
-    const char *type;
-    bool (SDLCALL *is)(SDL_IOStream *src);
-    IMG_Animation *(SDLCALL *load)(SDL_IOStream *src);
-} supported_anims[] = {
-    /* keep magicless formats first */
-    { "GIF", IMG_isGIF, IMG_LoadGIFAnimation_IO     },
-    { "WEBP", IMG_isWEBP, IMG_LoadWEBPAnimation_IO  },
-    { "APNG", IMG_isPNG, IMG_LoadAPNGAnimation_IO   },
-    { "AVIFS", IMG_isAVIF, IMG_LoadAVIFAnimation_IO },
-    { "ANI", IMG_isANI, IMG_LoadANIAnimation_IO },
-};
+/* Asynchronous loads are queued for a small pool of threads, which is started on first use */
+#define MAX_ASYNC_LOAD_THREADS  4
 
-int IMG_Version(void)
+static struct
 {
-    return SDL_IMAGE_VERSION;
+    SDL_InitState init;
+    SDL_Mutex *lock;
+    SDL_Condition *work;    /* signaled when a load is queued */
+    SDL_Condition *done;    /* broadcast when a load finishes */
+    IMG_AsyncLoad *head;
+    IMG_AsyncLoad *tail;
+    int queued;
+    int num_threads;
+    int idle_threads;
+} async_pool;
+
+/* The cancellation flag of the asynchronous load running on this thread */
+static SDL_TLSID async_load_tls;
+
+SDL_AtomicInt *IMG_GetLoadCancelledFlag(void)
+{
+    return (SDL_AtomicInt *)SDL_GetTLS(&async_load_tls);
 }
 
-#if !defined(__APPLE__) || defined(SDL_IMAGE_USE_COMMON_BACKEND)
-/* Load an image from a file */
-SDL_Surface *IMG_Load(const char *file)
+bool IMG_LoadCancelled(void)
 {
-#ifdef __EMSCRIPTEN__
-    int w, h;
-    char *data;
-    SDL_Surface *surf;
+    SDL_AtomicInt *cancelled = IMG_GetLoadCancelledFlag();
 
-    data = emscripten_get_preloaded_image_data(file, &w, &h);
-    if (data != NULL) {
-        surf = SDL_CreateSurface(w, h, SDL_PIXELFORMAT_RGBA32);
-        if (surf != NULL) {
-            SDL_memcpy(surf->pixels, data, w * h * 4);
+    if (cancelled && SDL_GetAtomicInt(cancelled)) {
+        SDL_SetError("Load cancelled");
+        return true;
+    }
+    return false;
+}
+
+static void RunAsyncLoad(IMG_AsyncLoad *load)
+{
+    SDL_Surface *surface = NULL;
+
+    SDL_SetTLS(&async_load_tls, &load->cancelled, NULL);
+    if (IMG_LoadCancelled()) {
+        if (load->src && load->closeio) {
+            SDL_CloseIO(load->src);
         }
-        free(data); /* This should NOT be SDL_free() */
-        return surf;
+    } else if (load->file) {
+        surface = IMG_Load(load->file);
+    } else {
+        surface = IMG_Load_IO(load->src, load->closeio);
     }
-#endif
+    if (surface && IMG_LoadCancelled()) {
+        SDL_DestroySurface(surface);
+        surface = NULL;
+    }
+    SDL_SetTLS(&async_load_tls, NULL, NULL);
 
-    SDL_IOStream *src = SDL_IOFromFile(file, "rb");
-    if (!src) {
-        /* The error message has been set in SDL_IOFromFile */
-        return NULL;
+    if (load->callback) {
+        load->callback(load->userdata, surface);
+    } else {
+        load->surface = surface;
+        if (!surface) {
+            /* The error is thread-local, so keep a copy for IMG_WaitAsyncLoad() */
+            load->error = SDL_strdup(SDL_GetError());
+        }
     }
+}
 
-    const char *ext = SDL_strrchr(file, '.');
-    if (ext) {
-        ext++;
+static int SDLCALL AsyncLoadThread(void *data)
+{
+    IMG_AsyncLoad *load;
+
+    (void)data;
+
+    for (;;) {
+        SDL_LockMutex(async_pool.lock);
+        while (!async_pool.head) {
+            ++async_pool.idle_threads;
+            SDL_WaitCondition(async_pool.work, async_pool.lock);
+            --async_pool.idle_threads;
+        }
+        load = async_pool.head;
+        async_pool.head = load->next;
+        if (!async_pool.head) {
+            async_pool.tail = NULL;
+        }
+        --async_pool.queued;
+        SDL_UnlockMutex(async_pool.lock);
+
+        RunAsyncLoad(load);
+
+        /* The load may be freed as soon as it's marked done, so it isn't touched after that */
+        SDL_LockMutex(async_pool.lock);
+        SDL_SetAtomicInt(&load->done, 1);
+        SDL_BroadcastCondition(async_pool.done);
+        SDL_UnlockMutex(async_pool.lock);
     }
-    return IMG_LoadTyped_IO(src, true, ext);
+    return 0;
 }
-#endif
 
-/* Load an image from an SDL datasource (for compatibility) */
-SDL_Surface *IMG_Load_IO(SDL_IOStream *src, bool closeio)
+static bool InitAsyncPool(void)
 {
-    return IMG_LoadTyped_IO(src, closeio, NULL);
+    if (SDL_ShouldInit(&async_pool.init)) {
+        async_pool.lock = SDL_CreateMutex();
+        async_pool.work = SDL_CreateCondition();
+        async_pool.done = SDL_CreateCondition();
+        if (!async_pool.lock || !async_pool.work || !async_pool.done) {
+            SDL_DestroyCondition(async_pool.done);
+            SDL_DestroyCondition(async_pool.work);
+            SDL_DestroyMutex(async_pool.lock);
+            async_pool.lock = NULL;
+            async_pool.work = NULL;
+            async_pool.done = NULL;
+            SDL_SetInitialized(&async_pool.init, false);
+            return false;
+        }
+        SDL_SetInitialized(&async_pool.init, true);
+    }
+    return (SDL_GetAtomicInt(&async_pool.init.status) == SDL_INIT_STATUS_INITIALIZED);
 }
 
-/* Load an image from an SDL datasource, optionally specifying the type */
-SDL_Surface *IMG_LoadTyped_IO(SDL_IOStream *src, bool closeio, const char *type)
+static IMG_AsyncLoad *StartAsyncLoad(IMG_AsyncLoad *load)
 {
-    size_t i;
-    SDL_Surface *image;
+    int max_threads;
+    bool queued = false;
+
+    if (InitAsyncPool()) {
+        max_threads = SDL_clamp(SDL_GetNumLogicalCPUCores(), 1, MAX_ASYNC_LOAD_THREADS);
+
+        SDL_LockMutex(async_pool.lock);
+        /* Only start another thread if the idle ones can't take every queued load */
+        if (async_pool.queued >= async_pool.idle_threads && async_pool.num_threads < max_threads) {
+            SDL_Thread *thread = SDL_CreateThread(AsyncLoadThread, "SDL_image async load", NULL);
+            if (thread) {
+                SDL_DetachThread(thread);
+                ++async_pool.num_threads;
+            }
+        }
+        if (async_pool.num_threads > 0) {
+            if (async_pool.tail) {
+                async_pool.tail->next = load;
+            } else {
+                async_pool.head = load;
+            }
+            async_pool.tail = load;
+            ++async_pool.queued;
+            SDL_SignalCondition(async_pool.work);
+            queued = true;
+        }
+        SDL_UnlockMutex(async_pool.lock);
+    }
+
+    if (!queued) {
+        if (load->src && load->closeio) {
+            SDL_CloseIO(load->src);
+        }
+        SDL_free(load->file);
+        SDL_free(load);
+        return NULL;
+    }
+    return load;
+}
+
+IMG_AsyncLoad *IMG_LoadAsync(const char *file, IMG_AsyncLoadCallback callback, void *userdata)
+{
+    IMG_AsyncLoad *load;
+
+    if (!file) {
+        SDL_InvalidParamError("file");
+        return NULL;
+    }
+
+    load = (IMG_AsyncLoad *)SDL_calloc(1, sizeof(*load));
+    if (!load) {
+        return NULL;
+    }
+    load->file = SDL_strdup(file);
+    if (!load->file) {
+        SDL_free(load);
+        return NULL;
+    }
+    load->callback = callback;
+    load->userdata = userdata;
+    return StartAsyncLoad(load);
+}
+
+IMG_AsyncLoad *IMG_LoadAsync_IO(SDL_IOStream *src, bool closeio, IMG_AsyncLoadCallback callback, void *userdata)
+{
+    IMG_AsyncLoad *load;
 
-    /* Make sure there is something to do.. */
     if (!src) {
         SDL_InvalidParamError("src");
         return NULL;
     }
 
-    /* See whether or not this data source can handle seeking */
-    if (SDL_SeekIO(src, 0, SDL_IO_SEEK_CUR) < 0) {
-        SDL_SetError("Can't seek in this data source");
+    load = (IMG_AsyncLoad *)SDL_calloc(1, sizeof(*load));
+    if (!load) {
         if (closeio) {
             SDL_CloseIO(src);
         }
         return NULL;
     }
+    load->src = src;
+    load->closeio = closeio;
+    load->callback = callback;
+    load->userdata = userdata;
+    return StartAsyncLoad(load);
+}
 
-#ifdef __EMSCRIPTEN__
-    /*load through preloadedImages*/
-    FILE *fp = (FILE *)SDL_GetPointerProperty(SDL_GetIOProperties(src), SDL_PROP_IOSTREAM_STDIO_FILE_POINTER, NULL);
-    if (fp) {
-        int w, h;
-        char *data;
+void IMG_CancelAsyncLoad(IMG_AsyncLoad *load)
+{
+    if (load) {
+        SDL_SetAtomicInt(&load->cancelled, 1);
+    }
+}
 
-        data = emscripten_get_preloaded_image_data_from_FILE(fp, &w, &h);
-        if (data) {
-            image = SDL_CreateSurface(w, h, SDL_PIXELFORMAT_RGBA32);
-            if (image != NULL) {
-                SDL_memcpy(image->pixels, data, w * h * 4);
-            }
-            free(data); /* This should NOT be SDL_free() */
+bool IMG_IsAsyncLoadDone(IMG_AsyncLoad *load)
+{
+    if (!load) {
+        return SDL_InvalidParamError("load");
+    }
+    return (SDL_GetAtomicInt(&load->done) != 0);
+}
 
-            if (closeio) {
-                SDL_CloseIO(src);
-            }
+SDL_Surface *IMG_WaitAsyncLoad(IMG_AsyncLoad *load)
+{
+    SDL_Surface *surface;
 
-            /* If SDL_CreateSurface returns NULL, it has set the error message for us */
-            return image;
-        }
+    if (!load) {
+        SDL_InvalidParamError("load");
+        return NULL;
     }
-#endif
 
-    /* Detect the type of image being loaded */
-    for (i = 0; i < SDL_arraysize(supported); ++i) {
-        if (supported[i].is) {
-            if (!supported[i].is(src)) {
-                continue;
-            }
-        } else {
-            /* magicless format */
-            if (!type || SDL_strcasecmp(type, supported[i].type) != 0) {
-                continue;
-            }
-        }
-#ifdef DEBUG_IMGLIB
-        SDL_Log("IMGLIB: Loading image as %s\n", supported[i].type);
-#endif
-        image = supported[i].load(src);
-        if (closeio) {
-            SDL_CloseIO(src);
-        }
-        return image;
+    SDL_LockMutex(async_pool.lock);
+    while (!SDL_GetAtomicInt(&load->done)) {
+        SDL_WaitCondition(async_pool.done, async_pool.lock);
     }
+    SDL_UnlockMutex(async_pool.lock);
 
-    if (closeio) {
-        SDL_CloseIO(src);
+    surface = load->surface;
+    if (!surface && load->error) {
+        SDL_SetError("%s", load->error);
     }
-    SDL_SetError("Unsupported image format");
-    return NULL;
+    SDL_free(load->error);
+    SDL_free(load->file);
+    SDL_free(load);
+    return surface;
 }
 
 SDL_Texture *IMG_LoadTexture(SDL_Renderer *renderer, const char *file)
@@ -246,7 +3201,7 @@ SDL_Texture *IMG_LoadTextureTyped_IO(SDL_Renderer *renderer, SDL_IOStream *src,
 /* Load an animation from a file */
 IMG_Animation *IMG_LoadAnimation(const char *file)
 {
-    SDL_IOStream *src = SDL_IOFromFile(file, "rb");
+    SDL_IOStream *src = IMG_OpenImageFile(file, true);
     const char *ext = SDL_strrchr(file, '.');
     if (ext) {
         ext++;
@@ -268,6 +3223,7 @@ IMG_Animation *IMG_LoadAnimation_IO(SDL_IOStream *src, bool closeio)
 IMG_Animation *IMG_LoadAnimationTyped_IO(SDL_IOStream *src, bool closeio, const char *type)
 {
     size_t i;
+    const char *format;
     IMG_Animation *anim;
     SDL_Surface *image;
 
@@ -277,35 +3233,35 @@ IMG_Animation *IMG_LoadAnimationTyped_IO(SDL_IOStream *src, bool closeio, const
         return NULL;
     }
 
-    /* See whether or not this data source can handle seeking */
+    /* Animation decoders seek back to the start, so read all of a data source that can't seek */
     if (SDL_SeekIO(src, 0, SDL_IO_SEEK_CUR) < 0) {
-        SDL_SetError("Can't seek in this data source");
-        if (closeio) {
+        src = OpenRewindStream(src, closeio);
+        if (!src) {
+            return NULL;
+        }
+        closeio = true;
+        if (!SpoolRewindStream(src)) {
             SDL_CloseIO(src);
+            return NULL;
         }
-        return NULL;
     }
 
     /* Detect the type of image being loaded */
-    for (i = 0; i < SDL_arraysize(supported_anims); ++i) {
-        if (supported_anims[i].is) {
-            if (!supported_anims[i].is(src)) {
-                continue;
-            }
-        } else {
-            /* magicless format */
-            if (!type || SDL_strcasecmp(type, supported_anims[i].type) != 0) {
+    format = IMG_DetectFormat_IO(src);
+    if (format) {
+        for (i = 0; i < SDL_arraysize(supported_anims); ++i) {
+            if (SDL_strcmp(format, supported_anims[i].format) != 0) {
                 continue;
             }
-        }
 #ifdef DEBUG_IMGLIB
-        SDL_Log("IMGLIB: Loading image as %s\n", supported_anims[i].type);
+            SDL_Log("IMGLIB: Loading image as %s\n", supported_anims[i].type);
 #endif
-        anim = supported_anims[i].load(src);
-        if (closeio) {
-            SDL_CloseIO(src);
+            anim = supported_anims[i].load(src);
+            if (closeio) {
+                SDL_CloseIO(src);
+            }
+            return anim;
         }
-        return anim;
     }
 
     /* Create a single frame animation from an image */
@@ -563,6 +3519,292 @@ Uint64 IMG_TimebaseDuration(Uint64 pts, Uint64 duration, Uint64 src_numerator, U
     return (a - b);
 }
 
+void IMG_GetOrientedSize(int orientation, int width, int height, int *oriented_w, int *oriented_h)
+{
+    if (orientation >= 5 && orientation <= 8) {
+        *oriented_w = height;
+        *oriented_h = width;
+    } else {
+        *oriented_w = width;
+        *oriented_h = height;
+    }
+}
+
+/* The size of the square tiles used to transpose pixels, which keeps the source and destination rows of a tile in cache */
+#define ORIENT_TILE_SIZE    32
+
+/* Copy pixels so that moving right in the source moves by step_x bytes in the destination, and moving down moves by step_y bytes */
+static void CopyOrientedTile(const Uint8 *src, int src_pitch, Uint8 *dst, intptr_t step_x, intptr_t step_y, int w, int h, int bpp)
+{
+    int x, y;
+
+    for (y = 0; y < h; ++y, src += src_pitch, dst += step_y) {
+        const Uint8 *s = src;
+        Uint8 *d = dst;
+
+        switch (bpp) {
+        case 1:
+            for (x = 0; x < w; ++x, s += 1, d += step_x) {
+                *d = *s;
+            }
+            break;
+        case 2:
+            for (x = 0; x < w; ++x, s += 2, d += step_x) {
+                *(Uint16 *)d = *(const Uint16 *)s;
+            }
+            break;
+        case 3:
+            for (x = 0; x < w; ++x, s += 3, d += step_x) {
+                d[0] = s[0];
+                d[1] = s[1];
+                d[2] = s[2];
+            }
+            break;
+        case 4:
+            for (x = 0; x < w; ++x, s += 4, d += step_x) {
+                *(Uint32 *)d = *(const Uint32 *)s;
+            }
+            break;
+        default:
+            for (x = 0; x < w; ++x, s += bpp, d += step_x) {
+                SDL_memcpy(d, s, bpp);
+            }
+            break;
+        }
+    }
+}
+
+/* Transpose a square block of pixels, so each source column is stored as a destination row */
+typedef void (*TransposeBlockFunc)(const Uint8 *src, intptr_t src_pitch, Uint8 *dst, intptr_t dst_pitch);
+
+#ifdef SDL_SSE2_INTRINSICS
+static void SDL_TARGETING("sse2") TransposeBlock8_SSE2(const Uint8 *src, intptr_t src_pitch, Uint8 *dst, intptr_t dst_pitch)
+{
+    __m128i a0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)src), _mm_loadl_epi64((const __m128i *)(src + src_pitch)));
+    __m128i a1 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(src + 2 * src_pitch)), _mm_loadl_epi64((const __m128i *)(src + 3 * src_pitch)));
+    __m128i a2 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(src + 4 * src_pitch)), _mm_loadl_epi64((const __m128i *)(src + 5 * src_pitch)));
+    __m128i a3 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(src + 6 * src_pitch)), _mm_loadl_epi64((const __m128i *)(src + 7 * src_pitch)));
+    __m128i b0 = _mm_unpacklo_epi16(a0, a1);
+    __m128i b1 = _mm_unpackhi_epi16(a0, a1);
+    __m128i b2 = _mm_unpacklo_epi16(a2, a3);
+    __m128i b3 = _mm_unpackhi_epi16(a2, a3);
+    __m128i c0 = _mm_unpacklo_epi32(b0, b2);
+    __m128i c1 = _mm_unpackhi_epi32(b0, b2);
+    __m128i c2 = _mm_unpacklo_epi32(b1, b3);
+    __m128i c3 = _mm_unpackhi_epi32(b1, b3);
+
+    _mm_storel_epi64((__m128i *)dst, c0);
+    _mm_storel_epi64((__m128i *)(dst + dst_pitch), _mm_srli_si128(c0, 8));
+    _mm_storel_epi64((__m128i *)(dst + 2 * dst_pitch), c1);
+    _mm_storel_epi64((__m128i *)(dst + 3 * dst_pitch), _mm_srli_si128(c1, 8));
+    _mm_storel_epi64((__m128i *)(dst + 4 * dst_pitch), c2);
+    _mm_storel_epi64((__m128i *)(dst + 5 * dst_pitch), _mm_srli_si128(c2, 8));
+    _mm_storel_epi64((__m128i *)(dst + 6 * dst_pitch), c3);
+    _mm_storel_epi64((__m128i *)(dst + 7 * dst_pitch), _mm_srli_si128(c3, 8));
+}
+
+static void SDL_TARGETING("sse2") TransposeBlock32_SSE2(const Uint8 *src, intptr_t src_pitch, Uint8 *dst, intptr_t dst_pitch)
+{
+    __m128i r0 = _mm_loadu_si128((const __m128i *)src);
+    __m128i r1 = _mm_loadu_si128((const __m128i *)(src + src_pitch));
+    __m128i r2 = _mm_loadu_si128((const __m128i *)(src + 2 * src_pitch));
+    __m128i r3 = _mm_loadu_si128((const __m128i *)(src + 3 * src_pitch));
+    __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+    __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+    __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+    __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+    _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi64(t0, t1));
+    _mm_storeu_si128((__m128i *)(dst + dst_pitch), _mm_unpackhi_epi64(t0, t1));
+    _mm_storeu_si128((__m128i *)(dst + 2 * dst_pitch), _mm_unpacklo_epi64(t2, t3));
+    _mm_storeu_si128((__m128i *)(dst + 3 * dst_pitch), _mm_unpackhi_epi64(t2, t3));
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
+#ifdef SDL_NEON_INTRINSICS
+static void TransposeBlock32_NEON(const Uint8 *src, intptr_t src_pitch, Uint8 *dst, intptr_t dst_pitch)
+{
+    uint32x4x2_t t0 = vtrnq_u32(vld1q_u32((const uint32_t *)src), vld1q_u32((const uint32_t *)(src + src_pitch)));
+    uint32x4x2_t t1 = vtrnq_u32(vld1q_u32((const uint32_t *)(src + 2 * src_pitch)), vld1q_u32((const uint32_t *)(src + 3 * src_pitch)));
+
+    vst1q_u32((uint32_t *)dst, vcombine_u32(vget_low_u32(t0.val[0]), vget_low_u32(t1.val[0])));
+    vst1q_u32((uint32_t *)(dst + dst_pitch), vcombine_u32(vget_low_u32(t0.val[1]), vget_low_u32(t1.val[1])));
+    vst1q_u32((uint32_t *)(dst + 2 * dst_pitch), vcombine_u32(vget_high_u32(t0.val[0]), vget_high_u32(t1.val[0])));
+    vst1q_u32((uint32_t *)(dst + 3 * dst_pitch), vcombine_u32(vget_high_u32(t0.val[1]), vget_high_u32(t1.val[1])));
+}
+#endif /* SDL_NEON_INTRINSICS */
+
+/* Get the fastest block transpose available for a pixel size, if there is one */
+static TransposeBlockFunc GetTransposeBlockFunc(int bpp, int *block_size)
+{
+#ifdef SDL_SSE2_INTRINSICS
+    if (SDL_HasSSE2()) {
+        if (bpp == 1) {
+            *block_size = 8;
+            return TransposeBlock8_SSE2;
+        }
+        if (bpp == 4) {
+            *block_size = 4;
+            return TransposeBlock32_SSE2;
+        }
+    }
+#endif
+#ifdef SDL_NEON_INTRINSICS
+    if (bpp == 4) {
+        *block_size = 4;
+        return TransposeBlock32_NEON;
+    }
+#endif
+    *block_size = 0;
+    return NULL;
+}
+
+/* Copy a tile whose rows become destination columns, transposing whole blocks at a time */
+static void CopyTransposedTile(const Uint8 *src, int src_pitch, Uint8 *dst, intptr_t step_x, intptr_t step_y, int w, int h, int bpp, TransposeBlockFunc transpose, int block_size)
+{
+    int block_w, block_h, bx, by;
+
+    if (!transpose) {
+        CopyOrientedTile(src, src_pitch, dst, step_x, step_y, w, h, bpp);
+        return;
+    }
+
+    block_w = w - (w % block_size);
+    block_h = h - (h % block_size);
+    for (by = 0; by < block_h; by += block_size) {
+        const Uint8 *s = src + by * src_pitch;
+        Uint8 *d = dst + by * step_y;
+
+        for (bx = 0; bx < block_w; bx += block_size) {
+            if (step_y > 0) {
+                transpose(s + bx * bpp, src_pitch, d + bx * step_x, step_x);
+            } else {
+                /* The source rows run backwards in the destination, so transpose them bottom up */
+                transpose(s + bx * bpp + (block_size - 1) * src_pitch, -src_pitch,
+                          d + bx * step_x + (block_size - 1) * step_y, step_x);
+            }
+        }
+    }
+
+    /* Copy the partial blocks along the right and bottom edges */
+    if (block_w < w) {
+        CopyOrientedTile(src + block_w * bpp, src_pitch, dst + block_w * step_x, step_x, step_y, w - block_w, h, bpp);
+    }
+    if (block_h < h) {
+        CopyOrientedTile(src + block_h * src_pitch, src_pitch, dst + block_h * step_y, step_x, step_y, block_w, h - block_h, bpp);
+    }
+}
+
+void IMG_CopyOrientedPixels(const void *pixels, int pitch, int x, int y, int w, int h, SDL_Surface *dst, int orientation)
+{
+    const int bpp = SDL_BYTESPERPIXEL(dst->format);
+    const intptr_t dst_pitch = dst->pitch;
+    TransposeBlockFunc transpose;
+    int block_size;
+    int width, height, tx, ty;
+    intptr_t step_x, step_y;
+    Uint8 *origin;
+
+    /* The size of the image before it is oriented */
+    IMG_GetOrientedSize(orientation, dst->w, dst->h, &width, &height);
+
+    /* Find where the source pixel (0, 0) goes, and which way the source rows and columns run in the destination */
+    origin = (Uint8 *)dst->pixels;
+    switch (orientation) {
+    case 2:
+        origin += (width - 1) * bpp;
+        step_x = -bpp;
+        step_y = dst_pitch;
+        break;
+    case 3:
+        origin += (height - 1) * dst_pitch + (width - 1) * bpp;
+        step_x = -bpp;
+        step_y = -dst_pitch;
+        break;
+    case 4:
+        origin += (height - 1) * dst_pitch;
+        step_x = bpp;
+        step_y = -dst_pitch;
+        break;
+    case 5:
+        step_x = dst_pitch;
+        step_y = bpp;
+        break;
+    case 6:
+        origin += (height - 1) * bpp;
+        step_x = dst_pitch;
+        step_y = -bpp;
+        break;
+    case 7:
+        origin += (width - 1) * dst_pitch + (height - 1) * bpp;
+        step_x = -dst_pitch;
+        step_y = -bpp;
+        break;
+    case 8:
+        origin += (width - 1) * dst_pitch;
+        step_x = -dst_pitch;
+        step_y = bpp;
+        break;
+    default:
+        origin += y * dst_pitch + x * bpp;
+        for (ty = 0; ty < h; ++ty) {
+            SDL_memcpy(origin + ty * dst_pitch, (const Uint8 *)pixels + ty * pitch, (size_t)w * bpp);
+        }
+        return;
+    }
+    origin += x * step_x + y * step_y;
+
+    if (orientation <= 4) {
+        /* Rows stay rows, so copy them one at a time */
+        CopyOrientedTile((const Uint8 *)pixels, pitch, origin, step_x, step_y, w, h, bpp);
+        return;
+    }
+
+    /* Rows become columns, so copy in tiles */
+    transpose = GetTransposeBlockFunc(bpp, &block_size);
+    for (ty = 0; ty < h; ty += ORIENT_TILE_SIZE) {
+        for (tx = 0; tx < w; tx += ORIENT_TILE_SIZE) {
+            CopyTransposedTile((const Uint8 *)pixels + ty * pitch + tx * bpp, pitch,
+                               origin + tx * step_x + ty * step_y, step_x, step_y,
+                               SDL_min(ORIENT_TILE_SIZE, w - tx), SDL_min(ORIENT_TILE_SIZE, h - ty), bpp,
+                               transpose, block_size);
+        }
+    }
+}
+
+#ifndef ORIENTATION_USES_PROPERTIES
+/* Create a copy of a surface with an EXIF orientation applied, moving each pixel once */
+static SDL_Surface *CreateOrientedSurface(SDL_Surface *surface, int orientation)
+{
+    SDL_Surface *oriented;
+    SDL_Palette *palette;
+    SDL_BlendMode blend_mode;
+    Uint32 colorkey;
+    int w, h;
+
+    IMG_GetOrientedSize(orientation, surface->w, surface->h, &w, &h);
+    oriented = SDL_CreateSurface(w, h, surface->format);
+    if (!oriented) {
+        return NULL;
+    }
+
+    palette = SDL_GetSurfacePalette(surface);
+    if (palette) {
+        SDL_SetSurfacePalette(oriented, palette);
+    }
+    if (SDL_GetSurfaceColorKey(surface, &colorkey)) {
+        SDL_SetSurfaceColorKey(oriented, true, colorkey);
+    }
+    if (SDL_GetSurfaceBlendMode(surface, &blend_mode)) {
+        SDL_SetSurfaceBlendMode(oriented, blend_mode);
+    }
+    SDL_SetSurfaceColorspace(oriented, SDL_GetSurfaceColorspace(surface));
+
+    IMG_CopyOrientedPixels(surface->pixels, surface->pitch, 0, 0, surface->w, surface->h, oriented, orientation);
+    return oriented;
+}
+#endif
+
 SDL_Surface *IMG_ApplyOrientation(SDL_Surface *surface, int orientation)
 {
     float rotation = 0.0f;
@@ -615,6 +3857,11 @@ SDL_Surface *IMG_ApplyOrientation(SDL_Surface *surface, int orientation)
         SDL_SetFloatProperty(props, SDL_PROP_SURFACE_ROTATION_FLOAT, rotation);
     }
 #else
+    if (rotation != 0.0f && SDL_BYTESPERPIXEL(surface->format) > 0 && !SDL_MUSTLOCK(surface)) {
+        SDL_Surface *tmp = CreateOrientedSurface(surface, orientation);
+        SDL_DestroySurface(surface);
+        return tmp;
+    }
     if (flip != SDL_FLIP_NONE) {
         if (!SDL_FlipSurface(surface, flip)) {
             SDL_DestroySurface(surface);
@@ -22,3 +22,73 @@
 #include <SDL3_image/SDL_image.h>
 
 extern bool IMG_VerifyCanSaveSurface(SDL_Surface *surface);
+extern bool IMG_GetJXLInfo(const Uint8 *data, size_t size, int *width, int *height, int *bit_depth, bool *has_alpha, int *orientation, bool *animated);
+extern void IMG_GetScaledSize(int width, int height, int max_w, int max_h, int *scaled_w, int *scaled_h);
+
+/* Options for loading an image, applied natively by the codecs that support them.
+ *
+ * The crop rectangle is applied before scaling. A codec that applies the crop
+ * sets `cropped` and returns exactly the crop rectangle, clipped to the image.
+ * A codec that can't crop must not scale when a crop is requested, and one that
+ * scales may return an image larger than the maximum size, which is then
+ * reduced to fit by the caller.
+ *
+ * Codecs create their output surface with IMG_CreateLoadSurface(), which hands
+ * out the destination surface when the output matches it, so the image is
+ * decoded in place. Otherwise the caller copies the result into it.
+ *
+ * Codecs decode to the requested pixel format where they can, and the caller
+ * converts anything else. Alpha is premultiplied by the caller unless the
+ * codec sets `premultiplied`.
+ */
+typedef struct IMG_LoadOptions
+{
+    SDL_Rect crop;      /* the region of the image to load, empty for the whole image */
+    int max_w;          /* the maximum size of the loaded image, 0 for no maximum */
+    int max_h;
+    bool cropped;       /* set by codecs that applied the crop rectangle */
+    SDL_Surface *dst;   /* the surface to decode into, or NULL */
+    SDL_PixelFormat format; /* the requested pixel format, or SDL_PIXELFORMAT_UNKNOWN */
+    bool premultiply_alpha;
+    bool premultiplied; /* set by codecs that premultiplied the alpha channel */
+    int threads;        /* the number of threads a codec may use to decode the image */
+    bool trusted;       /* the data is known to be valid, so codecs may skip integrity checks */
+    bool compact;       /* codecs may keep images in a smaller pixel format than RGBA */
+} IMG_LoadOptions;
+
+extern SDL_Surface *IMG_CreateLoadSurface(IMG_LoadOptions *options, int width, int height, SDL_PixelFormat format);
+extern SDL_Surface *IMG_CreateLoadSurfaceFrom(IMG_LoadOptions *options, int width, int height, SDL_PixelFormat format, void *pixels, int pitch);
+extern SDL_Surface *IMG_LoadFormatted_IO(SDL_IOStream *src, bool closeio, const char *type, SDL_PixelFormat format);
+
+/* Open a file for loading, mapping regular files into memory where possible
+ * if map is true, and reading them with SDL_IOFromFile() otherwise.
+ */
+extern SDL_IOStream *IMG_OpenImageFile(const char *file, bool map);
+
+/* Read data from the current position in a stream, pointing directly into the
+ * stream's memory when it is memory-backed (SDL_IOFromMem(), SDL_IOFromConstMem()
+ * or a file mapped by IMG_Load()) and reading a copy otherwise. A size of 0 reads
+ * to the end of the stream. The data must be released with IMG_FreeIOData().
+ */
+extern const Uint8 *IMG_ReadIOData(SDL_IOStream *src, size_t size, size_t *datasize, bool *allocated);
+extern void IMG_FreeIOData(const Uint8 *data, bool allocated);
+
+/* Returns true and sets an error if the load running on this thread was
+ * cancelled with IMG_CancelAsyncLoad(). Decoders check this between rows or
+ * frames so a cancelled load stops promptly.
+ */
+extern bool IMG_LoadCancelled(void);
+
+/* Returns the cancellation flag of the load running on this thread, or NULL.
+ * The flag is thread-local, so decoders that split work across threads pass
+ * it to their workers rather than calling IMG_LoadCancelled() there.
+ */
+extern SDL_AtomicInt *IMG_GetLoadCancelledFlag(void);
+
+extern SDL_Surface *IMG_LoadJPGWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options);
+extern SDL_Surface *IMG_LoadPNGWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options);
+extern SDL_Surface *IMG_LoadPNMWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options);
+extern SDL_Surface *IMG_LoadQOIWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options);
+extern SDL_Surface *IMG_LoadTGAWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options);
+extern SDL_Surface *IMG_LoadTIFWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options);
+extern SDL_Surface *IMG_LoadWEBPWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options);
@@ -26,31 +26,41 @@
 #include <initguid.h>
 #include <wincodec.h>
 
+static SDL_InitState wicInit;
 static IWICImagingFactory* wicFactory = NULL;
 
-bool WIC_Init(void)
+static bool WIC_CreateFactory(void)
 {
-    if (wicFactory == NULL) {
-        HRESULT hr = CoCreateInstance(
-            &CLSID_WICImagingFactory,
-            NULL,
-            CLSCTX_INPROC_SERVER,
-            &IID_IWICImagingFactory,
-            (void**)&wicFactory
-        );
-        if (FAILED(hr)) {
-            return false;
-        }
+    HRESULT hr = CoCreateInstance(
+        &CLSID_WICImagingFactory,
+        NULL,
+        CLSCTX_INPROC_SERVER,
+        &IID_IWICImagingFactory,
+        (void**)&wicFactory
+    );
+    if (FAILED(hr)) {
+        return false;
     }
 
     return true;
 }
 
+bool WIC_Init(void)
+{
+    /* Loads may run on several threads at once, the first one creates the factory */
+    if (SDL_ShouldInit(&wicInit)) {
+        SDL_SetInitialized(&wicInit, WIC_CreateFactory());
+    }
+    return (SDL_GetAtomicInt(&wicInit.status) == SDL_INIT_STATUS_INITIALIZED);
+}
+
 #if 0
 static void WIC_Quit(void)
 {
-    if (wicFactory) {
+    if (SDL_ShouldQuit(&wicInit)) {
         IWICImagingFactory_Release(wicFactory);
+        wicFactory = NULL;
+        SDL_SetInitialized(&wicInit, false);
     }
 }
 #endif // 0
@@ -21,6 +21,7 @@
 
 #include <SDL3_image/SDL_image.h>
 
+#include "IMG.h"
 #include "IMG_anim_decoder.h"
 #include "IMG_ani.h"
 #include "IMG_avif.h"
@@ -151,6 +152,7 @@ IMG_AnimationDecoder *IMG_CreateAnimationDecoderWithProperties(SDL_PropertiesID
     SDL_IOStream *src = SDL_GetPointerProperty(props, IMG_PROP_ANIMATION_DECODER_CREATE_IOSTREAM_POINTER, NULL);
     bool closeio = SDL_GetBooleanProperty(props, IMG_PROP_ANIMATION_DECODER_CREATE_IOSTREAM_AUTOCLOSE_BOOLEAN, false);
     const char *type = SDL_GetStringProperty(props, IMG_PROP_ANIMATION_DECODER_CREATE_TYPE_STRING, NULL);
+    bool map = SDL_GetBooleanProperty(props, IMG_PROP_ANIMATION_DECODER_CREATE_MAP_FILE_BOOLEAN, true);
     int timebase_numerator = (int)SDL_GetNumberProperty(props, IMG_PROP_ANIMATION_ENCODER_CREATE_TIMEBASE_NUMERATOR_NUMBER, 1);
     int timebase_denominator = (int)SDL_GetNumberProperty(props, IMG_PROP_ANIMATION_ENCODER_CREATE_TIMEBASE_DENOMINATOR_NUMBER, 1000);
 
@@ -184,7 +186,7 @@ IMG_AnimationDecoder *IMG_CreateAnimationDecoderWithProperties(SDL_PropertiesID
             return NULL;
         }
 
-        src = SDL_IOFromFile(file, "rb");
+        src = IMG_OpenImageFile(file, map);
         if (!src) {
             return NULL;
         }
@@ -275,7 +277,8 @@ bool IMG_GetAnimationDecoderFrame(IMG_AnimationDecoder *decoder, SDL_Surface **f
     // Reset the status before trying to get the next frame
     decoder->status = IMG_DECODER_STATUS_OK;
 
-    bool result = decoder->GetNextFrame(decoder, frame, duration);
+    // Stop between frames if the load was cancelled
+    bool result = !IMG_LoadCancelled() && decoder->GetNextFrame(decoder, frame, duration);
     if (temp_frame) {
         SDL_DestroySurface(temp_frame);
     }
@@ -66,7 +66,7 @@ SDL_ELF_NOTE_DLOPEN(
 
 
 static struct {
-    int loaded;
+    SDL_InitState init;
     void *handle;
     avifDecoder * (*avifDecoderCreate)(void);
     void (*avifDecoderDestroy)(avifDecoder * decoder);
@@ -104,52 +104,55 @@ static struct {
     /* Need to turn off optimizations so weak framework load check works */
     __attribute__ ((optnone))
 #endif
-static bool IMG_InitAVIF(void)
+static bool IMG_LoadAVIFLibrary(void)
 {
-    if ( lib.loaded == 0 ) {
 #ifdef LOAD_AVIF_DYNAMIC
-        lib.handle = SDL_LoadObject(LOAD_AVIF_DYNAMIC);
-        if ( lib.handle == NULL ) {
-            return false;
-        }
+    lib.handle = SDL_LoadObject(LOAD_AVIF_DYNAMIC);
+    if ( lib.handle == NULL ) {
+        return false;
+    }
 #endif
-        FUNCTION_LOADER(avifDecoderCreate, avifDecoder * (*)(void))
-        FUNCTION_LOADER(avifDecoderDestroy, void (*)(avifDecoder * decoder))
-        FUNCTION_LOADER(avifDecoderNextImage, avifResult (*)(avifDecoder * decoder))
-        FUNCTION_LOADER(avifDecoderParse, avifResult (*)(avifDecoder * decoder))
-        FUNCTION_LOADER(avifDecoderSetIO, void (*)(avifDecoder * decoder, avifIO * io))
-        FUNCTION_LOADER(avifEncoderAddImage, avifResult (*)(avifEncoder * encoder, const avifImage * image, uint64_t durationInTimescales, avifAddImageFlags addImageFlags))
-        FUNCTION_LOADER(avifEncoderCreate, avifEncoder * (*)(void))
-        FUNCTION_LOADER(avifEncoderDestroy, void (*)(avifEncoder * encoder))
-        FUNCTION_LOADER(avifEncoderFinish, avifResult (*)(avifEncoder * encoder, avifRWData * output))
-        FUNCTION_LOADER(avifImageCreate, avifImage * (*)(uint32_t width, uint32_t height, uint32_t depth, avifPixelFormat yuvFormat))
-        FUNCTION_LOADER(avifImageDestroy, void (*)(avifImage * image))
-        FUNCTION_LOADER(avifImageRGBToYUV, avifResult (*)(avifImage * image, const avifRGBImage * rgb))
-        FUNCTION_LOADER(avifImageYUVToRGB, avifResult (*)(const avifImage * image, avifRGBImage * rgb))
-        FUNCTION_LOADER(avifPeekCompatibleFileType, avifBool (*)(const avifROData * input))
-        FUNCTION_LOADER(avifRGBImageSetDefaults, void (*)(avifRGBImage * rgb, const avifImage * image))
-        FUNCTION_LOADER(avifRWDataFree, void (*)(avifRWData * raw))
-        FUNCTION_LOADER(avifResultToString, const char * (*)(avifResult res))
-
-        // XMP metadata support
-        FUNCTION_LOADER(avifImageSetMetadataXMP, avifResult (*)(avifImage * image, const uint8_t * xmp, size_t xmpSize))
-    }
-    ++lib.loaded;
+    FUNCTION_LOADER(avifDecoderCreate, avifDecoder * (*)(void))
+    FUNCTION_LOADER(avifDecoderDestroy, void (*)(avifDecoder * decoder))
+    FUNCTION_LOADER(avifDecoderNextImage, avifResult (*)(avifDecoder * decoder))
+    FUNCTION_LOADER(avifDecoderParse, avifResult (*)(avifDecoder * decoder))
+    FUNCTION_LOADER(avifDecoderSetIO, void (*)(avifDecoder * decoder, avifIO * io))
+    FUNCTION_LOADER(avifEncoderAddImage, avifResult (*)(avifEncoder * encoder, const avifImage * image, uint64_t durationInTimescales, avifAddImageFlags addImageFlags))
+    FUNCTION_LOADER(avifEncoderCreate, avifEncoder * (*)(void))
+    FUNCTION_LOADER(avifEncoderDestroy, void (*)(avifEncoder * encoder))
+    FUNCTION_LOADER(avifEncoderFinish, avifResult (*)(avifEncoder * encoder, avifRWData * output))
+    FUNCTION_LOADER(avifImageCreate, avifImage * (*)(uint32_t width, uint32_t height, uint32_t depth, avifPixelFormat yuvFormat))
+    FUNCTION_LOADER(avifImageDestroy, void (*)(avifImage * image))
+    FUNCTION_LOADER(avifImageRGBToYUV, avifResult (*)(avifImage * image, const avifRGBImage * rgb))
+    FUNCTION_LOADER(avifImageYUVToRGB, avifResult (*)(const avifImage * image, avifRGBImage * rgb))
+    FUNCTION_LOADER(avifPeekCompatibleFileType, avifBool (*)(const avifROData * input))
+    FUNCTION_LOADER(avifRGBImageSetDefaults, void (*)(avifRGBImage * rgb, const avifImage * image))
+    FUNCTION_LOADER(avifRWDataFree, void (*)(avifRWData * raw))
+    FUNCTION_LOADER(avifResultToString, const char * (*)(avifResult res))
+
+    // XMP metadata support
+    FUNCTION_LOADER(avifImageSetMetadataXMP, avifResult (*)(avifImage * image, const uint8_t * xmp, size_t xmpSize))
 
     return true;
 }
+
+static bool IMG_InitAVIF(void)
+{
+    /* Loads may run on several threads at once, the first one loads the library */
+    if (SDL_ShouldInit(&lib.init)) {
+        SDL_SetInitialized(&lib.init, IMG_LoadAVIFLibrary());
+    }
+    return (SDL_GetAtomicInt(&lib.init.status) == SDL_INIT_STATUS_INITIALIZED);
+}
 #if 0
 void IMG_QuitAVIF(void)
 {
-    if ( lib.loaded == 0 ) {
-        return;
-    }
-    if ( lib.loaded == 1 ) {
+    if (SDL_ShouldQuit(&lib.init)) {
 #ifdef LOAD_AVIF_DYNAMIC
         SDL_UnloadObject(lib.handle);
 #endif
+        SDL_SetInitialized(&lib.init, false);
     }
-    --lib.loaded;
 }
 #endif // 0
 
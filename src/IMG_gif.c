@@ -122,13 +122,16 @@ typedef struct {
     unsigned char buf[280];
     int curbit, lastbit, done, last_byte;
 
-    int fresh;
     int code_size, set_code_size;
     int max_code, max_code_size;
-    int firstcode, oldcode;
     int clear_code, end_code;
-    int table[2][(1 << MAX_LWZ_BITS)];
-    int stack[(1 << (MAX_LWZ_BITS)) * 2], *sp;
+    /* Each code is its prefix code plus one suffix byte; the string length
+       and first byte are cached so whole strings can be written at once */
+    Uint16 prefix[(1 << MAX_LWZ_BITS)];
+    Uint16 length[(1 << MAX_LWZ_BITS)];
+    Uint8 suffix[(1 << MAX_LWZ_BITS)];
+    Uint8 first[(1 << MAX_LWZ_BITS)];
+    Uint8 stack[(1 << MAX_LWZ_BITS)];
 
     int ZeroDataBlock;
 } State_t;
@@ -152,7 +155,8 @@ static int ReadColorMap(SDL_IOStream * src, int number,
 static int DoExtension(SDL_IOStream * src, int label, State_t * state);
 static int GetDataBlock(SDL_IOStream * src, unsigned char *buf, State_t * state);
 static int GetCode(SDL_IOStream * src, int code_size, int flag, State_t * state);
-static int LWZReadByte(SDL_IOStream * src, int flag, int input_code_size, State_t * state);
+static int LWZReadImage(SDL_IOStream * src, int input_code_size, Image * image,
+                        int interlace, State_t * state);
 static Image *ReadImage(SDL_IOStream *src, int len, int height, int cmapSize,
           unsigned char cmap[3][MAXCOLORMAPSIZE],
           int gray, int interlace, int ignore, State_t *state);
@@ -247,7 +251,7 @@ GetDataBlock(SDL_IOStream *src, unsigned char *buf, State_t * state)
 static int
 GetCode(SDL_IOStream *src, int code_size, int flag, State_t * state)
 {
-    int i, j, ret;
+    int i, ret;
     unsigned char count;
 
     if (flag) {
@@ -278,9 +282,10 @@ GetCode(SDL_IOStream *src, int code_size, int flag, State_t * state)
         state->curbit = (state->curbit - state->lastbit) + 16;
         state->lastbit = (2 + count) * 8;
     }
-    ret = 0;
-    for (i = state->curbit, j = 0; j < code_size; ++i, ++j)
-        ret |= ((state->buf[i / 8] & (1 << (i % 8))) != 0) << j;
+    /* A code is at most 12 bits, so it always fits in three bytes */
+    i = state->curbit / 8;
+    ret = state->buf[i] | (state->buf[i + 1] << 8) | (state->buf[i + 2] << 16);
+    ret = (ret >> (state->curbit % 8)) & ((1 << code_size) - 1);
 
     state->curbit += code_size;
 
@@ -288,67 +293,58 @@ GetCode(SDL_IOStream *src, int code_size, int flag, State_t * state)
 }
 
 static int
-LWZReadByte(SDL_IOStream *src, int flag, int input_code_size, State_t * state)
-{
-    int i, code, incode;
-
-    /* Fixed buffer overflow found by Michael Skladnikiewicz */
-    if (input_code_size > MAX_LWZ_BITS)
-        return -1;
-
-    if (flag) {
-        state->set_code_size = input_code_size;
-        state->code_size = state->set_code_size + 1;
-        state->clear_code = 1 << state->set_code_size;
-        state->end_code = state->clear_code + 1;
-        state->max_code_size = 2 * state->clear_code;
-        state->max_code = state->clear_code + 2;
-
-        GetCode(src, 0, TRUE, state);
+LWZReadImage(SDL_IOStream *src, int input_code_size, Image *image,
+             int interlace, State_t * state)
+{
+    static const int pass_start[4] = { 0, 4, 2, 1 };
+    static const int pass_step[4] = { 8, 8, 4, 2 };
+    const int width = image->w;
+    const int height = image->h;
+    Uint8 *pixels = (Uint8 *)image->pixels;
+    Uint8 *row = pixels;
+    int xpos = 0, ypos = 0, pass = 0;
+    Uint8 *sp = NULL;
+    int i, code, oldcode = -1;
 
-        state->fresh = TRUE;
+    state->set_code_size = input_code_size;
+    state->code_size = state->set_code_size + 1;
+    state->clear_code = 1 << state->set_code_size;
+    state->end_code = state->clear_code + 1;
+    state->max_code_size = 2 * state->clear_code;
+    state->max_code = state->clear_code + 2;
 
-        for (i = 0; i < state->clear_code; ++i) {
-            state->table[0][i] = 0;
-            state->table[1][i] = i;
-        }
-        state->table[1][0] = 0;
-        for (; i < (1 << MAX_LWZ_BITS); ++i)
-            state->table[0][i] = 0;
+    for (i = 0; i < state->clear_code; ++i) {
+        state->prefix[i] = 0;
+        state->length[i] = 1;
+        state->suffix[i] = (Uint8)i;
+        state->first[i] = (Uint8)i;
+    }
 
-        state->sp = state->stack;
+    if (width <= 0 || height <= 0) {
+        unsigned char buf[260];
 
-        return 0;
-    } else if (state->fresh) {
-        state->fresh = FALSE;
-        do {
-            state->firstcode = state->oldcode = GetCode(src, state->code_size, FALSE, state);
-        } while (state->firstcode == state->clear_code);
-        return state->firstcode;
+        while (GetDataBlock(src, buf, state) > 0)
+            ;
+        return TRUE;
     }
-    if (state->sp > state->stack)
-        return *--state->sp;
+
+    GetCode(src, 0, TRUE, state);
 
     while ((code = GetCode(src, state->code_size, FALSE, state)) >= 0) {
+        int len;
+
         if (code == state->clear_code) {
-            for (i = 0; i < state->clear_code; ++i) {
-                state->table[0][i] = 0;
-                state->table[1][i] = i;
-            }
-            for (; i < (1 << MAX_LWZ_BITS); ++i)
-                state->table[0][i] = state->table[1][i] = 0;
             state->code_size = state->set_code_size + 1;
             state->max_code_size = 2 * state->clear_code;
             state->max_code = state->clear_code + 2;
-            state->sp = state->stack;
-            state->firstcode = state->oldcode = GetCode(src, state->code_size, FALSE, state);
-            return state->firstcode;
+            oldcode = -1;
+            continue;
         } else if (code == state->end_code) {
             int count;
             unsigned char buf[260];
 
             if (state->ZeroDataBlock)
-                return -2;
+                break;
 
             while ((count = GetDataBlock(src, buf, state)) > 0)
                 ;
@@ -358,38 +354,26 @@ LWZReadByte(SDL_IOStream *src, int flag, int input_code_size, State_t * state)
              * pm_message("missing EOD in data stream (common occurrence)");
              */
             }
-            return -2;
-        }
-        incode = code;
-
-        if (code >= state->max_code) {
-            *state->sp++ = state->firstcode;
-            code = state->oldcode;
-        }
-        while (code >= state->clear_code) {
-            /* Guard against buffer overruns */
-            if (code < 0 || code >= (1 << MAX_LWZ_BITS)) {
-                RWSetMsg("invalid LWZ data");
-                return -3;
-            }
-            *state->sp++ = state->table[1][code];
-            if (code == state->table[0][code]) {
-                RWSetMsg("circular table entry BIG ERROR");
-                return -3;
-            }
-            code = state->table[0][code];
+            break;
         }
 
         /* Guard against buffer overruns */
-        if (code < 0 || code >= (1 << MAX_LWZ_BITS)) {
+        if (code > state->max_code || code >= (1 << MAX_LWZ_BITS) ||
+            (code == state->max_code && oldcode < 0)) {
             RWSetMsg("invalid LWZ data");
-            return -4;
+            break;
         }
-        *state->sp++ = state->firstcode = state->table[1][code];
 
-        if ((code = state->max_code) < (1 << MAX_LWZ_BITS)) {
-            state->table[0][code] = state->oldcode;
-            state->table[1][code] = state->firstcode;
+        /* Add the previous string plus the first byte of this one. When the
+           code is the one being defined (KwKwK), that is the first byte of
+           the previous string. */
+        if (oldcode >= 0 && state->max_code < (1 << MAX_LWZ_BITS)) {
+            int next = state->max_code;
+
+            state->prefix[next] = (Uint16)oldcode;
+            state->length[next] = state->length[oldcode] + 1;
+            state->first[next] = state->first[oldcode];
+            state->suffix[next] = state->first[code == next ? oldcode : code];
             ++state->max_code;
             if ((state->max_code >= state->max_code_size) &&
                 (state->max_code_size < (1 << MAX_LWZ_BITS))) {
@@ -397,12 +381,65 @@ LWZReadByte(SDL_IOStream *src, int flag, int input_code_size, State_t * state)
                 ++state->code_size;
             }
         }
-        state->oldcode = incode;
+        oldcode = code;
+
+        len = state->length[code];
+        if (len <= width - xpos) {
+            /* The whole string lands in this row, write it back to front */
+            Uint8 *start = row + xpos;
+            Uint8 *dst = start + len;
+
+            do {
+                *--dst = state->suffix[code];
+                code = state->prefix[code];
+            } while (dst > start);
+            xpos += len;
+            len = 0;
+        } else {
+            sp = state->stack + len;
+            do {
+                *--sp = state->suffix[code];
+                code = state->prefix[code];
+            } while (sp > state->stack);
+        }
+
+        /* Spread whatever is left of the string over the following rows */
+        for (;;) {
+            if (len > 0) {
+                int count = SDL_min(len, width - xpos);
+
+                SDL_memcpy(row + xpos, sp, count);
+                xpos += count;
+                sp += count;
+                len -= count;
+            }
+            if (xpos < width) {
+                break;
+            }
 
-        if (state->sp > state->stack)
-            return *--state->sp;
+            xpos = 0;
+            if (IMG_LoadCancelled()) {
+                return FALSE;
+            }
+            if (interlace) {
+                ypos += pass_step[pass];
+                while (ypos >= height) {
+                    if (++pass == 4) {
+                        return TRUE;
+                    }
+                    ypos = pass_start[pass];
+                }
+            } else if (++ypos >= height) {
+                return TRUE;
+            }
+            row = pixels + ypos * image->pitch;
+
+            if (len == 0) {
+                break;
+            }
+        }
     }
-    return code;
+    return TRUE;
 }
 
 static Image *
@@ -413,8 +450,7 @@ ReadImage(SDL_IOStream * src, int len, int height, int cmapSize,
     Image *image;
     SDL_Palette *palette;
     unsigned char c;
-    int i, v;
-    int xpos = 0, ypos = 0, pass = 0;
+    int i;
 
     /*
     **  Initialize the compression routines
@@ -423,7 +459,8 @@ ReadImage(SDL_IOStream * src, int len, int height, int cmapSize,
         RWSetMsg("EOF / read error on image data");
         return NULL;
     }
-    if (LWZReadByte(src, TRUE, c, state) < 0) {
+    /* Fixed buffer overflow found by Michael Skladnikiewicz */
+    if (c > MAX_LWZ_BITS) {
         RWSetMsg("error reading image");
         return NULL;
     }
@@ -431,7 +468,9 @@ ReadImage(SDL_IOStream * src, int len, int height, int cmapSize,
     **  If this is an "uninteresting picture" ignore it.
      */
     if (ignore) {
-        while (LWZReadByte(src, FALSE, c, state) >= 0)
+        unsigned char buf[260];
+
+        while (GetDataBlock(src, buf, state) > 0)
             ;
         return NULL;
     }
@@ -456,51 +495,10 @@ ReadImage(SDL_IOStream * src, int len, int height, int cmapSize,
         SDL_SetSurfaceColorKey(image, true, state->Gif89.transparent);
     }
 
-    while ((v = LWZReadByte(src, FALSE, c, state)) >= 0) {
-        ((Uint8 *)image->pixels)[xpos + ypos * image->pitch] = (Uint8)v;
-        ++xpos;
-        if (xpos == len) {
-            xpos = 0;
-            if (interlace) {
-                switch (pass) {
-                case 0:
-                case 1:
-                    ypos += 8;
-                    break;
-                case 2:
-                    ypos += 4;
-                    break;
-                case 3:
-                    ypos += 2;
-                    break;
-                }
-
-                if (ypos >= height) {
-                    ++pass;
-                    switch (pass) {
-                    case 1:
-                        ypos = 4;
-                        break;
-                    case 2:
-                        ypos = 2;
-                        break;
-                    case 3:
-                        ypos = 1;
-                        break;
-                    default:
-                        goto fini;
-                    }
-                }
-            } else {
-                ++ypos;
-            }
-        }
-        if (ypos >= height)
-            break;
+    if (!LWZReadImage(src, c, image, interlace, state)) {
+        SDL_DestroySurface(image);
+        return NULL;
     }
-
-  fini:
-
     return image;
 }
 
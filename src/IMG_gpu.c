@@ -21,6 +21,8 @@
 
 #include <SDL3_image/SDL_image.h>
 
+#include "IMG.h"
+
 static SDL_GPUTexture * LoadGPUTexture(SDL_GPUDevice *device, SDL_GPUCopyPass *copy_pass, SDL_Surface *surface, int *width, int *height)
 {
     if (width) {
@@ -117,7 +119,19 @@ SDL_GPUTexture * IMG_LoadGPUTexture(SDL_GPUDevice *device, SDL_GPUCopyPass *copy
         return NULL;
     }
 
-    return LoadGPUTexture(device, copy_pass, IMG_Load(file), width, height);
+    SDL_IOStream *src = IMG_OpenImageFile(file, true);
+    if (!src) {
+        /* The error message has been set in SDL_IOFromFile */
+        return NULL;
+    }
+
+    const char *ext = SDL_strrchr(file, '.');
+    if (ext) {
+        ext++;
+    }
+
+    /* Decode straight to the texture format where the codec supports it */
+    return LoadGPUTexture(device, copy_pass, IMG_LoadFormatted_IO(src, true, ext, SDL_PIXELFORMAT_RGBA32), width, height);
 }
 
 SDL_GPUTexture * IMG_LoadGPUTexture_IO(SDL_GPUDevice *device, SDL_GPUCopyPass *copy_pass, SDL_IOStream *src, bool closeio, int *width, int *height)
@@ -136,5 +150,6 @@ SDL_GPUTexture * IMG_LoadGPUTextureTyped_IO(SDL_GPUDevice *device, SDL_GPUCopyPa
         return NULL;
     }
 
-    return LoadGPUTexture(device, copy_pass, IMG_LoadTyped_IO(src, closeio, type), width, height);
+    /* Decode straight to the texture format where the codec supports it */
+    return LoadGPUTexture(device, copy_pass, IMG_LoadFormatted_IO(src, closeio, type, SDL_PIXELFORMAT_RGBA32), width, height);
 }
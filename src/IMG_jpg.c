@@ -23,9 +23,24 @@
 
 #include <SDL3_image/SDL_image.h>
 
+#include "IMG.h"
+
 #include <stdio.h>
 #include <setjmp.h>
 
+/* The encoder settings for IMG_SaveJPGWithProperties() */
+typedef struct IMG_SaveJPGOptions
+{
+    int quality;            /* 0-100 */
+    bool progressive;
+    bool optimize_coding;
+    int h_samp_factor;      /* the luma sampling factors, 2x2 for 4:2:0 */
+    int v_samp_factor;
+    const char *dct_method; /* "islow", "ifast" or "float" */
+    int restart_interval;   /* the number of MCUs between restart markers, 0 for none */
+    int threads;            /* the number of threads to encode baseline images on */
+} IMG_SaveJPGOptions;
+
 
 /* We'll have JPG save support by default */
 #ifndef SAVE_JPG
@@ -74,7 +89,7 @@ SDL_ELF_NOTE_DLOPEN(
 #define FAST_IS_JPEG
 
 static struct {
-    int loaded;
+    SDL_InitState init;
     void *handle;
     void (*jpeg_calc_output_dimensions) (j_decompress_ptr cinfo);
     void (*jpeg_CreateDecompress) (j_decompress_ptr cinfo, int version, size_t structsize);
@@ -88,64 +103,83 @@ static struct {
     void (*jpeg_start_compress) (j_compress_ptr cinfo, boolean write_all_tables);
     void (*jpeg_set_quality) (j_compress_ptr cinfo, int quality, boolean force_baseline);
     void (*jpeg_set_defaults) (j_compress_ptr cinfo);
+    void (*jpeg_simple_progression) (j_compress_ptr cinfo);
     JDIMENSION (*jpeg_write_scanlines) (j_compress_ptr cinfo, JSAMPARRAY scanlines, JDIMENSION num_lines);
     void (*jpeg_finish_compress) (j_compress_ptr cinfo);
     void (*jpeg_destroy_compress) (j_compress_ptr cinfo);
     struct jpeg_error_mgr * (*jpeg_std_error) (struct jpeg_error_mgr * err);
+    void (*jpeg_crop_scanline) (j_decompress_ptr cinfo, JDIMENSION *xoffset, JDIMENSION *width);
+    JDIMENSION (*jpeg_skip_scanlines) (j_decompress_ptr cinfo, JDIMENSION num_lines);
 } lib;
 
 #ifdef LOAD_JPG_DYNAMIC
 #define FUNCTION_LOADER(FUNC, SIG) \
     lib.FUNC = (SIG) SDL_LoadFunction(lib.handle, #FUNC); \
     if (lib.FUNC == NULL) { SDL_UnloadObject(lib.handle); return false; }
+/* libjpeg-turbo extensions, which may be missing from the library at runtime */
+#define FUNCTION_LOADER_TURBO(FUNC, SIG) \
+    lib.FUNC = (SIG) SDL_LoadFunction(lib.handle, #FUNC);
+#elif defined(LIBJPEG_TURBO_VERSION_NUMBER)
+#define FUNCTION_LOADER(FUNC, SIG) \
+    lib.FUNC = FUNC;
+#define FUNCTION_LOADER_TURBO(FUNC, SIG) \
+    lib.FUNC = FUNC;
 #else
 #define FUNCTION_LOADER(FUNC, SIG) \
     lib.FUNC = FUNC;
+#define FUNCTION_LOADER_TURBO(FUNC, SIG) \
+    lib.FUNC = NULL;
 #endif
 
-static bool IMG_InitJPG(void)
+static bool IMG_LoadJPGLibrary(void)
 {
-    if ( lib.loaded == 0 ) {
 #ifdef LOAD_JPG_DYNAMIC
-        lib.handle = SDL_LoadObject(LOAD_JPG_DYNAMIC);
-        if ( lib.handle == NULL ) {
-            return false;
-        }
+    lib.handle = SDL_LoadObject(LOAD_JPG_DYNAMIC);
+    if ( lib.handle == NULL ) {
+        return false;
+    }
 #endif
-        FUNCTION_LOADER(jpeg_calc_output_dimensions, void (*) (j_decompress_ptr cinfo))
-        FUNCTION_LOADER(jpeg_CreateDecompress, void (*) (j_decompress_ptr cinfo, int version, size_t structsize))
-        FUNCTION_LOADER(jpeg_destroy_decompress, void (*) (j_decompress_ptr cinfo))
-        FUNCTION_LOADER(jpeg_finish_decompress, boolean (*) (j_decompress_ptr cinfo))
-        FUNCTION_LOADER(jpeg_read_header, int (*) (j_decompress_ptr cinfo, boolean require_image))
-        FUNCTION_LOADER(jpeg_read_scanlines, JDIMENSION (*) (j_decompress_ptr cinfo, JSAMPARRAY scanlines, JDIMENSION max_lines))
-        FUNCTION_LOADER(jpeg_resync_to_restart, boolean (*) (j_decompress_ptr cinfo, int desired))
-        FUNCTION_LOADER(jpeg_start_decompress, boolean (*) (j_decompress_ptr cinfo))
-        FUNCTION_LOADER(jpeg_CreateCompress, void (*) (j_compress_ptr cinfo, int version, size_t structsize))
-        FUNCTION_LOADER(jpeg_start_compress, void (*) (j_compress_ptr cinfo, boolean write_all_tables))
-        FUNCTION_LOADER(jpeg_set_quality, void (*) (j_compress_ptr cinfo, int quality, boolean force_baseline))
-        FUNCTION_LOADER(jpeg_set_defaults, void (*) (j_compress_ptr cinfo))
-        FUNCTION_LOADER(jpeg_write_scanlines, JDIMENSION (*) (j_compress_ptr cinfo, JSAMPARRAY scanlines, JDIMENSION num_lines))
-        FUNCTION_LOADER(jpeg_finish_compress, void (*) (j_compress_ptr cinfo))
-        FUNCTION_LOADER(jpeg_destroy_compress, void (*) (j_compress_ptr cinfo))
-        FUNCTION_LOADER(jpeg_std_error, struct jpeg_error_mgr * (*) (struct jpeg_error_mgr * err))
-    }
-    ++lib.loaded;
+    FUNCTION_LOADER(jpeg_calc_output_dimensions, void (*) (j_decompress_ptr cinfo))
+    FUNCTION_LOADER(jpeg_CreateDecompress, void (*) (j_decompress_ptr cinfo, int version, size_t structsize))
+    FUNCTION_LOADER(jpeg_destroy_decompress, void (*) (j_decompress_ptr cinfo))
+    FUNCTION_LOADER(jpeg_finish_decompress, boolean (*) (j_decompress_ptr cinfo))
+    FUNCTION_LOADER(jpeg_read_header, int (*) (j_decompress_ptr cinfo, boolean require_image))
+    FUNCTION_LOADER(jpeg_read_scanlines, JDIMENSION (*) (j_decompress_ptr cinfo, JSAMPARRAY scanlines, JDIMENSION max_lines))
+    FUNCTION_LOADER(jpeg_resync_to_restart, boolean (*) (j_decompress_ptr cinfo, int desired))
+    FUNCTION_LOADER(jpeg_start_decompress, boolean (*) (j_decompress_ptr cinfo))
+    FUNCTION_LOADER(jpeg_CreateCompress, void (*) (j_compress_ptr cinfo, int version, size_t structsize))
+    FUNCTION_LOADER(jpeg_start_compress, void (*) (j_compress_ptr cinfo, boolean write_all_tables))
+    FUNCTION_LOADER(jpeg_set_quality, void (*) (j_compress_ptr cinfo, int quality, boolean force_baseline))
+    FUNCTION_LOADER(jpeg_set_defaults, void (*) (j_compress_ptr cinfo))
+    FUNCTION_LOADER(jpeg_simple_progression, void (*) (j_compress_ptr cinfo))
+    FUNCTION_LOADER(jpeg_write_scanlines, JDIMENSION (*) (j_compress_ptr cinfo, JSAMPARRAY scanlines, JDIMENSION num_lines))
+    FUNCTION_LOADER(jpeg_finish_compress, void (*) (j_compress_ptr cinfo))
+    FUNCTION_LOADER(jpeg_destroy_compress, void (*) (j_compress_ptr cinfo))
+    FUNCTION_LOADER(jpeg_std_error, struct jpeg_error_mgr * (*) (struct jpeg_error_mgr * err))
+    FUNCTION_LOADER_TURBO(jpeg_crop_scanline, void (*) (j_decompress_ptr cinfo, JDIMENSION *xoffset, JDIMENSION *width))
+    FUNCTION_LOADER_TURBO(jpeg_skip_scanlines, JDIMENSION (*) (j_decompress_ptr cinfo, JDIMENSION num_lines))
 
     return true;
 }
 
+static bool IMG_InitJPG(void)
+{
+    /* Loads may run on several threads at once, the first one loads the library */
+    if (SDL_ShouldInit(&lib.init)) {
+        SDL_SetInitialized(&lib.init, IMG_LoadJPGLibrary());
+    }
+    return (SDL_GetAtomicInt(&lib.init.status) == SDL_INIT_STATUS_INITIALIZED);
+}
+
 #if 0
 void IMG_QuitJPG(void)
 {
-    if ( lib.loaded == 0 ) {
-        return;
-    }
-    if ( lib.loaded == 1 ) {
+    if (SDL_ShouldQuit(&lib.init)) {
 #ifdef LOAD_JPG_DYNAMIC
         SDL_UnloadObject(lib.handle);
 #endif
+        SDL_SetInitialized(&lib.init, false);
     }
-    --lib.loaded;
 }
 #endif // 0
 
@@ -353,14 +387,106 @@ static void output_no_message(j_common_ptr cinfo)
 struct loadjpeg_vars {
     const char *error;
     SDL_Surface *surface;
+    Uint8 *row;
+    IMG_LoadOptions *options;
+    SDL_PixelFormat format;     /* the pixel format the image is decoded to */
     struct jpeg_decompress_struct cinfo;
     struct my_error_mgr jerr;
 };
 
+/* Get the libjpeg-turbo output color space that decodes directly to a pixel format */
+static bool GetJPEGColorSpace(SDL_PixelFormat format, J_COLOR_SPACE *color_space)
+{
+#ifdef JCS_EXTENSIONS
+    /* A library loaded at runtime may not be libjpeg-turbo, but if it has
+       jpeg_skip_scanlines() it also has the extended color spaces */
+    if (!lib.jpeg_skip_scanlines) {
+        return false;
+    }
+
+    switch (format) {
+    case SDL_PIXELFORMAT_RGB24:
+        *color_space = JCS_EXT_RGB;
+        return true;
+    case SDL_PIXELFORMAT_BGR24:
+        *color_space = JCS_EXT_BGR;
+        return true;
+    case SDL_PIXELFORMAT_RGBX32:
+        *color_space = JCS_EXT_RGBX;
+        return true;
+    case SDL_PIXELFORMAT_BGRX32:
+        *color_space = JCS_EXT_BGRX;
+        return true;
+    case SDL_PIXELFORMAT_XRGB32:
+        *color_space = JCS_EXT_XRGB;
+        return true;
+    case SDL_PIXELFORMAT_XBGR32:
+        *color_space = JCS_EXT_XBGR;
+        return true;
+#ifdef JCS_ALPHA_EXTENSIONS
+    /* The alpha channel is filled with 0xFF */
+    case SDL_PIXELFORMAT_RGBA32:
+        *color_space = JCS_EXT_RGBA;
+        return true;
+    case SDL_PIXELFORMAT_BGRA32:
+        *color_space = JCS_EXT_BGRA;
+        return true;
+    case SDL_PIXELFORMAT_ARGB32:
+        *color_space = JCS_EXT_ARGB;
+        return true;
+    case SDL_PIXELFORMAT_ABGR32:
+        *color_space = JCS_EXT_ABGR;
+        return true;
+#endif
+    default:
+        break;
+    }
+#endif /* JCS_EXTENSIONS */
+    return false;
+}
+
+/* Multiply two 8-bit values as fractions of 255, rounding to nearest */
+#define MUL_255(a, b)   (t = (Uint32)(a) * (b) + 128, (Uint8)((t + (t >> 8)) >> 8))
+
+/* Convert a row of CMYK pixels to RGB by composing the inks over white.
+   Adobe applications write CMYK with inverted values, 255 meaning no ink. */
+static void ConvertCMYKRow(const Uint8 *src, Uint8 *dst, int width, bool inverted)
+{
+    Uint32 t;
+    int i;
+
+    if (inverted) {
+        for (i = 0; i < width; ++i, src += 4, dst += 3) {
+            dst[0] = MUL_255(src[0], src[3]);
+            dst[1] = MUL_255(src[1], src[3]);
+            dst[2] = MUL_255(src[2], src[3]);
+        }
+    } else {
+        for (i = 0; i < width; ++i, src += 4, dst += 3) {
+            const Uint32 k = 255 - src[3];
+
+            dst[0] = MUL_255(255 - src[0], k);
+            dst[1] = MUL_255(255 - src[1], k);
+            dst[2] = MUL_255(255 - src[2], k);
+        }
+    }
+}
+
+#undef MUL_255
+
+/* The most scanlines read from the library in a single call */
+#define MAX_JPEG_ROWS   16
+
 /* Load a JPEG type image from an SDL datasource */
 static bool LIBJPEG_LoadJPG_IO(SDL_IOStream *src, struct loadjpeg_vars *vars)
 {
-    JSAMPROW rowptr[1];
+    JSAMPROW rowptr[MAX_JPEG_ROWS];
+    SDL_Rect crop;
+    JDIMENSION xoffset, end, rows, count, i;
+    size_t row_size = 0;
+    J_COLOR_SPACE color_space;
+    bool cmyk;
+    int bpp, src_bpp;
 
     /* Create a decompression structure and load the JPEG header */
     vars->cinfo.err = lib.jpeg_std_error(&vars->jerr.errmgr);
@@ -376,61 +502,580 @@ static bool LIBJPEG_LoadJPG_IO(SDL_IOStream *src, struct loadjpeg_vars *vars)
     lib.jpeg_create_decompress(&vars->cinfo);
     jpeg_SDL_IO_src(&vars->cinfo, src);
     lib.jpeg_read_header(&vars->cinfo, TRUE);
+    vars->format = SDL_PIXELFORMAT_RGB24;
+
+    /* Crop in full size coordinates, or scale the whole image */
+    crop.x = 0;
+    crop.y = 0;
+    crop.w = (int)vars->cinfo.image_width;
+    crop.h = (int)vars->cinfo.image_height;
+    if (!SDL_RectEmpty(&vars->options->crop)) {
+        if (!SDL_GetRectIntersection(&vars->options->crop, &crop, &crop)) {
+            lib.jpeg_destroy_decompress(&vars->cinfo);
+            vars->error = "Crop rectangle is outside the image";
+            return false;
+        }
+        vars->options->cropped = true;
+    } else if (vars->options->max_w > 0 || vars->options->max_h > 0) {
+        int scaled_w, scaled_h;
+
+        /* Use the smallest DCT scaling that isn't below the requested size */
+        IMG_GetScaledSize(crop.w, crop.h, vars->options->max_w, vars->options->max_h, &scaled_w, &scaled_h);
+        vars->cinfo.scale_num = 1;
+        vars->cinfo.scale_denom = 8;
+        while (vars->cinfo.scale_num < 8 &&
+               ((vars->cinfo.image_width * vars->cinfo.scale_num + 7) / 8 < (JDIMENSION)scaled_w ||
+                (vars->cinfo.image_height * vars->cinfo.scale_num + 7) / 8 < (JDIMENSION)scaled_h)) {
+            vars->cinfo.scale_num *= 2;
+        }
+    }
 
-    if (vars->cinfo.num_components == 4) {
-        /* Set 32-bit Raw output */
+    cmyk = (vars->cinfo.num_components == 4);
+    if (cmyk) {
+        /* Set 32-bit Raw output, which is converted to RGB as it's read */
         vars->cinfo.out_color_space = JCS_CMYK;
         vars->cinfo.quantize_colors = FALSE;
         lib.jpeg_calc_output_dimensions(&vars->cinfo);
-
-        /* Allocate an output surface to hold the image */
-        vars->surface = SDL_CreateSurface(vars->cinfo.output_width, vars->cinfo.output_height, SDL_PIXELFORMAT_RGBA32);
     } else {
-        /* Set 24-bit RGB output */
+        /* Set 24-bit RGB output, or the requested format if the library supports it */
         vars->cinfo.out_color_space = JCS_RGB;
+        if (GetJPEGColorSpace(vars->options->format, &color_space)) {
+            vars->cinfo.out_color_space = color_space;
+            vars->format = vars->options->format;
+        }
         vars->cinfo.quantize_colors = FALSE;
 #ifdef FAST_JPEG
-        vars->cinfo.scale_num   = 1;
-        vars->cinfo.scale_denom = 1;
         vars->cinfo.dct_method = JDCT_FASTEST;
         vars->cinfo.do_fancy_upsampling = FALSE;
 #endif
         lib.jpeg_calc_output_dimensions(&vars->cinfo);
-
-        /* Allocate an output surface to hold the image */
-        vars->surface = SDL_CreateSurface(vars->cinfo.output_width, vars->cinfo.output_height, SDL_PIXELFORMAT_RGB24);
+    }
+    if (!vars->options->cropped) {
+        crop.w = (int)vars->cinfo.output_width;
+        crop.h = (int)vars->cinfo.output_height;
     }
 
+    /* Allocate an output surface to hold the image */
+    vars->surface = IMG_CreateLoadSurface(vars->options, crop.w, crop.h, vars->format);
     if (!vars->surface) {
         lib.jpeg_destroy_decompress(&vars->cinfo);
         return false;
     }
+    bpp = SDL_BYTESPERPIXEL(vars->surface->format);
+    src_bpp = cmyk ? 4 : bpp;
 
     /* Decompress the image */
     lib.jpeg_start_decompress(&vars->cinfo);
-    while (vars->cinfo.output_scanline < vars->cinfo.output_height) {
-        rowptr[0] = (JSAMPROW)(Uint8 *)vars->surface->pixels +
-                            vars->cinfo.output_scanline * vars->surface->pitch;
-        lib.jpeg_read_scanlines(&vars->cinfo, rowptr, (JDIMENSION) 1);
+    xoffset = 0;
+    end = vars->cinfo.output_height;
+
+    /* Read as many scanlines per call as the library can produce at once */
+    rows = (JDIMENSION)SDL_clamp(vars->cinfo.rec_outbuf_height, 1, MAX_JPEG_ROWS);
+    if (vars->options->cropped) {
+        /* Decode only the columns and rows of the crop rectangle where possible */
+        JDIMENSION width = (JDIMENSION)crop.w;
+
+        xoffset = (JDIMENSION)crop.x;
+        if (lib.jpeg_crop_scanline) {
+            lib.jpeg_crop_scanline(&vars->cinfo, &xoffset, &width);
+        } else {
+            xoffset = 0;
+        }
+        if (lib.jpeg_skip_scanlines) {
+            lib.jpeg_skip_scanlines(&vars->cinfo, (JDIMENSION)crop.y);
+        }
+        end = (JDIMENSION)(crop.y + crop.h);
+    }
+    if (vars->options->cropped || cmyk) {
+        /* Decode into a row buffer and copy or convert the rows we need */
+        row_size = (size_t)vars->cinfo.output_width * src_bpp;
+        vars->row = (Uint8 *)SDL_malloc(row_size * rows);
+        if (!vars->row) {
+            lib.jpeg_destroy_decompress(&vars->cinfo);
+            return false;
+        }
+    }
+    while (vars->cinfo.output_scanline < end) {
+        JDIMENSION y = vars->cinfo.output_scanline;
+
+        if (IMG_LoadCancelled()) {
+            lib.jpeg_destroy_decompress(&vars->cinfo);
+            return false;
+        }
+        count = SDL_min(rows, end - y);
+        if (vars->row) {
+            for (i = 0; i < count; ++i) {
+                rowptr[i] = (JSAMPROW)(vars->row + i * row_size);
+            }
+            count = lib.jpeg_read_scanlines(&vars->cinfo, rowptr, count);
+            for (i = 0; i < count; ++i) {
+                if (y + i >= (JDIMENSION)crop.y) {
+                    const Uint8 *row = vars->row + i * row_size + (crop.x - xoffset) * src_bpp;
+                    Uint8 *pixels = (Uint8 *)vars->surface->pixels + (y + i - crop.y) * vars->surface->pitch;
+
+                    if (cmyk) {
+                        ConvertCMYKRow(row, pixels, crop.w, vars->cinfo.saw_Adobe_marker);
+                    } else {
+                        SDL_memcpy(pixels, row, (size_t)crop.w * bpp);
+                    }
+                }
+            }
+        } else {
+            for (i = 0; i < count; ++i) {
+                rowptr[i] = (JSAMPROW)((Uint8 *)vars->surface->pixels + (y + i) * vars->surface->pitch);
+            }
+            lib.jpeg_read_scanlines(&vars->cinfo, rowptr, count);
+        }
+    }
+    if (vars->cinfo.output_scanline == vars->cinfo.output_height) {
+        lib.jpeg_finish_decompress(&vars->cinfo);
     }
-    lib.jpeg_finish_decompress(&vars->cinfo);
     lib.jpeg_destroy_decompress(&vars->cinfo);
 
-    if (vars->cinfo.num_components == 4) {
-        // The CMYK image is essentially RGBA composed over black
-        SDL_Surface *output = SDL_CreateSurface(vars->cinfo.output_width, vars->cinfo.output_height, SDL_PIXELFORMAT_RGB24);
-        if (!output) {
+    return true;
+}
+
+/* A baseline JPEG image split at its restart markers, so bands of MCU rows can be decoded independently */
+struct jpeg_parallel_image {
+    const Uint8 *data;
+    size_t header_size;     /* the size of the markers before the entropy-coded data */
+    size_t height_offset;   /* the offset of the image height in the SOF marker */
+    size_t entropy_end;     /* the offset of the EOI marker */
+    size_t *restarts;       /* the offset of each RSTn marker */
+    int num_restarts;
+    int width;
+    int height;
+    int mcu_height;
+    int mcu_rows;
+    int mcus_per_row;
+    int restart_interval;
+    int row_step;           /* the number of MCU rows between restart markers that start a row */
+    J_COLOR_SPACE color_space;
+    SDL_Surface *surface;
+    SDL_AtomicInt *cancelled;   /* the cancellation flag of the calling thread, or NULL */
+};
+
+struct jpeg_band {
+    struct jpeg_parallel_image *image;
+    int first_row;          /* the MCU rows written to the surface */
+    int end_row;
+    bool result;
+    Uint8 *buffer;
+    Uint8 *row;
+    struct jpeg_decompress_struct cinfo;
+    struct my_error_mgr jerr;
+};
+
+/* Find the restart markers of a single scan baseline JPEG, returning false if it can't be decoded in bands */
+static bool ParseJPEGRestarts(const Uint8 *data, size_t size, struct jpeg_parallel_image *image)
+{
+    size_t pos = 2;
+    int components = 0, h_max = 1, v_max = 1;
+    int mcu_width, intervals, a, b, capacity = 0;
+    bool sof = false;
+
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+        return false;
+    }
+
+    /* Read the markers up to the start of the scan */
+    for (;;) {
+        Uint8 marker;
+        size_t length;
+        int i;
+
+        if (pos >= size || data[pos] != 0xFF) {
+            return false;
+        }
+        while (pos < size && data[pos] == 0xFF) {
+            ++pos;
+        }
+        if (pos + 3 > size) {
+            return false;
+        }
+        marker = data[pos++];
+        length = ((size_t)data[pos] << 8) | data[pos + 1];
+        if (length < 2 || pos + length > size) {
             return false;
         }
 
-        SDL_BlitSurface(vars->surface, NULL, output, NULL);
-        SDL_DestroySurface(vars->surface);
-        vars->surface = output;
+        if (marker == 0xC0 || marker == 0xC1) {
+            /* Baseline or extended sequential Huffman coding */
+            if (length < 8) {
+                return false;
+            }
+            image->height_offset = pos + 3;
+            image->height = (data[pos + 3] << 8) | data[pos + 4];
+            image->width = (data[pos + 5] << 8) | data[pos + 6];
+            components = data[pos + 7];
+            if (data[pos + 2] != 8 || components != 3 || length < 8 + 3 * (size_t)components) {
+                return false;
+            }
+            for (i = 0; i < components; ++i) {
+                Uint8 factors = data[pos + 8 + 3 * i + 1];
+
+                h_max = SDL_max(h_max, factors >> 4);
+                v_max = SDL_max(v_max, factors & 0x0F);
+            }
+            sof = true;
+        } else if ((marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) ||
+                   (marker >= 0xD0 && marker <= 0xD9) || marker == 0x01) {
+            /* Progressive, lossless or arithmetic coding, or an unexpected marker */
+            return false;
+        } else if (marker == 0xDD) {
+            if (length != 4) {
+                return false;
+            }
+            image->restart_interval = (data[pos + 2] << 8) | data[pos + 3];
+        } else if (marker == 0xDA) {
+            /* All the components need to be in this scan */
+            if (!sof || data[pos + 2] != components) {
+                return false;
+            }
+            pos += length;
+            break;
+        }
+        pos += length;
+    }
+    image->header_size = pos;
+
+    if (image->width == 0 || image->height == 0 || image->restart_interval == 0 || h_max > 4 || v_max > 4) {
+        return false;
+    }
+    mcu_width = 8 * h_max;
+    image->mcu_height = 8 * v_max;
+    image->mcus_per_row = (image->width + mcu_width - 1) / mcu_width;
+    image->mcu_rows = (image->height + image->mcu_height - 1) / image->mcu_height;
+
+    /* Find the restart markers in the entropy-coded data */
+    while (pos + 1 < size) {
+        if (data[pos] != 0xFF) {
+            ++pos;
+        } else if (data[pos + 1] == 0x00) {
+            /* This is an encoded 0xFF within the data */
+            pos += 2;
+        } else if (data[pos + 1] == 0xFF) {
+            /* Fill bytes before a marker */
+            ++pos;
+        } else if (data[pos + 1] >= 0xD0 && data[pos + 1] <= 0xD7) {
+            if (image->num_restarts == capacity) {
+                size_t *restarts;
+
+                capacity = capacity ? 2 * capacity : 256;
+                restarts = (size_t *)SDL_realloc(image->restarts, capacity * sizeof(*restarts));
+                if (!restarts) {
+                    return false;
+                }
+                image->restarts = restarts;
+            }
+            image->restarts[image->num_restarts++] = pos;
+            pos += 2;
+        } else {
+            break;
+        }
+    }
+    if (pos + 1 >= size || data[pos + 1] != 0xD9) {
+        /* There's more than one scan */
+        return false;
+    }
+    image->entropy_end = pos;
+
+    intervals = (int)(((Sint64)image->mcus_per_row * image->mcu_rows + image->restart_interval - 1) / image->restart_interval);
+    if (image->num_restarts != intervals - 1) {
+        return false;
+    }
+
+    /* Bands have to start at a restart marker at the beginning of an MCU row */
+    a = image->restart_interval;
+    b = image->mcus_per_row;
+    while (b != 0) {
+        int remainder = a % b;
+
+        a = b;
+        b = remainder;
+    }
+    image->row_step = image->restart_interval / a;
+    return (image->row_step < image->mcu_rows);
+}
+
+/* Get the offset of the entropy-coded data of the restart interval starting at an MCU row */
+static size_t GetJPEGBandOffset(struct jpeg_parallel_image *image, int row)
+{
+    int interval;
+
+    if (row == 0) {
+        return image->header_size;
+    }
+    if (row == image->mcu_rows) {
+        return image->entropy_end;
+    }
+    interval = (int)((Sint64)row * image->mcus_per_row / image->restart_interval);
+    return image->restarts[interval - 1] + 2;
+}
+
+static bool DecodeJPEGBand(struct jpeg_band *band)
+{
+    struct jpeg_parallel_image *image = band->image;
+    JSAMPROW rowptr[MAX_JPEG_ROWS];
+    JDIMENSION rows, count, i;
+    int first, end, height, y, top, bottom, bpp, restart, number;
+    size_t offset, length, size;
+    SDL_IOStream *io;
+
+    /* Decode an extra step of MCU rows on each side, so upsampling at the edges of the band matches a serial decode */
+    first = SDL_max(band->first_row - image->row_step, 0);
+    end = SDL_min(band->end_row + image->row_step, image->mcu_rows);
+    height = SDL_min(end * image->mcu_height, image->height) - first * image->mcu_height;
+    top = (band->first_row - first) * image->mcu_height;
+    bottom = SDL_min(band->end_row * image->mcu_height, image->height) - first * image->mcu_height;
+
+    /* Build a JPEG image of the band, with its restart markers renumbered from 0 */
+    offset = GetJPEGBandOffset(image, first);
+    length = GetJPEGBandOffset(image, end) - offset;
+    if (end < image->mcu_rows) {
+        /* Leave out the restart marker that follows the band */
+        length -= 2;
+    }
+    size = image->header_size + length + 2;
+    band->buffer = (Uint8 *)SDL_malloc(size);
+    if (!band->buffer) {
+        return false;
+    }
+    SDL_memcpy(band->buffer, image->data, image->header_size);
+    band->buffer[image->height_offset] = (Uint8)(height >> 8);
+    band->buffer[image->height_offset + 1] = (Uint8)height;
+    SDL_memcpy(band->buffer + image->header_size, image->data + offset, length);
+    for (restart = 0, number = 0; restart < image->num_restarts; ++restart) {
+        if (image->restarts[restart] >= offset && image->restarts[restart] < offset + length) {
+            band->buffer[image->header_size + (image->restarts[restart] - offset) + 1] = (Uint8)(0xD0 + (number++ & 7));
+        }
+    }
+    band->buffer[size - 2] = 0xFF;
+    band->buffer[size - 1] = 0xD9;
+
+    io = SDL_IOFromConstMem(band->buffer, size);
+    if (!io) {
+        return false;
+    }
+
+    band->cinfo.err = lib.jpeg_std_error(&band->jerr.errmgr);
+    band->jerr.errmgr.error_exit = my_error_exit;
+    band->jerr.errmgr.output_message = output_no_message;
+    if (setjmp(band->jerr.escape)) {
+        /* If we get here, libjpeg found an error */
+        lib.jpeg_destroy_decompress(&band->cinfo);
+        SDL_CloseIO(io);
+        return false;
+    }
+
+    lib.jpeg_create_decompress(&band->cinfo);
+    jpeg_SDL_IO_src(&band->cinfo, io);
+    lib.jpeg_read_header(&band->cinfo, TRUE);
+    band->cinfo.out_color_space = image->color_space;
+    band->cinfo.quantize_colors = FALSE;
+#ifdef FAST_JPEG
+    band->cinfo.dct_method = JDCT_FASTEST;
+    band->cinfo.do_fancy_upsampling = FALSE;
+#endif
+    lib.jpeg_start_decompress(&band->cinfo);
+    if (band->cinfo.output_width != (JDIMENSION)image->surface->w ||
+        band->cinfo.output_height != (JDIMENSION)height) {
+        lib.jpeg_destroy_decompress(&band->cinfo);
+        SDL_CloseIO(io);
+        return false;
+    }
+
+    /* Rows in the overlap are decoded into a scratch buffer */
+    bpp = SDL_BYTESPERPIXEL(image->surface->format);
+    rows = (JDIMENSION)SDL_clamp(band->cinfo.rec_outbuf_height, 1, MAX_JPEG_ROWS);
+    band->row = (Uint8 *)SDL_malloc((size_t)image->surface->w * bpp * rows);
+    if (!band->row) {
+        lib.jpeg_destroy_decompress(&band->cinfo);
+        SDL_CloseIO(io);
+        return false;
+    }
+    while (band->cinfo.output_scanline < band->cinfo.output_height) {
+        y = (int)band->cinfo.output_scanline;
+
+        if (image->cancelled && SDL_GetAtomicInt(image->cancelled)) {
+            lib.jpeg_destroy_decompress(&band->cinfo);
+            SDL_CloseIO(io);
+            return false;
+        }
+        count = SDL_min(rows, band->cinfo.output_height - (JDIMENSION)y);
+        for (i = 0; i < count; ++i) {
+            if (y + (int)i >= top && y + (int)i < bottom) {
+                rowptr[i] = (JSAMPROW)((Uint8 *)image->surface->pixels +
+                                       (first * image->mcu_height + y + (int)i) * image->surface->pitch);
+            } else {
+                rowptr[i] = (JSAMPROW)(band->row + i * image->surface->w * bpp);
+            }
+        }
+        lib.jpeg_read_scanlines(&band->cinfo, rowptr, count);
     }
+    lib.jpeg_finish_decompress(&band->cinfo);
+    lib.jpeg_destroy_decompress(&band->cinfo);
+    SDL_CloseIO(io);
     return true;
 }
 
+static int SDLCALL DecodeJPEGBandThread(void *data)
+{
+    struct jpeg_band *band = (struct jpeg_band *)data;
+
+    band->result = DecodeJPEGBand(band);
+    return 0;
+}
+
+/* Check the markers before the scan for a YCbCr baseline image with restart markers,
+   so other images aren't read into memory for a band decode that can't be used */
+static bool HasJPEGRestarts(SDL_IOStream *src)
+{
+    Uint8 marker, components = 0;
+    Uint16 length, interval = 0;
+    Sint64 start = SDL_TellIO(src);
+    bool sof = false;
+
+    if (!SDL_ReadU8(src, &marker) || marker != 0xFF ||
+        !SDL_ReadU8(src, &marker) || marker != 0xD8) {
+        goto done;
+    }
+    for (;;) {
+        if (!SDL_ReadU8(src, &marker) || marker != 0xFF) {
+            goto done;
+        }
+        while (marker == 0xFF) {
+            if (!SDL_ReadU8(src, &marker)) {
+                goto done;
+            }
+        }
+        if (marker == 0xDA) {
+            break;
+        }
+        if (!SDL_ReadU16BE(src, &length) || length < 2) {
+            goto done;
+        }
+        if (marker == 0xC0 || marker == 0xC1) {
+            /* Skip the precision and dimensions to the number of components */
+            if (length < 8 || SDL_SeekIO(src, 5, SDL_IO_SEEK_CUR) < 0 || !SDL_ReadU8(src, &components)) {
+                goto done;
+            }
+            length -= 6;
+            sof = true;
+        } else if (marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            /* Progressive, lossless or arithmetic coding */
+            goto done;
+        } else if (marker == 0xDD) {
+            if (length != 4 || !SDL_ReadU16BE(src, &interval)) {
+                goto done;
+            }
+            length -= 2;
+        }
+        if (SDL_SeekIO(src, length - 2, SDL_IO_SEEK_CUR) < 0) {
+            goto done;
+        }
+    }
+    SDL_SeekIO(src, start, SDL_IO_SEEK_SET);
+    return sof && components == 3 && interval != 0;
+
+done:
+    SDL_SeekIO(src, start, SDL_IO_SEEK_SET);
+    return false;
+}
+
+/* Decode a baseline JPEG image with restart markers in bands on several threads.
+   This returns NULL without setting an error if the image needs a serial decode. */
+static SDL_Surface *LoadJPGParallel(SDL_IOStream *src, IMG_LoadOptions *options)
+{
+    struct jpeg_parallel_image image;
+    struct jpeg_band *bands = NULL;
+    SDL_Thread **threads = NULL;
+    SDL_PixelFormat format = SDL_PIXELFORMAT_RGB24;
+    const Uint8 *data;
+    size_t size;
+    bool allocated;
+    bool result = false;
+    int steps, num_bands = 0, i;
+
+    if (!HasJPEGRestarts(src)) {
+        return NULL;
+    }
+    data = IMG_ReadIOData(src, 0, &size, &allocated);
+    if (!data) {
+        return NULL;
+    }
+
+    SDL_zero(image);
+    image.data = data;
+    image.cancelled = IMG_GetLoadCancelledFlag();
+    image.color_space = JCS_RGB;
+    if (GetJPEGColorSpace(options->format, &image.color_space)) {
+        format = options->format;
+    }
+    if (!ParseJPEGRestarts(data, size, &image)) {
+        goto done;
+    }
+
+    /* Split the image into bands of whole steps between restart markers */
+    steps = (image.mcu_rows + image.row_step - 1) / image.row_step;
+    num_bands = SDL_min(options->threads, steps);
+    bands = (struct jpeg_band *)SDL_calloc(num_bands, sizeof(*bands));
+    threads = (SDL_Thread **)SDL_calloc(num_bands, sizeof(*threads));
+    if (!bands || !threads) {
+        goto done;
+    }
+    image.surface = IMG_CreateLoadSurface(options, image.width, image.height, format);
+    if (!image.surface) {
+        goto done;
+    }
+    for (i = 0; i < num_bands; ++i) {
+        bands[i].image = &image;
+        bands[i].first_row = SDL_min((int)((Sint64)steps * i / num_bands) * image.row_step, image.mcu_rows);
+        bands[i].end_row = SDL_min((int)((Sint64)steps * (i + 1) / num_bands) * image.row_step, image.mcu_rows);
+    }
+
+    /* The calling thread decodes the first band, and any bands that threads can't be created for */
+    for (i = 1; i < num_bands; ++i) {
+        threads[i] = SDL_CreateThread(DecodeJPEGBandThread, "SDL_image JPEG", &bands[i]);
+    }
+    result = true;
+    for (i = 0; i < num_bands; ++i) {
+        if (threads[i]) {
+            SDL_WaitThread(threads[i], NULL);
+        } else {
+            bands[i].result = DecodeJPEGBand(&bands[i]);
+        }
+        result = result && bands[i].result;
+    }
+
+done:
+    if (bands) {
+        for (i = 0; i < num_bands; ++i) {
+            SDL_free(bands[i].buffer);
+            SDL_free(bands[i].row);
+        }
+        SDL_free(bands);
+    }
+    SDL_free(threads);
+    SDL_free(image.restarts);
+    IMG_FreeIOData(data, allocated);
+    if (!result && image.surface) {
+        SDL_DestroySurface(image.surface);
+        image.surface = NULL;
+    }
+    return image.surface;
+}
+
 SDL_Surface *IMG_LoadJPG_IO(SDL_IOStream *src)
+{
+    IMG_LoadOptions options;
+
+    SDL_zero(options);
+    return IMG_LoadJPGWithOptions_IO(src, &options);
+}
+
+/* Load a JPEG type image, decoding only the crop rectangle or using DCT scaling to reduce its size */
+SDL_Surface *IMG_LoadJPGWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options)
 {
     Sint64 start;
     struct loadjpeg_vars vars;
@@ -445,20 +1090,38 @@ SDL_Surface *IMG_LoadJPG_IO(SDL_IOStream *src)
     }
 
     start = SDL_TellIO(src);
+
+    /* Decode large baseline images with restart markers on several threads if requested */
+    if (options->threads > 1 && SDL_RectEmpty(&options->crop) &&
+        options->max_w <= 0 && options->max_h <= 0 && SDL_GetIOSize(src) >= 0) {
+        SDL_Surface *surface = LoadJPGParallel(src, options);
+        if (surface) {
+            return surface;
+        }
+        SDL_SeekIO(src, start, SDL_IO_SEEK_SET);
+        if (IMG_LoadCancelled()) {
+            return NULL;
+        }
+    }
+
     SDL_zero(vars);
+    vars.options = options;
 
     if (LIBJPEG_LoadJPG_IO(src, &vars)) {
+        SDL_free(vars.row);
         return vars.surface;
     }
 
     /* this may clobber a set error if seek fails: don't care. */
     SDL_SeekIO(src, start, SDL_IO_SEEK_SET);
+    SDL_free(vars.row);
     if (vars.surface) {
         SDL_DestroySurface(vars.surface);
     }
     if (vars.error) {
         SDL_SetError("%s", vars.error);
     }
+    options->cropped = false;
 
     return NULL;
 }
@@ -524,7 +1187,7 @@ struct savejpeg_vars
     Sint64 original_offset;
 };
 
-static bool JPEG_SaveJPEG_IO(struct savejpeg_vars *vars, SDL_Surface *jpeg_surface, SDL_IOStream *dst, int quality)
+static bool JPEG_SaveJPEG_IO(struct savejpeg_vars *vars, SDL_Surface *jpeg_surface, SDL_IOStream *dst, const IMG_SaveJPGOptions *options)
 {
     /* Create a compression structure and load the JPEG header */
     vars->cinfo.err = lib.jpeg_std_error(&vars->jerr.errmgr);
@@ -548,7 +1211,21 @@ static bool JPEG_SaveJPEG_IO(struct savejpeg_vars *vars, SDL_Surface *jpeg_surfa
     vars->cinfo.input_components = 3;
 
     lib.jpeg_set_defaults(&vars->cinfo);
-    lib.jpeg_set_quality(&vars->cinfo, quality, TRUE);
+    lib.jpeg_set_quality(&vars->cinfo, options->quality, TRUE);
+    vars->cinfo.comp_info[0].h_samp_factor = options->h_samp_factor;
+    vars->cinfo.comp_info[0].v_samp_factor = options->v_samp_factor;
+    if (SDL_strcmp(options->dct_method, "ifast") == 0) {
+        vars->cinfo.dct_method = JDCT_IFAST;
+    } else if (SDL_strcmp(options->dct_method, "float") == 0) {
+        vars->cinfo.dct_method = JDCT_FLOAT;
+    } else {
+        vars->cinfo.dct_method = JDCT_ISLOW;
+    }
+    vars->cinfo.optimize_coding = options->optimize_coding ? TRUE : FALSE;
+    vars->cinfo.restart_interval = (unsigned int)options->restart_interval;
+    if (options->progressive) {
+        lib.jpeg_simple_progression(&vars->cinfo);
+    }
     lib.jpeg_start_compress(&vars->cinfo, TRUE);
 
     while (vars->cinfo.next_scanline < vars->cinfo.image_height) {
@@ -564,7 +1241,150 @@ static bool JPEG_SaveJPEG_IO(struct savejpeg_vars *vars, SDL_Surface *jpeg_surfa
     return true;
 }
 
-static bool IMG_SaveJPG_IO_jpeglib(SDL_Surface *surface, SDL_IOStream *dst, int quality)
+/* A horizontal strip of MCU rows encoded as a separate JPEG image */
+struct jpeg_strip {
+    SDL_Surface *surface;
+    const IMG_SaveJPGOptions *options;
+    SDL_IOStream *output;
+    bool result;
+    char *error;    /* the error from the thread that encoded the strip, if it failed */
+};
+
+static int SDLCALL EncodeJPEGStripThread(void *data)
+{
+    struct jpeg_strip *strip = (struct jpeg_strip *)data;
+    struct savejpeg_vars vars;
+
+    SDL_zero(vars);
+    strip->result = JPEG_SaveJPEG_IO(&vars, strip->surface, strip->output, strip->options);
+    if (!strip->result) {
+        /* The error is thread-local, so keep it for the calling thread */
+        strip->error = SDL_strdup(SDL_GetError());
+    }
+    return 0;
+}
+
+/* Get the entropy-coded data of a JPEG image written by libjpeg, and the offset of the height in its SOF marker */
+static bool GetJPEGStripData(const Uint8 *data, size_t size, size_t *height_offset, size_t *header_size)
+{
+    size_t pos = 2;
+
+    while (pos + 4 <= size && data[pos] == 0xFF) {
+        Uint8 marker = data[pos + 1];
+        size_t length = ((size_t)data[pos + 2] << 8) | data[pos + 3];
+
+        if (marker == 0xC0 || marker == 0xC1) {
+            *height_offset = pos + 5;
+        }
+        pos += 2 + length;
+        if (marker == 0xDA) {
+            *header_size = pos;
+            return (pos + 2 <= size && data[size - 2] == 0xFF && data[size - 1] == 0xD9);
+        }
+    }
+    return false;
+}
+
+/* Encode a baseline JPEG image in strips of MCU rows on several threads, and join
+   them into one image with restart markers at the start of every MCU row.
+   Strips start on a multiple of 8 MCU rows, so the RST0-RST7 markers inside each
+   strip already have the right numbers and the strips can simply be concatenated. */
+static bool JPEG_SaveJPEGParallel_IO(SDL_Surface *jpeg_surface, SDL_IOStream *dst, const IMG_SaveJPGOptions *options, int num_strips)
+{
+    IMG_SaveJPGOptions strip_options = *options;
+    struct jpeg_strip *strips;
+    SDL_Thread **threads;
+    int mcu_height = 8 * options->v_samp_factor;
+    int mcu_rows = (jpeg_surface->h + mcu_height - 1) / mcu_height;
+    int groups = (mcu_rows + 7) / 8;
+    int i;
+    bool result = true;
+
+    num_strips = SDL_min(num_strips, groups);
+    strips = (struct jpeg_strip *)SDL_calloc(num_strips, sizeof(*strips));
+    threads = (SDL_Thread **)SDL_calloc(num_strips, sizeof(*threads));
+    if (!strips || !threads) {
+        SDL_free(strips);
+        SDL_free(threads);
+        return false;
+    }
+
+    /* Restart once per MCU row, so each strip starts on a restart marker */
+    strip_options.restart_interval = (jpeg_surface->w + 8 * options->h_samp_factor - 1) / (8 * options->h_samp_factor);
+    for (i = 0; i < num_strips && result; ++i) {
+        int y = (groups * i / num_strips) * 8 * mcu_height;
+        int h = SDL_min((groups * (i + 1) / num_strips) * 8 * mcu_height, jpeg_surface->h) - y;
+
+        strips[i].options = &strip_options;
+        strips[i].surface = SDL_CreateSurfaceFrom(jpeg_surface->w, h, jpeg_surface->format,
+                                                  (Uint8 *)jpeg_surface->pixels + y * jpeg_surface->pitch,
+                                                  jpeg_surface->pitch);
+        strips[i].output = SDL_IOFromDynamicMem();
+        result = (strips[i].surface && strips[i].output);
+    }
+
+    /* The calling thread encodes the first strip, and any strips that threads can't be created for */
+    if (result) {
+        for (i = 1; i < num_strips; ++i) {
+            threads[i] = SDL_CreateThread(EncodeJPEGStripThread, "SDL_image JPEG", &strips[i]);
+        }
+        for (i = 0; i < num_strips; ++i) {
+            if (threads[i]) {
+                SDL_WaitThread(threads[i], NULL);
+            } else {
+                EncodeJPEGStripThread(&strips[i]);
+            }
+            if (result && !strips[i].result) {
+                SDL_SetError("%s", strips[i].error ? strips[i].error : "Error saving JPEG with libjpeg");
+                result = false;
+            }
+        }
+    }
+
+    /* Write the headers of the first strip with the full image height, then all the entropy-coded data */
+    for (i = 0; i < num_strips && result; ++i) {
+        const Uint8 *data = (const Uint8 *)SDL_GetPointerProperty(SDL_GetIOProperties(strips[i].output), SDL_PROP_IOSTREAM_DYNAMIC_MEMORY_POINTER, NULL);
+        size_t size = (size_t)SDL_TellIO(strips[i].output);
+        size_t height_offset = 0, header_size = 0;
+
+        if (!data || !GetJPEGStripData(data, size, &height_offset, &header_size) || height_offset == 0) {
+            result = SDL_SetError("Error saving JPEG with libjpeg");
+            break;
+        }
+        if (i == 0) {
+            Uint8 height[2];
+
+            height[0] = (Uint8)(jpeg_surface->h >> 8);
+            height[1] = (Uint8)jpeg_surface->h;
+            result = (SDL_WriteIO(dst, data, height_offset) == height_offset &&
+                      SDL_WriteIO(dst, height, sizeof(height)) == sizeof(height) &&
+                      SDL_WriteIO(dst, data + height_offset + 2, header_size - height_offset - 2) == header_size - height_offset - 2);
+        } else {
+            static const Uint8 rst7[2] = { 0xFF, 0xD7 };
+
+            result = (SDL_WriteIO(dst, rst7, sizeof(rst7)) == sizeof(rst7));
+        }
+        result = result && SDL_WriteIO(dst, data + header_size, size - header_size - 2) == size - header_size - 2;
+        if (result && i == num_strips - 1) {
+            static const Uint8 eoi[2] = { 0xFF, 0xD9 };
+
+            result = (SDL_WriteIO(dst, eoi, sizeof(eoi)) == sizeof(eoi));
+        }
+    }
+
+    for (i = 0; i < num_strips; ++i) {
+        SDL_DestroySurface(strips[i].surface);
+        if (strips[i].output) {
+            SDL_CloseIO(strips[i].output);
+        }
+        SDL_free(strips[i].error);
+    }
+    SDL_free(strips);
+    SDL_free(threads);
+    return result;
+}
+
+static bool IMG_SaveJPG_IO_jpeglib(SDL_Surface *surface, SDL_IOStream *dst, const IMG_SaveJPGOptions *options)
 {
     /* The JPEG library reads bytes in R,G,B order, so this is the right
      * encoding for either endianness */
@@ -585,8 +1405,21 @@ static bool IMG_SaveJPG_IO_jpeglib(SDL_Surface *surface, SDL_IOStream *dst, int
         }
     }
 
-    SDL_zero(vars);
-    result = JPEG_SaveJPEG_IO(&vars, jpeg_surface, dst, quality);
+    /* Baseline images with the standard Huffman tables can be encoded in strips and joined */
+    if (options->threads > 1 && !options->progressive && !options->optimize_coding &&
+        options->restart_interval == 0 && jpeg_surface->h > 64 * options->v_samp_factor) {
+        Sint64 start = SDL_TellIO(dst);
+
+        result = JPEG_SaveJPEGParallel_IO(jpeg_surface, dst, options, options->threads);
+        if (!result && start >= 0 && SDL_SeekIO(dst, start, SDL_IO_SEEK_SET) == start) {
+            /* Try again on this thread, which reports its own error if it fails too */
+            SDL_zero(vars);
+            result = JPEG_SaveJPEG_IO(&vars, jpeg_surface, dst, options);
+        }
+    } else {
+        SDL_zero(vars);
+        result = JPEG_SaveJPEG_IO(&vars, jpeg_surface, dst, options);
+    }
 
     if (jpeg_surface != surface) {
         SDL_DestroySurface(jpeg_surface);
@@ -596,7 +1429,7 @@ static bool IMG_SaveJPG_IO_jpeglib(SDL_Surface *surface, SDL_IOStream *dst, int
 
 #elif defined(USE_STBIMAGE)
 
-extern SDL_Surface *IMG_LoadSTB_IO(SDL_IOStream *src);
+extern SDL_Surface *IMG_LoadSTB_IO(SDL_IOStream *src, IMG_LoadOptions *options);
 
 /* FIXME: This is a copypaste from JPEGLIB! Pull that out of the ifdefs */
 /* Define this for quicker (but less perfect) JPEG identification */
@@ -673,7 +1506,13 @@ bool IMG_isJPG(SDL_IOStream *src)
 /* Load a JPEG type image from an SDL datasource */
 SDL_Surface *IMG_LoadJPG_IO(SDL_IOStream *src)
 {
-    return IMG_LoadSTB_IO(src);
+    return IMG_LoadSTB_IO(src, NULL);
+}
+
+/* Load a JPEG type image, decoding into the destination surface if it matches */
+SDL_Surface *IMG_LoadJPGWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options)
+{
+    return IMG_LoadSTB_IO(src, options);
 }
 
 #endif /* WANT_JPEGLIB */
@@ -695,6 +1534,14 @@ SDL_Surface *IMG_LoadJPG_IO(SDL_IOStream *src)
 
 #endif /* LOAD_JPG */
 
+#if !defined(USE_JPEGLIB) && !(defined(LOAD_JPG) && defined(USE_STBIMAGE))
+/* Load a JPEG type image, without support for any options */
+SDL_Surface *IMG_LoadJPGWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options)
+{
+    return IMG_LoadJPG_IO(src);
+}
+#endif
+
 /* Use tinyjpeg as a fallback if we don't have a hard dependency on libjpeg */
 #if SAVE_JPG && (defined(LOAD_JPG_DYNAMIC) || !defined(WANT_JPEGLIB))
 
@@ -724,12 +1571,14 @@ static void IMG_SaveJPG_IO_tinyjpeg_callback(void* context, void* data, int size
     SDL_WriteIO((SDL_IOStream*) context, data, size);
 }
 
-static bool IMG_SaveJPG_IO_tinyjpeg(SDL_Surface *surface, SDL_IOStream *dst, int quality)
+/* tinyjpeg only supports the quality setting, and always writes baseline 4:4:4 images */
+static bool IMG_SaveJPG_IO_tinyjpeg(SDL_Surface *surface, SDL_IOStream *dst, const IMG_SaveJPGOptions *options)
 {
     /* The JPEG library reads bytes in R,G,B order, so this is the right
      * encoding for either endianness */
     static const Uint32 jpg_format = SDL_PIXELFORMAT_RGB24;
     SDL_Surface* jpeg_surface = surface;
+    int quality = options->quality;
     bool result = false;
 
     /* Convert surface to format we can save */
@@ -774,7 +1623,7 @@ static bool IMG_SaveJPG_IO_tinyjpeg(SDL_Surface *surface, SDL_IOStream *dst, int
 
 #if SAVE_JPG
 
-bool IMG_SaveJPG_IO(SDL_Surface *surface, SDL_IOStream *dst, bool closeio, int quality)
+static bool SaveJPG(SDL_Surface *surface, SDL_IOStream *dst, bool closeio, const IMG_SaveJPGOptions *options)
 {
     bool result = false;
 
@@ -789,13 +1638,13 @@ bool IMG_SaveJPG_IO(SDL_Surface *surface, SDL_IOStream *dst, bool closeio, int q
 
 #ifdef USE_JPEGLIB
     if (!result) {
-        result = IMG_SaveJPG_IO_jpeglib(surface, dst, quality);
+        result = IMG_SaveJPG_IO_jpeglib(surface, dst, options);
     }
 #endif
 
 #if defined(LOAD_JPG_DYNAMIC) || !defined(WANT_JPEGLIB)
     if (!result) {
-        result = IMG_SaveJPG_IO_tinyjpeg(surface, dst, quality);
+        result = IMG_SaveJPG_IO_tinyjpeg(surface, dst, options);
     }
 #endif
 
@@ -806,6 +1655,23 @@ done:
     return result;
 }
 
+static void InitSaveJPGOptions(IMG_SaveJPGOptions *options, int quality)
+{
+    SDL_zerop(options);
+    options->quality = quality;
+    options->h_samp_factor = 2;
+    options->v_samp_factor = 2;
+    options->dct_method = "islow";
+}
+
+bool IMG_SaveJPG_IO(SDL_Surface *surface, SDL_IOStream *dst, bool closeio, int quality)
+{
+    IMG_SaveJPGOptions options;
+
+    InitSaveJPGOptions(&options, quality);
+    return SaveJPG(surface, dst, closeio, &options);
+}
+
 bool IMG_SaveJPG(SDL_Surface *surface, const char *file, int quality)
 {
     SDL_IOStream *dst = SDL_IOFromFile(file, "wb");
@@ -816,6 +1682,62 @@ bool IMG_SaveJPG(SDL_Surface *surface, const char *file, int quality)
     }
 }
 
+bool IMG_SaveJPGWithProperties(SDL_Surface *surface, SDL_PropertiesID props)
+{
+    IMG_SaveJPGOptions options;
+    const char *file = SDL_GetStringProperty(props, IMG_PROP_SAVE_FILENAME_STRING, NULL);
+    SDL_IOStream *dst = (SDL_IOStream *)SDL_GetPointerProperty(props, IMG_PROP_SAVE_IOSTREAM_POINTER, NULL);
+    bool closeio = SDL_GetBooleanProperty(props, IMG_PROP_SAVE_IOSTREAM_AUTOCLOSE_BOOLEAN, false);
+    const char *subsampling = SDL_GetStringProperty(props, IMG_PROP_SAVE_JPG_SUBSAMPLING_STRING, "4:2:0");
+    const char *dct_method = SDL_GetStringProperty(props, IMG_PROP_SAVE_JPG_DCT_METHOD_STRING, "islow");
+
+    InitSaveJPGOptions(&options, (int)SDL_GetNumberProperty(props, IMG_PROP_SAVE_QUALITY_NUMBER, 90));
+    options.progressive = SDL_GetBooleanProperty(props, IMG_PROP_SAVE_JPG_PROGRESSIVE_BOOLEAN, false);
+    options.optimize_coding = SDL_GetBooleanProperty(props, IMG_PROP_SAVE_JPG_OPTIMIZE_CODING_BOOLEAN, false);
+    options.restart_interval = (int)SDL_GetNumberProperty(props, IMG_PROP_SAVE_JPG_RESTART_INTERVAL_NUMBER, 0);
+    options.threads = (int)SDL_GetNumberProperty(props, IMG_PROP_SAVE_THREAD_COUNT_NUMBER, 1);
+
+    if (SDL_strcmp(subsampling, "4:4:4") == 0) {
+        options.h_samp_factor = 1;
+        options.v_samp_factor = 1;
+    } else if (SDL_strcmp(subsampling, "4:2:2") == 0) {
+        options.h_samp_factor = 2;
+        options.v_samp_factor = 1;
+    } else if (SDL_strcmp(subsampling, "4:2:0") != 0) {
+        SDL_SetError("Unsupported JPEG chroma subsampling: %s", subsampling);
+        goto error;
+    }
+    if (SDL_strcmp(dct_method, "islow") != 0 &&
+        SDL_strcmp(dct_method, "ifast") != 0 &&
+        SDL_strcmp(dct_method, "float") != 0) {
+        SDL_SetError("Unsupported JPEG DCT method: %s", dct_method);
+        goto error;
+    }
+    options.dct_method = dct_method;
+    if (options.restart_interval < 0 || options.restart_interval > 65535) {
+        SDL_SetError("JPEG restart interval must be between 0 and 65535");
+        goto error;
+    }
+
+    if (!dst) {
+        if (!file) {
+            return SDL_SetError("Either IMG_PROP_SAVE_FILENAME_STRING or IMG_PROP_SAVE_IOSTREAM_POINTER must be set");
+        }
+        dst = SDL_IOFromFile(file, "wb");
+        if (!dst) {
+            return false;
+        }
+        closeio = true;
+    }
+    return SaveJPG(surface, dst, closeio, &options);
+
+error:
+    if (dst && closeio) {
+        SDL_CloseIO(dst);
+    }
+    return false;
+}
+
 #else // !SAVE_JPG
 
 bool IMG_SaveJPG_IO(SDL_Surface *surface, SDL_IOStream *dst, bool closeio, int quality)
@@ -828,4 +1750,9 @@ bool IMG_SaveJPG(SDL_Surface *surface, const char *file, int quality)
     return SDL_SetError("SDL_image built without JPG save support");
 }
 
+bool IMG_SaveJPGWithProperties(SDL_Surface *surface, SDL_PropertiesID props)
+{
+    return SDL_SetError("SDL_image built without JPG save support");
+}
+
 #endif // SAVE_JPG
@@ -23,6 +23,8 @@
 
 #include <SDL3_image/SDL_image.h>
 
+#include "IMG.h"
+
 #ifdef LOAD_JXL
 
 #if defined(LOAD_JXL_DYNAMIC) && defined(SDL_ELF_NOTE_DLOPEN)
@@ -38,7 +40,7 @@ SDL_ELF_NOTE_DLOPEN(
 
 
 static struct {
-    int loaded;
+    SDL_InitState init;
     void *handle;
     JxlDecoder* (*JxlDecoderCreate)(const JxlMemoryManager* memory_manager);
     JxlDecoderStatus (*JxlDecoderSubscribeEvents)(JxlDecoder* dec, int events_wanted);
@@ -64,40 +66,43 @@ static struct {
     /* Need to turn off optimizations so weak framework load check works */
     __attribute__ ((optnone))
 #endif
-static bool IMG_InitJXL(void)
+static bool IMG_LoadJXLLibrary(void)
 {
-    if ( lib.loaded == 0 ) {
 #ifdef LOAD_JXL_DYNAMIC
-        lib.handle = SDL_LoadObject(LOAD_JXL_DYNAMIC);
-        if ( lib.handle == NULL ) {
-            return false;
-        }
-#endif
-        FUNCTION_LOADER(JxlDecoderCreate, JxlDecoder* (*)(const JxlMemoryManager* memory_manager))
-        FUNCTION_LOADER(JxlDecoderSubscribeEvents, JxlDecoderStatus (*)(JxlDecoder* dec, int events_wanted))
-        FUNCTION_LOADER(JxlDecoderSetInput, JxlDecoderStatus (*)(JxlDecoder* dec, const uint8_t* data, size_t size))
-        FUNCTION_LOADER(JxlDecoderProcessInput, JxlDecoderStatus (*)(JxlDecoder* dec))
-        FUNCTION_LOADER(JxlDecoderGetBasicInfo, JxlDecoderStatus (*)(const JxlDecoder* dec, JxlBasicInfo* info))
-        FUNCTION_LOADER(JxlDecoderImageOutBufferSize, JxlDecoderStatus (*)(const JxlDecoder* dec, const JxlPixelFormat* format, size_t* size))
-        FUNCTION_LOADER(JxlDecoderSetImageOutBuffer, JxlDecoderStatus (*)(JxlDecoder* dec, const JxlPixelFormat* format, void* buffer, size_t size))
-        FUNCTION_LOADER(JxlDecoderDestroy, void (*)(JxlDecoder* dec))
+    lib.handle = SDL_LoadObject(LOAD_JXL_DYNAMIC);
+    if ( lib.handle == NULL ) {
+        return false;
     }
-    ++lib.loaded;
+#endif
+    FUNCTION_LOADER(JxlDecoderCreate, JxlDecoder* (*)(const JxlMemoryManager* memory_manager))
+    FUNCTION_LOADER(JxlDecoderSubscribeEvents, JxlDecoderStatus (*)(JxlDecoder* dec, int events_wanted))
+    FUNCTION_LOADER(JxlDecoderSetInput, JxlDecoderStatus (*)(JxlDecoder* dec, const uint8_t* data, size_t size))
+    FUNCTION_LOADER(JxlDecoderProcessInput, JxlDecoderStatus (*)(JxlDecoder* dec))
+    FUNCTION_LOADER(JxlDecoderGetBasicInfo, JxlDecoderStatus (*)(const JxlDecoder* dec, JxlBasicInfo* info))
+    FUNCTION_LOADER(JxlDecoderImageOutBufferSize, JxlDecoderStatus (*)(const JxlDecoder* dec, const JxlPixelFormat* format, size_t* size))
+    FUNCTION_LOADER(JxlDecoderSetImageOutBuffer, JxlDecoderStatus (*)(JxlDecoder* dec, const JxlPixelFormat* format, void* buffer, size_t size))
+    FUNCTION_LOADER(JxlDecoderDestroy, void (*)(JxlDecoder* dec))
 
     return true;
 }
+
+static bool IMG_InitJXL(void)
+{
+    /* Loads may run on several threads at once, the first one loads the library */
+    if (SDL_ShouldInit(&lib.init)) {
+        SDL_SetInitialized(&lib.init, IMG_LoadJXLLibrary());
+    }
+    return (SDL_GetAtomicInt(&lib.init.status) == SDL_INIT_STATUS_INITIALIZED);
+}
 #if 0
 void IMG_QuitJXL(void)
 {
-    if ( lib.loaded == 0 ) {
-        return;
-    }
-    if ( lib.loaded == 1 ) {
+    if (SDL_ShouldQuit(&lib.init)) {
 #ifdef LOAD_JXL_DYNAMIC
         SDL_UnloadObject(lib.handle);
 #endif
+        SDL_SetInitialized(&lib.init, false);
     }
-    --lib.loaded;
 }
 #endif // 0
 
@@ -136,12 +141,70 @@ bool IMG_isJXL(SDL_IOStream *src)
     return is_JXL;
 }
 
+/* Get the basic information about a JXL image from its header */
+bool IMG_GetJXLInfo(const Uint8 *data, size_t size, int *width, int *height, int *bit_depth, bool *has_alpha, int *orientation, bool *animated)
+{
+    JxlDecoder *decoder = NULL;
+    JxlBasicInfo info;
+    JxlDecoderStatus status;
+    bool result = false;
+
+    if (!IMG_InitJXL()) {
+        return false;
+    }
+
+    decoder = lib.JxlDecoderCreate(NULL);
+    if (!decoder) {
+        return SDL_SetError("Couldn't create JXL decoder");
+    }
+
+    if (lib.JxlDecoderSubscribeEvents(decoder, JXL_DEC_BASIC_INFO) != JXL_DEC_SUCCESS) {
+        SDL_SetError("Couldn't subscribe to JXL events");
+        goto done;
+    }
+
+    if (lib.JxlDecoderSetInput(decoder, data, size) != JXL_DEC_SUCCESS) {
+        SDL_SetError("Couldn't set JXL input");
+        goto done;
+    }
+
+    SDL_zero(info);
+
+    status = lib.JxlDecoderProcessInput(decoder);
+    switch (status) {
+    case JXL_DEC_BASIC_INFO:
+        if (lib.JxlDecoderGetBasicInfo(decoder, &info) != JXL_DEC_SUCCESS) {
+            SDL_SetError("Couldn't get JXL image info");
+            goto done;
+        }
+        *width = (int)info.xsize;
+        *height = (int)info.ysize;
+        *bit_depth = (int)info.bits_per_sample;
+        *has_alpha = (info.alpha_bits > 0);
+        *orientation = (int)info.orientation;
+        *animated = info.have_animation ? true : false;
+        result = true;
+        break;
+    case JXL_DEC_NEED_MORE_INPUT:
+        SDL_SetError("Incomplete JXL header");
+        break;
+    default:
+        SDL_SetError("JXL decoder error");
+        break;
+    }
+
+done:
+    lib.JxlDecoderDestroy(decoder);
+    return result;
+}
+
 /* Load a JXL type image from an SDL datasource */
 SDL_Surface *IMG_LoadJXL_IO(SDL_IOStream *src)
 {
     Sint64 start;
-    unsigned char *data;
+    const Uint8 *data;
     size_t datasize;
+    bool allocated = false;
     JxlDecoder *decoder = NULL;
     JxlBasicInfo info;
     JxlPixelFormat format = { 4, JXL_TYPE_UINT8, JXL_NATIVE_ENDIAN, 0 };
@@ -160,7 +223,7 @@ SDL_Surface *IMG_LoadJXL_IO(SDL_IOStream *src)
         return NULL;
     }
 
-    data = (unsigned char *)SDL_LoadFile_IO(src, &datasize, false);
+    data = IMG_ReadIOData(src, 0, &datasize, &allocated);
     if (!data) {
         return NULL;
     }
@@ -248,7 +311,7 @@ done:
         lib.JxlDecoderDestroy(decoder);
     }
     if (data) {
-        SDL_free(data);
+        IMG_FreeIOData(data, allocated);
     }
     if (pixels) {
         SDL_free(pixels);
@@ -267,6 +330,12 @@ bool IMG_isJXL(SDL_IOStream *src)
     return false;
 }
 
+/* Get the basic information about a JXL image from its header */
+bool IMG_GetJXLInfo(const Uint8 *data, size_t size, int *width, int *height, int *bit_depth, bool *has_alpha, int *orientation, bool *animated)
+{
+    return SDL_SetError("SDL_image built without JXL support");
+}
+
 /* Load a JXL type image from an SDL datasource */
 SDL_Surface *IMG_LoadJXL_IO(SDL_IOStream *src)
 {
@@ -29,6 +29,7 @@
 
 #include <SDL3_image/SDL_image.h>
 
+#include "IMG.h"
 #include "IMG_libpng.h"
 #include "IMG_anim_encoder.h"
 #include "IMG_anim_decoder.h"
@@ -40,6 +41,7 @@
 #else
 #include <png.h>
 #endif
+#include <zlib.h>
 
 #if defined(LOAD_LIBPNG_DYNAMIC) && defined(SDL_ELF_NOTE_DLOPEN)
 SDL_ELF_NOTE_DLOPEN(
@@ -111,14 +113,9 @@ typedef png_inforp png_noconst16_inforp;
 
 static struct
 {
-    int loaded;
+    SDL_InitState init;
     #ifdef LOAD_LIBPNG_DYNAMIC
     void *handle_libpng;
-
-    /* Uncomment this if you want to use zlib with libpng to decompress / compress manually if you'd prefer that.
-     *
-     * void *handle_zlib;
-     */
     #endif
 
     png_infop (*png_create_info_struct)(png_noconst15_structrp png_ptr);
@@ -134,6 +131,11 @@ static struct
     png_uint_32 (*png_get_tRNS)(png_const_structrp png_ptr, png_inforp info_ptr, png_bytep *trans, int *num_trans, png_color_16p *trans_values);
     png_uint_32 (*png_get_valid)(png_const_structrp png_ptr, png_const_inforp info_ptr, png_uint_32 flag);
     void (*png_read_image)(png_structrp png_ptr, png_bytepp image);
+    void (*png_read_rows)(png_structrp png_ptr, png_bytepp row, png_bytepp display_row, png_uint_32 num_rows);
+    void (*png_set_progressive_read_fn)(png_structrp png_ptr, png_voidp progressive_ptr, png_progressive_info_ptr info_fn, png_progressive_row_ptr row_fn, png_progressive_end_ptr end_fn);
+    png_voidp (*png_get_progressive_ptr)(png_const_structrp png_ptr);
+    void (*png_process_data)(png_structrp png_ptr, png_inforp info_ptr, png_bytep buffer, png_size_t buffer_size);
+    void (*png_progressive_combine_row)(png_const_structrp png_ptr, png_bytep old_row, png_const_bytep new_row);
     void (*png_read_info)(png_structrp png_ptr, png_inforp info_ptr);
     void (*png_read_update_info)(png_structrp png_ptr, png_inforp info_ptr);
     void (*png_set_expand)(png_structrp png_ptr);
@@ -142,17 +144,25 @@ static struct
     void (*png_set_strip_16)(png_structrp png_ptr);
     int (*png_set_interlace_handling)(png_structrp png_ptr);
     int (*png_sig_cmp)(png_const_bytep sig, png_size_t start, png_size_t num_to_check);
+    void (*png_set_crc_action)(png_structrp png_ptr, int crit_action, int ancil_action);
+#if defined(PNG_SET_OPTION_SUPPORTED) && defined(PNG_IGNORE_ADLER32)
+    int (*png_set_option)(png_structrp png_ptr, int option, int onoff);
+#endif
 #ifndef LIBPNG_VERSION_12
     jmp_buf *(*png_set_longjmp_fn)(png_structrp, png_longjmp_ptr, size_t);
 #endif
     void (*png_set_palette_to_rgb)(png_structrp png_ptr);
     void (*png_set_tRNS_to_alpha)(png_structrp png_ptr);
     void (*png_set_filler)(png_structrp png_ptr, png_uint_32 filler, int flags);
+    void (*png_set_bgr)(png_structrp png_ptr);
+    void (*png_set_swap_alpha)(png_structrp png_ptr);
 
     void (*png_set_read_user_chunk_fn)(png_structrp png_ptr, png_voidp user_chunk_ptr, png_user_chunk_ptr read_user_chunk_fn);
     void (*png_set_keep_unknown_chunks)(png_structrp png_ptr, int keep, png_const_bytep chunk_list, int num_chunks);
     void (*png_set_sig_bytes)(png_structrp png_ptr, int num_bytes);
     void (*png_set_compression_level)(png_structrp png_ptr, int level);
+    void (*png_set_compression_strategy)(png_structrp png_ptr, int strategy);
+    void (*png_set_packing)(png_structrp png_ptr);
 
     void (*png_set_filter)(png_structrp png_ptr, int method, int filters);
 
@@ -166,6 +176,7 @@ static struct
     void (*png_set_tRNS)(png_structrp png_ptr, png_inforp info_ptr, png_const_bytep trans_alpha, int num_trans, png_const_color_16p trans_color);
 
     void (*png_write_image)(png_structrp png_ptr, png_bytepp image);
+    void (*png_write_row)(png_structrp png_ptr, png_const_bytep row);
     void (*png_write_end)(png_structrp png_ptr, png_inforp info_ptr);
 
     void (*png_read_end)(png_structrp png_ptr, png_inforp info_ptr);
@@ -181,6 +192,16 @@ static struct
 #endif
 
     void (*png_write_flush)(png_structrp png_ptr);
+
+    /* These are used to compress PNG images on several threads, and may be NULL */
+    int (*deflateInit2_)(z_streamp strm, int level, int method, int windowBits, int memLevel, int strategy, const char *version, int stream_size);
+    int (*deflateSetDictionary)(z_streamp strm, const Bytef *dictionary, uInt dictLength);
+    int (*deflateReset)(z_streamp strm);
+    uLong (*deflateBound)(z_streamp strm, uLong sourceLen);
+    int (*deflate)(z_streamp strm, int flush);
+    int (*deflateEnd)(z_streamp strm);
+    uLong (*adler32)(uLong adler, const Bytef *buf, uInt len);
+    bool have_zlib;
 } lib;
 
 #define libpng_get_uint_32(buf)           \
@@ -197,110 +218,136 @@ static struct
             return false;                                           \
         }
 
-    /* Uncomment this if you want to use zlib with libpng to decompress / compress manually if you'd prefer that.
-    *
+    /* zlib is loaded along with libpng, so look up its functions through the libpng handle */
     #define FUNCTION_LOADER_ZLIB(FUNC, SIG)                             \
-        lib.FUNC = (SIG)SDL_LoadFunction(lib.handle_zlib, #FUNC);       \
+        lib.FUNC = (SIG)SDL_LoadFunction(lib.handle_libpng, #FUNC);     \
         if (lib.FUNC == NULL) {                                         \
-            SDL_UnloadObject(lib.handle_zlib);                          \
-            return false;                                               \
+            lib.have_zlib = false;                                      \
         }
-     */
 #else
     #define FUNCTION_LOADER_LIBPNG(FUNC, SIG)               \
         lib.FUNC = FUNC;                                    \
         if (lib.FUNC == NULL) {                             \
             return SDL_SetError("Missing png.framework");   \
         }
+
+    #define FUNCTION_LOADER_ZLIB(FUNC, SIG)                 \
+        lib.FUNC = FUNC;                                    \
+        if (lib.FUNC == NULL) {                             \
+            lib.have_zlib = false;                          \
+        }
 #endif
 
 #ifdef __APPLE__
 /* Need to turn off optimizations so weak framework load check works */
 __attribute__((optnone))
 #endif
-bool IMG_InitPNG(void)
+static bool IMG_LoadPNGLibrary(void)
 {
-    if (lib.loaded == 0) {
-        /* Uncomment this if you want to use zlib with libpng to decompress / compress manually if you'd prefer that.
-         *
-        lib.handle_zlib = SDL_LoadObject(LOAD_ZLIB_DYNAMIC);
-        if (lib.handle_zlib == NULL) {
-            return false;
-        }
-        */
-
 #ifdef LOAD_LIBPNG_DYNAMIC
-        lib.handle_libpng = SDL_LoadObject(LOAD_LIBPNG_DYNAMIC);
-        if (lib.handle_libpng == NULL) {
-            return false;
-        }
+    lib.handle_libpng = SDL_LoadObject(LOAD_LIBPNG_DYNAMIC);
+    if (lib.handle_libpng == NULL) {
+        return false;
+    }
 #endif
 
-        FUNCTION_LOADER_LIBPNG(png_create_info_struct, png_infop(*)(png_noconst15_structrp png_ptr))
-        FUNCTION_LOADER_LIBPNG(png_create_read_struct, png_structp(*)(png_const_charp user_png_ver, png_voidp error_ptr, png_error_ptr error_fn, png_error_ptr warn_fn))
-        FUNCTION_LOADER_LIBPNG(png_destroy_read_struct, void (*)(png_structpp png_ptr_ptr, png_infopp info_ptr_ptr, png_infopp end_info_ptr_ptr))
-        FUNCTION_LOADER_LIBPNG(png_get_IHDR, png_uint_32(*)(png_noconst15_structrp png_ptr, png_noconst15_inforp info_ptr, png_uint_32 * width, png_uint_32 * height, int *bit_depth, int *color_type, int *interlace_method, int *compression_method, int *filter_method))
-        FUNCTION_LOADER_LIBPNG(png_get_io_ptr, png_voidp(*)(png_noconst15_structrp png_ptr))
-        FUNCTION_LOADER_LIBPNG(png_get_channels, png_byte(*)(png_const_structrp png_ptr, png_const_inforp info_ptr))
-
-        FUNCTION_LOADER_LIBPNG(png_error,void (*)(png_noconst15_structrp png_ptr, png_const_charp error_message))
-
-        FUNCTION_LOADER_LIBPNG(png_get_PLTE, png_uint_32(*)(png_const_structrp png_ptr, png_noconst16_inforp info_ptr, png_colorp * palette, int *num_palette))
-        FUNCTION_LOADER_LIBPNG(png_get_tRNS, png_uint_32(*)(png_const_structrp png_ptr, png_inforp info_ptr, png_bytep * trans, int *num_trans, png_color_16p *trans_values))
-        FUNCTION_LOADER_LIBPNG(png_get_valid, png_uint_32(*)(png_const_structrp png_ptr, png_const_inforp info_ptr, png_uint_32 flag))
-        FUNCTION_LOADER_LIBPNG(png_read_image, void (*)(png_structrp png_ptr, png_bytepp image))
-        FUNCTION_LOADER_LIBPNG(png_read_info, void (*)(png_structrp png_ptr, png_inforp info_ptr))
-        FUNCTION_LOADER_LIBPNG(png_read_update_info, void (*)(png_structrp png_ptr, png_inforp info_ptr))
-        FUNCTION_LOADER_LIBPNG(png_set_expand, void (*)(png_structrp png_ptr))
-        FUNCTION_LOADER_LIBPNG(png_set_gray_to_rgb, void (*)(png_structrp png_ptr))
-        FUNCTION_LOADER_LIBPNG(png_set_read_fn, void (*)(png_structrp png_ptr, png_voidp io_ptr, png_rw_ptr read_data_fn))
-        FUNCTION_LOADER_LIBPNG(png_set_strip_16, void (*)(png_structrp png_ptr))
-        FUNCTION_LOADER_LIBPNG(png_set_interlace_handling, int (*)(png_structrp png_ptr))
-        FUNCTION_LOADER_LIBPNG(png_sig_cmp, int (*)(png_const_bytep sig, png_size_t start, png_size_t num_to_check))
+    FUNCTION_LOADER_LIBPNG(png_create_info_struct, png_infop(*)(png_noconst15_structrp png_ptr))
+    FUNCTION_LOADER_LIBPNG(png_create_read_struct, png_structp(*)(png_const_charp user_png_ver, png_voidp error_ptr, png_error_ptr error_fn, png_error_ptr warn_fn))
+    FUNCTION_LOADER_LIBPNG(png_destroy_read_struct, void (*)(png_structpp png_ptr_ptr, png_infopp info_ptr_ptr, png_infopp end_info_ptr_ptr))
+    FUNCTION_LOADER_LIBPNG(png_get_IHDR, png_uint_32(*)(png_noconst15_structrp png_ptr, png_noconst15_inforp info_ptr, png_uint_32 * width, png_uint_32 * height, int *bit_depth, int *color_type, int *interlace_method, int *compression_method, int *filter_method))
+    FUNCTION_LOADER_LIBPNG(png_get_io_ptr, png_voidp(*)(png_noconst15_structrp png_ptr))
+    FUNCTION_LOADER_LIBPNG(png_get_channels, png_byte(*)(png_const_structrp png_ptr, png_const_inforp info_ptr))
+
+    FUNCTION_LOADER_LIBPNG(png_error,void (*)(png_noconst15_structrp png_ptr, png_const_charp error_message))
+
+    FUNCTION_LOADER_LIBPNG(png_get_PLTE, png_uint_32(*)(png_const_structrp png_ptr, png_noconst16_inforp info_ptr, png_colorp * palette, int *num_palette))
+    FUNCTION_LOADER_LIBPNG(png_get_tRNS, png_uint_32(*)(png_const_structrp png_ptr, png_inforp info_ptr, png_bytep * trans, int *num_trans, png_color_16p *trans_values))
+    FUNCTION_LOADER_LIBPNG(png_get_valid, png_uint_32(*)(png_const_structrp png_ptr, png_const_inforp info_ptr, png_uint_32 flag))
+    FUNCTION_LOADER_LIBPNG(png_read_image, void (*)(png_structrp png_ptr, png_bytepp image))
+    FUNCTION_LOADER_LIBPNG(png_read_rows, void (*)(png_structrp png_ptr, png_bytepp row, png_bytepp display_row, png_uint_32 num_rows))
+    FUNCTION_LOADER_LIBPNG(png_set_progressive_read_fn, void (*)(png_structrp png_ptr, png_voidp progressive_ptr, png_progressive_info_ptr info_fn, png_progressive_row_ptr row_fn, png_progressive_end_ptr end_fn))
+    FUNCTION_LOADER_LIBPNG(png_get_progressive_ptr, png_voidp (*)(png_const_structrp png_ptr))
+    FUNCTION_LOADER_LIBPNG(png_process_data, void (*)(png_structrp png_ptr, png_inforp info_ptr, png_bytep buffer, png_size_t buffer_size))
+    FUNCTION_LOADER_LIBPNG(png_progressive_combine_row, void (*)(png_const_structrp png_ptr, png_bytep old_row, png_const_bytep new_row))
+    FUNCTION_LOADER_LIBPNG(png_read_info, void (*)(png_structrp png_ptr, png_inforp info_ptr))
+    FUNCTION_LOADER_LIBPNG(png_read_update_info, void (*)(png_structrp png_ptr, png_inforp info_ptr))
+    FUNCTION_LOADER_LIBPNG(png_set_expand, void (*)(png_structrp png_ptr))
+    FUNCTION_LOADER_LIBPNG(png_set_gray_to_rgb, void (*)(png_structrp png_ptr))
+    FUNCTION_LOADER_LIBPNG(png_set_read_fn, void (*)(png_structrp png_ptr, png_voidp io_ptr, png_rw_ptr read_data_fn))
+    FUNCTION_LOADER_LIBPNG(png_set_strip_16, void (*)(png_structrp png_ptr))
+    FUNCTION_LOADER_LIBPNG(png_set_interlace_handling, int (*)(png_structrp png_ptr))
+    FUNCTION_LOADER_LIBPNG(png_sig_cmp, int (*)(png_const_bytep sig, png_size_t start, png_size_t num_to_check))
+    FUNCTION_LOADER_LIBPNG(png_set_crc_action, void (*)(png_structrp png_ptr, int crit_action, int ancil_action))
+#if defined(PNG_SET_OPTION_SUPPORTED) && defined(PNG_IGNORE_ADLER32)
+    FUNCTION_LOADER_LIBPNG(png_set_option, int (*)(png_structrp png_ptr, int option, int onoff))
+#endif
 #ifndef LIBPNG_VERSION_12
-        FUNCTION_LOADER_LIBPNG(png_set_longjmp_fn, jmp_buf * (*)(png_structrp, png_longjmp_ptr, size_t))
+    FUNCTION_LOADER_LIBPNG(png_set_longjmp_fn, jmp_buf * (*)(png_structrp, png_longjmp_ptr, size_t))
 #endif
-        FUNCTION_LOADER_LIBPNG(png_set_palette_to_rgb, void (*)(png_structrp png_ptr))
-        FUNCTION_LOADER_LIBPNG(png_set_tRNS_to_alpha, void (*)(png_structrp png_ptr))
-        FUNCTION_LOADER_LIBPNG(png_set_filler, void (*)(png_structrp png_ptr, png_uint_32 filler, int flags))
-
-        FUNCTION_LOADER_LIBPNG(png_set_read_user_chunk_fn, void (*)(png_structrp png_ptr, png_voidp user_chunk_ptr, png_user_chunk_ptr read_user_chunk_fn))
-        FUNCTION_LOADER_LIBPNG(png_set_keep_unknown_chunks, void (*)(png_structrp png_ptr, int keep, png_const_bytep chunk_list, int num_chunks))
-        FUNCTION_LOADER_LIBPNG(png_set_sig_bytes, void (*)(png_structrp png_ptr, int num_bytes))
-        FUNCTION_LOADER_LIBPNG(png_set_compression_level, void (*)(png_structrp png_ptr, int level))
-
-        FUNCTION_LOADER_LIBPNG(png_set_filter, void (*)(png_structrp png_ptr, int method, int filters))
-
-        FUNCTION_LOADER_LIBPNG(png_create_write_struct, png_structp(*)(png_const_charp user_png_ver, png_voidp error_ptr, png_error_ptr error_fn, png_error_ptr warn_fn))
-        FUNCTION_LOADER_LIBPNG(png_destroy_write_struct, void (*)(png_structpp png_ptr_ptr, png_infopp info_ptr_ptr))
-        FUNCTION_LOADER_LIBPNG(png_set_write_fn, void (*)(png_structrp png_ptr, png_voidp io_ptr, png_rw_ptr write_data_fn, png_flush_ptr output_flush_fn))
-        FUNCTION_LOADER_LIBPNG(png_set_IHDR, void (*)(png_noconst15_structrp png_ptr, png_inforp info_ptr, png_uint_32 width, png_uint_32 height, int bit_depth, int color_type, int interlace_type, int compression_type, int filter_type))
-        FUNCTION_LOADER_LIBPNG(png_write_info, void (*)(png_structrp png_ptr, png_noconst15_inforp info_ptr))
-        FUNCTION_LOADER_LIBPNG(png_set_rows, void (*)(png_noconst15_structrp png_ptr, png_inforp info_ptr, png_bytepp row_pointers))
-        FUNCTION_LOADER_LIBPNG(png_set_PLTE, void (*)(png_structrp png_ptr, png_inforp info_ptr, png_const_colorp palette, int num_palette))
-        FUNCTION_LOADER_LIBPNG(png_set_tRNS, void (*)(png_structrp png_ptr, png_inforp info_ptr, png_const_bytep trans_alpha, int num_trans, png_const_color_16p trans_color))
-
-        FUNCTION_LOADER_LIBPNG(png_write_image, void (*)(png_structrp png_ptr, png_bytepp image))
-        FUNCTION_LOADER_LIBPNG(png_write_end, void (*)(png_structrp png_ptr, png_inforp info_ptr))
-
-        FUNCTION_LOADER_LIBPNG(png_read_end, void (*)(png_structrp png_ptr, png_inforp info_ptr))
-
-        FUNCTION_LOADER_LIBPNG(png_get_bit_depth, png_byte(*)(png_const_structrp png_ptr, png_const_inforp info_ptr))
-        FUNCTION_LOADER_LIBPNG(png_get_color_type, png_byte(*)(png_const_structrp png_ptr, png_const_inforp info_ptr))
-        FUNCTION_LOADER_LIBPNG(png_get_image_width, png_uint_32(*)(png_const_structrp png_ptr, png_const_inforp info_ptr))
-        FUNCTION_LOADER_LIBPNG(png_get_image_height, png_uint_32(*)(png_const_structrp png_ptr, png_const_inforp info_ptr))
+    FUNCTION_LOADER_LIBPNG(png_set_palette_to_rgb, void (*)(png_structrp png_ptr))
+    FUNCTION_LOADER_LIBPNG(png_set_tRNS_to_alpha, void (*)(png_structrp png_ptr))
+    FUNCTION_LOADER_LIBPNG(png_set_filler, void (*)(png_structrp png_ptr, png_uint_32 filler, int flags))
+    FUNCTION_LOADER_LIBPNG(png_set_bgr, void (*)(png_structrp png_ptr))
+    FUNCTION_LOADER_LIBPNG(png_set_swap_alpha, void (*)(png_structrp png_ptr))
+
+    FUNCTION_LOADER_LIBPNG(png_set_read_user_chunk_fn, void (*)(png_structrp png_ptr, png_voidp user_chunk_ptr, png_user_chunk_ptr read_user_chunk_fn))
+    FUNCTION_LOADER_LIBPNG(png_set_keep_unknown_chunks, void (*)(png_structrp png_ptr, int keep, png_const_bytep chunk_list, int num_chunks))
+    FUNCTION_LOADER_LIBPNG(png_set_sig_bytes, void (*)(png_structrp png_ptr, int num_bytes))
+    FUNCTION_LOADER_LIBPNG(png_set_compression_level, void (*)(png_structrp png_ptr, int level))
+    FUNCTION_LOADER_LIBPNG(png_set_compression_strategy, void (*)(png_structrp png_ptr, int strategy))
+    FUNCTION_LOADER_LIBPNG(png_set_packing, void (*)(png_structrp png_ptr))
+
+    FUNCTION_LOADER_LIBPNG(png_set_filter, void (*)(png_structrp png_ptr, int method, int filters))
+
+    FUNCTION_LOADER_LIBPNG(png_create_write_struct, png_structp(*)(png_const_charp user_png_ver, png_voidp error_ptr, png_error_ptr error_fn, png_error_ptr warn_fn))
+    FUNCTION_LOADER_LIBPNG(png_destroy_write_struct, void (*)(png_structpp png_ptr_ptr, png_infopp info_ptr_ptr))
+    FUNCTION_LOADER_LIBPNG(png_set_write_fn, void (*)(png_structrp png_ptr, png_voidp io_ptr, png_rw_ptr write_data_fn, png_flush_ptr output_flush_fn))
+    FUNCTION_LOADER_LIBPNG(png_set_IHDR, void (*)(png_noconst15_structrp png_ptr, png_inforp info_ptr, png_uint_32 width, png_uint_32 height, int bit_depth, int color_type, int interlace_type, int compression_type, int filter_type))
+    FUNCTION_LOADER_LIBPNG(png_write_info, void (*)(png_structrp png_ptr, png_noconst15_inforp info_ptr))
+    FUNCTION_LOADER_LIBPNG(png_set_rows, void (*)(png_noconst15_structrp png_ptr, png_inforp info_ptr, png_bytepp row_pointers))
+    FUNCTION_LOADER_LIBPNG(png_set_PLTE, void (*)(png_structrp png_ptr, png_inforp info_ptr, png_const_colorp palette, int num_palette))
+    FUNCTION_LOADER_LIBPNG(png_set_tRNS, void (*)(png_structrp png_ptr, png_inforp info_ptr, png_const_bytep trans_alpha, int num_trans, png_const_color_16p trans_color))
+
+    FUNCTION_LOADER_LIBPNG(png_write_image, void (*)(png_structrp png_ptr, png_bytepp image))
+    FUNCTION_LOADER_LIBPNG(png_write_row, void (*)(png_structrp png_ptr, png_const_bytep row))
+    FUNCTION_LOADER_LIBPNG(png_write_end, void (*)(png_structrp png_ptr, png_inforp info_ptr))
+
+    FUNCTION_LOADER_LIBPNG(png_read_end, void (*)(png_structrp png_ptr, png_inforp info_ptr))
+
+    FUNCTION_LOADER_LIBPNG(png_get_bit_depth, png_byte(*)(png_const_structrp png_ptr, png_const_inforp info_ptr))
+    FUNCTION_LOADER_LIBPNG(png_get_color_type, png_byte(*)(png_const_structrp png_ptr, png_const_inforp info_ptr))
+    FUNCTION_LOADER_LIBPNG(png_get_image_width, png_uint_32(*)(png_const_structrp png_ptr, png_const_inforp info_ptr))
+    FUNCTION_LOADER_LIBPNG(png_get_image_height, png_uint_32(*)(png_const_structrp png_ptr, png_const_inforp info_ptr))
 #if (PNG_LIBPNG_VER_MAJOR == 1) && (PNG_LIBPNG_VER_MINOR < 6)
-        FUNCTION_LOADER_LIBPNG(png_get_text, png_uint_32 (*)(png_const_structp png_ptr, png_const_infop info_ptr, png_textp *text_ptr, int *num_text))
+    FUNCTION_LOADER_LIBPNG(png_get_text, png_uint_32 (*)(png_const_structp png_ptr, png_const_infop info_ptr, png_textp *text_ptr, int *num_text))
 #else
-        FUNCTION_LOADER_LIBPNG(png_get_text, int (*)(png_const_structrp png_ptr, png_inforp info_ptr, png_textp *text_ptr, int *num_text))
+    FUNCTION_LOADER_LIBPNG(png_get_text, int (*)(png_const_structrp png_ptr, png_inforp info_ptr, png_textp *text_ptr, int *num_text))
 #endif
 
-        FUNCTION_LOADER_LIBPNG(png_write_flush, void (*)(png_structrp png_ptr))
-    }
-    ++lib.loaded;
+    FUNCTION_LOADER_LIBPNG(png_write_flush, void (*)(png_structrp png_ptr))
+
+    /* If zlib isn't available, PNG images are compressed by libpng on the calling thread */
+    lib.have_zlib = true;
+    FUNCTION_LOADER_ZLIB(deflateInit2_, int (*)(z_streamp strm, int level, int method, int windowBits, int memLevel, int strategy, const char *version, int stream_size))
+    FUNCTION_LOADER_ZLIB(deflateSetDictionary, int (*)(z_streamp strm, const Bytef *dictionary, uInt dictLength))
+    FUNCTION_LOADER_ZLIB(deflateReset, int (*)(z_streamp strm))
+    FUNCTION_LOADER_ZLIB(deflateBound, uLong (*)(z_streamp strm, uLong sourceLen))
+    FUNCTION_LOADER_ZLIB(deflate, int (*)(z_streamp strm, int flush))
+    FUNCTION_LOADER_ZLIB(deflateEnd, int (*)(z_streamp strm))
+    FUNCTION_LOADER_ZLIB(adler32, uLong (*)(uLong adler, const Bytef *buf, uInt len))
+
     return true;
 }
 
+bool IMG_InitPNG(void)
+{
+    /* Loads may run on several threads at once, the first one loads the library */
+    if (SDL_ShouldInit(&lib.init)) {
+        SDL_SetInitialized(&lib.init, IMG_LoadPNGLibrary());
+    }
+    return (SDL_GetAtomicInt(&lib.init.status) == SDL_INIT_STATUS_INITIALIZED);
+}
+
 static const png_byte png_sig[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
 
 // Custom implementation of png_save_uint_32 to ensure network byte order (big-endian) writing.
@@ -322,6 +369,9 @@ static void custom_png_save_uint_16(png_bytep buf, png_uint_16 i)
 static void png_read_data(png_structp png_ptr, png_bytep area, png_size_t size)
 {
     SDL_IOStream *src = (SDL_IOStream *)lib.png_get_io_ptr(png_ptr);
+    if (IMG_LoadCancelled()) {
+        lib.png_error(png_ptr, "Load cancelled");
+    }
     if (SDL_ReadIO(src, area, size) != size) {
         lib.png_error(png_ptr, "Failed to read all expected data from SDL_IOStream for PNG image.");
     }
@@ -347,6 +397,7 @@ struct png_load_vars
     png_structp png_ptr;
     png_infop info_ptr;
     png_bytep *row_pointers;
+    Uint8 *row_buffer;
     png_colorp color_ptr;
     SDL_Surface *source_surface_for_save;
 
@@ -359,10 +410,285 @@ struct png_load_vars
     png_bytep trans;
     int num_trans;
     png_color_16p trans_values;
+    int post_orientation;    /* the orientation still to apply after the rows are read */
+    bool color_key;          /* the tRNS color becomes a color key rather than alpha */
+    bool compact_grey_alpha; /* grey with alpha is read into a palette rather than RGBA */
+    IMG_LoadOptions *options;
 };
 
+/* Get the byte order of the 8-bit RGB pixel formats that libpng can produce directly */
+static bool GetPNGByteOrder(SDL_PixelFormat format, bool *bgr, bool *alpha_first, bool *has_alpha, bool *filler)
+{
+    *bgr = false;
+    *alpha_first = false;
+    *has_alpha = false;
+    *filler = false;
+
+    switch (format) {
+    case SDL_PIXELFORMAT_RGB24:
+        break;
+    case SDL_PIXELFORMAT_BGR24:
+        *bgr = true;
+        break;
+    case SDL_PIXELFORMAT_RGBA32:
+        *has_alpha = true;
+        break;
+    case SDL_PIXELFORMAT_BGRA32:
+        *bgr = *has_alpha = true;
+        break;
+    case SDL_PIXELFORMAT_ARGB32:
+        *alpha_first = *has_alpha = true;
+        break;
+    case SDL_PIXELFORMAT_ABGR32:
+        *bgr = *alpha_first = *has_alpha = true;
+        break;
+    case SDL_PIXELFORMAT_RGBX32:
+        *filler = true;
+        break;
+    case SDL_PIXELFORMAT_BGRX32:
+        *bgr = *filler = true;
+        break;
+    case SDL_PIXELFORMAT_XRGB32:
+        *alpha_first = *filler = true;
+        break;
+    case SDL_PIXELFORMAT_XBGR32:
+        *bgr = *alpha_first = *filler = true;
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+/* Set up libpng transformations to decode directly to the requested pixel format */
+static void LIBPNG_SetOutputFormat(struct png_load_vars *vars)
+{
+    SDL_PixelFormat format = vars->options ? vars->options->format : SDL_PIXELFORMAT_UNKNOWN;
+    bool bgr, alpha_first, has_alpha, filler;
+    bool source_alpha;
+
+    if (format == SDL_PIXELFORMAT_UNKNOWN || format == vars->format ||
+        !GetPNGByteOrder(format, &bgr, &alpha_first, &has_alpha, &filler)) {
+        return;
+    }
+
+    source_alpha = (vars->color_type & PNG_COLOR_MASK_ALPHA) ||
+                   (vars->color_type == PNG_COLOR_TYPE_PALETTE && lib.png_get_valid(vars->png_ptr, vars->info_ptr, PNG_INFO_tRNS));
+    if (source_alpha && !has_alpha) {
+        /* Let the conversion decide what to do with the alpha channel */
+        return;
+    }
+
+    if (vars->color_type == PNG_COLOR_TYPE_PALETTE) {
+        lib.png_set_palette_to_rgb(vars->png_ptr);
+        if (source_alpha) {
+            lib.png_set_tRNS_to_alpha(vars->png_ptr);
+        }
+    } else if (vars->color_type == PNG_COLOR_TYPE_GRAY) {
+        lib.png_set_expand(vars->png_ptr);
+        lib.png_set_gray_to_rgb(vars->png_ptr);
+    }
+    if (vars->bit_depth == 16) {
+        lib.png_set_strip_16(vars->png_ptr);
+    }
+    if (bgr) {
+        lib.png_set_bgr(vars->png_ptr);
+    }
+    if (source_alpha) {
+        if (alpha_first) {
+            lib.png_set_swap_alpha(vars->png_ptr);
+        }
+    } else if (has_alpha || filler) {
+        lib.png_set_filler(vars->png_ptr, 0xFF, alpha_first ? PNG_FILLER_BEFORE : PNG_FILLER_AFTER);
+    }
+    vars->format = format;
+}
+
+/* Get the EXIF orientation stored in the XMP metadata of a PNG image, or 1 if there isn't one */
+static int LIBPNG_GetOrientation(struct png_load_vars *vars)
+{
+    png_textp text_ptr = NULL;
+    int num_text = 0;
+    int orientation = 1;
+
+    if (lib.png_get_text(vars->png_ptr, vars->info_ptr, &text_ptr, &num_text) > 0) {
+        for (int i = 0; i < num_text; ++i, ++text_ptr) {
+            if (SDL_strcmp(text_ptr->key, "XML:com.adobe.xmp") == 0) {
+                // Look for tiff:Orientation in the XMP data
+                const char *value = SDL_strstr(text_ptr->text, "tiff:Orientation=\"");
+                if (value) {
+                    value += 18;
+                    if (*value >= '1' && *value <= '8') {
+                        orientation = (*value - '0');
+                    }
+                }
+            }
+        }
+    }
+    return orientation;
+}
+
+#if SDL_BYTEORDER != SDL_BIG_ENDIAN
+static void LIBPNG_SwapRows16(png_bytep *rows, png_uint_32 num_rows, int num_values)
+{
+    for (png_uint_32 y = 0; y < num_rows; y++) {
+        Uint16 *pixels = (Uint16 *)rows[y];
+        for (int i = 0; i < num_values; i++) {
+            pixels[i] = SDL_Swap16(pixels[i]);
+        }
+    }
+}
+#endif
+
+/* Reverse the order of the pixels in a row */
+static void LIBPNG_MirrorRow(Uint8 *row, png_uint_32 width, int bpp)
+{
+    Uint8 *left = row;
+    Uint8 *right = row + (width - 1) * (size_t)bpp;
+    Uint8 tmp[8];
+
+    while (left < right) {
+        SDL_memcpy(tmp, left, bpp);
+        SDL_memcpy(left, right, bpp);
+        SDL_memcpy(right, tmp, bpp);
+        left += bpp;
+        right -= bpp;
+    }
+}
+
+/* The number of rows decoded at a time when an image is transposed as it is read */
+#define PNG_TRANSPOSE_ROWS  32
+
+/* Decode a non-interlaced image a band of rows at a time, transposing each band into the oriented surface */
+static void LIBPNG_ReadTransposedImage(struct png_load_vars *vars, int orientation)
+{
+    const size_t row_size = (size_t)vars->width * SDL_BYTESPERPIXEL(vars->format);
+    png_bytep rows[PNG_TRANSPOSE_ROWS];
+
+    vars->row_buffer = (Uint8 *)SDL_malloc(row_size * PNG_TRANSPOSE_ROWS);
+    if (!vars->row_buffer) {
+        lib.png_error(vars->png_ptr, "Out of memory allocating row buffer");
+    }
+    for (int i = 0; i < PNG_TRANSPOSE_ROWS; i++) {
+        rows[i] = vars->row_buffer + i * row_size;
+    }
+
+    for (png_uint_32 y = 0; y < vars->height; y += PNG_TRANSPOSE_ROWS) {
+        png_uint_32 num_rows = SDL_min(PNG_TRANSPOSE_ROWS, vars->height - y);
+
+        lib.png_read_rows(vars->png_ptr, rows, NULL, num_rows);
+#if SDL_BYTEORDER != SDL_BIG_ENDIAN
+        if (vars->format == SDL_PIXELFORMAT_RGBA64) {
+            LIBPNG_SwapRows16(rows, num_rows, vars->width * 4);
+        }
+#endif
+        IMG_CopyOrientedPixels(vars->row_buffer, (int)row_size, 0, (int)y, (int)vars->width, (int)num_rows, vars->surface, orientation);
+    }
+}
+
+/* Read an 8-bit grey+alpha image as an indexed image with a translucent palette, if it has few enough grey and alpha combinations */
+static bool LIBPNG_ReadCompactGreyAlpha(struct png_load_vars *vars, int orientation)
+{
+    size_t pitch = (size_t)vars->width * 2;
+    Uint16 *indices;
+    SDL_Color colors[256];
+    int count = 0;
+    png_uint_32 x, y;
+
+    vars->row_buffer = (Uint8 *)SDL_malloc(pitch * vars->height);
+    vars->row_pointers = (png_bytep *)SDL_malloc(sizeof(png_bytep) * vars->height);
+    if (!vars->row_buffer || !vars->row_pointers) {
+        vars->error = "Out of memory allocating PNG image";
+        return false;
+    }
+    for (y = 0; y < vars->height; y++) {
+        vars->row_pointers[y] = vars->row_buffer + y * pitch;
+    }
+    lib.png_read_image(vars->png_ptr, vars->row_pointers);
+
+    /* Number the grey and alpha combinations from 1, stopping if there are too many for a palette */
+    indices = (Uint16 *)SDL_calloc(65536, sizeof(*indices));
+    if (indices) {
+        for (y = 0; y < vars->height && count <= 256; y++) {
+            const Uint8 *src = vars->row_pointers[y];
+
+            for (x = 0; x < vars->width; x++, src += 2) {
+                Uint16 key = (Uint16)((src[0] << 8) | src[1]);
+
+                if (!indices[key]) {
+                    if (count == 256) {
+                        count = 257;
+                        break;
+                    }
+                    colors[count].r = src[0];
+                    colors[count].g = src[0];
+                    colors[count].b = src[0];
+                    colors[count].a = src[1];
+                    indices[key] = (Uint16)++count;
+                }
+            }
+        }
+    } else {
+        count = 257;
+    }
+
+    if (count <= 256) {
+        SDL_Palette *palette = SDL_CreatePalette(count);
+
+        vars->surface = SDL_CreateSurface((int)vars->width, (int)vars->height, SDL_PIXELFORMAT_INDEX8);
+        if (!palette || !vars->surface ||
+            !SDL_SetPaletteColors(palette, colors, 0, count) ||
+            !SDL_SetSurfacePalette(vars->surface, palette)) {
+            SDL_DestroySurface(vars->surface);
+            vars->surface = NULL;
+        }
+        SDL_DestroyPalette(palette);
+        if (vars->surface) {
+            SDL_SetSurfaceBlendMode(vars->surface, SDL_BLENDMODE_BLEND);
+            for (y = 0; y < vars->height; y++) {
+                const Uint8 *src = vars->row_pointers[y];
+                Uint8 *dst = (Uint8 *)vars->surface->pixels + y * (size_t)vars->surface->pitch;
+
+                for (x = 0; x < vars->width; x++, src += 2) {
+                    dst[x] = (Uint8)(indices[(src[0] << 8) | src[1]] - 1);
+                }
+            }
+        }
+    } else {
+        vars->surface = SDL_CreateSurface((int)vars->width, (int)vars->height, SDL_PIXELFORMAT_RGBA32);
+        if (vars->surface) {
+            for (y = 0; y < vars->height; y++) {
+                const Uint8 *src = vars->row_pointers[y];
+                Uint8 *dst = (Uint8 *)vars->surface->pixels + y * (size_t)vars->surface->pitch;
+
+                for (x = 0; x < vars->width; x++, src += 2, dst += 4) {
+                    dst[0] = dst[1] = dst[2] = src[0];
+                    dst[3] = src[1];
+                }
+            }
+        }
+    }
+    SDL_free(indices);
+
+    if (!vars->surface) {
+        vars->error = SDL_GetError();
+        return false;
+    }
+    if (orientation != 1) {
+        vars->surface = IMG_ApplyOrientation(vars->surface, orientation);
+        if (!vars->surface) {
+            return false;
+        }
+    }
+    return true;
+}
+
 static bool LIBPNG_LoadPNG_IO_Internal(SDL_IOStream *src, struct png_load_vars *vars)
 {
+    int orientation;
+    int oriented_w, oriented_h;
+    bool compact;
+
     if (SDL_ReadIO(src, vars->header, sizeof(vars->header)) != sizeof(vars->header)) {
         vars->error = "Failed to read PNG header from SDL_IOStream";
         return false;
@@ -395,23 +721,42 @@ static bool LIBPNG_LoadPNG_IO_Internal(SDL_IOStream *src, struct png_load_vars *
     lib.png_set_read_fn(vars->png_ptr, src, png_read_data);
     lib.png_set_sig_bytes(vars->png_ptr, 8);
 
+    if (vars->options->trusted) {
+        /* The data has already been validated, so skip the chunk and zlib checksums */
+        lib.png_set_crc_action(vars->png_ptr, PNG_CRC_QUIET_USE, PNG_CRC_QUIET_USE);
+#if defined(PNG_SET_OPTION_SUPPORTED) && defined(PNG_IGNORE_ADLER32)
+        lib.png_set_option(vars->png_ptr, PNG_IGNORE_ADLER32, PNG_OPTION_ON);
+#endif
+    }
+
     lib.png_read_info(vars->png_ptr, vars->info_ptr);
     lib.png_get_IHDR(vars->png_ptr, vars->info_ptr, &vars->width, &vars->height, &vars->bit_depth,
                      &vars->color_type, &vars->interlace_type, NULL, NULL);
 
-    // Only convert non-palette formats to RGB/RGBA
-    // TODO: Convert this to a colour key - the specs say that there's
-    // only one transparent colour for non-palette images
+    /* Compact images are only useful if the caller hasn't asked for a format */
+    compact = (vars->options->compact && vars->options->format == SDL_PIXELFORMAT_UNKNOWN &&
+               !vars->options->dst && !vars->options->premultiply_alpha && vars->bit_depth <= 8);
+
+    // Only convert non-palette formats to RGB/RGBA, unless the
+    // single transparent colour of grey and RGB images can be a colour key
     if (vars->color_type != PNG_COLOR_TYPE_PALETTE) {
         if (lib.png_get_valid(vars->png_ptr, vars->info_ptr, PNG_INFO_tRNS)) {
-            lib.png_set_tRNS_to_alpha(vars->png_ptr);
-            vars->color_type |= PNG_COLOR_MASK_ALPHA;
+            if (compact && (vars->color_type == PNG_COLOR_TYPE_GRAY || vars->color_type == PNG_COLOR_TYPE_RGB)) {
+                vars->color_key = true;
+            } else {
+                lib.png_set_tRNS_to_alpha(vars->png_ptr);
+                vars->color_type |= PNG_COLOR_MASK_ALPHA;
+            }
         }
     }
 
     /* SDL doesn't currently support this format, so we convert to RGB for now. */
     if (vars->color_type == PNG_COLOR_TYPE_GRAY_ALPHA) {
-        lib.png_set_gray_to_rgb(vars->png_ptr);
+        if (compact && vars->bit_depth == 8) {
+            vars->compact_grey_alpha = true;
+        } else {
+            lib.png_set_gray_to_rgb(vars->png_ptr);
+        }
     }
 
     if (vars->color_type == PNG_COLOR_TYPE_PALETTE ||
@@ -439,11 +784,27 @@ static bool LIBPNG_LoadPNG_IO_Internal(SDL_IOStream *src, struct png_load_vars *
         }
     }
 
+    LIBPNG_SetOutputFormat(vars);
+
     lib.png_read_update_info(vars->png_ptr, vars->info_ptr);
     lib.png_get_IHDR(vars->png_ptr, vars->info_ptr, &vars->width, &vars->height, &vars->bit_depth,
                      &vars->color_type, &vars->interlace_type, NULL, NULL);
 
-    vars->surface = SDL_CreateSurface(vars->width, vars->height, vars->format);
+    /* Orient the image as the rows are decoded, unless the pixels aren't whole bytes
+     * or the rows of an interlaced image would need to be transposed more than once.
+     */
+    orientation = LIBPNG_GetOrientation(vars);
+    if (vars->compact_grey_alpha) {
+        return LIBPNG_ReadCompactGreyAlpha(vars, orientation);
+    }
+    if (SDL_BYTESPERPIXEL(vars->format) == 0 ||
+        (orientation >= 5 && vars->interlace_type != PNG_INTERLACE_NONE)) {
+        vars->post_orientation = orientation;
+        orientation = 1;
+    }
+    IMG_GetOrientedSize(orientation, (int)vars->width, (int)vars->height, &oriented_w, &oriented_h);
+
+    vars->surface = IMG_CreateLoadSurface(vars->options, oriented_w, oriented_h, vars->format);
     if (vars->surface == NULL) {
         vars->error = SDL_GetError();
         return false;
@@ -480,58 +841,61 @@ static bool LIBPNG_LoadPNG_IO_Internal(SDL_IOStream *src, struct png_load_vars *
         }
 
         for (int i = 0; i < palette->ncolors; i++) {
-            palette->colors[i].r = (i * 255) / palette->ncolors;
-            palette->colors[i].g = (i * 255) / palette->ncolors;
-            palette->colors[i].b = (i * 255) / palette->ncolors;
+            palette->colors[i].r = (Uint8)((i * 255) / (palette->ncolors - 1));
+            palette->colors[i].g = (Uint8)((i * 255) / (palette->ncolors - 1));
+            palette->colors[i].b = (Uint8)((i * 255) / (palette->ncolors - 1));
             palette->colors[i].a = 255;
         }
     }
 
-    vars->row_pointers = (png_bytep *)SDL_malloc(sizeof(png_bytep) * vars->height);
-    if (!vars->row_pointers) {
-        vars->error = "Out of memory allocating row pointers";
-        return false;
-    }
-    for (png_uint_32 y = 0; y < vars->height; y++) {
-        vars->row_pointers[y] = (png_bytep)((Uint8 *)vars->surface->pixels + y * (size_t)vars->surface->pitch);
+    if (vars->color_key && lib.png_get_tRNS(vars->png_ptr, vars->info_ptr, &vars->trans, &vars->num_trans, &vars->trans_values) && vars->trans_values) {
+        if (vars->color_type == PNG_COLOR_TYPE_GRAY) {
+            SDL_SetSurfaceColorKey(vars->surface, true, vars->trans_values->gray & ((1 << vars->bit_depth) - 1));
+        } else {
+            SDL_SetSurfaceColorKey(vars->surface, true, SDL_MapSurfaceRGB(vars->surface, (Uint8)vars->trans_values->red, (Uint8)vars->trans_values->green, (Uint8)vars->trans_values->blue));
+        }
     }
 
-    lib.png_read_image(vars->png_ptr, vars->row_pointers);
+    if (orientation >= 5) {
+        LIBPNG_ReadTransposedImage(vars, orientation);
+    } else {
+        const bool flip_rows = (orientation == 3 || orientation == 4);
+
+        vars->row_pointers = (png_bytep *)SDL_malloc(sizeof(png_bytep) * vars->height);
+        if (!vars->row_pointers) {
+            vars->error = "Out of memory allocating row pointers";
+            return false;
+        }
+        for (png_uint_32 y = 0; y < vars->height; y++) {
+            png_uint_32 row = flip_rows ? (vars->height - 1 - y) : y;
+            vars->row_pointers[y] = (png_bytep)((Uint8 *)vars->surface->pixels + row * (size_t)vars->surface->pitch);
+        }
+
+        lib.png_read_image(vars->png_ptr, vars->row_pointers);
 
 #if SDL_BYTEORDER != SDL_BIG_ENDIAN
-    if (vars->format == SDL_PIXELFORMAT_RGBA64) {
-        Uint16 *pixels = (Uint16 *)vars->surface->pixels;
-        int num_pixels = vars->width * vars->height * 4;
-        for (int i = 0; i < num_pixels; i++) {
-            pixels[i] = SDL_Swap16(pixels[i]);
+        if (vars->format == SDL_PIXELFORMAT_RGBA64) {
+            LIBPNG_SwapRows16(vars->row_pointers, vars->height, vars->width * 4);
         }
-    }
 #endif
-
-    png_textp text_ptr = NULL;
-    int num_text = 0;
-    if (lib.png_get_text(vars->png_ptr, vars->info_ptr, &text_ptr, &num_text) > 0) {
-        for (int i = 0; i < num_text; ++i, ++text_ptr) {
-            if (SDL_strcmp(text_ptr->key, "XML:com.adobe.xmp") == 0) {
-                // Look for tiff:Orientation in the XMP data
-                int orientation;
-                const char *value = SDL_strstr(text_ptr->text, "tiff:Orientation=\"");
-                if (value) {
-                    value += 18;
-                    orientation = (*value - '0');
-                    vars->surface = IMG_ApplyOrientation(vars->surface, orientation);
-                    if (!vars->surface) {
-                        return false;
-                    }
-                }
+        if (orientation == 2 || orientation == 3) {
+            for (png_uint_32 y = 0; y < vars->height; y++) {
+                LIBPNG_MirrorRow(vars->row_pointers[y], vars->width, SDL_BYTESPERPIXEL(vars->format));
             }
         }
     }
 
+    if (vars->post_orientation != 1) {
+        vars->surface = IMG_ApplyOrientation(vars->surface, vars->post_orientation);
+        if (!vars->surface) {
+            return false;
+        }
+    }
+
     return true;
 }
 
-SDL_Surface *IMG_LoadPNG_LIBPNG(SDL_IOStream *src)
+SDL_Surface *IMG_LoadPNG_LIBPNG(SDL_IOStream *src, IMG_LoadOptions *options)
 {
     Sint64 start_pos;
     bool success = false;
@@ -545,6 +909,8 @@ SDL_Surface *IMG_LoadPNG_LIBPNG(SDL_IOStream *src)
 
     struct png_load_vars vars;
     SDL_zero(vars);
+    vars.options = options;
+    vars.post_orientation = 1;
 
     success = LIBPNG_LoadPNG_IO_Internal(src, &vars);
 
@@ -556,6 +922,9 @@ SDL_Surface *IMG_LoadPNG_LIBPNG(SDL_IOStream *src)
     if (vars.row_pointers) {
         SDL_free(vars.row_pointers);
     }
+    if (vars.row_buffer) {
+        SDL_free(vars.row_buffer);
+    }
 
     if (success) {
         return vars.surface;
@@ -573,6 +942,596 @@ SDL_Surface *IMG_LoadPNG_LIBPNG(SDL_IOStream *src)
 
 #if SAVE_PNG
 
+static bool write_png_chunk(SDL_IOStream *stream, const char *chunk_type_str, png_bytep data, png_size_t size)
+{
+    png_byte crc_data[4];
+    png_uint_32 crc;
+    png_byte size_bytes[4];
+    png_byte chunk_type[4];
+
+    SDL_memcpy(chunk_type, chunk_type_str, 4);
+
+    // Write chunk length
+    custom_png_save_uint_32(size_bytes, (png_uint_32)size);
+    if (SDL_WriteIO(stream, size_bytes, 4) != 4) {
+        SDL_SetError("Failed to write chunk size for %s chunk", chunk_type_str);
+        return false;
+    }
+
+    // Write chunk type
+    if (SDL_WriteIO(stream, chunk_type, 4) != 4) {
+        SDL_SetError("Failed to write chunk type for %s chunk", chunk_type_str);
+        return false;
+    }
+
+    // Write chunk data (if any)
+    if (data && size > 0) {
+        if (SDL_WriteIO(stream, data, size) != size) {
+            SDL_SetError("Failed to write chunk data for %s chunk", chunk_type_str);
+            return false;
+        }
+    }
+
+    // Calculate and write CRC
+    crc = SDL_crc32(0L, NULL, 0);
+    crc = SDL_crc32(crc, chunk_type, 4);
+    if (data && size > 0) {
+        crc = SDL_crc32(crc, data, size);
+    }
+    custom_png_save_uint_32(crc_data, crc);
+    if (SDL_WriteIO(stream, crc_data, 4) != 4) {
+        SDL_SetError("Failed to write chunk CRC for %s chunk", chunk_type_str);
+        return false;
+    }
+
+    return true;
+}
+
+/* The amount of image data compressed at a time on each thread */
+#define PNG_DEFLATE_BLOCK_SIZE  (256 * 1024)
+#define PNG_DEFLATE_WINDOW_SIZE 32768
+
+typedef struct
+{
+    png_bytep data;     /* two bytes for the zlib header, the compressed data, and four bytes for the Adler-32 */
+    size_t size;        /* the size of the compressed data */
+    png_uint_32 adler;  /* the Adler-32 of the filtered rows in this block */
+    Uint64 length;      /* the size of the filtered rows in this block */
+} PNGDeflateBlock;
+
+typedef struct
+{
+    const Uint8 *pixels;
+    int pitch;
+    int height;
+    size_t rowbytes;
+    int bpp;
+    int filters;            /* the PNG_FILTER_* flags of the filters that may be used */
+    int compression_level;
+    int strategy;
+    int rows_per_block;
+    int dictionary_rows;
+    int num_blocks;
+    PNGDeflateBlock *blocks;
+    SDL_AtomicInt next_block;
+    SDL_AtomicInt failed;
+} PNGDeflateJob;
+
+static png_byte PaethPredictor(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = SDL_abs(p - a);
+    int pb = SDL_abs(p - b);
+    int pc = SDL_abs(p - c);
+
+    if (pa <= pb && pa <= pc) {
+        return (png_byte)a;
+    } else if (pb <= pc) {
+        return (png_byte)b;
+    } else {
+        return (png_byte)c;
+    }
+}
+
+/* Pick the allowed filter with the smallest sum of absolute differences, like libpng does */
+static png_byte ChoosePNGFilter(const Uint8 *row, const Uint8 *prev, size_t rowbytes, int bpp, int filters)
+{
+    Uint64 sums[5] = { 0, 0, 0, 0, 0 };
+    png_byte best = PNG_FILTER_VALUE_LAST;
+    size_t i;
+    int f;
+
+    for (f = PNG_FILTER_VALUE_NONE; f < PNG_FILTER_VALUE_LAST; ++f) {
+        if (filters == (PNG_FILTER_NONE << f)) {
+            return (png_byte)f;
+        }
+    }
+
+    for (i = 0; i < rowbytes; ++i) {
+        int a = (i >= (size_t)bpp) ? row[i - bpp] : 0;
+        int b = prev ? prev[i] : 0;
+        int c = (prev && i >= (size_t)bpp) ? prev[i - bpp] : 0;
+        int x = row[i];
+
+        sums[PNG_FILTER_VALUE_NONE] += SDL_abs((Sint8)x);
+        sums[PNG_FILTER_VALUE_SUB] += SDL_abs((Sint8)(x - a));
+        sums[PNG_FILTER_VALUE_UP] += SDL_abs((Sint8)(x - b));
+        sums[PNG_FILTER_VALUE_AVG] += SDL_abs((Sint8)(x - ((a + b) >> 1)));
+        sums[PNG_FILTER_VALUE_PAETH] += SDL_abs((Sint8)(x - PaethPredictor(a, b, c)));
+    }
+    for (f = PNG_FILTER_VALUE_NONE; f < PNG_FILTER_VALUE_LAST; ++f) {
+        if ((filters & (PNG_FILTER_NONE << f)) && (best == PNG_FILTER_VALUE_LAST || sums[f] < sums[best])) {
+            best = (png_byte)f;
+        }
+    }
+    return best;
+}
+
+/* Write the filter type byte and the filtered bytes of a row, prev is NULL for the first row of the image */
+static void FilterPNGRow(png_bytep out, const Uint8 *row, const Uint8 *prev, size_t rowbytes, int bpp, png_byte filter)
+{
+    size_t i;
+
+    *out++ = filter;
+    for (i = 0; i < rowbytes; ++i) {
+        int a = (i >= (size_t)bpp) ? row[i - bpp] : 0;
+        int b = prev ? prev[i] : 0;
+        int c = (prev && i >= (size_t)bpp) ? prev[i - bpp] : 0;
+
+        switch (filter) {
+        case PNG_FILTER_VALUE_SUB:
+            out[i] = (png_byte)(row[i] - a);
+            break;
+        case PNG_FILTER_VALUE_UP:
+            out[i] = (png_byte)(row[i] - b);
+            break;
+        case PNG_FILTER_VALUE_AVG:
+            out[i] = (png_byte)(row[i] - ((a + b) >> 1));
+            break;
+        case PNG_FILTER_VALUE_PAETH:
+            out[i] = (png_byte)(row[i] - PaethPredictor(a, b, c));
+            break;
+        default:
+            out[i] = row[i];
+            break;
+        }
+    }
+}
+
+/* Combine the Adler-32 of two pieces of data, as adler32_combine() does in zlib 1.2.2.1 and newer */
+static png_uint_32 CombineAdler32(png_uint_32 adler1, png_uint_32 adler2, Uint64 length2)
+{
+    const png_uint_32 base = 65521;
+    png_uint_32 rem = (png_uint_32)(length2 % base);
+    png_uint_32 sum1 = adler1 & 0xffff;
+    png_uint_32 sum2 = (png_uint_32)(((Uint64)rem * sum1) % base);
+
+    sum1 += (adler2 & 0xffff) + base - 1;
+    sum2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) + base - rem;
+    if (sum1 >= base) {
+        sum1 -= base;
+    }
+    if (sum1 >= base) {
+        sum1 -= base;
+    }
+    if (sum2 >= (base << 1)) {
+        sum2 -= (base << 1);
+    }
+    if (sum2 >= base) {
+        sum2 -= base;
+    }
+    return sum1 | (sum2 << 16);
+}
+
+/* Filter and compress a block of rows as raw deflate data that ends on a byte boundary.
+   The stream is primed with the filtered rows before the block, so the block compresses
+   as well as it would in the middle of a single stream, and all but the last block end
+   with a full flush so the compressed blocks can be concatenated. */
+static bool DeflatePNGBlock(PNGDeflateJob *job, z_stream *strm, png_bytep filtered, int index)
+{
+    PNGDeflateBlock *block = &job->blocks[index];
+    size_t stride = job->rowbytes + 1;
+    int y0 = index * job->rows_per_block;
+    int y1 = SDL_min(y0 + job->rows_per_block, job->height);
+    int first = SDL_max(y0 - job->dictionary_rows, 0);
+    int flush = (index == job->num_blocks - 1) ? Z_FINISH : Z_FULL_FLUSH;
+    png_bytep input = filtered + (y0 - first) * stride;
+    size_t input_size = (y1 - y0) * stride;
+    size_t dictionary_size = SDL_min((y0 - first) * stride, PNG_DEFLATE_WINDOW_SIZE);
+    size_t capacity;
+    int y;
+
+    for (y = first; y < y1; ++y) {
+        const Uint8 *row = job->pixels + y * (size_t)job->pitch;
+        const Uint8 *prev = (y > 0) ? row - job->pitch : NULL;
+        png_byte filter = ChoosePNGFilter(row, prev, job->rowbytes, job->bpp, job->filters);
+
+        FilterPNGRow(filtered + (y - first) * stride, row, prev, job->rowbytes, job->bpp, filter);
+    }
+
+    if (lib.deflateReset(strm) != Z_OK) {
+        return false;
+    }
+    if (dictionary_size > 0 && lib.deflateSetDictionary(strm, input - dictionary_size, (uInt)dictionary_size) != Z_OK) {
+        return false;
+    }
+    block->adler = (png_uint_32)lib.adler32(lib.adler32(0, NULL, 0), input, (uInt)input_size);
+    block->length = input_size;
+
+    /* Leave room for the end of the block after a full flush, and the zlib header and Adler-32 */
+    capacity = lib.deflateBound(strm, (uLong)input_size) + 16;
+    block->data = (png_bytep)SDL_malloc(2 + capacity + 4);
+    if (!block->data) {
+        return false;
+    }
+    strm->next_in = input;
+    strm->avail_in = (uInt)input_size;
+    strm->next_out = block->data + 2;
+    strm->avail_out = (uInt)capacity;
+    for (;;) {
+        int status = lib.deflate(strm, flush);
+        png_bytep data;
+
+        if (status == Z_STREAM_ERROR) {
+            return false;
+        }
+        if (flush == Z_FINISH ? (status == Z_STREAM_END) : (strm->avail_in == 0 && strm->avail_out > 0)) {
+            break;
+        }
+
+        /* This shouldn't happen, but grow the buffer if deflateBound() was too small */
+        block->size = strm->next_out - (block->data + 2);
+        data = (png_bytep)SDL_realloc(block->data, 2 + capacity * 2 + 4);
+        if (!data) {
+            return false;
+        }
+        block->data = data;
+        strm->next_out = block->data + 2 + block->size;
+        strm->avail_out = (uInt)(capacity * 2 - block->size);
+        capacity *= 2;
+    }
+    block->size = strm->next_out - (block->data + 2);
+    return true;
+}
+
+static int SDLCALL DeflatePNGBlocksThread(void *data)
+{
+    PNGDeflateJob *job = (PNGDeflateJob *)data;
+    png_bytep filtered;
+    z_stream strm;
+    int index;
+
+    filtered = (png_bytep)SDL_malloc((size_t)(job->dictionary_rows + job->rows_per_block) * (job->rowbytes + 1));
+    SDL_zero(strm);
+    if (!filtered ||
+        lib.deflateInit2_(&strm, job->compression_level, Z_DEFLATED, -15, 8, job->strategy, ZLIB_VERSION, (int)sizeof(strm)) != Z_OK) {
+        SDL_SetAtomicInt(&job->failed, 1);
+        SDL_free(filtered);
+        return 0;
+    }
+
+    while (!SDL_GetAtomicInt(&job->failed) &&
+           (index = SDL_AddAtomicInt(&job->next_block, 1)) < job->num_blocks) {
+        if (!DeflatePNGBlock(job, &strm, filtered, index)) {
+            SDL_SetAtomicInt(&job->failed, 1);
+        }
+    }
+    lib.deflateEnd(&strm);
+    SDL_free(filtered);
+    return 0;
+}
+
+/* Filter and compress the image data in blocks of rows on several threads, and write them as one zlib stream in IDAT chunks */
+static bool LIBPNG_WriteImageParallel(const Uint8 *pixels, int pitch, int width, int height, int bpp, SDL_IOStream *dst, int filters, int compression_level, int strategy, int num_threads)
+{
+    PNGDeflateJob job;
+    SDL_Thread **threads = NULL;
+    png_uint_32 adler;
+    int i;
+    bool result = true;
+
+    SDL_zero(job);
+    job.pixels = pixels;
+    job.pitch = pitch;
+    job.height = height;
+    job.bpp = bpp;
+    job.rowbytes = (size_t)width * bpp;
+    job.filters = filters;
+    job.compression_level = compression_level;
+    job.strategy = strategy;
+    job.rows_per_block = (int)SDL_max(PNG_DEFLATE_BLOCK_SIZE / (job.rowbytes + 1), 1);
+    job.dictionary_rows = (int)((PNG_DEFLATE_WINDOW_SIZE + job.rowbytes) / (job.rowbytes + 1));
+    job.num_blocks = (job.height + job.rows_per_block - 1) / job.rows_per_block;
+    num_threads = SDL_min(num_threads, job.num_blocks);
+
+    job.blocks = (PNGDeflateBlock *)SDL_calloc(job.num_blocks, sizeof(*job.blocks));
+    threads = (SDL_Thread **)SDL_calloc(num_threads, sizeof(*threads));
+    if (!job.blocks || !threads) {
+        SDL_free(job.blocks);
+        SDL_free(threads);
+        return false;
+    }
+
+    /* The calling thread compresses blocks too, and picks up all of them if threads can't be created */
+    for (i = 1; i < num_threads; ++i) {
+        threads[i] = SDL_CreateThread(DeflatePNGBlocksThread, "SDL_image PNG", &job);
+    }
+    DeflatePNGBlocksThread(&job);
+    for (i = 1; i < num_threads; ++i) {
+        if (threads[i]) {
+            SDL_WaitThread(threads[i], NULL);
+        }
+    }
+    if (SDL_GetAtomicInt(&job.failed)) {
+        result = SDL_SetError("Couldn't compress PNG image data");
+    }
+
+    if (result) {
+        /* The zlib header for a 32K window, with the compression level as libpng would set it */
+        PNGDeflateBlock *first = &job.blocks[0];
+        PNGDeflateBlock *last = &job.blocks[job.num_blocks - 1];
+        int flevel = (compression_level < 2) ? 0 : (compression_level < 6) ? 1 : (compression_level == 6) ? 2 : 3;
+        int header = (0x78 << 8) | (flevel << 6);
+
+        header += 31 - (header % 31);
+        first->data[0] = (png_byte)(header >> 8);
+        first->data[1] = (png_byte)header;
+
+        adler = first->adler;
+        for (i = 1; i < job.num_blocks; ++i) {
+            adler = CombineAdler32(adler, job.blocks[i].adler, job.blocks[i].length);
+        }
+        custom_png_save_uint_32(last->data + 2 + last->size, adler);
+
+        for (i = 0; i < job.num_blocks && result; ++i) {
+            PNGDeflateBlock *block = &job.blocks[i];
+            png_bytep data = (i == 0) ? block->data : block->data + 2;
+            png_size_t size = block->size + ((i == 0) ? 2 : 0) + ((i == job.num_blocks - 1) ? 4 : 0);
+
+            result = write_png_chunk(dst, "IDAT", data, size);
+        }
+    }
+    result = result && write_png_chunk(dst, "IEND", NULL, 0);
+
+    for (i = 0; i < job.num_blocks; ++i) {
+        SDL_free(job.blocks[i].data);
+    }
+    SDL_free(job.blocks);
+    SDL_free(threads);
+    return result;
+}
+
+/* A small hash set of the colors in an image, to see whether it can be saved with a palette */
+#define PNG_COLOR_TABLE_SIZE 1024
+
+typedef struct
+{
+    Uint32 colors[PNG_COLOR_TABLE_SIZE];
+    Uint8 indices[PNG_COLOR_TABLE_SIZE];
+    bool used[PNG_COLOR_TABLE_SIZE];
+    int count;  /* more than 256 if the image has too many colors for a palette */
+} PNGColorTable;
+
+static int FindPNGColor(PNGColorTable *table, Uint32 color)
+{
+    int slot = (int)((color * 0x9E3779B1u) >> 22);
+
+    while (table->used[slot] && table->colors[slot] != color) {
+        slot = (slot + 1) & (PNG_COLOR_TABLE_SIZE - 1);
+    }
+    return slot;
+}
+
+/* Clear opaque or grey for a row of RGBA32 pixels, returning the number of pixels checked */
+typedef int (*CheckPNGColorsFunc)(const Uint8 *pixels, int width, bool *opaque, bool *grey);
+
+#ifdef SDL_SSE2_INTRINSICS
+static int SDL_TARGETING("sse2") CheckPNGColors_SSE2(const Uint8 *pixels, int width, bool *opaque, bool *grey)
+{
+    const __m128i alpha_mask = _mm_set1_epi32(0xFF000000);
+    const __m128i green_blue_mask = _mm_set1_epi32(0x00FFFF00);
+    __m128i alpha = alpha_mask;
+    __m128i diff = _mm_setzero_si128();
+    int x;
+
+    for (x = 0; x + 4 <= width; x += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(pixels + x * 4));
+
+        /* Compare green with red and blue with green by shifting each pixel up a byte */
+        alpha = _mm_and_si128(alpha, v);
+        diff = _mm_or_si128(diff, _mm_and_si128(_mm_xor_si128(v, _mm_slli_epi32(v, 8)), green_blue_mask));
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alpha_mask)) != 0xFFFF) {
+        *opaque = false;
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(diff, _mm_setzero_si128())) != 0xFFFF) {
+        *grey = false;
+    }
+    return x;
+}
+#endif /* SDL_SSE2_INTRINSICS */
+
+#if defined(SDL_NEON_INTRINSICS) && (defined(__aarch64__) || defined(_M_ARM64))
+static int CheckPNGColors_NEON(const Uint8 *pixels, int width, bool *opaque, bool *grey)
+{
+    uint8x16_t alpha = vdupq_n_u8(0xFF);
+    uint8x16_t diff = vdupq_n_u8(0);
+    int x;
+
+    for (x = 0; x + 16 <= width; x += 16) {
+        uint8x16x4_t v = vld4q_u8(pixels + x * 4);
+
+        alpha = vandq_u8(alpha, v.val[3]);
+        diff = vorrq_u8(diff, vorrq_u8(veorq_u8(v.val[0], v.val[1]), veorq_u8(v.val[1], v.val[2])));
+    }
+    if (vminvq_u8(alpha) != 0xFF) {
+        *opaque = false;
+    }
+    if (vmaxvq_u8(diff) != 0) {
+        *grey = false;
+    }
+    return x;
+}
+#endif /* SDL_NEON_INTRINSICS && 64-bit ARM */
+
+static CheckPNGColorsFunc GetCheckPNGColorsFunc(void)
+{
+#ifdef SDL_SSE2_INTRINSICS
+    if (SDL_HasSSE2()) {
+        return CheckPNGColors_SSE2;
+    }
+#endif
+#if defined(SDL_NEON_INTRINSICS) && (defined(__aarch64__) || defined(_M_ARM64))
+    return CheckPNGColors_NEON;
+#endif
+    return NULL;
+}
+
+/* Find out whether an RGBA32 image is opaque or grey, and collect its colors if there are 256 or fewer */
+static void LIBPNG_AnalyzeColors(SDL_Surface *rgba, PNGColorTable *table, bool *opaque, bool *grey)
+{
+    CheckPNGColorsFunc check = GetCheckPNGColorsFunc();
+    Uint32 last_color = 0;
+    int last_slot = -1;
+    int x, y;
+
+    *opaque = true;
+    *grey = true;
+    for (y = 0; y < rgba->h; ++y) {
+        const Uint8 *row = (const Uint8 *)rgba->pixels + y * (size_t)rgba->pitch;
+        const Uint32 *src = (const Uint32 *)row;
+
+        x = 0;
+        if (check && (*opaque || *grey)) {
+            x = check(row, rgba->w, opaque, grey);
+        }
+        for (; x < rgba->w && (*opaque || *grey); ++x) {
+            const Uint8 *pixel = row + x * 4;
+
+            if (pixel[3] != SDL_ALPHA_OPAQUE) {
+                *opaque = false;
+            }
+            if (pixel[0] != pixel[1] || pixel[1] != pixel[2]) {
+                *grey = false;
+            }
+        }
+
+        for (x = 0; x < rgba->w && table->count <= 256; ++x) {
+            if (src[x] != last_color || last_slot < 0) {
+                last_color = src[x];
+                last_slot = FindPNGColor(table, last_color);
+                if (!table->used[last_slot]) {
+                    table->used[last_slot] = true;
+                    table->colors[last_slot] = last_color;
+                    ++table->count;
+                }
+            }
+        }
+
+        /* Stop early once nothing can be saved with fewer channels */
+        if (table->count > 256 && !*opaque && !*grey) {
+            break;
+        }
+    }
+}
+
+/* Create an indexed copy of an RGBA32 image from its colors, with the translucent colors first so tRNS is as short as possible */
+static SDL_Surface *LIBPNG_CreateIndexedSurface(SDL_Surface *rgba, PNGColorTable *table)
+{
+    SDL_Surface *indexed = NULL;
+    SDL_Palette *palette;
+    Uint32 last_color = 0;
+    int last_slot = -1;
+    int x, y, i, pass;
+
+    palette = SDL_CreatePalette(table->count);
+    if (!palette) {
+        return NULL;
+    }
+    i = 0;
+    for (pass = 0; pass < 2; ++pass) {
+        for (x = 0; x < PNG_COLOR_TABLE_SIZE; ++x) {
+            const Uint8 *rgba_bytes = (const Uint8 *)&table->colors[x];
+
+            if (table->used[x] && (rgba_bytes[3] == SDL_ALPHA_OPAQUE) == (pass == 1)) {
+                palette->colors[i].r = rgba_bytes[0];
+                palette->colors[i].g = rgba_bytes[1];
+                palette->colors[i].b = rgba_bytes[2];
+                palette->colors[i].a = rgba_bytes[3];
+                table->indices[x] = (Uint8)i++;
+            }
+        }
+    }
+
+    indexed = SDL_CreateSurface(rgba->w, rgba->h, SDL_PIXELFORMAT_INDEX8);
+    if (!indexed || !SDL_SetSurfacePalette(indexed, palette)) {
+        SDL_DestroySurface(indexed);
+        SDL_DestroyPalette(palette);
+        return NULL;
+    }
+    SDL_DestroyPalette(palette);
+
+    for (y = 0; y < rgba->h; ++y) {
+        const Uint32 *src = (const Uint32 *)((const Uint8 *)rgba->pixels + y * (size_t)rgba->pitch);
+        Uint8 *dst = (Uint8 *)indexed->pixels + y * (size_t)indexed->pitch;
+
+        for (x = 0; x < rgba->w; ++x) {
+            if (src[x] != last_color || last_slot < 0) {
+                last_color = src[x];
+                last_slot = FindPNGColor(table, last_color);
+            }
+            dst[x] = table->indices[last_slot];
+        }
+    }
+    return indexed;
+}
+
+/* Copy the grey, and optionally the alpha, channel of an RGBA32 image */
+static Uint8 *LIBPNG_CreateGreyPixels(SDL_Surface *rgba, bool alpha)
+{
+    int channels = alpha ? 2 : 1;
+    Uint8 *pixels = (Uint8 *)SDL_malloc((size_t)rgba->w * rgba->h * channels);
+    int x, y;
+
+    if (!pixels) {
+        return NULL;
+    }
+    for (y = 0; y < rgba->h; ++y) {
+        const Uint8 *src = (const Uint8 *)rgba->pixels + y * (size_t)rgba->pitch;
+        Uint8 *dst = pixels + y * (size_t)rgba->w * channels;
+
+        if (alpha) {
+            for (x = 0; x < rgba->w; ++x, src += 4, dst += 2) {
+                dst[0] = src[0];
+                dst[1] = src[3];
+            }
+        } else {
+            for (x = 0; x < rgba->w; ++x, src += 4) {
+                *dst++ = src[0];
+            }
+        }
+    }
+    return pixels;
+}
+
+/* Get the zlib strategy for the name of a strategy, which has already been checked */
+static int LIBPNG_GetCompressionStrategy(const char *strategy)
+{
+    if (!strategy) {
+        return Z_DEFAULT_STRATEGY;
+    } else if (SDL_strcmp(strategy, "filtered") == 0) {
+        return Z_FILTERED;
+    } else if (SDL_strcmp(strategy, "huffman") == 0) {
+        return Z_HUFFMAN_ONLY;
+    } else if (SDL_strcmp(strategy, "rle") == 0) {
+        return Z_RLE;
+    } else if (SDL_strcmp(strategy, "fixed") == 0) {
+        return Z_FIXED;
+    } else {
+        return Z_DEFAULT_STRATEGY;
+    }
+}
+
 struct png_save_vars
 {
     const char *error;
@@ -582,6 +1541,8 @@ struct png_save_vars
     png_bytep *row_pointers;
     png_colorp color_ptr;
     SDL_Surface *source_surface_for_save;
+    SDL_Surface *reduced_surface;   /* the surface converted to fewer colors, or NULL */
+    Uint8 *grey_pixels;
 
     Uint8 transparent_table[256];
     SDL_Palette *palette;
@@ -589,9 +1550,70 @@ struct png_save_vars
     int bit_depth; // default to 8
 };
 
-static bool LIBPNG_SavePNG_IO_Internal(struct png_save_vars *vars, SDL_Surface *surface, SDL_IOStream *dst)
+/* Choose the smallest PNG color type that holds the pixels of an image without a palette losslessly.
+   The image is left as it is if there isn't enough memory to analyze it. */
+static void LIBPNG_ReduceColors(struct png_save_vars *vars, SDL_Surface *surface)
 {
-    vars->source_surface_for_save = surface;
+    SDL_Surface *rgba = surface;
+    PNGColorTable *table;
+    bool opaque, grey;
+
+    table = (PNGColorTable *)SDL_calloc(1, sizeof(*table));
+    if (table && surface->format != SDL_PIXELFORMAT_RGBA32) {
+        rgba = SDL_ConvertSurface(surface, SDL_PIXELFORMAT_RGBA32);
+    }
+    if (!table || !rgba) {
+        goto done;
+    }
+    LIBPNG_AnalyzeColors(rgba, table, &opaque, &grey);
+
+    /* Small palettes are packed into fewer bits, which beats 8-bit grey */
+    if (table->count <= 16 || (table->count <= 256 && !(grey && opaque))) {
+        SDL_Surface *indexed = LIBPNG_CreateIndexedSurface(rgba, table);
+        if (indexed) {
+            vars->reduced_surface = indexed;
+            goto done;
+        }
+    }
+    if (grey) {
+        vars->grey_pixels = LIBPNG_CreateGreyPixels(rgba, !opaque);
+        if (vars->grey_pixels) {
+            vars->png_color_type = opaque ? PNG_COLOR_TYPE_GRAY : PNG_COLOR_TYPE_GRAY_ALPHA;
+            goto done;
+        }
+    }
+    if (opaque) {
+        if (SDL_ISPIXELFORMAT_ALPHA(surface->format)) {
+            SDL_Surface *rgb = SDL_ConvertSurface(rgba, SDL_PIXELFORMAT_RGB24);
+            if (rgb) {
+                vars->reduced_surface = rgb;
+            }
+        }
+    } else if (rgba != surface) {
+        /* Keep the conversion, it's what would be saved anyway */
+        vars->reduced_surface = rgba;
+    }
+
+done:
+    if (rgba && rgba != surface && rgba != vars->reduced_surface) {
+        SDL_DestroySurface(rgba);
+    }
+    SDL_free(table);
+}
+
+static bool LIBPNG_SavePNG_IO_Internal(struct png_save_vars *vars, SDL_Surface *surface, SDL_IOStream *dst, const IMG_SavePNGOptions *options)
+{
+    SDL_Surface *image;
+    int filters;
+    int strategy = LIBPNG_GetCompressionStrategy(options->strategy);
+    const Uint8 *pixels;
+    int pitch;
+    int bpp;
+
+    if (options->reduce_colors && !SDL_GetSurfacePalette(surface) && !SDL_MUSTLOCK(surface)) {
+        LIBPNG_ReduceColors(vars, surface);
+    }
+    vars->source_surface_for_save = vars->reduced_surface ? vars->reduced_surface : surface;
 
     vars->png_ptr = lib.png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
     if (vars->png_ptr == NULL) {
@@ -614,10 +1636,16 @@ static bool LIBPNG_SavePNG_IO_Internal(struct png_save_vars *vars, SDL_Surface *
         return false;
     }
 
+    image = vars->source_surface_for_save;
+
     lib.png_set_write_fn(vars->png_ptr, dst, png_write_data, png_flush_data);
+    lib.png_set_compression_level(vars->png_ptr, options->compression_level);
+    lib.png_set_compression_strategy(vars->png_ptr, strategy);
 
-    vars->palette = SDL_GetSurfacePalette(surface);
-    if (vars->palette) {
+    vars->palette = SDL_GetSurfacePalette(image);
+    if (vars->grey_pixels) {
+        /* The color type was chosen when the colors were reduced */
+    } else if (vars->palette) {
         const int ncolors = vars->palette->ncolors;
         int i;
         int last_transparent = -1;
@@ -644,37 +1672,84 @@ static bool LIBPNG_SavePNG_IO_Internal(struct png_save_vars *vars, SDL_Surface *
             }
             lib.png_set_tRNS(vars->png_ptr, vars->info_ptr, vars->transparent_table, last_transparent + 1, NULL);
         }
-    } else if (surface->format == SDL_PIXELFORMAT_RGB24) {
+
+        /* Pack the pixels of small palettes built by LIBPNG_ReduceColors() into fewer bits.
+           Other surfaces may have indices past the end of the palette, which packing would truncate. */
+        if (image == vars->reduced_surface && image->format == SDL_PIXELFORMAT_INDEX8) {
+            if (ncolors <= 2) {
+                vars->bit_depth = 1;
+            } else if (ncolors <= 4) {
+                vars->bit_depth = 2;
+            } else if (ncolors <= 16) {
+                vars->bit_depth = 4;
+            }
+        }
+    } else if (image->format == SDL_PIXELFORMAT_RGB24) {
         vars->png_color_type = PNG_COLOR_TYPE_RGB;
-    } else if (!SDL_ISPIXELFORMAT_ALPHA(surface->format)) {
+    } else if (!SDL_ISPIXELFORMAT_ALPHA(image->format)) {
         vars->png_color_type = PNG_COLOR_TYPE_RGB;
-        vars->source_surface_for_save = SDL_ConvertSurface(surface, SDL_PIXELFORMAT_RGB24);
+        vars->source_surface_for_save = SDL_ConvertSurface(image, SDL_PIXELFORMAT_RGB24);
         if (!vars->source_surface_for_save) {
             vars->error = SDL_GetError();
             return false;
         }
+    } else if (image->format == SDL_PIXELFORMAT_RGBA32 && !SDL_MUSTLOCK(image)) {
+        vars->png_color_type = PNG_COLOR_TYPE_RGBA;
     } else {
         vars->png_color_type = PNG_COLOR_TYPE_RGBA;
-        vars->source_surface_for_save = SDL_ConvertSurface(surface, SDL_PIXELFORMAT_RGBA32);
+        vars->source_surface_for_save = SDL_ConvertSurface(image, SDL_PIXELFORMAT_RGBA32);
         if (!vars->source_surface_for_save) {
             vars->error = SDL_GetError();
             return false;
         }
     }
 
+    if (vars->grey_pixels) {
+        bpp = (vars->png_color_type == PNG_COLOR_TYPE_GRAY_ALPHA) ? 2 : 1;
+        pixels = vars->grey_pixels;
+        pitch = vars->source_surface_for_save->w * bpp;
+    } else {
+        bpp = SDL_BYTESPERPIXEL(vars->source_surface_for_save->format);
+        pixels = (const Uint8 *)vars->source_surface_for_save->pixels;
+        pitch = vars->source_surface_for_save->pitch;
+    }
+
     lib.png_set_IHDR(vars->png_ptr, vars->info_ptr, vars->source_surface_for_save->w, vars->source_surface_for_save->h,
                      vars->bit_depth, vars->png_color_type, PNG_INTERLACE_NONE,
                      PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
 
+    /* The filter types are in the same order as the PNG_FILTER_* flags, which start at PNG_FILTER_NONE */
+    if (options->filters) {
+        filters = options->filters * PNG_FILTER_NONE;
+    } else {
+        filters = vars->palette ? PNG_FILTER_NONE : PNG_ALL_FILTERS;
+    }
+    lib.png_set_filter(vars->png_ptr, PNG_FILTER_TYPE_BASE, filters);
+
     lib.png_write_info(vars->png_ptr, vars->info_ptr);
 
+    if (vars->bit_depth < 8) {
+        lib.png_set_packing(vars->png_ptr);
+    }
+
+    /* Large images are filtered and compressed on several threads, with the rest of the file written directly */
+    if (options->threads > 1 && lib.have_zlib && vars->bit_depth == 8 && bpp > 0 &&
+        (Sint64)vars->source_surface_for_save->w * bpp * vars->source_surface_for_save->h > PNG_DEFLATE_BLOCK_SIZE) {
+        if (!LIBPNG_WriteImageParallel(pixels, pitch, vars->source_surface_for_save->w, vars->source_surface_for_save->h, bpp,
+                                       dst, filters, options->compression_level, strategy, options->threads)) {
+            vars->error = "Error during PNG write operation";
+            return false;
+        }
+        return true;
+    }
+
     vars->row_pointers = (png_bytep *)SDL_malloc(sizeof(png_bytep) * vars->source_surface_for_save->h);
     if (!vars->row_pointers) {
         vars->error = "Out of memory allocating row pointers";
         return false;
     }
     for (int row = 0; row < (int)vars->source_surface_for_save->h; row++) {
-        vars->row_pointers[row] = (png_bytep)((Uint8 *)vars->source_surface_for_save->pixels + row * (size_t)vars->source_surface_for_save->pitch);
+        vars->row_pointers[row] = (png_bytep)(pixels + row * (size_t)pitch);
     }
 
     lib.png_write_image(vars->png_ptr, vars->row_pointers);
@@ -683,7 +1758,7 @@ static bool LIBPNG_SavePNG_IO_Internal(struct png_save_vars *vars, SDL_Surface *
     return true;
 }
 
-bool IMG_SavePNG_LIBPNG(SDL_Surface *surface, SDL_IOStream *dst, bool closeio)
+bool IMG_SavePNG_LIBPNG(SDL_Surface *surface, SDL_IOStream *dst, bool closeio, const IMG_SavePNGOptions *options)
 {
     if (!surface || !dst) {
         SDL_SetError("Surface or SDL_IOStream is NULL");
@@ -696,7 +1771,7 @@ bool IMG_SavePNG_LIBPNG(SDL_Surface *surface, SDL_IOStream *dst, bool closeio)
     SDL_zero(vars);
     vars.bit_depth = 8;
 
-    result = LIBPNG_SavePNG_IO_Internal(&vars, surface, dst);
+    result = LIBPNG_SavePNG_IO_Internal(&vars, surface, dst, options);
 
     if (vars.png_ptr) {
         lib.png_destroy_write_struct(&vars.png_ptr, &vars.info_ptr);
@@ -707,9 +1782,16 @@ bool IMG_SavePNG_LIBPNG(SDL_Surface *surface, SDL_IOStream *dst, bool closeio)
     if (vars.row_pointers) {
         SDL_free(vars.row_pointers);
     }
-    if (vars.source_surface_for_save && vars.source_surface_for_save != surface) {
+    if (vars.grey_pixels) {
+        SDL_free(vars.grey_pixels);
+    }
+    if (vars.source_surface_for_save && vars.source_surface_for_save != surface &&
+        vars.source_surface_for_save != vars.reduced_surface) {
         SDL_DestroySurface(vars.source_surface_for_save);
     }
+    if (vars.reduced_surface) {
+        SDL_DestroySurface(vars.reduced_surface);
+    }
 
     if (!result && vars.error) {
         SDL_SetError("%s", vars.error);
@@ -745,177 +1827,106 @@ typedef struct
     png_size_t raw_idat_size;
 } apng_fcTL_chunk;
 
-typedef struct
-{
-    SDL_IOStream *stream;
-    apng_acTL_chunk actl;
-    apng_fcTL_chunk *fctl_frames;
-    int fctl_count;
-    int fctl_capacity;
-    bool is_apng;
-    SDL_Surface *canvas;
-    SDL_Surface *prev_canvas_copy;
-    png_uint_32 current_idat_sequence;
-} apng_read_context;
-
-typedef struct
-{
-    SDL_IOStream *mem_stream;
-    SDL_IOStream *read_stream;
-    png_structp png_ptr;
-    png_infop info_ptr;
-    SDL_Surface *surface;
-    png_bytep *row_pointers;
-} DecompressionContext;
-
-static SDL_Surface *decompress_png_frame_data(DecompressionContext *context, png_bytep compressed_data, png_size_t compressed_size,
-                                              int width, int height, int png_color_type, int bit_depth, png_bytep chunk_PLTE, Uint32 size_PLTE, png_bytep chunk_tRNS, Uint32 size_tRNS)
-{
-    /*
-     * Usually you'd directly decompress zlib but then we have to do defiltering and deinterlacing ourselves.
-     * We can decompress zlib then pass those jobs to libpng but then libpng expects a fully compressed data,
-     * therefore, we manually add chunks for header and other parts only for this given compressed data,
-     * tricking libpng to believe this is a normal PNG file, then make it defilter (if any) and deinterlace
-     * (if any) for us.
-     */
-
-    // Create a memory stream to hold our synthetic PNG
-    context->mem_stream = SDL_IOFromDynamicMem();
-    if (!context->mem_stream) {
-        goto error;
-    }
-
-    // Write PNG signature
-    if (SDL_WriteIO(context->mem_stream, png_sig, 8) != 8) {
-        goto error;
-    }
-
-    // Write IHDR chunk
-    {
-        png_byte ihdr_data[13];
-        png_byte ihdr_header[8] = { 0, 0, 0, 13, 'I', 'H', 'D', 'R' };
-
-        // Write IHDR length and type
-        if (SDL_WriteIO(context->mem_stream, ihdr_header, 8) != 8) {
-            goto error;
-        }
-
-        // Write IHDR data
-        custom_png_save_uint_32(ihdr_data, width);
-        custom_png_save_uint_32(ihdr_data + 4, height);
-        ihdr_data[8] = bit_depth;
-        ihdr_data[9] = png_color_type;
-        ihdr_data[10] = PNG_INTERLACE_NONE;
-        ihdr_data[11] = PNG_COMPRESSION_TYPE_DEFAULT;
-        ihdr_data[12] = PNG_FILTER_TYPE_DEFAULT;
-
-        if (SDL_WriteIO(context->mem_stream, ihdr_data, 13) != 13) {
-            goto error;
-        }
-
-        // Calculate and write IHDR CRC
-        png_uint_32 crc = SDL_crc32(0, (Uint8 *)"IHDR", 4);
-        crc = SDL_crc32(crc, ihdr_data, 13);
-        png_byte crc_bytes[4];
-        custom_png_save_uint_32(crc_bytes, crc);
-        if (SDL_WriteIO(context->mem_stream, crc_bytes, 4) != 4) {
-            goto error;
-        }
-    }
-
-    // Write PLTE chunk
-    if (chunk_PLTE) {
-        if (SDL_WriteIO(context->mem_stream, chunk_PLTE, size_PLTE) != size_PLTE) {
-            goto error;
-        }
-    }
-
-    // Write tRNS chunk
-    if (chunk_tRNS) {
-        if (SDL_WriteIO(context->mem_stream, chunk_tRNS, size_tRNS) != size_tRNS) {
-            goto error;
-        }
-    }
-
-    // Write IDAT chunk
-    {
-        png_byte idat_header[8] = { 0, 0, 0, 0, 'I', 'D', 'A', 'T' };
-        custom_png_save_uint_32(idat_header, (png_uint_32)compressed_size);
+typedef struct
+{
+    SDL_IOStream *stream;
+    apng_acTL_chunk actl;
+    apng_fcTL_chunk *fctl_frames;
+    int fctl_count;
+    int fctl_capacity;
+    bool is_apng;
+    SDL_Surface *canvas;
+    SDL_Surface *prev_canvas_copy;
+    png_uint_32 current_idat_sequence;
+} apng_read_context;
 
-        // Write IDAT length and type
-        if (SDL_WriteIO(context->mem_stream, idat_header, 8) != 8) {
-            goto error;
-        }
+typedef struct
+{
+    png_structp png_ptr;
+    png_infop info_ptr;
+    SDL_Surface *frame;
+    int png_color_type;
+    int bit_depth;
+} DecompressionContext;
 
-        // Write compressed data
-        if (SDL_WriteIO(context->mem_stream, compressed_data, compressed_size) != compressed_size) {
-            goto error;
-        }
+static void apng_frame_info_callback(png_structp png_ptr, png_infop info_ptr)
+{
+    DecompressionContext *context = (DecompressionContext *)lib.png_get_progressive_ptr(png_ptr);
 
-        // Calculate and write IDAT CRC
-        png_uint_32 crc = SDL_crc32(0, (Uint8 *)"IDAT", 4);
-        crc = SDL_crc32(crc, compressed_data, compressed_size);
-        png_byte crc_bytes[4];
-        custom_png_save_uint_32(crc_bytes, crc);
-        if (SDL_WriteIO(context->mem_stream, crc_bytes, 4) != 4) {
-            goto error;
-        }
+    // Expand every frame to RGBA32
+    lib.png_set_expand(png_ptr);
+    if (!(context->png_color_type & PNG_COLOR_MASK_COLOR)) {
+        lib.png_set_gray_to_rgb(png_ptr);
+    }
+    if (context->bit_depth == 16) {
+        lib.png_set_strip_16(png_ptr);
     }
+    if (!(context->png_color_type & PNG_COLOR_MASK_ALPHA)) {
+        lib.png_set_filler(png_ptr, 0xFF, PNG_FILLER_AFTER);
+    }
+    lib.png_set_interlace_handling(png_ptr);
+    lib.png_read_update_info(png_ptr, info_ptr);
+}
 
-    // Write IEND chunk
-    {
-        png_byte iend_chunk[12] = {
-            0, 0, 0, 0,            // Length (0)
-            'I', 'E', 'N', 'D',    // Type
-            0xAE, 0x42, 0x60, 0x82 // CRC (precomputed for empty IEND)
-        };
+static void apng_frame_row_callback(png_structp png_ptr, png_bytep new_row, png_uint_32 row_num, int pass)
+{
+    DecompressionContext *context = (DecompressionContext *)lib.png_get_progressive_ptr(png_ptr);
+    SDL_Surface *frame = context->frame;
 
-        if (SDL_WriteIO(context->mem_stream, iend_chunk, 12) != 12) {
-            goto error;
-        }
+    (void)pass;
+    if (!new_row || row_num >= (png_uint_32)frame->h) {
+        return;
     }
+    lib.png_progressive_combine_row(png_ptr, (png_bytep)frame->pixels + row_num * (size_t)frame->pitch, new_row);
+}
 
-    Sint64 data_size = SDL_TellIO(context->mem_stream);
-    if (data_size < 0) {
-        goto error;
-    }
-    if (data_size >= SDL_MAX_SINT32) {
-        SDL_SetError("data size >= INT32_MAX");
-        goto error;
-    }
-    void *buffer = NULL;
+/*
+ * Decode the zlib data of one frame into the top left corner of context->frame.
+ *
+ * libpng does the defiltering and deinterlacing, so its progressive reader is fed
+ * a header for the frame followed by the frame data as it is stored, without
+ * building a PNG file in memory. libpng can't restart a reader with a new image
+ * header, so each frame gets a fresh reader, but the pixels are decoded straight
+ * into the frame surface that is reused for the whole animation.
+ */
+static bool decompress_png_frame_data(DecompressionContext *context, png_bytep compressed_data, png_size_t compressed_size,
+                                      int width, int height, int interlace_type, png_bytep chunk_PLTE, Uint32 size_PLTE, png_bytep chunk_tRNS, Uint32 size_tRNS)
+{
+    png_byte ihdr_chunk[25] = { 0, 0, 0, 13, 'I', 'H', 'D', 'R' };
+    png_byte idat_header[8] = { 0, 0, 0, 0, 'I', 'D', 'A', 'T' };
+    png_byte idat_crc[4] = { 0, 0, 0, 0 }; // Not checked
+    png_byte iend_chunk[12] = {
+        0, 0, 0, 0,            // Length (0)
+        'I', 'E', 'N', 'D',    // Type
+        0xAE, 0x42, 0x60, 0x82 // CRC (precomputed for empty IEND)
+    };
 
-    if (SDL_SeekIO(context->mem_stream, 0, SDL_IO_SEEK_SET) < 0) {
-        goto error;
+    if (width < 1 || height < 1 || width > context->frame->w || height > context->frame->h) {
+        return SDL_SetError("APNG frame is larger than the image");
     }
-
-    buffer = SDL_malloc(data_size);
-    if (!buffer) {
-        goto error;
+    if (compressed_size > SDL_MAX_SINT32) {
+        return SDL_SetError("APNG frame data too large to process");
     }
 
-    if (SDL_ReadIO(context->mem_stream, buffer, data_size) != (size_t)data_size) {
-        SDL_free(buffer);
-        goto error;
-    }
+    custom_png_save_uint_32(ihdr_chunk + 8, width);
+    custom_png_save_uint_32(ihdr_chunk + 12, height);
+    ihdr_chunk[16] = (png_byte)context->bit_depth;
+    ihdr_chunk[17] = (png_byte)context->png_color_type;
+    ihdr_chunk[18] = PNG_COMPRESSION_TYPE_DEFAULT;
+    ihdr_chunk[19] = PNG_FILTER_TYPE_DEFAULT;
+    ihdr_chunk[20] = (png_byte)interlace_type;
+    custom_png_save_uint_32(ihdr_chunk + 21, (png_uint_32)SDL_crc32(0, ihdr_chunk + 4, 17));
 
-    context->read_stream = SDL_IOFromConstMem(buffer, data_size);
-    if (!context->read_stream) {
-        SDL_free(buffer);
-        goto error;
-    }
+    custom_png_save_uint_32(idat_header, (png_uint_32)compressed_size);
 
-    // Now we have a proper PNG file in memory, use libpng to read it
     context->png_ptr = lib.png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
     if (!context->png_ptr) {
-        SDL_free(buffer);
-        goto error;
+        return SDL_SetError("Couldn't allocate memory for PNG read struct");
     }
-
     context->info_ptr = lib.png_create_info_struct(context->png_ptr);
     if (!context->info_ptr) {
-        SDL_free(buffer);
-        goto error;
+        lib.png_destroy_read_struct(&context->png_ptr, NULL, NULL);
+        return SDL_SetError("Couldn't create image information for PNG file");
     }
 
 #ifndef LIBPNG_VERSION_12
@@ -924,72 +1935,31 @@ static SDL_Surface *decompress_png_frame_data(DecompressionContext *context, png
     if (setjmp(context->png_ptr->jmpbuf))
 #endif
     {
-        SDL_SetError("Error during PNG read");
-        SDL_free(buffer);
-        goto error;
-    }
-
-    lib.png_set_read_fn(context->png_ptr, context->read_stream, png_read_data);
-    lib.png_read_info(context->png_ptr, context->info_ptr);
-
-    if (png_color_type == PNG_COLOR_TYPE_PALETTE) {
-        lib.png_set_palette_to_rgb(context->png_ptr);
-    }
-
-    if (bit_depth == 16) {
-        lib.png_set_strip_16(context->png_ptr);
-    }
-
-    if (!(png_color_type & PNG_COLOR_MASK_ALPHA)) {
-        lib.png_set_filler(context->png_ptr, 0xFF, PNG_FILLER_AFTER);
+        lib.png_destroy_read_struct(&context->png_ptr, &context->info_ptr, NULL);
+        return SDL_SetError("Error during PNG read");
     }
 
-    lib.png_read_update_info(context->png_ptr, context->info_ptr);
+    // The IDAT header is made up, so don't compute a CRC over the frame data just to check it
+    lib.png_set_crc_action(context->png_ptr, PNG_CRC_QUIET_USE, PNG_CRC_QUIET_USE);
+    lib.png_set_progressive_read_fn(context->png_ptr, context, apng_frame_info_callback, apng_frame_row_callback, NULL);
 
-    context->surface = SDL_CreateSurface(width, height, SDL_PIXELFORMAT_RGBA32);
-    if (!context->surface) {
-        SDL_free(buffer);
-        goto error;
+    lib.png_process_data(context->png_ptr, context->info_ptr, (png_bytep)png_sig, sizeof(png_sig));
+    lib.png_process_data(context->png_ptr, context->info_ptr, ihdr_chunk, sizeof(ihdr_chunk));
+    if (chunk_PLTE) {
+        lib.png_process_data(context->png_ptr, context->info_ptr, chunk_PLTE, size_PLTE);
     }
-
-    context->row_pointers = (png_bytep *)SDL_malloc(height * sizeof(png_bytep));
-    if (!context->row_pointers) {
-        SDL_free(buffer);
-        goto error;
+    if (chunk_tRNS) {
+        lib.png_process_data(context->png_ptr, context->info_ptr, chunk_tRNS, size_tRNS);
     }
-
-    for (int y = 0; y < height; y++) {
-        context->row_pointers[y] = (png_bytep)((Uint8 *)context->surface->pixels + y * (size_t)context->surface->pitch);
+    lib.png_process_data(context->png_ptr, context->info_ptr, idat_header, sizeof(idat_header));
+    if (compressed_size > 0) {
+        lib.png_process_data(context->png_ptr, context->info_ptr, compressed_data, compressed_size);
     }
+    lib.png_process_data(context->png_ptr, context->info_ptr, idat_crc, sizeof(idat_crc));
+    lib.png_process_data(context->png_ptr, context->info_ptr, iend_chunk, sizeof(iend_chunk));
 
-    lib.png_read_image(context->png_ptr, context->row_pointers);
-
-    SDL_free(context->row_pointers);
     lib.png_destroy_read_struct(&context->png_ptr, &context->info_ptr, NULL);
-    SDL_CloseIO(context->read_stream);
-    SDL_CloseIO(context->mem_stream);
-    SDL_free(buffer);
-
-    return context->surface;
-
-error:
-    if (context->row_pointers) {
-        SDL_free(context->row_pointers);
-    }
-    if (context->png_ptr) {
-        lib.png_destroy_read_struct(&context->png_ptr, context->info_ptr ? &context->info_ptr : NULL, NULL);
-    }
-    if (context->surface) {
-        SDL_DestroySurface(context->surface);
-    }
-    if (context->read_stream) {
-        SDL_CloseIO(context->read_stream);
-    }
-    if (context->mem_stream) {
-        SDL_CloseIO(context->mem_stream);
-    }
-
-    return NULL;
+    return true;
 }
 
 static bool read_png_chunk(SDL_IOStream *stream, png_bytep *chunk, Uint32 *chunk_size, char *chunk_type, png_bytep *data, Uint32 *data_length)
@@ -1052,6 +2022,8 @@ struct IMG_AnimationDecoderContext
     int height;
     int bit_depth;
     int png_color_type;
+    int interlace_type;
+    SDL_Surface *frame;
 
     SDL_Palette *palette;
     png_bytep chunk_PLTE;
@@ -1151,44 +2123,51 @@ static bool IMG_AnimationDecoderGetNextFrame_Internal(IMG_AnimationDecoder *deco
         }
     }
 
+    if (!ctx->frame) {
+        ctx->frame = SDL_CreateSurface(ctx->width, ctx->height, SDL_PIXELFORMAT_RGBA32);
+        if (!ctx->frame) {
+            return SDL_SetError("Failed to create APNG frame surface");
+        }
+    }
+
     DecompressionContext decompressionContext;
     SDL_zero(decompressionContext);
-    SDL_Surface *temp_frame = decompress_png_frame_data(
+    decompressionContext.frame = ctx->frame;
+    decompressionContext.png_color_type = ctx->png_color_type;
+    decompressionContext.bit_depth = ctx->bit_depth;
+    if (!decompress_png_frame_data(
         &decompressionContext,
         fctl->raw_idat_data,
         fctl->raw_idat_size,
         fctl->width,
         fctl->height,
-        ctx->png_color_type,
-        ctx->bit_depth,
+        ctx->interlace_type,
         ctx->chunk_PLTE,
         ctx->size_PLTE,
         ctx->chunk_tRNS,
-        ctx->size_tRNS);
-
-    if (!temp_frame) {
+        ctx->size_tRNS)) {
         return SDL_SetError("Failed to decompress PNG frame data: %s", SDL_GetError());
     }
 
-    if (temp_frame->format == SDL_PIXELFORMAT_INDEX8) {
-        SDL_SetSurfacePalette(temp_frame, ctx->palette);
-    }
-
     switch (fctl->blend_op) {
     case PNG_BLEND_OP_SOURCE:
-        if (!SDL_SetSurfaceBlendMode(temp_frame, SDL_BLENDMODE_NONE)) {
-            SDL_DestroySurface(temp_frame);
+        if (!SDL_SetSurfaceBlendMode(ctx->frame, SDL_BLENDMODE_NONE)) {
             return SDL_SetError("Failed to set blend mode for frame: %s", SDL_GetError());
         }
         break;
     case PNG_BLEND_OP_OVER:
-        if (!SDL_SetSurfaceBlendMode(temp_frame, SDL_BLENDMODE_BLEND)) {
-            SDL_DestroySurface(temp_frame);
+        if (!SDL_SetSurfaceBlendMode(ctx->frame, SDL_BLENDMODE_BLEND)) {
             return SDL_SetError("Failed to set blend mode for frame: %s", SDL_GetError());
         }
         break;
     }
 
+    SDL_Rect frame_rect = {
+        0,
+        0,
+        (int)fctl->width,
+        (int)fctl->height
+    };
     SDL_Rect dest_rect = {
         (int)fctl->x_offset,
         (int)fctl->y_offset,
@@ -1196,11 +2175,9 @@ static bool IMG_AnimationDecoderGetNextFrame_Internal(IMG_AnimationDecoder *deco
         (int)fctl->height
     };
 
-    if (!SDL_BlitSurface(temp_frame, NULL, ctx->canvas, &dest_rect)) {
-        SDL_DestroySurface(temp_frame);
+    if (!SDL_BlitSurface(ctx->frame, &frame_rect, ctx->canvas, &dest_rect)) {
         return SDL_SetError("Failed to blit frame onto canvas: %s", SDL_GetError());
     }
-    SDL_DestroySurface(temp_frame);
 
     retval = SDL_DuplicateSurface(ctx->canvas);
     if (!retval) {
@@ -1231,6 +2208,7 @@ static bool IMG_AnimationDecoderClose_Internal(IMG_AnimationDecoder *decoder)
     SDL_free(ctx->chunk_tRNS);
     SDL_DestroySurface(ctx->canvas);
     SDL_DestroySurface(ctx->prev_canvas_copy);
+    SDL_DestroySurface(ctx->frame);
 
     SDL_free(ctx);
     decoder->ctx = NULL;
@@ -1304,6 +2282,7 @@ bool IMG_CreateAPNGAnimationDecoder(IMG_AnimationDecoder *decoder, SDL_Propertie
             ctx->height = SDL_Swap32BE(*(Uint32 *)(chunk_data + 4));
             ctx->bit_depth = *(Uint8 *)(chunk_data + 8);
             ctx->png_color_type = *(Uint8 *)(chunk_data + 9);
+            ctx->interlace_type = *(Uint8 *)(chunk_data + 12);
 
         } else if (SDL_memcmp(chunk_type, "acTL", 4) == 0) {
             if (chunk_length != 8) {
@@ -1560,7 +2539,10 @@ struct IMG_AnimationEncoderContext
     png_structp png_write_ptr;
     png_infop info_write_ptr;
     Sint64 acTL_chunk_start_pos;
-    int current_frame_index; // This also serves as the sequence number for APNG chunks
+    int current_frame_index; // The number of frames written so far
+    png_uint_32 sequence_number; // The sequence number of the next fcTL or fdAT chunk
+    SDL_Surface *canvas; // The previous frame, to find the pixels that changed
+    png_bytep row_buffer;
     int apng_width;
     int apng_height;
     int compression_level;
@@ -1569,236 +2551,249 @@ struct IMG_AnimationEncoderContext
     SDL_PropertiesID metadata;
 };
 
-static bool write_png_chunk(SDL_IOStream *stream, const char *chunk_type_str, png_bytep data, png_size_t size)
+typedef struct
 {
-    png_byte crc_data[4];
+    SDL_IOStream *dst;
+    png_uint_32 *sequence_number;
+    bool default_image; // Write IDAT chunks instead of fdAT chunks
+    png_size_t skip;    // The bytes of the PNG signature left to skip
+    png_byte header[8];
+    png_size_t header_len;
+    png_uint_32 remaining;
+    png_size_t crc_len;
+    bool is_idat;
     png_uint_32 crc;
-    png_byte size_bytes[4];
-    png_byte chunk_type[4];
-
-    SDL_memcpy(chunk_type, chunk_type_str, 4);
+} APNGFrameWriter;
 
-    // Write chunk length
-    custom_png_save_uint_32(size_bytes, (png_uint_32)size);
-    if (SDL_WriteIO(stream, size_bytes, 4) != 4) {
-        SDL_SetError("Failed to write chunk size for %s chunk", chunk_type_str);
-        return false;
+static void apng_write_frame_bytes(png_structp png_ptr, APNGFrameWriter *writer, const void *data, png_size_t size)
+{
+    if (SDL_WriteIO(writer->dst, data, size) != size) {
+        lib.png_error(png_ptr, "Failed to write APNG frame data");
     }
+    writer->crc = SDL_crc32(writer->crc, data, size);
+}
 
-    // Write chunk type
-    if (SDL_WriteIO(stream, chunk_type, 4) != 4) {
-        SDL_SetError("Failed to write chunk type for %s chunk", chunk_type_str);
-        return false;
+/*
+ * libpng write callback for a frame, which passes the IDAT chunks libpng produces
+ * straight through to the animation as IDAT or fdAT chunks, and drops the rest.
+ */
+static void apng_write_frame_data(png_structp png_ptr, png_bytep data, png_size_t size)
+{
+    APNGFrameWriter *writer = (APNGFrameWriter *)lib.png_get_io_ptr(png_ptr);
+
+    while (size > 0) {
+        png_size_t n;
+
+        if (writer->skip > 0) {
+            n = SDL_min(writer->skip, size);
+            writer->skip -= n;
+        } else if (writer->header_len < sizeof(writer->header)) {
+            n = SDL_min(sizeof(writer->header) - writer->header_len, size);
+            SDL_memcpy(writer->header + writer->header_len, data, n);
+            writer->header_len += n;
+            if (writer->header_len == sizeof(writer->header)) {
+                writer->remaining = libpng_get_uint_32(writer->header);
+                writer->is_idat = (SDL_memcmp(writer->header + 4, "IDAT", 4) == 0);
+                if (writer->is_idat) {
+                    png_byte chunk_header[12];
+                    png_size_t header_size;
+
+                    if (writer->default_image) {
+                        SDL_memcpy(chunk_header, writer->header, 8);
+                        header_size = 8;
+                    } else {
+                        custom_png_save_uint_32(chunk_header, writer->remaining + 4);
+                        SDL_memcpy(chunk_header + 4, "fdAT", 4);
+                        custom_png_save_uint_32(chunk_header + 8, (*writer->sequence_number)++);
+                        header_size = 12;
+                    }
+                    if (SDL_WriteIO(writer->dst, chunk_header, header_size) != header_size) {
+                        lib.png_error(png_ptr, "Failed to write APNG frame data");
+                    }
+                    writer->crc = SDL_crc32(0, chunk_header + 4, header_size - 4);
+                }
+            }
+        } else if (writer->remaining > 0) {
+            n = SDL_min(writer->remaining, size);
+            if (writer->is_idat) {
+                apng_write_frame_bytes(png_ptr, writer, data, n);
+            }
+            writer->remaining -= (png_uint_32)n;
+        } else {
+            n = SDL_min(4 - writer->crc_len, size);
+            writer->crc_len += n;
+            if (writer->crc_len == 4) {
+                if (writer->is_idat) {
+                    png_byte crc_bytes[4];
+                    custom_png_save_uint_32(crc_bytes, writer->crc);
+                    if (SDL_WriteIO(writer->dst, crc_bytes, 4) != 4) {
+                        lib.png_error(png_ptr, "Failed to write APNG frame data");
+                    }
+                }
+                writer->header_len = 0;
+                writer->crc_len = 0;
+            }
+        }
+        data += n;
+        size -= n;
     }
+}
 
-    // Write chunk data (if any)
-    if (data && size > 0) {
-        if (SDL_WriteIO(stream, data, size) != size) {
-            SDL_SetError("Failed to write chunk data for %s chunk", chunk_type_str);
-            return false;
+static void apng_flush_frame_data(png_structp png_ptr)
+{
+    (void)png_ptr;
+}
+
+/* Set the pixels that didn't change since the previous frame to transparent, so the frame can be blended over it */
+static void apng_mask_unchanged_pixels(png_bytep dst, const Uint8 *src, const Uint8 *prev, int width, int bpp)
+{
+    if (bpp == 4) {
+        const Uint32 *src32 = (const Uint32 *)src;
+        const Uint32 *prev32 = (const Uint32 *)prev;
+        Uint32 *dst32 = (Uint32 *)dst;
+        for (int x = 0; x < width; ++x) {
+            dst32[x] = (src32[x] == prev32[x]) ? 0 : src32[x];
+        }
+    } else {
+        for (int x = 0; x < width; ++x) {
+            dst[x] = (src[x] == prev[x]) ? 0 : src[x];
         }
     }
+}
 
-    // Calculate and write CRC
-    crc = SDL_crc32(0L, NULL, 0);
-    crc = SDL_crc32(crc, chunk_type, 4);
-    if (data && size > 0) {
-        crc = SDL_crc32(crc, data, size);
+/*
+ * Find the rectangle of pixels that changed since the previous frame.
+ * The changed pixels can be blended over the previous frame if they're all opaque,
+ * and the unchanged ones are then written as transparent, which compresses better.
+ */
+static bool get_apng_changed_rect(SDL_Surface *prev, SDL_Surface *surface, SDL_Rect *rect, bool *blend_over)
+{
+    const int bpp = SDL_BYTESPERPIXEL(surface->format);
+    const size_t row_size = (size_t)surface->w * bpp;
+    int top, bottom, left, right;
+
+    for (top = 0; top < surface->h; ++top) {
+        if (SDL_memcmp((Uint8 *)surface->pixels + top * (size_t)surface->pitch, (Uint8 *)prev->pixels + top * (size_t)prev->pitch, row_size) != 0) {
+            break;
+        }
     }
-    custom_png_save_uint_32(crc_data, crc);
-    if (SDL_WriteIO(stream, crc_data, 4) != 4) {
-        SDL_SetError("Failed to write chunk CRC for %s chunk", chunk_type_str);
+    if (top == surface->h) {
         return false;
     }
+    for (bottom = surface->h - 1; bottom > top; --bottom) {
+        if (SDL_memcmp((Uint8 *)surface->pixels + bottom * (size_t)surface->pitch, (Uint8 *)prev->pixels + bottom * (size_t)prev->pitch, row_size) != 0) {
+            break;
+        }
+    }
+
+    left = surface->w;
+    right = -1;
+    *blend_over = true;
+    for (int y = top; y <= bottom; ++y) {
+        const Uint8 *src = (const Uint8 *)surface->pixels + y * (size_t)surface->pitch;
+        const Uint8 *old = (const Uint8 *)prev->pixels + y * (size_t)prev->pitch;
+
+        for (int x = 0; x < surface->w; ++x, src += bpp, old += bpp) {
+            if (SDL_memcmp(src, old, bpp) != 0) {
+                left = SDL_min(left, x);
+                right = SDL_max(right, x);
+                // Index 0 is the transparent color of indexed frames
+                if (bpp == 4 ? (src[3] != SDL_ALPHA_OPAQUE) : (src[0] == 0)) {
+                    *blend_over = false;
+                }
+            }
+        }
+    }
 
+    rect->x = left;
+    rect->y = top;
+    rect->w = right - left + 1;
+    rect->h = bottom - top + 1;
     return true;
 }
 
-typedef struct
+static bool write_apng_fcTL(IMG_AnimationEncoderContext *ctx, SDL_IOStream *dst, const SDL_Rect *rect, png_uint_16 delay_num, png_uint_16 delay_den, png_byte blend_op)
 {
-    png_structp temp_png_ptr;
-    png_infop temp_info_ptr;
-    SDL_IOStream *mem_stream;
-    png_bytep full_zlib_data_buffer;
-    png_bytep mem_buffer_ptr;
-    png_bytep *row_pointers;
-    bool iend_found;
-    Sint64 current_pos;
-    png_byte chunk_header[8];
-    png_uint_32 chunk_len;
-    png_byte chunk_type[4];
-    Sint64 mem_buffer_size;
-} CompressionContext;
+    png_byte fctl_data[26];
+
+    custom_png_save_uint_32(fctl_data, ctx->sequence_number++);
+    custom_png_save_uint_32(fctl_data + 4, (png_uint_32)rect->w);
+    custom_png_save_uint_32(fctl_data + 8, (png_uint_32)rect->h);
+    custom_png_save_uint_32(fctl_data + 12, (png_uint_32)rect->x);
+    custom_png_save_uint_32(fctl_data + 16, (png_uint_32)rect->y);
+    custom_png_save_uint_16(fctl_data + 20, delay_num);
+    custom_png_save_uint_16(fctl_data + 22, delay_den);
+    fctl_data[24] = PNG_DISPOSE_OP_NONE;
+    fctl_data[25] = blend_op;
+    return write_png_chunk(dst, "fcTL", fctl_data, 26);
+}
 
-static png_bytep compress_surface_to_png_data(CompressionContext *context, SDL_Surface *surface, png_size_t *compressed_size, int compression_level, int png_color_type)
+/* Compress a rectangle of a frame, streaming the zlib data from libpng into IDAT or fdAT chunks */
+static bool write_apng_frame_data(IMG_AnimationEncoderContext *ctx, SDL_IOStream *dst, SDL_Surface *surface, const SDL_Rect *rect, bool blend_over, bool default_image)
 {
-    *compressed_size = 0; // Reset compressed_size to accumulate IDAT data
+    const int bpp = SDL_BYTESPERPIXEL(surface->format);
+    APNGFrameWriter writer;
+    png_structp png_ptr;
+    png_infop info_ptr;
 
-    // Create a growable memory buffer for the temporary PNG
-    context->mem_stream = SDL_IOFromDynamicMem();
-    if (!context->mem_stream) {
-        SDL_SetError("Failed to create dynamic memory stream for PNG compression: %s", SDL_GetError());
-        goto error;
-    }
+    SDL_zero(writer);
+    writer.dst = dst;
+    writer.sequence_number = &ctx->sequence_number;
+    writer.default_image = default_image;
+    writer.skip = sizeof(png_sig);
 
-    context->temp_png_ptr = lib.png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-    if (!context->temp_png_ptr) {
-        SDL_SetError("Couldn't allocate memory for temporary PNG write struct");
-        goto error;
+    png_ptr = lib.png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (!png_ptr) {
+        return SDL_SetError("Couldn't allocate memory for PNG write struct");
     }
-    context->temp_info_ptr = lib.png_create_info_struct(context->temp_png_ptr);
-    if (!context->temp_info_ptr) {
-        SDL_SetError("Couldn't create temporary image information for PNG file");
-        goto error;
+    info_ptr = lib.png_create_info_struct(png_ptr);
+    if (!info_ptr) {
+        lib.png_destroy_write_struct(&png_ptr, NULL);
+        return SDL_SetError("Couldn't create image information for PNG file");
     }
 
 #ifndef LIBPNG_VERSION_12
-    if (setjmp(*lib.png_set_longjmp_fn(context->temp_png_ptr, longjmp, sizeof(jmp_buf))))
+    if (setjmp(*lib.png_set_longjmp_fn(png_ptr, longjmp, sizeof(jmp_buf))))
 #else
-    if (setjmp(context->temp_png_ptr->jmpbuf))
+    if (setjmp(png_ptr->jmpbuf))
 #endif
     {
-        SDL_SetError("Error during temporary PNG write operation for compression");
-        goto error;
+        lib.png_destroy_write_struct(&png_ptr, &info_ptr);
+        return SDL_SetError("Error during APNG frame compression");
     }
 
-    // png_io_context temp_io_context = { mem_stream };
-    lib.png_set_write_fn(context->temp_png_ptr, context->mem_stream, png_write_data, png_flush_data);
-    lib.png_set_compression_level(context->temp_png_ptr, compression_level);
-    lib.png_set_filter(context->temp_png_ptr, 0, PNG_FILTER_TYPE_DEFAULT);
-    lib.png_set_IHDR(context->temp_png_ptr, context->temp_info_ptr, surface->w, surface->h,
-                     8, png_color_type, // Use specified color type
+    lib.png_set_write_fn(png_ptr, &writer, apng_write_frame_data, apng_flush_frame_data);
+    lib.png_set_compression_level(png_ptr, ctx->compression_level);
+    lib.png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, (surface->format == SDL_PIXELFORMAT_INDEX8) ? PNG_FILTER_NONE : PNG_ALL_FILTERS);
+    lib.png_set_IHDR(png_ptr, info_ptr, rect->w, rect->h, 8,
+                     (surface->format == SDL_PIXELFORMAT_INDEX8) ? PNG_COLOR_TYPE_PALETTE : PNG_COLOR_TYPE_RGBA,
                      PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
-
-    if (png_color_type == PNG_COLOR_TYPE_PALETTE) {
-        if (surface->format != SDL_PIXELFORMAT_INDEX8 || !SDL_GetSurfacePalette(surface)) {
-            SDL_SetError("compress_surface_to_png_data: Expected SDL_PIXELFORMAT_INDEX8 surface with palette for paletted PNG type.");
-            goto error;
-        }
-        SDL_Palette *surface_palette = SDL_GetSurfacePalette(surface);
-        if (surface_palette && surface_palette->ncolors > 0) {
-            lib.png_set_PLTE(context->temp_png_ptr, context->temp_info_ptr, (png_colorp)surface_palette->colors, surface_palette->ncolors);
-        } else {
-            SDL_SetError("Surface has no palette for paletted PNG compression.");
-            goto error;
-        }
-        png_byte tRNS_data[1];
-        tRNS_data[0] = 0x00;
-        lib.png_set_tRNS(context->temp_png_ptr, context->temp_info_ptr, tRNS_data, 1, NULL);
-    } else if (png_color_type == PNG_COLOR_TYPE_RGBA) {
-        if (surface->format != SDL_PIXELFORMAT_RGBA32) {
-            SDL_SetError("compress_surface_to_png_data: Expected SDL_PIXELFORMAT_RGBA32 surface for RGBA PNG type.");
-            goto error;
+    if (surface->format == SDL_PIXELFORMAT_INDEX8) {
+        // libpng needs a palette to write indexed pixels, the PLTE chunk itself was written with the first frame
+        png_color colors[256];
+        int num_colors = SDL_min(ctx->apng_palette_ptr->ncolors, 256);
+        for (int i = 0; i < num_colors; ++i) {
+            colors[i].red = ctx->apng_palette_ptr->colors[i].r;
+            colors[i].green = ctx->apng_palette_ptr->colors[i].g;
+            colors[i].blue = ctx->apng_palette_ptr->colors[i].b;
         }
-    } else {
-        SDL_SetError("Unsupported PNG color type for compression.");
-        goto error;
-    }
-
-    lib.png_write_info(context->temp_png_ptr, context->temp_info_ptr);
-    context->row_pointers = (png_bytep *)SDL_malloc(sizeof(png_bytep) * surface->h);
-    if (!context->row_pointers) {
-        SDL_SetError("Out of memory for temporary row pointers");
-        goto error;
-    }
-    for (int y = 0; y < surface->h; y++) {
-        context->row_pointers[y] = (png_bytep)((Uint8 *)surface->pixels + y * (size_t)surface->pitch);
-    }
-
-    lib.png_write_image(context->temp_png_ptr, context->row_pointers);
-    lib.png_write_end(context->temp_png_ptr, context->temp_info_ptr);
-
-    SDL_free(context->row_pointers);
-    context->row_pointers = NULL;
-
-    context->mem_buffer_size = SDL_TellIO(context->mem_stream);
-    if (context->mem_buffer_size < 0) {
-        SDL_SetError("Failed to get size of memory stream: %s", SDL_GetError());
-        goto error;
-    }
-
-    // Sanity check
-    if (context->mem_buffer_size < (Sint64)(8 + 12 + 13 + 12 + 12)) { // PNG_SIG + IHDR_CHUNK + IDAT_CHUNK + IEND_CHUNK
-        SDL_SetError("Temporary PNG stream too small, likely corrupted during internal write.");
-        goto error;
-    }
-
-    // Allocate buffer to hold the entire content of the temporary PNG
-    context->mem_buffer_ptr = (png_bytep)SDL_malloc(context->mem_buffer_size);
-    if (!context->mem_buffer_ptr) {
-        SDL_SetError("Out of memory for reading memory stream content");
-        goto error;
-    }
-
-    if (SDL_SeekIO(context->mem_stream, 0, SDL_IO_SEEK_SET) < 0) {
-        SDL_SetError("Failed to seek memory stream to beginning: %s", SDL_GetError());
-        goto error;
+        lib.png_set_PLTE(png_ptr, info_ptr, colors, num_colors);
     }
-    if (SDL_ReadIO(context->mem_stream, context->mem_buffer_ptr, (size_t)context->mem_buffer_size) != (size_t)context->mem_buffer_size) {
-        SDL_SetError("Failed to read all data from memory stream: %s", SDL_GetError());
-        goto error;
-    }
-
-    context->current_pos = 8;      // Skip PNG signature (8 bytes)
-
-    // Parse the temporary PNG in memory to extract only the IDAT chunk data (which is a full zlib stream)
-    while (context->current_pos < context->mem_buffer_size) {
-        if ((png_size_t)context->current_pos + 8 > (png_size_t)context->mem_buffer_size) {
-            break;
-        }
-        SDL_memcpy(context->chunk_header, context->mem_buffer_ptr + context->current_pos, 8);
-        context->chunk_len = libpng_get_uint_32(context->chunk_header);
-        SDL_memcpy(context->chunk_type, context->chunk_header + 4, 4);
+    lib.png_write_info(png_ptr, info_ptr);
 
-        context->current_pos += 8;
-
-        if (SDL_memcmp(context->chunk_type, "IDAT", 4) == 0) {
-            context->full_zlib_data_buffer = (png_bytep)SDL_realloc(context->full_zlib_data_buffer, *compressed_size + context->chunk_len);
-            if (!context->full_zlib_data_buffer) {
-                SDL_SetError("Out of memory for IDAT data aggregation (full zlib stream)");
-                goto error;
-            }
-            SDL_memcpy(context->full_zlib_data_buffer + *compressed_size, context->mem_buffer_ptr + context->current_pos, context->chunk_len);
-            *compressed_size += context->chunk_len;
-        } else if (SDL_memcmp(context->chunk_type, "IEND", 4) == 0) {
-            context->iend_found = true;
-            break;
+    for (int y = rect->y; y < rect->y + rect->h; ++y) {
+        const Uint8 *row = (const Uint8 *)surface->pixels + y * (size_t)surface->pitch + rect->x * bpp;
+        if (blend_over) {
+            const Uint8 *prev = (const Uint8 *)ctx->canvas->pixels + y * (size_t)ctx->canvas->pitch + rect->x * bpp;
+            apng_mask_unchanged_pixels(ctx->row_buffer, row, prev, rect->w, bpp);
+            row = ctx->row_buffer;
         }
-
-        context->current_pos += (Sint64)context->chunk_len + 4;
-    }
-
-    if (*compressed_size == 0) {
-        SDL_SetError("Could not find IDAT chunk in temporary PNG for compression");
-        goto error;
-    }
-    if (!context->iend_found) {
-        SDL_SetError("IEND chunk not found in temporary PNG, likely incomplete write.");
-        goto error;
-    }
-
-    SDL_free(context->mem_buffer_ptr); // Free the temporary buffer holding the full PNG
-    context->mem_buffer_ptr = NULL;
-    SDL_CloseIO(context->mem_stream);  // Close the memory stream
-    lib.png_destroy_write_struct(&context->temp_png_ptr, &context->temp_info_ptr);
-
-    return context->full_zlib_data_buffer;
-
-error:
-    if (context->temp_png_ptr) {
-        lib.png_destroy_write_struct(&context->temp_png_ptr, &context->temp_info_ptr);
-    }
-    if (context->mem_stream) {
-        SDL_CloseIO(context->mem_stream);
-    }
-    if (context->full_zlib_data_buffer) {
-        SDL_free(context->full_zlib_data_buffer);
-    }
-    if (context->mem_buffer_ptr) {
-        SDL_free(context->mem_buffer_ptr);
+        lib.png_write_row(png_ptr, (png_const_bytep)row);
     }
+    lib.png_write_end(png_ptr, NULL);
 
-    return NULL;
+    lib.png_destroy_write_struct(&png_ptr, &info_ptr);
+    return true;
 }
 
 static bool writetEXtchunk(SDL_IOStream *dst, const char *keyword, const char *value)
@@ -1837,8 +2832,8 @@ static bool SaveAPNGAnimationPushFrame(IMG_AnimationEncoder *encoder, SDL_Surfac
 
     SDL_Surface *current_frame_for_processing = NULL;
     SDL_Surface *final_frame_for_compression = NULL;
-    png_bytep full_zlib_data = NULL;
-    png_size_t full_zlib_size = 0;
+    SDL_Rect frame_rect;
+    bool blend_over = false;
 
     if (encoder->ctx->current_frame_index == 0) {
         png_byte pngColorType;
@@ -1939,13 +2934,6 @@ static bool SaveAPNGAnimationPushFrame(IMG_AnimationEncoder *encoder, SDL_Surfac
         }
     }
 
-    int png_color_type_for_compression;
-    if (encoder->ctx->output_pixel_format == SDL_PIXELFORMAT_INDEX8) {
-        png_color_type_for_compression = PNG_COLOR_TYPE_PALETTE;
-    } else {
-        png_color_type_for_compression = PNG_COLOR_TYPE_RGBA;
-    }
-
     png_uint_16 delay_den = (png_uint_16)encoder->timebase_denominator;
     png_uint_16 delay_num = (png_uint_16)(duration * encoder->timebase_numerator);
 
@@ -2025,95 +3013,46 @@ static bool SaveAPNGAnimationPushFrame(IMG_AnimationEncoder *encoder, SDL_Surfac
             }
         }
 
-        // Now, write the fcTL for the first animated frame (sequence 0)
-        png_byte fctl_data[26];
-        custom_png_save_uint_32(fctl_data, 0);                                          // Sequence number for the first animated frame is fixed at 0.
-        custom_png_save_uint_32(fctl_data + 4, (png_uint_32)encoder->ctx->apng_width);  // Frame width
-        custom_png_save_uint_32(fctl_data + 8, (png_uint_32)encoder->ctx->apng_height); // Frame height
-        custom_png_save_uint_32(fctl_data + 12, 0);                                     // x_offset
-        custom_png_save_uint_32(fctl_data + 16, 0);                                     // y_offset
-
-        custom_png_save_uint_16(fctl_data + 20, delay_num);
-        custom_png_save_uint_16(fctl_data + 22, delay_den);
-        fctl_data[24] = PNG_DISPOSE_OP_NONE; // dispose_op
-        fctl_data[25] = PNG_BLEND_OP_SOURCE; // blend_op
-        if (!write_png_chunk(encoder->dst, "fcTL", fctl_data, 26)) {
-            goto error;
-        }
-
-        // Compress the current frame's surface into a full zlib stream (IDAT payload)
-        CompressionContext compressionContext;
-        SDL_zero(compressionContext);
-        full_zlib_data = compress_surface_to_png_data(&compressionContext, final_frame_for_compression, &full_zlib_size, encoder->ctx->compression_level, png_color_type_for_compression);
-        if (!full_zlib_data || full_zlib_size == 0) {
-            SDL_SetError("Failed to compress frame data for default IDAT.");
-            goto error;
-        }
-
-        // Write IDAT chunk: This is the default image, NOT part of the animation sequence
-        if (!write_png_chunk(encoder->dst, "IDAT", full_zlib_data, full_zlib_size)) {
+        encoder->ctx->canvas = SDL_CreateSurface(encoder->ctx->apng_width, encoder->ctx->apng_height, encoder->ctx->output_pixel_format);
+        if (!encoder->ctx->canvas) {
             goto error;
         }
-        SDL_free(full_zlib_data);
-        full_zlib_data = NULL;
-
-        // We have no fdAT chunk for the first frame, so we increase our index only by 1.
-        encoder->ctx->current_frame_index = 1;
-
-    } else { // For subsequent animated frames (current_frame_index > 0)
-        // Compress the current frame's surface into a full zlib stream (IDAT payload)
-        CompressionContext compressionContext;
-        SDL_zero(compressionContext);
-        full_zlib_data = compress_surface_to_png_data(&compressionContext, final_frame_for_compression, &full_zlib_size, encoder->ctx->compression_level, png_color_type_for_compression);
-        if (!full_zlib_data || full_zlib_size == 0) {
-            SDL_SetError("Failed to compress frame data or compressed data is empty.");
+        encoder->ctx->row_buffer = (png_bytep)SDL_malloc((size_t)encoder->ctx->apng_width * SDL_BYTESPERPIXEL(encoder->ctx->output_pixel_format));
+        if (!encoder->ctx->row_buffer) {
             goto error;
         }
 
-        // Write fcTL chunk for this frame
-        png_byte fctl_data[26];
-        custom_png_save_uint_32(fctl_data, (png_uint_32)encoder->ctx->current_frame_index); // Sequence number for this fcTL
-        custom_png_save_uint_32(fctl_data + 4, (png_uint_32)encoder->ctx->apng_width);      // Frame width
-        custom_png_save_uint_32(fctl_data + 8, (png_uint_32)encoder->ctx->apng_height);     // Frame height
-        custom_png_save_uint_32(fctl_data + 12, 0);                                         // x_offset
-        custom_png_save_uint_32(fctl_data + 16, 0);                                         // y_offset
-
-        custom_png_save_uint_16(fctl_data + 20, delay_num);
-        custom_png_save_uint_16(fctl_data + 22, delay_den);
-        fctl_data[24] = PNG_DISPOSE_OP_NONE;
-        fctl_data[25] = PNG_BLEND_OP_SOURCE;
-
-        if (!write_png_chunk(encoder->dst, "fcTL", fctl_data, 26)) {
-            goto error;
-        }
+        // The first frame is also the default image, so it covers the whole canvas
+        frame_rect.x = 0;
+        frame_rect.y = 0;
+        frame_rect.w = encoder->ctx->apng_width;
+        frame_rect.h = encoder->ctx->apng_height;
+    } else if (!get_apng_changed_rect(encoder->ctx->canvas, final_frame_for_compression, &frame_rect, &blend_over)) {
+        // Nothing changed, so blend a single transparent pixel over the previous frame
+        frame_rect.x = 0;
+        frame_rect.y = 0;
+        frame_rect.w = 1;
+        frame_rect.h = 1;
+        blend_over = true;
+    }
 
-        // Write fdAT chunk for this frame
-        png_byte fdat_prefix[4];
-        custom_png_save_uint_32(fdat_prefix, (png_uint_32)(encoder->ctx->current_frame_index + 1)); // Sequence number for fdAT
+    if (!write_apng_fcTL(encoder->ctx, encoder->dst, &frame_rect, delay_num, delay_den, blend_over ? PNG_BLEND_OP_OVER : PNG_BLEND_OP_SOURCE)) {
+        goto error;
+    }
+    if (!write_apng_frame_data(encoder->ctx, encoder->dst, final_frame_for_compression, &frame_rect, blend_over, encoder->ctx->current_frame_index == 0)) {
+        goto error;
+    }
 
-        png_bytep fdat_data = NULL;
-        if (full_zlib_size > SDL_SIZE_MAX - 4) {
-            SDL_SetError("fdAT data size would overflow");
-            goto error;
-        }
-        fdat_data = (png_bytep)SDL_malloc(4 + full_zlib_size);
-        if (!fdat_data) {
-            SDL_SetError("Out of memory for fdAT data");
-            goto error;
-        }
-        SDL_memcpy(fdat_data, fdat_prefix, 4);
-        SDL_memcpy(fdat_data + 4, full_zlib_data, full_zlib_size);
-        if (!write_png_chunk(encoder->dst, "fdAT", fdat_data, 4 + full_zlib_size)) {
-            SDL_free(fdat_data);
-            goto error;
+    // Remember this frame to compare the next one against
+    {
+        const int bpp = SDL_BYTESPERPIXEL(encoder->ctx->output_pixel_format);
+        for (int y = frame_rect.y; y < frame_rect.y + frame_rect.h; ++y) {
+            SDL_memcpy((Uint8 *)encoder->ctx->canvas->pixels + y * (size_t)encoder->ctx->canvas->pitch + frame_rect.x * bpp,
+                       (const Uint8 *)final_frame_for_compression->pixels + y * (size_t)final_frame_for_compression->pitch + frame_rect.x * bpp,
+                       (size_t)frame_rect.w * bpp);
         }
-        SDL_free(fdat_data);
-        fdat_data = NULL;
-        SDL_free(full_zlib_data);
-        full_zlib_data = NULL;
-
-        encoder->ctx->current_frame_index += 2; // Increment by 2 (one for fcTL and one for fdAT) for the next fcTL sequence number
     }
+    ++encoder->ctx->current_frame_index;
 
     if (current_frame_for_processing && current_frame_for_processing != frame) {
         SDL_DestroySurface(current_frame_for_processing);
@@ -2124,9 +3063,6 @@ static bool SaveAPNGAnimationPushFrame(IMG_AnimationEncoder *encoder, SDL_Surfac
     return true;
 
 error:
-    if (full_zlib_data) {
-        SDL_free(full_zlib_data);
-    }
     if (current_frame_for_processing && current_frame_for_processing != frame) {
         SDL_DestroySurface(current_frame_for_processing);
     }
@@ -2162,8 +3098,8 @@ static bool SaveAPNGAnimationEnd(IMG_AnimationEncoder *encoder)
     }
 
     png_byte actl_data[8];
-    // Write the actual total number of frames pushed (which is current_frame_index + 1 / 2 or directly 0 if current_frame_index is 0)
-    custom_png_save_uint_32(actl_data, (png_uint_32)(encoder->ctx->current_frame_index == 0 ? 0 : (encoder->ctx->current_frame_index + 1) / 2));
+    // Write the actual total number of frames pushed
+    custom_png_save_uint_32(actl_data, (png_uint_32)encoder->ctx->current_frame_index);
 
     // num_plays
     png_uint_32 numplays = 0;
@@ -2192,6 +3128,8 @@ static bool SaveAPNGAnimationEnd(IMG_AnimationEncoder *encoder)
     if (encoder->ctx->apng_palette_ptr) {
         SDL_DestroyPalette(encoder->ctx->apng_palette_ptr);
     }
+    SDL_DestroySurface(encoder->ctx->canvas);
+    SDL_free(encoder->ctx->row_buffer);
 
     if (encoder->ctx->metadata) {
         SDL_DestroyProperties(encoder->ctx->metadata);
@@ -2213,6 +3151,8 @@ error:
     if (encoder->ctx->apng_palette_ptr) {
         SDL_DestroyPalette(encoder->ctx->apng_palette_ptr);
     }
+    SDL_DestroySurface(encoder->ctx->canvas);
+    SDL_free(encoder->ctx->row_buffer);
     SDL_free(encoder->ctx);
     encoder->ctx = NULL;
     return false;
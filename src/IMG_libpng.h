@@ -19,9 +19,21 @@
   3. This notice may not be removed or altered from any source distribution.
 */
 
+struct IMG_LoadOptions;
+
+/* The encoder settings for IMG_SavePNGWithProperties() */
+typedef struct IMG_SavePNGOptions
+{
+    int compression_level;  /* the zlib compression level, 0-9 */
+    int filters;            /* a bit for each PNG filter type that may be used, 0 for the default */
+    const char *strategy;   /* "default", "filtered", "huffman", "rle" or "fixed" */
+    bool reduce_colors;     /* true to save images in the smallest color type that holds them losslessly */
+    int threads;            /* the number of threads to compress large images on */
+} IMG_SavePNGOptions;
+
 extern bool IMG_InitPNG(void);
-extern SDL_Surface *IMG_LoadPNG_LIBPNG(SDL_IOStream *src);
-extern bool IMG_SavePNG_LIBPNG(SDL_Surface *surface, SDL_IOStream *dst, bool closeio);
+extern SDL_Surface *IMG_LoadPNG_LIBPNG(SDL_IOStream *src, struct IMG_LoadOptions *options);
+extern bool IMG_SavePNG_LIBPNG(SDL_Surface *surface, SDL_IOStream *dst, bool closeio, const IMG_SavePNGOptions *options);
 
 extern bool IMG_CreateAPNGAnimationEncoder(IMG_AnimationEncoder *encoder, SDL_PropertiesID props);
 extern bool IMG_CreateAPNGAnimationDecoder(IMG_AnimationDecoder *decoder, SDL_PropertiesID props);
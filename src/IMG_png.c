@@ -65,10 +65,19 @@ bool IMG_isPNG(SDL_IOStream *src)
 
 /* Load a PNG type image from an SDL datasource */
 SDL_Surface *IMG_LoadPNG_IO(SDL_IOStream *src)
+{
+    IMG_LoadOptions options;
+
+    SDL_zero(options);
+    return IMG_LoadPNGWithOptions_IO(src, &options);
+}
+
+/* Load a PNG type image, decoding into the destination surface if it matches */
+SDL_Surface *IMG_LoadPNGWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options)
 {
 #ifdef SDL_IMAGE_LIBPNG
     if (IMG_InitPNG()) {
-        return IMG_LoadPNG_LIBPNG(src);
+        return IMG_LoadPNG_LIBPNG(src, options);
     }
 #endif
 
@@ -100,24 +109,85 @@ SDL_Surface *IMG_LoadPNG_IO(SDL_IOStream *src)
     return NULL;
 }
 
+SDL_Surface *IMG_LoadPNGWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options)
+{
+    SDL_SetError("SDL_image built without PNG support");
+    return NULL;
+}
+
 #endif /* LOAD_PNG */
 
 #if SAVE_PNG
 
-bool IMG_SavePNG_IO(SDL_Surface *surface, SDL_IOStream *dst, bool closeio)
+static void InitSavePNGOptions(IMG_SavePNGOptions *options)
 {
-    if (!IMG_VerifyCanSaveSurface(surface)) {
-        return false;
+    options->compression_level = 6;
+    options->filters = 0;
+    options->strategy = "default";
+    options->reduce_colors = false;
+    options->threads = 1;
+}
+
+/* Parse a comma separated list of PNG filter names into a bit for each filter type */
+static bool ParsePNGFilters(const char *list, int *filters)
+{
+    static const char *names[] = { "none", "sub", "up", "average", "paeth" };
+    const char *name = list;
+
+    *filters = 0;
+    while (*name) {
+        size_t len = 0;
+        size_t i;
+
+        while (name[len] && name[len] != ',') {
+            ++len;
+        }
+        if (len == 8 && SDL_strncmp(name, "adaptive", len) == 0) {
+            *filters |= (1 << SDL_arraysize(names)) - 1;
+        } else {
+            for (i = 0; i < SDL_arraysize(names); ++i) {
+                if (SDL_strlen(names[i]) == len && SDL_strncmp(name, names[i], len) == 0) {
+                    *filters |= (1 << i);
+                    break;
+                }
+            }
+            if (i == SDL_arraysize(names)) {
+                return SDL_SetError("Unsupported PNG filter: %s", list);
+            }
+        }
+        name += len;
+        if (*name == ',') {
+            ++name;
+        }
+    }
+    if (!*filters) {
+        return SDL_SetError("Unsupported PNG filter: %s", list);
     }
+    return true;
+}
+
+static bool SavePNG(SDL_Surface *surface, SDL_IOStream *dst, bool closeio, const IMG_SavePNGOptions *options)
+{
 #ifdef SDL_IMAGE_LIBPNG
     if (IMG_InitPNG()) {
-        return IMG_SavePNG_LIBPNG(surface, dst, closeio);
+        return IMG_SavePNG_LIBPNG(surface, dst, closeio, options);
     }
 #endif
 
     return SDL_SavePNG_IO(surface, dst, closeio);
 }
 
+bool IMG_SavePNG_IO(SDL_Surface *surface, SDL_IOStream *dst, bool closeio)
+{
+    IMG_SavePNGOptions options;
+
+    if (!IMG_VerifyCanSaveSurface(surface)) {
+        return false;
+    }
+    InitSavePNGOptions(&options);
+    return SavePNG(surface, dst, closeio, &options);
+}
+
 bool IMG_SavePNG(SDL_Surface *surface, const char *file)
 {
     if (!IMG_VerifyCanSaveSurface(surface)) {
@@ -131,6 +201,58 @@ bool IMG_SavePNG(SDL_Surface *surface, const char *file)
     }
 }
 
+bool IMG_SavePNGWithProperties(SDL_Surface *surface, SDL_PropertiesID props)
+{
+    IMG_SavePNGOptions options;
+    const char *file = SDL_GetStringProperty(props, IMG_PROP_SAVE_FILENAME_STRING, NULL);
+    SDL_IOStream *dst = (SDL_IOStream *)SDL_GetPointerProperty(props, IMG_PROP_SAVE_IOSTREAM_POINTER, NULL);
+    bool closeio = SDL_GetBooleanProperty(props, IMG_PROP_SAVE_IOSTREAM_AUTOCLOSE_BOOLEAN, false);
+    const char *filter = SDL_GetStringProperty(props, IMG_PROP_SAVE_PNG_FILTER_STRING, NULL);
+
+    InitSavePNGOptions(&options);
+    options.compression_level = (int)SDL_GetNumberProperty(props, IMG_PROP_SAVE_PNG_COMPRESSION_LEVEL_NUMBER, options.compression_level);
+    options.strategy = SDL_GetStringProperty(props, IMG_PROP_SAVE_PNG_STRATEGY_STRING, options.strategy);
+    options.reduce_colors = SDL_GetBooleanProperty(props, IMG_PROP_SAVE_PNG_REDUCE_COLORS_BOOLEAN, options.reduce_colors);
+    options.threads = (int)SDL_GetNumberProperty(props, IMG_PROP_SAVE_THREAD_COUNT_NUMBER, options.threads);
+
+    if (!IMG_VerifyCanSaveSurface(surface)) {
+        goto error;
+    }
+    if (options.compression_level < 0 || options.compression_level > 9) {
+        SDL_SetError("PNG compression level must be between 0 and 9");
+        goto error;
+    }
+    if (filter && !ParsePNGFilters(filter, &options.filters)) {
+        goto error;
+    }
+    if (SDL_strcmp(options.strategy, "default") != 0 &&
+        SDL_strcmp(options.strategy, "filtered") != 0 &&
+        SDL_strcmp(options.strategy, "huffman") != 0 &&
+        SDL_strcmp(options.strategy, "rle") != 0 &&
+        SDL_strcmp(options.strategy, "fixed") != 0) {
+        SDL_SetError("Unsupported PNG compression strategy: %s", options.strategy);
+        goto error;
+    }
+
+    if (!dst) {
+        if (!file) {
+            return SDL_SetError("Either IMG_PROP_SAVE_FILENAME_STRING or IMG_PROP_SAVE_IOSTREAM_POINTER must be set");
+        }
+        dst = SDL_IOFromFile(file, "wb");
+        if (!dst) {
+            return false;
+        }
+        closeio = true;
+    }
+    return SavePNG(surface, dst, closeio, &options);
+
+error:
+    if (dst && closeio) {
+        SDL_CloseIO(dst);
+    }
+    return false;
+}
+
 #else // !SAVE_PNG
 
 bool IMG_SavePNG_IO(SDL_Surface *surface, SDL_IOStream *dst, bool closeio)
@@ -143,4 +265,9 @@ bool IMG_SavePNG(SDL_Surface *surface, const char *file)
     return SDL_SetError("SDL_image built without PNG save support");
 }
 
+bool IMG_SavePNGWithProperties(SDL_Surface *surface, SDL_PropertiesID props)
+{
+    return SDL_SetError("SDL_image built without PNG save support");
+}
+
 #endif // SAVE_PNG
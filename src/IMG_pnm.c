@@ -29,6 +29,8 @@
 
 #include <SDL3_image/SDL_image.h>
 
+#include "IMG.h"
+
 #ifdef LOAD_PNM
 
 /* See if an image is contained in a data source */
@@ -108,6 +110,15 @@ static int ReadNumber(SDL_IOStream *src)
 }
 
 SDL_Surface *IMG_LoadPNM_IO(SDL_IOStream *src)
+{
+    IMG_LoadOptions options;
+
+    SDL_zero(options);
+    return IMG_LoadPNMWithOptions_IO(src, &options);
+}
+
+/* Load a PNM type image, decoding into the destination surface if it matches */
+SDL_Surface *IMG_LoadPNMWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options)
 {
     Sint64 start;
     SDL_Surface *surface = NULL;
@@ -156,10 +167,10 @@ SDL_Surface *IMG_LoadPNM_IO(SDL_IOStream *src)
 
     if(kind == PPM) {
         /* 24-bit surface in R,G,B byte order */
-        surface = SDL_CreateSurface(width, height, SDL_PIXELFORMAT_RGB24);
+        surface = IMG_CreateLoadSurface(options, width, height, SDL_PIXELFORMAT_RGB24);
     } else {
         /* load PBM/PGM as 8-bit indexed images */
-        surface = SDL_CreateSurface(width, height, SDL_PIXELFORMAT_INDEX8);
+        surface = IMG_CreateLoadSurface(options, width, height, SDL_PIXELFORMAT_INDEX8);
     }
     if ( surface == NULL )
         ERROR("Out of memory");
@@ -267,4 +278,10 @@ SDL_Surface *IMG_LoadPNM_IO(SDL_IOStream *src)
     return NULL;
 }
 
+SDL_Surface *IMG_LoadPNMWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options)
+{
+    SDL_SetError("SDL_image built without PNM support");
+    return NULL;
+}
+
 #endif /* LOAD_PNM */
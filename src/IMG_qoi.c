@@ -26,6 +26,8 @@
 #include <SDL3_image/SDL_image.h>
 #include <limits.h> /* for INT_MAX */
 
+#include "IMG.h"
+
 #ifdef LOAD_QOI
 
 /* SDL < 2.0.12 compatibility */
@@ -66,44 +68,55 @@ bool IMG_isQOI(SDL_IOStream *src)
 /* Load a QOI type image from an SDL datasource */
 SDL_Surface *IMG_LoadQOI_IO(SDL_IOStream *src)
 {
-    void *data;
+    IMG_LoadOptions options;
+
+    SDL_zero(options);
+    return IMG_LoadQOIWithOptions_IO(src, &options);
+}
+
+/* Load a QOI type image, copying it into the destination surface if it matches */
+SDL_Surface *IMG_LoadQOIWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options)
+{
+    const Uint8 *data;
     size_t size;
+    bool allocated;
     void *pixel_data;
+    int channels;
     qoi_desc image_info;
     SDL_Surface *surface = NULL;
 
-    data = SDL_LoadFile_IO(src, &size, false);
+    data = IMG_ReadIOData(src, 0, &size, &allocated);
     if ( !data ) {
         return NULL;
     }
     if ( size > INT_MAX ) {
-        SDL_free(data);
+        IMG_FreeIOData(data, allocated);
         SDL_SetError("QOI image is too big.");
         return NULL;
     }
 
-    pixel_data = qoi_decode(data, (int)size, &image_info, 4);
+    /* Decode without the alpha channel if the caller asked for it */
+    channels = (options->format == SDL_PIXELFORMAT_RGB24) ? 3 : 4;
+    pixel_data = qoi_decode(data, (int)size, &image_info, channels);
     /* pixel_data is in R,G,B,A order regardless of endianness */
-    SDL_free(data);
+    IMG_FreeIOData(data, allocated);
     if ( !pixel_data ) {
         SDL_SetError("Couldn't parse QOI image");
         return NULL;
     }
 
-    surface = SDL_CreateSurfaceFrom(image_info.width,
-                                    image_info.height,
-                                    SDL_PIXELFORMAT_RGBA32,
-                                    pixel_data,
-                                    (image_info.width * 4));
+    surface = IMG_CreateLoadSurfaceFrom(options,
+                                        image_info.width,
+                                        image_info.height,
+                                        (channels == 3) ? SDL_PIXELFORMAT_RGB24 : SDL_PIXELFORMAT_RGBA32,
+                                        pixel_data,
+                                        (image_info.width * channels));
     if ( !surface ) {
         QOI_FREE(pixel_data);
         SDL_SetError("Couldn't create SDL_Surface");
         return NULL;
     }
 
-    /* Let SDL manage the memory now */
-    surface->flags &= ~SDL_SURFACE_PREALLOCATED;
-
     return surface;
 }
 
@@ -122,4 +135,10 @@ SDL_Surface *IMG_LoadQOI_IO(SDL_IOStream *src)
     return NULL;
 }
 
+SDL_Surface *IMG_LoadQOIWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options)
+{
+    SDL_SetError("SDL_image built without QOI support");
+    return NULL;
+}
+
 #endif /* LOAD_QOI */
@@ -21,6 +21,8 @@
 
 #include <SDL3_image/SDL_image.h>
 
+#include "IMG.h"
+
 #ifdef USE_STBIMAGE
 
 #define malloc SDL_malloc
@@ -73,7 +75,7 @@ static int IMG_LoadSTB_IO_eof(void *user)
     return SDL_GetIOStatus(src) == SDL_IO_STATUS_EOF;
 }
 
-SDL_Surface *IMG_LoadSTB_IO(SDL_IOStream *src)
+SDL_Surface *IMG_LoadSTB_IO(SDL_IOStream *src, IMG_LoadOptions *options)
 {
     Sint64 start;
     Uint8 magic[26];
@@ -138,8 +140,14 @@ SDL_Surface *IMG_LoadSTB_IO(SDL_IOStream *src)
         return NULL;
     }
 
+    /* FIXME: This sucks. It'd be better to allocate the surface first, then
+     * write directly to the pixel buffer:
+     * https://github.com/nothings/stb/issues/58
+     * -flibit
+     */
     if (use_palette) {
-        surface = SDL_CreateSurfaceFrom(
+        surface = IMG_CreateLoadSurfaceFrom(
+            options,
             w,
             h,
             SDL_PIXELFORMAT_INDEX8,
@@ -178,17 +186,11 @@ SDL_Surface *IMG_LoadSTB_IO(SDL_IOStream *src)
                 palette->colors[colorkey_index].a = SDL_ALPHA_OPAQUE;
                 SDL_SetSurfaceColorKey(surface, true, colorkey_index);
             }
-
-            /* FIXME: This sucks. It'd be better to allocate the surface first, then
-             * write directly to the pixel buffer:
-             * https://github.com/nothings/stb/issues/58
-             * -flibit
-             */
-            surface->flags &= ~SDL_SURFACE_PREALLOCATED;
         }
 
     } else if (format == STBI_grey || format == STBI_rgb || format == STBI_rgb_alpha) {
-        surface = SDL_CreateSurfaceFrom(
+        surface = IMG_CreateLoadSurfaceFrom(
+            options,
             w,
             h,
             (format == STBI_rgb_alpha) ? SDL_PIXELFORMAT_RGBA32 :
@@ -211,17 +213,10 @@ SDL_Surface *IMG_LoadSTB_IO(SDL_IOStream *src)
                     }
                 }
             }
-
-            /* FIXME: This sucks. It'd be better to allocate the surface first, then
-             * write directly to the pixel buffer:
-             * https://github.com/nothings/stb/issues/58
-             * -flibit
-             */
-            surface->flags &= ~SDL_SURFACE_PREALLOCATED;
         }
 
     } else if (format == STBI_grey_alpha) {
-        surface = SDL_CreateSurface(w, h, SDL_PIXELFORMAT_RGBA32);
+        surface = IMG_CreateLoadSurface(options, w, h, SDL_PIXELFORMAT_RGBA32);
         if (surface) {
             Uint8 *src_ptr = pixels;
             Uint8 *dst = (Uint8 *)surface->pixels;
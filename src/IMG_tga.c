@@ -90,6 +90,15 @@ enum tga_type {
 
 /* Load a TGA type image from an SDL datasource */
 SDL_Surface *IMG_LoadTGA_IO(SDL_IOStream *src)
+{
+    IMG_LoadOptions options;
+
+    SDL_zero(options);
+    return IMG_LoadTGAWithOptions_IO(src, &options);
+}
+
+/* Load a TGA type image, decoding into the destination surface if it matches */
+SDL_Surface *IMG_LoadTGAWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options)
 {
     Sint64 start;
     const char *error = NULL;
@@ -190,7 +199,7 @@ SDL_Surface *IMG_LoadTGA_IO(SDL_IOStream *src)
         error = "TGA image with zero width or height";
         goto error;
     }
-    img = SDL_CreateSurface(w, h, format);
+    img = IMG_CreateLoadSurface(options, w, h, format);
     if (img == NULL) {
         error = "Out of memory";
         goto error;
@@ -356,8 +365,22 @@ SDL_Surface *IMG_LoadTGA_IO(SDL_IOStream *src)
     return NULL;
 }
 
+SDL_Surface *IMG_LoadTGAWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options)
+{
+    SDL_SetError("SDL_image built without TGA support");
+    return NULL;
+}
+
 #endif /* LOAD_TGA */
 
+#else
+
+/* The platform backend loads the image and the caller copies it */
+SDL_Surface *IMG_LoadTGAWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options)
+{
+    return IMG_LoadTGA_IO(src);
+}
+
 #endif /* !defined(__APPLE__) || defined(SDL_IMAGE_USE_COMMON_BACKEND) */
 
 #if SAVE_TGA
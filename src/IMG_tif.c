@@ -24,6 +24,8 @@
 /* This is a TIFF image file loading framework */
 
 #include <SDL3_image/SDL_image.h>
+#include "IMG.h"
+#include "IMG_utils.h"
 
 #ifdef LOAD_TIF
 
@@ -39,12 +41,19 @@ SDL_ELF_NOTE_DLOPEN(
 #endif
 
 static struct {
-    int loaded;
+    SDL_InitState init;
     void *handle;
     TIFF* (*TIFFClientOpen)(const char*, const char*, thandle_t, TIFFReadWriteProc, TIFFReadWriteProc, TIFFSeekProc, TIFFCloseProc, TIFFSizeProc, TIFFMapFileProc, TIFFUnmapFileProc);
     void (*TIFFClose)(TIFF*);
     int (*TIFFGetField)(TIFF*, ttag_t, ...);
     int (*TIFFReadRGBAImageOriented)(TIFF*, Uint32, Uint32, Uint32*, int, int);
+    int (*TIFFIsTiled)(TIFF*);
+    int (*TIFFReadRGBATile)(TIFF*, Uint32, Uint32, Uint32*);
+    int (*TIFFReadRGBAStrip)(TIFF*, Uint32, Uint32*);
+    int (*TIFFRGBAImageOK)(TIFF*, char[1024]);
+    int (*TIFFRGBAImageBegin)(TIFFRGBAImage*, TIFF*, int, char[1024]);
+    int (*TIFFRGBAImageGet)(TIFFRGBAImage*, Uint32*, Uint32, Uint32);
+    void (*TIFFRGBAImageEnd)(TIFFRGBAImage*);
     TIFFErrorHandler (*TIFFSetErrorHandler)(TIFFErrorHandler);
 } lib;
 
@@ -57,37 +66,47 @@ static struct {
     lib.FUNC = FUNC;
 #endif
 
-static bool IMG_InitTIF(void)
+static bool IMG_LoadTIFLibrary(void)
 {
-    if ( lib.loaded == 0 ) {
 #ifdef LOAD_TIF_DYNAMIC
-        lib.handle = SDL_LoadObject(LOAD_TIF_DYNAMIC);
-        if ( lib.handle == NULL ) {
-            return false;
-        }
-#endif
-        FUNCTION_LOADER(TIFFClientOpen, TIFF * (*)(const char*, const char*, thandle_t, TIFFReadWriteProc, TIFFReadWriteProc, TIFFSeekProc, TIFFCloseProc, TIFFSizeProc, TIFFMapFileProc, TIFFUnmapFileProc))
-        FUNCTION_LOADER(TIFFClose, void (*)(TIFF*))
-        FUNCTION_LOADER(TIFFGetField, int (*)(TIFF*, ttag_t, ...))
-        FUNCTION_LOADER(TIFFReadRGBAImageOriented, int (*)(TIFF*, Uint32, Uint32, Uint32*, int, int))
-        FUNCTION_LOADER(TIFFSetErrorHandler, TIFFErrorHandler (*)(TIFFErrorHandler))
+    lib.handle = SDL_LoadObject(LOAD_TIF_DYNAMIC);
+    if ( lib.handle == NULL ) {
+        return false;
     }
-    ++lib.loaded;
+#endif
+    FUNCTION_LOADER(TIFFClientOpen, TIFF * (*)(const char*, const char*, thandle_t, TIFFReadWriteProc, TIFFReadWriteProc, TIFFSeekProc, TIFFCloseProc, TIFFSizeProc, TIFFMapFileProc, TIFFUnmapFileProc))
+    FUNCTION_LOADER(TIFFClose, void (*)(TIFF*))
+    FUNCTION_LOADER(TIFFGetField, int (*)(TIFF*, ttag_t, ...))
+    FUNCTION_LOADER(TIFFReadRGBAImageOriented, int (*)(TIFF*, Uint32, Uint32, Uint32*, int, int))
+    FUNCTION_LOADER(TIFFIsTiled, int (*)(TIFF*))
+    FUNCTION_LOADER(TIFFReadRGBATile, int (*)(TIFF*, Uint32, Uint32, Uint32*))
+    FUNCTION_LOADER(TIFFReadRGBAStrip, int (*)(TIFF*, Uint32, Uint32*))
+    FUNCTION_LOADER(TIFFRGBAImageOK, int (*)(TIFF*, char[1024]))
+    FUNCTION_LOADER(TIFFRGBAImageBegin, int (*)(TIFFRGBAImage*, TIFF*, int, char[1024]))
+    FUNCTION_LOADER(TIFFRGBAImageGet, int (*)(TIFFRGBAImage*, Uint32*, Uint32, Uint32))
+    FUNCTION_LOADER(TIFFRGBAImageEnd, void (*)(TIFFRGBAImage*))
+    FUNCTION_LOADER(TIFFSetErrorHandler, TIFFErrorHandler (*)(TIFFErrorHandler))
 
     return true;
 }
+
+static bool IMG_InitTIF(void)
+{
+    /* Loads may run on several threads at once, the first one loads the library */
+    if (SDL_ShouldInit(&lib.init)) {
+        SDL_SetInitialized(&lib.init, IMG_LoadTIFLibrary());
+    }
+    return (SDL_GetAtomicInt(&lib.init.status) == SDL_INIT_STATUS_INITIALIZED);
+}
 #if 0
 void IMG_QuitTIF(void)
 {
-    if ( lib.loaded == 0 ) {
-        return;
-    }
-    if ( lib.loaded == 1 ) {
+    if (SDL_ShouldQuit(&lib.init)) {
 #ifdef LOAD_TIF_DYNAMIC
         SDL_UnloadObject(lib.handle);
 #endif
+        SDL_SetInitialized(&lib.init, false);
     }
-    --lib.loaded;
 }
 #endif // 0
 
@@ -170,6 +189,55 @@ bool IMG_isTIF(SDL_IOStream * src)
     return is_TIF;
 }
 
+/* Decode a transposed TIFF image a band of rows at a time, writing each band into the oriented surface */
+static bool ReadTransposedTIF(TIFF *tiff, Uint32 img_width, Uint32 img_height, int orientation, SDL_Surface *surface)
+{
+    TIFFRGBAImage img;
+    char emsg[1024];
+    Uint32 *raster;
+    Uint32 band_height = 0;
+    Uint32 y;
+    bool result = true;
+
+    if (lib.TIFFIsTiled(tiff)) {
+        lib.TIFFGetField(tiff, TIFFTAG_TILELENGTH, &band_height);
+    } else {
+        lib.TIFFGetField(tiff, TIFFTAG_ROWSPERSTRIP, &band_height);
+    }
+    if (band_height == 0 || band_height > img_height) {
+        band_height = img_height;
+    }
+
+    if (!lib.TIFFRGBAImageOK(tiff, emsg) || !lib.TIFFRGBAImageBegin(&img, tiff, 0, emsg)) {
+        return SDL_SetError("%s", emsg);
+    }
+
+    /* Request the orientation the rows are stored in, so libtiff returns them unflipped */
+    img.req_orientation = (Uint16)orientation;
+
+    raster = (Uint32 *)SDL_malloc((size_t)img_width * band_height * sizeof(Uint32));
+    if (!raster) {
+        lib.TIFFRGBAImageEnd(&img);
+        return false;
+    }
+
+    for (y = 0; y < img_height; y += band_height) {
+        Uint32 rows = SDL_min(band_height, img_height - y);
+
+        img.row_offset = (int)y;
+        img.col_offset = 0;
+        if (!lib.TIFFRGBAImageGet(&img, raster, img_width, rows)) {
+            result = false;
+            break;
+        }
+        IMG_CopyOrientedPixels(raster, (int)(img_width * sizeof(Uint32)), 0, (int)y, (int)img_width, (int)rows, surface, orientation);
+    }
+
+    SDL_free(raster);
+    lib.TIFFRGBAImageEnd(&img);
+    return result;
+}
+
 SDL_Surface* IMG_LoadTIF_IO(SDL_IOStream * src)
 {
     Sint64 start;
@@ -199,55 +267,176 @@ SDL_Surface* IMG_LoadTIF_IO(SDL_IOStream * src)
     lib.TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &img_height);
     lib.TIFFGetField(tiff, TIFFTAG_ORIENTATION, &img_orientation);
 
-    surface = SDL_CreateSurface(img_width, img_height, SDL_PIXELFORMAT_ABGR8888);
-    if(!surface)
+    if (img_orientation >= ORIENTATION_LEFTTOP && img_orientation <= ORIENTATION_LEFTBOT) {
+        /* Transpose the image into its final orientation while it is decoded */
+        surface = SDL_CreateSurface(img_height, img_width, SDL_PIXELFORMAT_ABGR8888);
+        if(!surface)
+            goto error;
+
+        if (!ReadTransposedTIF(tiff, img_width, img_height, img_orientation, surface)) {
+            goto error;
+        }
+    } else {
+        /* libtiff flips the rows in place for the mirrored orientations */
+        surface = SDL_CreateSurface(img_width, img_height, SDL_PIXELFORMAT_ABGR8888);
+        if(!surface)
+            goto error;
+
+        if(!lib.TIFFReadRGBAImageOriented(tiff, img_width, img_height, (Uint32 *)surface->pixels, ORIENTATION_TOPLEFT, 0)) {
+            goto error;
+        }
+    }
+
+    lib.TIFFClose(tiff);
+
+    return surface;
+
+error:
+    SDL_SeekIO(src, start, SDL_IO_SEEK_SET);
+    if (surface) {
+        SDL_DestroySurface(surface);
+    }
+    if (tiff) {
+        lib.TIFFClose(tiff);
+    }
+    return NULL;
+}
+
+/* Copy the rows of a bottom-up RGBA raster that intersect the crop rectangle */
+static void CopyRasterRows(SDL_Surface *surface, const SDL_Rect *crop, const Uint32 *raster, int raster_x, int raster_y, int raster_w, int raster_h, int raster_pitch)
+{
+    SDL_Rect area, clipped;
+    int y;
+
+    area.x = raster_x;
+    area.y = raster_y;
+    area.w = raster_w;
+    area.h = raster_h;
+    if (!SDL_GetRectIntersection(&area, crop, &clipped)) {
+        return;
+    }
+
+    for (y = clipped.y; y < clipped.y + clipped.h; ++y) {
+        const Uint32 *src = raster + (size_t)(raster_h - 1 - (y - raster_y)) * raster_pitch + (clipped.x - raster_x);
+        Uint8 *dst = (Uint8 *)surface->pixels + (size_t)(y - crop->y) * surface->pitch + (size_t)(clipped.x - crop->x) * sizeof(Uint32);
+        SDL_memcpy(dst, src, clipped.w * sizeof(Uint32));
+    }
+}
+
+/* Load a TIFF type image, reading only the tiles or strips that intersect the crop rectangle */
+SDL_Surface *IMG_LoadTIFWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options)
+{
+    Sint64 start;
+    TIFF* tiff = NULL;
+    SDL_Surface* surface = NULL;
+    Uint32 *raster = NULL;
+    Uint32 img_width, img_height;
+    Uint16 img_orientation = 1;
+    SDL_Rect crop;
+
+    if ( !src ) {
+        /* The error message has been set in SDL_IOFromFile */
+        return NULL;
+    }
+    if (SDL_RectEmpty(&options->crop)) {
+        return IMG_LoadTIF_IO(src);
+    }
+    start = SDL_TellIO(src);
+
+    if (!IMG_InitTIF()) {
+        return NULL;
+    }
+
+    /* turn off memory mapped access with the m flag */
+    tiff = lib.TIFFClientOpen("SDL_image", "rm", (thandle_t)src,
+        tiff_read, tiff_write, tiff_seek, tiff_close, tiff_size, tiff_map, tiff_unmap);
+    if(!tiff)
         goto error;
 
-    int load_orientation;
-    switch (img_orientation) {
-    case 5:
-    case 6:
-    case 7:
-    case 8:
-        load_orientation = ORIENTATION_TOPRIGHT;
-        break;
-    default:
-        load_orientation = ORIENTATION_TOPLEFT;
-        break;
+    lib.TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &img_width);
+    lib.TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &img_height);
+    lib.TIFFGetField(tiff, TIFFTAG_ORIENTATION, &img_orientation);
+
+    if (img_orientation != ORIENTATION_TOPLEFT) {
+        /* Let the caller crop the oriented image */
+        lib.TIFFClose(tiff);
+        SDL_SeekIO(src, start, SDL_IO_SEEK_SET);
+        return IMG_LoadTIF_IO(src);
     }
-    if(!lib.TIFFReadRGBAImageOriented(tiff, img_width, img_height, (Uint32 *)surface->pixels, load_orientation, 0)) {
+
+    crop.x = 0;
+    crop.y = 0;
+    crop.w = (int)img_width;
+    crop.h = (int)img_height;
+    if (!SDL_GetRectIntersection(&options->crop, &crop, &crop)) {
+        SDL_SetError("Crop rectangle is outside the image");
         goto error;
     }
+    options->cropped = true;
 
-    lib.TIFFClose(tiff);
+    surface = IMG_CreateLoadSurface(options, crop.w, crop.h, SDL_PIXELFORMAT_ABGR8888);
+    if(!surface)
+        goto error;
 
-    SDL_Surface *rotated;
-    switch (img_orientation) {
-    case 5:
-    case 7:
-        rotated = SDL_RotateSurface(surface, 270.0f);
-        if (!rotated) {
+    if (lib.TIFFIsTiled(tiff)) {
+        Uint32 tile_width = 0, tile_height = 0;
+        Uint32 x, y;
+
+        lib.TIFFGetField(tiff, TIFFTAG_TILEWIDTH, &tile_width);
+        lib.TIFFGetField(tiff, TIFFTAG_TILELENGTH, &tile_height);
+        if (tile_width == 0 || tile_height == 0) {
+            SDL_SetError("Invalid TIFF tile size");
             goto error;
         }
-        SDL_DestroySurface(surface);
-        surface = rotated;
-        break;
-    case 6:
-    case 8:
-        rotated = SDL_RotateSurface(surface, 90.0f);
-        if (!rotated) {
+
+        raster = (Uint32 *)SDL_malloc((size_t)tile_width * tile_height * sizeof(Uint32));
+        if (!raster) {
             goto error;
         }
-        SDL_DestroySurface(surface);
-        surface = rotated;
-        break;
-    default:
-        break;
+
+        for (y = (crop.y / tile_height) * tile_height; y < (Uint32)(crop.y + crop.h); y += tile_height) {
+            for (x = (crop.x / tile_width) * tile_width; x < (Uint32)(crop.x + crop.w); x += tile_width) {
+                if (!lib.TIFFReadRGBATile(tiff, x, y, raster)) {
+                    goto error;
+                }
+                CopyRasterRows(surface, &crop, raster, x, y, tile_width, tile_height, tile_width);
+            }
+        }
+    } else {
+        Uint32 rows_per_strip = img_height;
+        Uint32 y;
+
+        lib.TIFFGetField(tiff, TIFFTAG_ROWSPERSTRIP, &rows_per_strip);
+        if (rows_per_strip == 0 || rows_per_strip > img_height) {
+            rows_per_strip = img_height;
+        }
+
+        raster = (Uint32 *)SDL_malloc((size_t)img_width * rows_per_strip * sizeof(Uint32));
+        if (!raster) {
+            goto error;
+        }
+
+        for (y = (crop.y / rows_per_strip) * rows_per_strip; y < (Uint32)(crop.y + crop.h); y += rows_per_strip) {
+            Uint32 rows = SDL_min(rows_per_strip, img_height - y);
+
+            if (!lib.TIFFReadRGBAStrip(tiff, y, raster)) {
+                goto error;
+            }
+            CopyRasterRows(surface, &crop, raster, 0, y, img_width, rows, img_width);
+        }
     }
+
+    SDL_free(raster);
+    lib.TIFFClose(tiff);
+
     return surface;
 
 error:
     SDL_SeekIO(src, start, SDL_IO_SEEK_SET);
+    options->cropped = false;
+    if (raster) {
+        SDL_free(raster);
+    }
     if (surface) {
         SDL_DestroySurface(surface);
     }
@@ -272,6 +461,23 @@ SDL_Surface *IMG_LoadTIF_IO(SDL_IOStream *src)
     return NULL;
 }
 
+SDL_Surface *IMG_LoadTIFWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options)
+{
+    SDL_SetError("SDL_image built without TIFF support");
+    return NULL;
+}
+
 #endif /* LOAD_TIF */
 
+#else
+
+#include <SDL3_image/SDL_image.h>
+#include "IMG.h"
+
+/* The platform backend decodes the whole image and the caller crops it */
+SDL_Surface *IMG_LoadTIFWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options)
+{
+    return IMG_LoadTIF_IO(src);
+}
+
 #endif /* !defined(__APPLE__) || defined(SDL_IMAGE_USE_COMMON_BACKEND) */
@@ -21,3 +21,13 @@
 
 extern SDL_Surface *IMG_ApplyOrientation(SDL_Surface *surface, int orientation);
 
+/* Get the size of an image after an EXIF orientation is applied */
+extern void IMG_GetOrientedSize(int orientation, int width, int height, int *oriented_w, int *oriented_h);
+
+/* Copy a block of pixels at (x, y) in an image, as it is stored, into the surface
+ * holding the image with an EXIF orientation applied. This lets codecs write
+ * rows directly into the final surface instead of rotating it afterwards.
+ * The pitch may be negative for bottom-up pixels.
+ */
+extern void IMG_CopyOrientedPixels(const void *pixels, int pitch, int x, int y, int w, int h, SDL_Surface *dst, int orientation);
+
@@ -91,7 +91,7 @@ SDL_ELF_NOTE_DLOPEN(
 
 static struct
 {
-    int loaded;
+    SDL_InitState init;
     void *handle_libwebpdemux;
     void *handle_libwebp;
     void *handle_libwebpmux;
@@ -99,6 +99,8 @@ static struct
     VP8StatusCode (*WebPGetFeaturesInternal)(const uint8_t *data, size_t data_size, WebPBitstreamFeatures *features, int decoder_abi_version);
     uint8_t *(*WebPDecodeRGBInto)(const uint8_t *data, size_t data_size, uint8_t *output_buffer, size_t output_buffer_size, int output_stride);
     uint8_t *(*WebPDecodeRGBAInto)(const uint8_t *data, size_t data_size, uint8_t *output_buffer, size_t output_buffer_size, int output_stride);
+    int (*WebPInitDecoderConfigInternal)(WebPDecoderConfig *config, int version);
+    VP8StatusCode (*WebPDecode)(const uint8_t *data, size_t data_size, WebPDecoderConfig *config);
     WebPDemuxer *(*WebPDemuxInternal)(const WebPData *data, int allow_partial, WebPDemuxState *state, int version);
     int (*WebPDemuxGetFrame)(const WebPDemuxer *dmux, int frame_number, WebPIterator *iter);
     int (*WebPDemuxNextFrame)(WebPIterator *iter);
@@ -182,84 +184,89 @@ static struct
 /* Need to turn off optimizations so weak framework load check works */
 __attribute__((optnone))
 #endif
-static bool IMG_InitWEBP(void)
+static bool IMG_LoadWEBPLibrary(void)
 {
-    if (lib.loaded == 0) {
 #if defined(LOAD_WEBP_DYNAMIC) && defined(LOAD_WEBPDEMUX_DYNAMIC) && defined(LOAD_WEBPMUX_DYNAMIC)
-        lib.handle_libwebp = SDL_LoadObject(LOAD_WEBP_DYNAMIC);
-        if (lib.handle_libwebp == NULL) {
-            return false;
-        }
-        lib.handle_libwebpdemux = SDL_LoadObject(LOAD_WEBPDEMUX_DYNAMIC);
-        if (lib.handle_libwebpdemux == NULL) {
-            return false;
-        }
-        lib.handle_libwebpmux = SDL_LoadObject(LOAD_WEBPMUX_DYNAMIC);
-        if (lib.handle_libwebpmux == NULL) {
-            return false;
-        }
+    lib.handle_libwebp = SDL_LoadObject(LOAD_WEBP_DYNAMIC);
+    if (lib.handle_libwebp == NULL) {
+        return false;
+    }
+    lib.handle_libwebpdemux = SDL_LoadObject(LOAD_WEBPDEMUX_DYNAMIC);
+    if (lib.handle_libwebpdemux == NULL) {
+        return false;
+    }
+    lib.handle_libwebpmux = SDL_LoadObject(LOAD_WEBPMUX_DYNAMIC);
+    if (lib.handle_libwebpmux == NULL) {
+        return false;
+    }
 #endif
-        FUNCTION_LOADER_LIBWEBP(WebPGetFeaturesInternal, VP8StatusCode(*)(const uint8_t *data, size_t data_size, WebPBitstreamFeatures *features, int decoder_abi_version))
-        FUNCTION_LOADER_LIBWEBP(WebPDecodeRGBInto, uint8_t *(*)(const uint8_t *data, size_t data_size, uint8_t *output_buffer, size_t output_buffer_size, int output_stride))
-        FUNCTION_LOADER_LIBWEBP(WebPDecodeRGBAInto, uint8_t *(*)(const uint8_t *data, size_t data_size, uint8_t *output_buffer, size_t output_buffer_size, int output_stride))
-        FUNCTION_LOADER_LIBWEBPDEMUX(WebPDemuxInternal, WebPDemuxer * (*)(const WebPData *, int, WebPDemuxState *, int))
-        FUNCTION_LOADER_LIBWEBPDEMUX(WebPDemuxGetFrame, int (*)(const WebPDemuxer *dmux, int frame_number, WebPIterator *iter))
-        FUNCTION_LOADER_LIBWEBPDEMUX(WebPDemuxNextFrame, int (*)(WebPIterator *iter))
-        FUNCTION_LOADER_LIBWEBPDEMUX(WebPDemuxReleaseIterator, void (*)(WebPIterator *iter))
-        FUNCTION_LOADER_LIBWEBPDEMUX(WebPDemuxGetI, uint32_t (*)(const WebPDemuxer *dmux, WebPFormatFeature feature))
-        FUNCTION_LOADER_LIBWEBPDEMUX(WebPDemuxDelete, void (*)(WebPDemuxer *dmux))
-
-        // Encoding frame functions
-        FUNCTION_LOADER_LIBWEBP(WebPConfigInitInternal, int (*)(WebPConfig *, WebPPreset, float, int))
-        FUNCTION_LOADER_LIBWEBP(WebPValidateConfig, int (*)(const WebPConfig *))
-        FUNCTION_LOADER_LIBWEBP(WebPPictureInitInternal, int (*)(WebPPicture *, int))
-        FUNCTION_LOADER_LIBWEBP(WebPEncode, int (*)(const WebPConfig *, WebPPicture *))
-        FUNCTION_LOADER_LIBWEBP(WebPPictureFree, void (*)(WebPPicture *))
-        FUNCTION_LOADER_LIBWEBP(WebPPictureImportRGBA, int (*)(WebPPicture *, const uint8_t *, int))
-
-        FUNCTION_LOADER_LIBWEBP(WebPMemoryWriterInit, void (*)(WebPMemoryWriter *))
-        FUNCTION_LOADER_LIBWEBP(WebPMemoryWrite, int (*)(const uint8_t *, size_t, const WebPPicture *))
-        FUNCTION_LOADER_LIBWEBP(WebPMemoryWriterClear, void (*)(WebPMemoryWriter *))
-
-        // Free function required for cleanup after muxing.
-        FUNCTION_LOADER_LIBWEBP(WebPFree, void (*)(void *))
-
-        // Muxing functions
-        FUNCTION_LOADER_LIBWEBPMUX(WebPAnimEncoderNewInternal, WebPAnimEncoder * (*)(int, int, const WebPAnimEncoderOptions *, int))
-        FUNCTION_LOADER_LIBWEBPMUX(WebPAnimEncoderOptionsInitInternal, int (*)(WebPAnimEncoderOptions *, int))
-        FUNCTION_LOADER_LIBWEBPMUX(WebPAnimEncoderAdd, int (*)(WebPAnimEncoder *, WebPPicture *, int, const WebPConfig *))
-        FUNCTION_LOADER_LIBWEBPMUX(WebPAnimEncoderAssemble, int (*)(WebPAnimEncoder *, WebPData *))
-        FUNCTION_LOADER_LIBWEBPMUX(WebPAnimEncoderDelete, void (*)(WebPAnimEncoder *))
-
-        // Used for extracting EXIF & XMP chunks.
-        FUNCTION_LOADER_LIBWEBPDEMUX(WebPDemuxGetChunk, int (*)(const WebPDemuxer *dmux, const char fourcc[4], int chunk_number, WebPChunkIterator *iter))
-        FUNCTION_LOADER_LIBWEBPDEMUX(WebPDemuxReleaseChunkIterator, void (*)(WebPChunkIterator* iter))
-
-        // Used for setting EXIF & XMP chunks and for loop count.
-        FUNCTION_LOADER_LIBWEBPMUX(WebPMuxCreateInternal, WebPMux * (*)(const WebPData*, int, int))
-        FUNCTION_LOADER_LIBWEBPMUX(WebPMuxDelete, void (*)(WebPMux* mux))
-        FUNCTION_LOADER_LIBWEBPMUX(WebPMuxSetChunk, WebPMuxError (*)(WebPMux *mux, const char fourcc[4], const WebPData *chunk_data, int copy_data))
-        FUNCTION_LOADER_LIBWEBPMUX(WebPMuxGetAnimationParams, WebPMuxError (*)(const WebPMux* mux, WebPMuxAnimParams* params))
-        FUNCTION_LOADER_LIBWEBPMUX(WebPMuxSetAnimationParams, WebPMuxError (*)(WebPMux* mux, const WebPMuxAnimParams* params))
-        FUNCTION_LOADER_LIBWEBPMUX(WebPMuxAssemble, WebPMuxError (*)(WebPMux* mux, WebPData* assembled_data))
-    }
-    ++lib.loaded;
+    FUNCTION_LOADER_LIBWEBP(WebPGetFeaturesInternal, VP8StatusCode(*)(const uint8_t *data, size_t data_size, WebPBitstreamFeatures *features, int decoder_abi_version))
+    FUNCTION_LOADER_LIBWEBP(WebPDecodeRGBInto, uint8_t *(*)(const uint8_t *data, size_t data_size, uint8_t *output_buffer, size_t output_buffer_size, int output_stride))
+    FUNCTION_LOADER_LIBWEBP(WebPDecodeRGBAInto, uint8_t *(*)(const uint8_t *data, size_t data_size, uint8_t *output_buffer, size_t output_buffer_size, int output_stride))
+    FUNCTION_LOADER_LIBWEBP(WebPInitDecoderConfigInternal, int (*)(WebPDecoderConfig *config, int version))
+    FUNCTION_LOADER_LIBWEBP(WebPDecode, VP8StatusCode (*)(const uint8_t *data, size_t data_size, WebPDecoderConfig *config))
+    FUNCTION_LOADER_LIBWEBPDEMUX(WebPDemuxInternal, WebPDemuxer * (*)(const WebPData *, int, WebPDemuxState *, int))
+    FUNCTION_LOADER_LIBWEBPDEMUX(WebPDemuxGetFrame, int (*)(const WebPDemuxer *dmux, int frame_number, WebPIterator *iter))
+    FUNCTION_LOADER_LIBWEBPDEMUX(WebPDemuxNextFrame, int (*)(WebPIterator *iter))
+    FUNCTION_LOADER_LIBWEBPDEMUX(WebPDemuxReleaseIterator, void (*)(WebPIterator *iter))
+    FUNCTION_LOADER_LIBWEBPDEMUX(WebPDemuxGetI, uint32_t (*)(const WebPDemuxer *dmux, WebPFormatFeature feature))
+    FUNCTION_LOADER_LIBWEBPDEMUX(WebPDemuxDelete, void (*)(WebPDemuxer *dmux))
+
+    // Encoding frame functions
+    FUNCTION_LOADER_LIBWEBP(WebPConfigInitInternal, int (*)(WebPConfig *, WebPPreset, float, int))
+    FUNCTION_LOADER_LIBWEBP(WebPValidateConfig, int (*)(const WebPConfig *))
+    FUNCTION_LOADER_LIBWEBP(WebPPictureInitInternal, int (*)(WebPPicture *, int))
+    FUNCTION_LOADER_LIBWEBP(WebPEncode, int (*)(const WebPConfig *, WebPPicture *))
+    FUNCTION_LOADER_LIBWEBP(WebPPictureFree, void (*)(WebPPicture *))
+    FUNCTION_LOADER_LIBWEBP(WebPPictureImportRGBA, int (*)(WebPPicture *, const uint8_t *, int))
+
+    FUNCTION_LOADER_LIBWEBP(WebPMemoryWriterInit, void (*)(WebPMemoryWriter *))
+    FUNCTION_LOADER_LIBWEBP(WebPMemoryWrite, int (*)(const uint8_t *, size_t, const WebPPicture *))
+    FUNCTION_LOADER_LIBWEBP(WebPMemoryWriterClear, void (*)(WebPMemoryWriter *))
+
+    // Free function required for cleanup after muxing.
+    FUNCTION_LOADER_LIBWEBP(WebPFree, void (*)(void *))
+
+    // Muxing functions
+    FUNCTION_LOADER_LIBWEBPMUX(WebPAnimEncoderNewInternal, WebPAnimEncoder * (*)(int, int, const WebPAnimEncoderOptions *, int))
+    FUNCTION_LOADER_LIBWEBPMUX(WebPAnimEncoderOptionsInitInternal, int (*)(WebPAnimEncoderOptions *, int))
+    FUNCTION_LOADER_LIBWEBPMUX(WebPAnimEncoderAdd, int (*)(WebPAnimEncoder *, WebPPicture *, int, const WebPConfig *))
+    FUNCTION_LOADER_LIBWEBPMUX(WebPAnimEncoderAssemble, int (*)(WebPAnimEncoder *, WebPData *))
+    FUNCTION_LOADER_LIBWEBPMUX(WebPAnimEncoderDelete, void (*)(WebPAnimEncoder *))
+
+    // Used for extracting EXIF & XMP chunks.
+    FUNCTION_LOADER_LIBWEBPDEMUX(WebPDemuxGetChunk, int (*)(const WebPDemuxer *dmux, const char fourcc[4], int chunk_number, WebPChunkIterator *iter))
+    FUNCTION_LOADER_LIBWEBPDEMUX(WebPDemuxReleaseChunkIterator, void (*)(WebPChunkIterator* iter))
+
+    // Used for setting EXIF & XMP chunks and for loop count.
+    FUNCTION_LOADER_LIBWEBPMUX(WebPMuxCreateInternal, WebPMux * (*)(const WebPData*, int, int))
+    FUNCTION_LOADER_LIBWEBPMUX(WebPMuxDelete, void (*)(WebPMux* mux))
+    FUNCTION_LOADER_LIBWEBPMUX(WebPMuxSetChunk, WebPMuxError (*)(WebPMux *mux, const char fourcc[4], const WebPData *chunk_data, int copy_data))
+    FUNCTION_LOADER_LIBWEBPMUX(WebPMuxGetAnimationParams, WebPMuxError (*)(const WebPMux* mux, WebPMuxAnimParams* params))
+    FUNCTION_LOADER_LIBWEBPMUX(WebPMuxSetAnimationParams, WebPMuxError (*)(WebPMux* mux, const WebPMuxAnimParams* params))
+    FUNCTION_LOADER_LIBWEBPMUX(WebPMuxAssemble, WebPMuxError (*)(WebPMux* mux, WebPData* assembled_data))
 
     return true;
 }
+
+static bool IMG_InitWEBP(void)
+{
+    /* Loads may run on several threads at once, the first one loads the library */
+    if (SDL_ShouldInit(&lib.init)) {
+        SDL_SetInitialized(&lib.init, IMG_LoadWEBPLibrary());
+    }
+    return (SDL_GetAtomicInt(&lib.init.status) == SDL_INIT_STATUS_INITIALIZED);
+}
 #if 0
 void IMG_QuitWEBP(void)
 {
-    if (lib.loaded == 0) {
-        return;
-    }
-    if (lib.loaded == 1) {
+    if (SDL_ShouldQuit(&lib.init)) {
 #if defined(LOAD_WEBP_DYNAMIC) && defined(LOAD_WEBPDEMUX_DYNAMIC)
         SDL_UnloadObject(lib.handle_libwebp);
         SDL_UnloadObject(lib.handle_libwebpdemux);
 #endif
+        SDL_SetInitialized(&lib.init, false);
     }
-    --lib.loaded;
 }
 #endif // 0
 
@@ -309,15 +316,52 @@ bool IMG_isWEBP(SDL_IOStream *src)
     return webp_getinfo(src, NULL);
 }
 
+/* Get the libwebp output mode that decodes directly to a pixel format */
+static bool GetWEBPColorspace(SDL_PixelFormat format, bool premultiply_alpha, WEBP_CSP_MODE *mode)
+{
+    switch (format) {
+    case SDL_PIXELFORMAT_RGB24:
+        *mode = MODE_RGB;
+        return true;
+    case SDL_PIXELFORMAT_BGR24:
+        *mode = MODE_BGR;
+        return true;
+    case SDL_PIXELFORMAT_RGBA32:
+        *mode = premultiply_alpha ? MODE_rgbA : MODE_RGBA;
+        return true;
+    case SDL_PIXELFORMAT_BGRA32:
+        *mode = premultiply_alpha ? MODE_bgrA : MODE_BGRA;
+        return true;
+    case SDL_PIXELFORMAT_ARGB32:
+        *mode = premultiply_alpha ? MODE_Argb : MODE_ARGB;
+        return true;
+    default:
+        return false;
+    }
+}
+
 SDL_Surface *IMG_LoadWEBP_IO(SDL_IOStream *src)
+{
+    IMG_LoadOptions options;
+
+    SDL_zero(options);
+    return IMG_LoadWEBPWithOptions_IO(src, &options);
+}
+
+/* Load a WEBP type image, using the decoder cropping and scaling */
+SDL_Surface *IMG_LoadWEBPWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options)
 {
     Sint64 start;
     const char *error = NULL;
     SDL_Surface *surface = NULL;
     Uint32 format;
+    WEBP_CSP_MODE mode;
+    SDL_Rect crop;
+    int width, height;
     WebPBitstreamFeatures features;
     size_t raw_data_size;
-    uint8_t *raw_data = NULL;
+    const uint8_t *raw_data = NULL;
+    bool raw_data_allocated = false;
     uint8_t *ret;
 
     if (!src) {
@@ -337,13 +381,8 @@ SDL_Surface *IMG_LoadWEBP_IO(SDL_IOStream *src)
         goto error;
     }
 
-    raw_data = (uint8_t *)SDL_malloc(raw_data_size);
+    raw_data = IMG_ReadIOData(src, raw_data_size, NULL, &raw_data_allocated);
     if (raw_data == NULL) {
-        error = "Failed to allocate enough buffer for WEBP";
-        goto error;
-    }
-
-    if (SDL_ReadIO(src, raw_data, raw_data_size) != raw_data_size) {
         error = "Failed to read WEBP";
         goto error;
     }
@@ -374,7 +413,7 @@ SDL_Surface *IMG_LoadWEBP_IO(SDL_IOStream *src)
                 if (surf) {
                     ++surf->refcount;
                     if (raw_data) {
-                        SDL_free(raw_data);
+                        IMG_FreeIOData(raw_data, raw_data_allocated);
                     }
                     IMG_FreeAnimation(animation);
                     return surf;
@@ -393,17 +432,82 @@ SDL_Surface *IMG_LoadWEBP_IO(SDL_IOStream *src)
 
     if (features.has_alpha) {
         format = SDL_PIXELFORMAT_RGBA32;
+        mode = MODE_RGBA;
     } else {
         format = SDL_PIXELFORMAT_RGB24;
+        mode = MODE_RGB;
+    }
+    if (GetWEBPColorspace(options->format, options->premultiply_alpha, &mode)) {
+        format = options->format;
+        if (WebPIsPremultipliedMode(mode)) {
+            options->premultiplied = true;
+        }
+    }
+
+    crop.x = 0;
+    crop.y = 0;
+    crop.w = features.width;
+    crop.h = features.height;
+    if (!SDL_RectEmpty(&options->crop)) {
+        if (!SDL_GetRectIntersection(&options->crop, &crop, &crop)) {
+            error = "Crop rectangle is outside the image";
+            goto error;
+        }
+        if (features.format != 2 && ((crop.x | crop.y) & 1)) {
+            /* Older libwebp versions move lossy crop offsets to even coordinates,
+               so decode the whole image at full size and let the caller crop it */
+            crop.x = 0;
+            crop.y = 0;
+            crop.w = features.width;
+            crop.h = features.height;
+        } else {
+            options->cropped = true;
+        }
+    }
+    if (SDL_RectEmpty(&options->crop) || options->cropped) {
+        IMG_GetScaledSize(crop.w, crop.h, options->max_w, options->max_h, &width, &height);
+    } else {
+        width = crop.w;
+        height = crop.h;
     }
 
-    surface = SDL_CreateSurface(features.width, features.height, format);
+    surface = IMG_CreateLoadSurface(options, width, height, format);
     if (surface == NULL) {
         error = "Failed to allocate SDL_Surface";
         goto error;
     }
 
-    if (features.has_alpha) {
+    if (width != features.width || height != features.height ||
+        mode != (features.has_alpha ? MODE_RGBA : MODE_RGB)) {
+        WebPDecoderConfig config;
+
+        if (!lib.WebPInitDecoderConfigInternal(&config, WEBP_DECODER_ABI_VERSION)) {
+            error = "WebPInitDecoderConfig has failed";
+            goto error;
+        }
+        if (crop.w != features.width || crop.h != features.height) {
+            config.options.use_cropping = 1;
+            config.options.crop_left = crop.x;
+            config.options.crop_top = crop.y;
+            config.options.crop_width = crop.w;
+            config.options.crop_height = crop.h;
+        }
+        if (width != crop.w || height != crop.h) {
+            config.options.use_scaling = 1;
+            config.options.scaled_width = width;
+            config.options.scaled_height = height;
+        }
+        config.output.colorspace = mode;
+        config.output.is_external_memory = 1;
+        config.output.u.RGBA.rgba = (uint8_t *)surface->pixels;
+        config.output.u.RGBA.stride = surface->pitch;
+        config.output.u.RGBA.size = (size_t)surface->pitch * surface->h;
+        if (lib.WebPDecode(raw_data, raw_data_size, &config) == VP8_STATUS_OK) {
+            ret = config.output.u.RGBA.rgba;
+        } else {
+            ret = NULL;
+        }
+    } else if (features.has_alpha) {
         ret = lib.WebPDecodeRGBAInto(raw_data, raw_data_size, (uint8_t *)surface->pixels, surface->pitch * surface->h, surface->pitch);
     } else {
         ret = lib.WebPDecodeRGBInto(raw_data, raw_data_size, (uint8_t *)surface->pixels, surface->pitch * surface->h, surface->pitch);
@@ -415,14 +519,14 @@ SDL_Surface *IMG_LoadWEBP_IO(SDL_IOStream *src)
     }
 
     if (raw_data) {
-        SDL_free(raw_data);
+        IMG_FreeIOData(raw_data, raw_data_allocated);
     }
 
     return surface;
 
 error:
     if (raw_data) {
-        SDL_free(raw_data);
+        IMG_FreeIOData(raw_data, raw_data_allocated);
     }
 
     if (surface) {
@@ -434,6 +538,8 @@ error:
     }
 
     SDL_SeekIO(src, start, SDL_IO_SEEK_SET);
+    options->cropped = false;
+    options->premultiplied = false;
     return NULL;
 }
 
@@ -444,8 +550,9 @@ struct IMG_AnimationDecoderContext
     SDL_Surface *canvas;
     WebPMuxAnimDispose dispose_method;
     uint32_t bgcolor;
-    uint8_t *raw_data;
+    const uint8_t *raw_data;
     size_t raw_data_size;
+    bool raw_data_allocated;
     WebPDemuxState demux_state;
     SDL_Rect last_rect;
     bool has_alpha;
@@ -569,7 +676,7 @@ static bool IMG_AnimationDecoderClose_Internal(IMG_AnimationDecoder *decoder)
         lib.WebPDemuxDelete(decoder->ctx->demuxer);
     }
     if (decoder->ctx->raw_data) {
-        SDL_free(decoder->ctx->raw_data);
+        IMG_FreeIOData(decoder->ctx->raw_data, decoder->ctx->raw_data_allocated);
     }
     lib.WebPDemuxReleaseIterator(&decoder->ctx->iter);
     SDL_free(decoder->ctx);
@@ -598,13 +705,13 @@ bool IMG_CreateWEBPAnimationDecoder(IMG_AnimationDecoder *decoder, SDL_Propertie
     }
 
     decoder->ctx->raw_data_size = (size_t)stream_size;
-    decoder->ctx->raw_data = (uint8_t *)SDL_malloc(decoder->ctx->raw_data_size);
-    if (!decoder->ctx->raw_data) {
+    if (SDL_SeekIO(decoder->src, decoder->start, SDL_IO_SEEK_SET) < 0) {
         IMG_AnimationDecoderClose_Internal(decoder);
         return false;
     }
-    if (SDL_SeekIO(decoder->src, decoder->start, SDL_IO_SEEK_SET) < 0 ||
-        SDL_ReadIO(decoder->src, decoder->ctx->raw_data, decoder->ctx->raw_data_size) != decoder->ctx->raw_data_size) {
+    /* Memory-backed streams stay open for the life of the decoder, so their data can be used in place */
+    decoder->ctx->raw_data = IMG_ReadIOData(decoder->src, decoder->ctx->raw_data_size, NULL, &decoder->ctx->raw_data_allocated);
+    if (!decoder->ctx->raw_data) {
         IMG_AnimationDecoderClose_Internal(decoder);
         return false;
     }
@@ -1125,6 +1232,12 @@ SDL_Surface *IMG_LoadWEBP_IO(SDL_IOStream *src)
     return NULL;
 }
 
+SDL_Surface *IMG_LoadWEBPWithOptions_IO(SDL_IOStream *src, IMG_LoadOptions *options)
+{
+    SDL_SetError("SDL_image built without WEBP support");
+    return NULL;
+}
+
 bool IMG_CreateWEBPAnimationDecoder(IMG_AnimationDecoder *decoder, SDL_PropertiesID props)
 {
     return SDL_SetError("SDL_image built without WEBP support");
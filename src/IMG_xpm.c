@@ -911,16 +911,20 @@ static int color_to_argb(char *spec, int speclen, Uint32 *argb)
     }
 }
 
-static char *linebuf;
-static size_t buflen;
-static char *error;
+/* The state of a single load, so images can be loaded on several threads at once */
+typedef struct
+{
+    char *linebuf;
+    size_t buflen;
+    char *error;
+} xpm_reader;
 
 /*
  * Read next line from the source.
  * If len > 0, it's assumed to be at least len chars (for efficiency).
  * Return NULL and set error upon EOF or parse error.
  */
-static char *get_next_line(char ***lines, SDL_IOStream *src, size_t len)
+static char *get_next_line(xpm_reader *reader, char ***lines, SDL_IOStream *src, size_t len)
 {
     char *linebufnew;
 
@@ -931,51 +935,51 @@ static char *get_next_line(char ***lines, SDL_IOStream *src, size_t len)
         size_t n;
         do {
             if (SDL_ReadIO(src, &c, 1) != 1) {
-                error = "Premature end of data";
+                reader->error = "Premature end of data";
                 return NULL;
             }
         } while (c != '"');
         if (len) {
             len += 3;   /* "\",\n" */
-            if (len > buflen){
-                buflen = len;
-                linebufnew = (char *)SDL_realloc(linebuf, buflen);
+            if (len > reader->buflen){
+                reader->buflen = len;
+                linebufnew = (char *)SDL_realloc(reader->linebuf, reader->buflen);
                 if (!linebufnew) {
-                    SDL_free(linebuf);
-                    error = "Out of memory";
+                    SDL_free(reader->linebuf);
+                    reader->error = "Out of memory";
                     return NULL;
                 }
-                linebuf = linebufnew;
+                reader->linebuf = linebufnew;
             }
-            if (SDL_ReadIO(src, linebuf, len) != len) {
-                error = "Premature end of data";
+            if (SDL_ReadIO(src, reader->linebuf, len) != len) {
+                reader->error = "Premature end of data";
                 return NULL;
             }
             n = len - 1;
         } else {
             n = 0;
             do {
-                if (n >= buflen) {
-                    if (buflen == 0)
-                        buflen = 16;
-                    buflen *= 2;
-                    linebufnew = (char *)SDL_realloc(linebuf, buflen);
+                if (n >= reader->buflen) {
+                    if (reader->buflen == 0)
+                        reader->buflen = 16;
+                    reader->buflen *= 2;
+                    linebufnew = (char *)SDL_realloc(reader->linebuf, reader->buflen);
                     if (!linebufnew) {
-                        SDL_free(linebuf);
-                        error = "Out of memory";
+                        SDL_free(reader->linebuf);
+                        reader->error = "Out of memory";
                         return NULL;
                     }
-                    linebuf = linebufnew;
+                    reader->linebuf = linebufnew;
                 }
-                if (SDL_ReadIO(src, linebuf + n, 1) != 1) {
-                    error = "Premature end of data";
+                if (SDL_ReadIO(src, reader->linebuf + n, 1) != 1) {
+                    reader->error = "Premature end of data";
                     return NULL;
                 }
-            } while (linebuf[n++] != '"');
+            } while (reader->linebuf[n++] != '"');
             n--;
         }
-        linebuf[n] = '\0';
-        return linebuf;
+        reader->linebuf[n] = '\0';
+        return reader->linebuf;
     }
 }
 
@@ -1007,10 +1011,9 @@ static SDL_Surface *load_xpm(char **xpm, SDL_IOStream *src, bool force_32bit)
     char *line;
     char ***xpmlines = NULL;
     size_t pixels_len;
+    xpm_reader reader;
 
-    error = NULL;
-    linebuf = NULL;
-    buflen = 0;
+    SDL_zero(reader);
 
     if (src)
         start = SDL_TellIO(src);
@@ -1018,7 +1021,7 @@ static SDL_Surface *load_xpm(char **xpm, SDL_IOStream *src, bool force_32bit)
     if (xpm)
         xpmlines = &xpm;
 
-    line = get_next_line(xpmlines, src, 0);
+    line = get_next_line(&reader, xpmlines, src, 0);
     if (!line)
         goto done;
     /*
@@ -1032,18 +1035,18 @@ static SDL_Surface *load_xpm(char **xpm, SDL_IOStream *src, bool force_32bit)
      */
     if (SDL_sscanf(line, "%d %d %d %d", &w, &h, &ncolors, &cpp) != 4
        || w <= 0 || h <= 0 || ncolors <= 0 || cpp <= 0) {
-        error = "Invalid format description";
+        reader.error = "Invalid format description";
         goto done;
     }
 
     /* Check for allocation overflow */
     if ((size_t)((Uint32)ncolors * cpp)/cpp != (Uint32)ncolors) {
-        error = "Invalid color specification";
+        reader.error = "Invalid color specification";
         goto done;
     }
     keystrings = (char *)SDL_malloc(ncolors * cpp);
     if (!keystrings) {
-        error = "Out of memory";
+        reader.error = "Out of memory";
         goto done;
     }
     nextkey = keystrings;
@@ -1055,7 +1058,7 @@ static SDL_Surface *load_xpm(char **xpm, SDL_IOStream *src, bool force_32bit)
         if (image) {
             SDL_Palette *palette = SDL_CreateSurfacePalette(image);
             if (!palette) {
-                error = "Couldn't create palette";
+                reader.error = "Couldn't create palette";
                 goto done;
             }
             if (ncolors > palette->ncolors) {
@@ -1076,12 +1079,12 @@ static SDL_Surface *load_xpm(char **xpm, SDL_IOStream *src, bool force_32bit)
     /* Read the colors */
     colors = create_colorhash(ncolors);
     if (!colors) {
-        error = "Out of memory";
+        reader.error = "Out of memory";
         goto done;
     }
     for (index = 0; index < ncolors; ++index ) {
         char *p;
-        line = get_next_line(xpmlines, src, 0);
+        line = get_next_line(&reader, xpmlines, src, 0);
         if (!line)
             goto done;
 
@@ -1095,7 +1098,7 @@ static SDL_Surface *load_xpm(char **xpm, SDL_IOStream *src, bool force_32bit)
 
             SKIPSPACE(p);
             if (!*p) {
-                error = "colour parse error";
+                reader.error = "colour parse error";
                 goto done;
             }
             nametype = *p;
@@ -1133,7 +1136,7 @@ static SDL_Surface *load_xpm(char **xpm, SDL_IOStream *src, bool force_32bit)
     pixels_len = w * cpp;
     dst = (Uint8 *)image->pixels;
     for (y = 0; y < h; y++) {
-        line = get_next_line(xpmlines, src, pixels_len);
+        line = get_next_line(&reader, xpmlines, src, pixels_len);
         if (!line)
             goto done;
 
@@ -1160,20 +1163,20 @@ static SDL_Surface *load_xpm(char **xpm, SDL_IOStream *src, bool force_32bit)
     }
 
 done:
-    if (error) {
+    if (reader.error) {
         if ( src )
             SDL_SeekIO(src, start, SDL_IO_SEEK_SET);
         if ( image ) {
             SDL_DestroySurface(image);
             image = NULL;
         }
-        SDL_SetError("%s", error);
+        SDL_SetError("%s", reader.error);
     }
     if (keystrings)
         SDL_free(keystrings);
     free_colorhash(colors);
-    if (linebuf)
-        SDL_free(linebuf);
+    if (reader.linebuf)
+        SDL_free(reader.linebuf);
     return image;
 }
 
@@ -870,6 +870,59 @@ static int SDLCALL testDecodeThirdPartyMetadata(void *args)
     return TEST_COMPLETED;
 }
 
+static int SDLCALL testLoadAnimationFile(void *args)
+{
+    (void)args;
+    SDLTest_Log("Starting test 'Load Animation File Test'");
+
+    for (size_t i = 0; i < SDL_arraysize(inputImages); ++i) {
+        if (!FormatAnimationEnabled(inputImages[i].format)) {
+            SDLTest_Log("animation format %s disabled (input)", inputImages[i].format);
+            continue;
+        }
+
+        char *inputImagePath = GetTestFilename(inputImages[i].filename);
+        if (!inputImagePath) {
+            return TEST_ABORTED;
+        }
+
+        // IMG_LoadAnimation() maps the file, so compare it with a decoder that reads it
+        IMG_Animation *anim = IMG_LoadAnimation(inputImagePath);
+        SDLTest_AssertCheck(anim != NULL, "IMG_LoadAnimation(\"%s\"): %s", inputImagePath, anim ? "ok" : SDL_GetError());
+
+        SDL_PropertiesID props = SDL_CreateProperties();
+        SDL_SetStringProperty(props, IMG_PROP_ANIMATION_DECODER_CREATE_FILENAME_STRING, inputImagePath);
+        SDL_SetBooleanProperty(props, IMG_PROP_ANIMATION_DECODER_CREATE_MAP_FILE_BOOLEAN, false);
+        IMG_AnimationDecoder *decoder = IMG_CreateAnimationDecoderWithProperties(props);
+        SDL_DestroyProperties(props);
+        SDLTest_AssertCheck(decoder != NULL, "IMG_CreateAnimationDecoderWithProperties(<map_file false>): %s", decoder ? "ok" : SDL_GetError());
+
+        if (anim && decoder) {
+            int count = 0;
+            SDL_Surface *frame = NULL;
+
+            while (IMG_GetAnimationDecoderFrame(decoder, &frame, NULL) && frame) {
+                SDLTest_AssertCheck(frame->w == anim->w && frame->h == anim->h, "Frame %d should be %dx%d, got %dx%d",
+                                    count, anim->w, anim->h, frame->w, frame->h);
+                SDL_DestroySurface(frame);
+                frame = NULL;
+                ++count;
+            }
+            SDLTest_AssertCheck(count == anim->count, "Decoder should read %d frames from %s, got %d", anim->count, inputImagePath, count);
+        }
+        if (decoder) {
+            IMG_CloseAnimationDecoder(decoder);
+        }
+        if (anim) {
+            IMG_FreeAnimation(anim);
+        }
+        SDL_free(inputImagePath);
+    }
+
+    SDLTest_Log("Finished test 'Load Animation File Test'.");
+    return TEST_COMPLETED;
+}
+
 static const SDLTest_TestCaseReference decodeEncodeAnimations = {
     testDecodeEncode, "decode_encode_animation", "Animation Decoder/Encoder Tests -- Decode, encode decoded frames then decode again to compare...", TEST_ENABLED
 };
@@ -886,11 +939,16 @@ static const SDLTest_TestCaseReference decodeThirdPartyMetadata = {
     testDecodeThirdPartyMetadata, "animation_decodeThirdPartyMetadata", "Decode Third Party Metadata", TEST_ENABLED
 };
 
+static const SDLTest_TestCaseReference loadAnimationFile = {
+    testLoadAnimationFile, "animation_loadFile", "Load animations from files, mapped and read", TEST_ENABLED
+};
+
 static const SDLTest_TestCaseReference *animationTests[] = {
     &decodeEncodeAnimations,
     &decoderRewindAnimations,
     &animationMetadata,
     &decodeThirdPartyMetadata,
+    &loadAnimationFile,
     NULL
 };
 
@@ -30,6 +30,21 @@ static const char pathsep[] = "/";
 # define USING_IMAGEIO 0
 #endif
 
+/* The same choice of JPEG backend as IMG_jpg.c */
+#if defined(USE_STBIMAGE) || (!defined(SDL_IMAGE_USE_COMMON_BACKEND) && \
+    (defined(SDL_IMAGE_USE_WIC_BACKEND) || (USING_IMAGEIO && defined(JPG_USES_IMAGEIO))))
+# define USING_LIBJPEG 0
+#else
+# define USING_LIBJPEG 1
+#endif
+
+/* The TIFF loader that orients images as they are decoded */
+#if defined(LOAD_TIF) && !USING_IMAGEIO && !defined(SDL_IMAGE_USE_WIC_BACKEND)
+# define USING_LIBTIFF 1
+#else
+# define USING_LIBTIFF 0
+#endif
+
 typedef enum
 {
     TEST_FILE_DIST,
@@ -502,6 +517,29 @@ StrHasSuffix(const char *str, const char *suffix)
             && SDL_strcmp(str + (str_len - suffix_len), suffix) == 0);
 }
 
+/* Read through to another stream without being able to seek, like a pipe */
+static size_t SDLCALL
+NonSeekableRead(void *userdata, void *ptr, size_t size, SDL_IOStatus *status)
+{
+    SDL_IOStream *src = (SDL_IOStream *)userdata;
+    size_t amount = SDL_ReadIO(src, ptr, size);
+
+    if (amount < size) {
+        *status = SDL_GetIOStatus(src);
+    }
+    return amount;
+}
+
+static SDL_IOStream *
+OpenNonSeekableIO(SDL_IOStream *src)
+{
+    SDL_IOStreamInterface iface;
+
+    SDL_INIT_INTERFACE(&iface);
+    iface.read = NonSeekableRead;
+    return SDL_OpenIO(&iface, src);
+}
+
 typedef enum
 {
     LOAD_CONVENIENCE = 0,
@@ -716,6 +754,119 @@ FormatLoadTest(const Format *format,
                 SDLTest_AssertCheck(check,
                                     "Should detect %s as %s -> %d",
                                     filename, format->name, check);
+
+                SDLTest_AssertPass("About to call IMG_DetectFormat_IO(<src>)");
+                const char *detected = IMG_DetectFormat_IO(src);
+
+                SDLTest_AssertCheck(detected && SDL_strncmp(format->name, detected, SDL_strlen(detected)) == 0,
+                                    "Should detect %s as %s -> %s",
+                                    filename, format->name, detected ? detected : "(null)");
+
+                if (SDL_strcmp(format->name, "SVG-sized") != 0) {
+                    SDLTest_AssertPass("About to call IMG_GetImageInfo_IO(<src>, false)");
+                    SDL_PropertiesID info = IMG_GetImageInfo_IO(src, false);
+
+                    SDLTest_AssertCheck(info != 0,
+                                        "Should get image info for %s -> %s",
+                                        filename, info ? "ok" : SDL_GetError());
+                    SDLTest_AssertCheck(SDL_GetNumberProperty(info, IMG_PROP_IMAGE_INFO_WIDTH_NUMBER, 0) == format->w &&
+                                        SDL_GetNumberProperty(info, IMG_PROP_IMAGE_INFO_HEIGHT_NUMBER, 0) == format->h,
+                                        "Image info size should be %dx%d -> %dx%d",
+                                        format->w, format->h,
+                                        (int)SDL_GetNumberProperty(info, IMG_PROP_IMAGE_INFO_WIDTH_NUMBER, 0),
+                                        (int)SDL_GetNumberProperty(info, IMG_PROP_IMAGE_INFO_HEIGHT_NUMBER, 0));
+                    SDL_DestroyProperties(info);
+
+                    int max_w = SDL_max(format->w / 2, 1);
+                    int max_h = SDL_max(format->h / 2, 1);
+                    Sint64 start = SDL_TellIO(src);
+                    SDLTest_AssertPass("About to call IMG_LoadScaled_IO(<src>, false, %d, %d)", max_w, max_h);
+                    SDL_Surface *scaled = IMG_LoadScaled_IO(src, false, max_w, max_h);
+
+                    SDLTest_AssertCheck(scaled != NULL,
+                                        "Should load scaled %s -> %s",
+                                        filename, scaled ? "ok" : SDL_GetError());
+                    if (scaled) {
+                        SDLTest_AssertCheck(scaled->w <= max_w && scaled->h <= max_h &&
+                                            (scaled->w == max_w || scaled->h == max_h),
+                                            "Scaled image should fit %dx%d -> %dx%d",
+                                            max_w, max_h, scaled->w, scaled->h);
+                        SDL_DestroySurface(scaled);
+                    }
+                    SDL_SeekIO(src, start, SDL_IO_SEEK_SET);
+
+                    SDL_PropertiesID props = SDL_CreateProperties();
+                    SDL_SetPointerProperty(props, IMG_PROP_LOAD_IOSTREAM_POINTER, src);
+                    SDL_SetNumberProperty(props, IMG_PROP_LOAD_CROP_X_NUMBER, format->w / 4);
+                    SDL_SetNumberProperty(props, IMG_PROP_LOAD_CROP_Y_NUMBER, format->h / 4);
+                    SDL_SetNumberProperty(props, IMG_PROP_LOAD_CROP_WIDTH_NUMBER, max_w);
+                    SDL_SetNumberProperty(props, IMG_PROP_LOAD_CROP_HEIGHT_NUMBER, max_h);
+                    SDL_SetNumberProperty(props, IMG_PROP_LOAD_FORMAT_NUMBER, SDL_PIXELFORMAT_BGRA32);
+                    SDLTest_AssertPass("About to call IMG_LoadWithProperties(<crop %dx%d>)", max_w, max_h);
+                    SDL_Surface *cropped = IMG_LoadWithProperties(props);
+
+                    SDLTest_AssertCheck(cropped != NULL,
+                                        "Should load cropped %s -> %s",
+                                        filename, cropped ? "ok" : SDL_GetError());
+                    if (cropped) {
+                        SDLTest_AssertCheck(cropped->w == max_w && cropped->h == max_h,
+                                            "Cropped image should be %dx%d -> %dx%d",
+                                            max_w, max_h, cropped->w, cropped->h);
+                        SDLTest_AssertCheck(cropped->format == SDL_PIXELFORMAT_BGRA32,
+                                            "Cropped image should be %s -> %s",
+                                            SDL_GetPixelFormatName(SDL_PIXELFORMAT_BGRA32),
+                                            SDL_GetPixelFormatName(cropped->format));
+                        SDL_DestroySurface(cropped);
+                    }
+                    SDL_DestroyProperties(props);
+                    SDL_SeekIO(src, start, SDL_IO_SEEK_SET);
+
+                    SDL_Surface *into = SDL_CreateSurface(format->w, format->h, SDL_PIXELFORMAT_RGBA32);
+                    SDLTest_AssertCheck(into != NULL,
+                                        "SDL_CreateSurface(%d, %d) -> %s",
+                                        format->w, format->h, into ? "ok" : SDL_GetError());
+                    if (into) {
+                        void *pixels = into->pixels;
+
+                        SDLTest_AssertPass("About to call IMG_LoadInto_IO(<src>, false, <%dx%d>)", into->w, into->h);
+                        bool loaded = IMG_LoadInto_IO(src, false, into);
+                        SDLTest_AssertCheck(loaded, "Should load %s into surface -> %s",
+                                            filename, loaded ? "ok" : SDL_GetError());
+                        SDLTest_AssertCheck(into->pixels == pixels && into->refcount == 1,
+                                            "Destination surface should keep its pixels and refcount");
+                        SDL_DestroySurface(into);
+                        SDL_SeekIO(src, start, SDL_IO_SEEK_SET);
+
+                        into = SDL_CreateSurface(format->w + 1, format->h, SDL_PIXELFORMAT_RGBA32);
+                        if (into) {
+                            SDLTest_AssertPass("About to call IMG_LoadInto_IO(<src>, false, <%dx%d>)", into->w, into->h);
+                            loaded = IMG_LoadInto_IO(src, false, into);
+                            SDLTest_AssertCheck(!loaded, "Should fail to load %s into a surface of the wrong size",
+                                                filename);
+                            SDL_DestroySurface(into);
+                            SDL_SeekIO(src, start, SDL_IO_SEEK_SET);
+                        }
+                    }
+
+                    SDL_IOStream *pipe = OpenNonSeekableIO(src);
+                    SDLTest_AssertCheck(pipe != NULL,
+                                        "SDL_OpenIO(<non-seekable>) -> %s",
+                                        pipe ? "ok" : SDL_GetError());
+                    if (pipe) {
+                        SDLTest_AssertPass("About to call IMG_Load_IO(<non-seekable>, true)");
+                        SDL_Surface *streamed = IMG_Load_IO(pipe, true);
+                        SDLTest_AssertCheck(streamed != NULL,
+                                            "Should load %s from a non-seekable stream -> %s",
+                                            filename, streamed ? "ok" : SDL_GetError());
+                        if (streamed) {
+                            SDLTest_AssertCheck(streamed->w == format->w && streamed->h == format->h,
+                                                "Streamed image should be %dx%d -> %dx%d",
+                                                format->w, format->h, streamed->w, streamed->h);
+                            SDL_DestroySurface(streamed);
+                        }
+                        SDL_SeekIO(src, start, SDL_IO_SEEK_SET);
+                    }
+                }
             }
 
             SDL_ClearError();
@@ -979,12 +1130,1810 @@ TestFormats(void *arg)
     return TEST_COMPLETED;
 }
 
-static const SDLTest_TestCaseReference formatsTestCase = {
-    TestFormats, "Images", "Load and save various image formats", TEST_ENABLED
+static int SDLCALL
+TestBatch(void *arg)
+{
+    const Format *batchFormats[SDL_arraysize(formats)];
+    char *files[SDL_arraysize(formats)];
+    SDL_Surface *surfaces[SDL_arraysize(formats)];
+    char *errors[SDL_arraysize(formats)];
+    SDL_PropertiesID props;
+    int count = 0;
+    int i;
+    (void)arg;
+
+    for (i = 0; i < (int)SDL_arraysize(formats); i++) {
+        if (formats[i].canLoad && SDL_strcmp(formats[i].name, "SVG-sized") != 0) {
+            batchFormats[count] = &formats[i];
+            files[count] = GetTestFilename(TEST_FILE_DIST, formats[i].sample);
+            count++;
+        }
+    }
+
+    props = SDL_CreateProperties();
+    SDL_SetNumberProperty(props, IMG_PROP_LOAD_BATCH_THREAD_COUNT_NUMBER, 4);
+    SDLTest_AssertPass("About to call IMG_LoadBatch(<%d files>)", count);
+    bool loaded = IMG_LoadBatch((const char * const *)files, NULL, count, surfaces, errors, props);
+    SDLTest_AssertCheck(loaded, "Should load every image -> %s", loaded ? "ok" : SDL_GetError());
+
+    for (i = 0; i < count; i++) {
+        const Format *format = batchFormats[i];
+
+        SDLTest_AssertCheck(surfaces[i] != NULL,
+                            "Load %s in a batch (%s)", files[i], errors[i] ? errors[i] : "ok");
+        if (surfaces[i]) {
+            SDLTest_AssertCheck(surfaces[i]->w == format->w && surfaces[i]->h == format->h,
+                                "Expected %dx%d px, got %dx%d",
+                                format->w, format->h, surfaces[i]->w, surfaces[i]->h);
+            SDL_DestroySurface(surfaces[i]);
+        }
+        SDL_free(errors[i]);
+        SDL_free(files[i]);
+    }
+    SDL_DestroyProperties(props);
+
+    return TEST_COMPLETED;
+}
+
+/* A stream that returns at most a few bytes from each read, like a pipe or socket */
+typedef struct
+{
+    const Uint8 *data;
+    size_t size;
+    size_t offset;
+} TrickleStream;
+
+static Sint64 SDLCALL
+TrickleSize(void *userdata)
+{
+    return (Sint64)((TrickleStream *)userdata)->size;
+}
+
+static Sint64 SDLCALL
+TrickleSeek(void *userdata, Sint64 offset, SDL_IOWhence whence)
+{
+    TrickleStream *stream = (TrickleStream *)userdata;
+
+    if (whence == SDL_IO_SEEK_CUR) {
+        offset += (Sint64)stream->offset;
+    } else if (whence == SDL_IO_SEEK_END) {
+        offset += (Sint64)stream->size;
+    }
+    if (offset < 0 || offset > (Sint64)stream->size) {
+        return -1;
+    }
+    stream->offset = (size_t)offset;
+    return offset;
+}
+
+static size_t SDLCALL
+TrickleRead(void *userdata, void *ptr, size_t size, SDL_IOStatus *status)
+{
+    TrickleStream *stream = (TrickleStream *)userdata;
+
+    size = SDL_min(size, SDL_min(stream->size - stream->offset, 7));
+    if (size == 0) {
+        *status = SDL_IO_STATUS_EOF;
+        return 0;
+    }
+    SDL_memcpy(ptr, stream->data + stream->offset, size);
+    stream->offset += size;
+    return size;
+}
+
+static int SDLCALL
+TestDetectShortReads(void *arg)
+{
+    int i;
+    (void)arg;
+
+    for (i = 0; i < (int)SDL_arraysize(formats); i++) {
+        const Format *format = &formats[i];
+        SDL_IOStreamInterface iface;
+        TrickleStream trickle;
+        SDL_IOStream *src;
+        const char *expected, *detected;
+        char *filename;
+        void *data;
+        size_t size;
+
+        if (!format->canLoad || SDL_strcmp(format->name, "SVG-sized") == 0) {
+            continue;
+        }
+        filename = GetTestFilename(TEST_FILE_DIST, format->sample);
+        data = filename ? SDL_LoadFile(filename, &size) : NULL;
+        SDL_free(filename);
+        if (!SDLTest_AssertCheck(data != NULL, "Loading %s should succeed (%s)", format->sample, SDL_GetError())) {
+            continue;
+        }
+
+        src = SDL_IOFromConstMem(data, size);
+        expected = IMG_DetectFormat_IO(src);
+        SDL_CloseIO(src);
+
+        SDL_zero(trickle);
+        trickle.data = (const Uint8 *)data;
+        trickle.size = size;
+        SDL_INIT_INTERFACE(&iface);
+        iface.size = TrickleSize;
+        iface.seek = TrickleSeek;
+        iface.read = TrickleRead;
+        src = SDL_OpenIO(&iface, &trickle);
+        if (src) {
+            SDLTest_AssertPass("About to call IMG_DetectFormat_IO(<%s in short reads>)", format->sample);
+            detected = IMG_DetectFormat_IO(src);
+            SDLTest_AssertCheck((!expected && !detected) || (expected && detected && SDL_strcmp(expected, detected) == 0),
+                                "%s should be detected as %s with short reads, got %s",
+                                format->sample, expected ? expected : "(null)", detected ? detected : "(null)");
+            SDL_CloseIO(src);
+        }
+        SDL_free(data);
+    }
+
+    return TEST_COMPLETED;
+}
+
+static int SDLCALL
+TestImageInfoTruncatedXV(void *arg)
+{
+    /* An XV header whose comments run past the detection window */
+    const size_t size = 8192;
+    Uint8 *data = (Uint8 *)SDL_malloc(size);
+    SDL_PropertiesID info;
+    size_t i;
+    (void)arg;
+
+    if (!SDLTest_AssertCheck(data != NULL, "Allocating test data should succeed")) {
+        return TEST_ABORTED;
+    }
+    SDL_memcpy(data, "P7 332\n", 7);
+    for (i = 7; i < size; i++) {
+        data[i] = ((i % 16) == 15) ? '\n' : '#';
+    }
+
+    SDLTest_AssertPass("About to call IMG_GetImageInfo_IO(<XV without #END_OF_COMMENTS>, true)");
+    info = IMG_GetImageInfo_IO(SDL_IOFromConstMem(data, size), true);
+    SDLTest_AssertCheck(info == 0, "An XV header without the end of the comments should fail");
+    if (info) {
+        SDL_DestroyProperties(info);
+    }
+    SDL_free(data);
+    return TEST_COMPLETED;
+}
+
+/* Create a little-endian TIFF with a chain of tiny 16x8 pages */
+static Uint8 *CreateMultiPageTIFF(int pages, size_t *size)
+{
+    const size_t ifd_size = 2 + 2 * 12 + 4;
+    Uint8 *data;
+    int i;
+
+    *size = 8 + pages * ifd_size;
+    data = (Uint8 *)SDL_calloc(1, *size);
+    if (!data) {
+        return NULL;
+    }
+    SDL_memcpy(data, "II\x2a\0\x08\0\0\0", 8);
+    for (i = 0; i < pages; i++) {
+        Uint8 *ifd = &data[8 + i * ifd_size];
+        Uint32 next = (i + 1 < pages) ? (Uint32)(8 + (i + 1) * ifd_size) : 0;
+
+        ifd[0] = 2;
+        ifd[2] = 0x00; ifd[3] = 0x01; /* ImageWidth */
+        ifd[4] = 3; /* SHORT */
+        ifd[6] = 1;
+        ifd[10] = 16;
+        ifd[14] = 0x01; ifd[15] = 0x01; /* ImageLength */
+        ifd[16] = 3;
+        ifd[18] = 1;
+        ifd[22] = 8;
+        ifd[26] = (Uint8)next;
+        ifd[27] = (Uint8)(next >> 8);
+        ifd[28] = (Uint8)(next >> 16);
+        ifd[29] = (Uint8)(next >> 24);
+    }
+    return data;
+}
+
+static int SDLCALL
+TestImageInfoFrames(void *arg)
+{
+    static const struct {
+        const char *sample;
+        bool animated;
+        int frames;
+    } samples[] = {
+        { "rgbrgb.gif", true, 6 },
+        { "rgbrgb.png", true, 6 },
+        { "rgbrgb.webp", true, 6 },
+        { "sample.png", false, 0 },
+    };
+    static const struct {
+        int pages;
+        int expected;
+    } tiffs[] = {
+        { 3, 3 },
+        { 1000, 0 },    /* too many pages to count without reading most of the file */
+    };
+    SDL_PropertiesID info;
+    int i;
+    (void)arg;
+
+    for (i = 0; i < (int)SDL_arraysize(samples); i++) {
+        char *filename = GetTestFilename(TEST_FILE_DIST, samples[i].sample);
+
+        SDLTest_AssertPass("About to call IMG_GetImageInfo_IO(\"%s\", true)", filename);
+        info = IMG_GetImageInfo_IO(SDL_IOFromFile(filename, "rb"), true);
+        SDLTest_AssertCheck(info != 0, "Should get image info for %s -> %s", filename, info ? "ok" : SDL_GetError());
+        if (info) {
+            bool animated = SDL_GetBooleanProperty(info, IMG_PROP_IMAGE_INFO_ANIMATED_BOOLEAN, false);
+            int frames = (int)SDL_GetNumberProperty(info, IMG_PROP_IMAGE_INFO_FRAME_COUNT_NUMBER, 0);
+
+            SDLTest_AssertCheck(animated == samples[i].animated, "%s should%s be animated",
+                                filename, samples[i].animated ? "" : " not");
+            SDLTest_AssertCheck(frames == samples[i].frames, "Expected %d frames in %s, got %d",
+                                samples[i].frames, filename, frames);
+            SDL_DestroyProperties(info);
+        }
+        SDL_free(filename);
+    }
+
+    for (i = 0; i < (int)SDL_arraysize(tiffs); i++) {
+        size_t size;
+        Uint8 *data = CreateMultiPageTIFF(tiffs[i].pages, &size);
+
+        if (!SDLTest_AssertCheck(data != NULL, "Creating a %d page TIFF should succeed", tiffs[i].pages)) {
+            return TEST_ABORTED;
+        }
+        SDLTest_AssertPass("About to call IMG_GetImageInfo_IO(<%d page TIFF>, true)", tiffs[i].pages);
+        info = IMG_GetImageInfo_IO(SDL_IOFromConstMem(data, size), true);
+        SDLTest_AssertCheck(info != 0, "Should get image info -> %s", info ? "ok" : SDL_GetError());
+        if (info) {
+            int frames = (int)SDL_GetNumberProperty(info, IMG_PROP_IMAGE_INFO_FRAME_COUNT_NUMBER, 0);
+
+            SDLTest_AssertCheck(SDL_GetNumberProperty(info, IMG_PROP_IMAGE_INFO_WIDTH_NUMBER, 0) == 16 &&
+                                SDL_GetNumberProperty(info, IMG_PROP_IMAGE_INFO_HEIGHT_NUMBER, 0) == 8,
+                                "Image info size should be 16x8");
+            SDLTest_AssertCheck(frames == tiffs[i].expected, "Expected a page count of %d, got %d",
+                                tiffs[i].expected, frames);
+            SDL_DestroyProperties(info);
+        }
+        SDL_free(data);
+    }
+    return TEST_COMPLETED;
+}
+
+static int SDLCALL
+TestLoadMapFile(void *arg)
+{
+    char *filename;
+    SDL_Surface *expected;
+    int i;
+    (void)arg;
+
+    filename = GetTestFilename(TEST_FILE_DIST, "sample.bmp");
+    expected = filename ? IMG_Load(filename) : NULL;
+    if (!SDLTest_AssertCheck(expected != NULL, "Loading %s should succeed (%s)", filename, SDL_GetError())) {
+        SDL_free(filename);
+        return TEST_ABORTED;
+    }
+
+    for (i = 0; i < 2; i++) {
+        const bool map = (i == 0);
+        SDL_PropertiesID props = SDL_CreateProperties();
+        SDL_Surface *surface;
+
+        SDL_SetStringProperty(props, IMG_PROP_LOAD_FILENAME_STRING, filename);
+        SDL_SetBooleanProperty(props, IMG_PROP_LOAD_MAP_FILE_BOOLEAN, map);
+        SDLTest_AssertPass("About to call IMG_LoadWithProperties(<\"%s\", map file %s>)", filename, map ? "true" : "false");
+        surface = IMG_LoadWithProperties(props);
+        SDLTest_AssertCheck(surface != NULL, "Load %s (%s)", filename, surface ? "ok" : SDL_GetError());
+        if (surface) {
+            int diff = SDLTest_CompareSurfaces(surface, expected, 0);
+
+            SDLTest_AssertCheck(diff == 0, "Image should match IMG_Load() (%d)", diff);
+            SDL_DestroySurface(surface);
+        }
+        SDL_DestroyProperties(props);
+    }
+
+    SDL_DestroySurface(expected);
+    SDL_free(filename);
+    return TEST_COMPLETED;
+}
+
+static void SDLCALL
+AsyncLoadCallback(void *userdata, SDL_Surface *surface)
+{
+    SDL_SetAtomicPointer((void **)userdata, surface);
+}
+
+static int SDLCALL
+TestAsync(void *arg)
+{
+    SDL_Surface *surface;
+    IMG_AsyncLoad *load;
+    int i;
+    (void)arg;
+
+    for (i = 0; i < (int)SDL_arraysize(formats); i++) {
+        const Format *format = &formats[i];
+        void *callbackSurface = NULL;
+        char *filename;
+
+        if (!format->canLoad || SDL_strcmp(format->name, "SVG-sized") == 0) {
+            continue;
+        }
+        filename = GetTestFilename(TEST_FILE_DIST, format->sample);
+
+        SDLTest_AssertPass("About to call IMG_LoadAsync(\"%s\", NULL, NULL)", filename);
+        load = IMG_LoadAsync(filename, NULL, NULL);
+        SDLTest_AssertCheck(load != NULL, "IMG_LoadAsync -> %s", load ? "ok" : SDL_GetError());
+        if (load) {
+            surface = IMG_WaitAsyncLoad(load);
+            SDLTest_AssertCheck(surface != NULL, "Load %s asynchronously (%s)",
+                                filename, surface ? "ok" : SDL_GetError());
+            if (surface) {
+                SDLTest_AssertCheck(surface->w == format->w && surface->h == format->h,
+                                    "Expected %dx%d px, got %dx%d",
+                                    format->w, format->h, surface->w, surface->h);
+                SDL_DestroySurface(surface);
+            }
+        }
+
+        SDLTest_AssertPass("About to call IMG_LoadAsync(\"%s\", callback, userdata)", filename);
+        load = IMG_LoadAsync(filename, AsyncLoadCallback, &callbackSurface);
+        SDLTest_AssertCheck(load != NULL, "IMG_LoadAsync -> %s", load ? "ok" : SDL_GetError());
+        if (load) {
+            surface = IMG_WaitAsyncLoad(load);
+            SDLTest_AssertCheck(surface == NULL, "Surface should go to the callback");
+            surface = (SDL_Surface *)SDL_GetAtomicPointer(&callbackSurface);
+            SDLTest_AssertCheck(surface != NULL, "Callback should receive %s", filename);
+            SDL_DestroySurface(surface);
+        }
+
+        SDLTest_AssertPass("About to cancel IMG_LoadAsync(\"%s\")", filename);
+        load = IMG_LoadAsync(filename, NULL, NULL);
+        if (load) {
+            IMG_CancelAsyncLoad(load);
+            /* The load may finish before it sees the cancellation */
+            SDL_DestroySurface(IMG_WaitAsyncLoad(load));
+        }
+        SDL_free(filename);
+    }
+
+    SDLTest_AssertPass("About to call IMG_LoadAsync() on a missing file");
+    load = IMG_LoadAsync("does-not-exist.png", NULL, NULL);
+    SDLTest_AssertCheck(load != NULL, "IMG_LoadAsync -> %s", load ? "ok" : SDL_GetError());
+    if (load) {
+        SDL_ClearError();
+        surface = IMG_WaitAsyncLoad(load);
+        SDLTest_AssertCheck(surface == NULL, "Loading a missing file should fail");
+        SDLTest_AssertCheck(*SDL_GetError() != '\0', "IMG_WaitAsyncLoad should report the error from the load thread");
+        SDL_DestroySurface(surface);
+    }
+
+#ifdef LOAD_BMP
+    {
+        /* More loads than the pool has threads, so some of them have to wait in the queue */
+        IMG_AsyncLoad *loads[16];
+        char *filename = GetTestFilename(TEST_FILE_DIST, "sample.bmp");
+        int loaded = 0;
+
+        SDLTest_AssertPass("About to queue %d loads of \"%s\"", (int)SDL_arraysize(loads), filename);
+        for (i = 0; i < (int)SDL_arraysize(loads); i++) {
+            loads[i] = IMG_LoadAsync(filename, NULL, NULL);
+        }
+        for (i = 0; i < (int)SDL_arraysize(loads); i++) {
+            if (loads[i]) {
+                surface = IMG_WaitAsyncLoad(loads[i]);
+                if (surface) {
+                    ++loaded;
+                    SDL_DestroySurface(surface);
+                }
+            }
+        }
+        SDLTest_AssertCheck(loaded == (int)SDL_arraysize(loads), "Expected %d queued loads to succeed, got %d",
+                            (int)SDL_arraysize(loads), loaded);
+        SDL_free(filename);
+    }
+#endif
+
+    return TEST_COMPLETED;
+}
+
+static int SDLCALL
+TestSaveJPGWithProperties(void *arg)
+{
+#if defined(SAVE_JPG) && SAVE_JPG
+    static const char *subsamplings[] = { "4:4:4", "4:2:2", "4:2:0" };
+    char *refFilename;
+    SDL_Surface *reference;
+    int i;
+    (void)arg;
+
+    refFilename = GetTestFilename(TEST_FILE_DIST, "sample.bmp");
+    reference = refFilename ? SDL_LoadBMP(refFilename) : NULL;
+    if (!SDLTest_AssertCheck(reference != NULL, "Loading reference should succeed (%s)", SDL_GetError())) {
+        SDL_free(refFilename);
+        return TEST_ABORTED;
+    }
+
+    for (i = 0; i < (int)SDL_arraysize(subsamplings); i++) {
+        SDL_IOStream *dest = SDL_IOFromDynamicMem();
+        SDL_PropertiesID props = SDL_CreateProperties();
+        bool result;
+
+        SDL_SetPointerProperty(props, IMG_PROP_SAVE_IOSTREAM_POINTER, dest);
+        SDL_SetNumberProperty(props, IMG_PROP_SAVE_QUALITY_NUMBER, 95);
+        SDL_SetBooleanProperty(props, IMG_PROP_SAVE_JPG_PROGRESSIVE_BOOLEAN, (i == 0));
+        SDL_SetBooleanProperty(props, IMG_PROP_SAVE_JPG_OPTIMIZE_CODING_BOOLEAN, true);
+        SDL_SetStringProperty(props, IMG_PROP_SAVE_JPG_SUBSAMPLING_STRING, subsamplings[i]);
+        SDL_SetNumberProperty(props, IMG_PROP_SAVE_JPG_RESTART_INTERVAL_NUMBER, 4);
+        SDLTest_AssertPass("About to call IMG_SaveJPGWithProperties(<%s>)", subsamplings[i]);
+        result = IMG_SaveJPGWithProperties(reference, props);
+        SDLTest_AssertCheck(result, "Save JPG with %s subsampling (%s)", subsamplings[i], result ? "ok" : SDL_GetError());
+
+#ifdef LOAD_JPG
+        if (result) {
+            SDL_Surface *surface;
+
+            SDL_SeekIO(dest, 0, SDL_IO_SEEK_SET);
+            surface = IMG_Load_IO(dest, false);
+            SDLTest_AssertCheck(surface != NULL, "Load saved JPG (%s)", surface ? "ok" : SDL_GetError());
+            if (surface) {
+                SDLTest_AssertCheck(surface->w == reference->w && surface->h == reference->h,
+                                    "Expected %dx%d px, got %dx%d",
+                                    reference->w, reference->h, surface->w, surface->h);
+                SDL_DestroySurface(surface);
+            }
+        }
+#endif
+        SDL_DestroyProperties(props);
+        SDL_CloseIO(dest);
+    }
+
+    SDL_ClearError();
+    SDLTest_AssertPass("About to call IMG_SaveJPGWithProperties() with unsupported subsampling");
+    {
+        SDL_IOStream *dest = SDL_IOFromDynamicMem();
+        SDL_PropertiesID props = SDL_CreateProperties();
+        bool result;
+
+        SDL_SetPointerProperty(props, IMG_PROP_SAVE_IOSTREAM_POINTER, dest);
+        SDL_SetStringProperty(props, IMG_PROP_SAVE_JPG_SUBSAMPLING_STRING, "4:1:1");
+        result = IMG_SaveJPGWithProperties(reference, props);
+        SDLTest_AssertCheck(!result, "Saving with 4:1:1 subsampling should fail");
+        SDL_DestroyProperties(props);
+        SDL_CloseIO(dest);
+    }
+
+    SDL_DestroySurface(reference);
+    SDL_free(refFilename);
+    return TEST_COMPLETED;
+#else
+    (void)arg;
+    return TEST_SKIPPED;
+#endif
+}
+
+#if defined(SAVE_JPG) && SAVE_JPG && defined(LOAD_JPG) && USING_LIBJPEG
+/* Create an RGB image with smooth gradients and some detail */
+static SDL_Surface *
+CreateJPGTestSurface(int w, int h)
+{
+    SDL_Surface *surface = SDL_CreateSurface(w, h, SDL_PIXELFORMAT_RGB24);
+    int x, y;
+
+    if (!surface) {
+        return NULL;
+    }
+    for (y = 0; y < h; y++) {
+        Uint8 *pixel = (Uint8 *)surface->pixels + y * surface->pitch;
+
+        for (x = 0; x < w; x++) {
+            pixel[0] = (Uint8)(x * 255 / w);
+            pixel[1] = (Uint8)(y * 255 / h);
+            pixel[2] = (Uint8)(((x / 10) ^ (y / 10)) & 1 ? 200 : 50);
+            pixel += 3;
+        }
+    }
+    return surface;
+}
+
+/* Save a JPEG to memory with the given subsampling, thread count and restart interval */
+static SDL_IOStream *
+SaveJPGToMemory(SDL_Surface *surface, const char *subsampling, int threads, int restart_interval)
+{
+    SDL_IOStream *dest = SDL_IOFromDynamicMem();
+    SDL_PropertiesID props = SDL_CreateProperties();
+    bool result;
+
+    SDL_SetPointerProperty(props, IMG_PROP_SAVE_IOSTREAM_POINTER, dest);
+    SDL_SetNumberProperty(props, IMG_PROP_SAVE_QUALITY_NUMBER, 90);
+    SDL_SetStringProperty(props, IMG_PROP_SAVE_JPG_SUBSAMPLING_STRING, subsampling);
+    SDL_SetNumberProperty(props, IMG_PROP_SAVE_THREAD_COUNT_NUMBER, threads);
+    SDL_SetNumberProperty(props, IMG_PROP_SAVE_JPG_RESTART_INTERVAL_NUMBER, restart_interval);
+    SDLTest_AssertPass("About to call IMG_SaveJPGWithProperties(<%s, %d threads, restart interval %d>)",
+                       subsampling, threads, restart_interval);
+    result = IMG_SaveJPGWithProperties(surface, props);
+    SDLTest_AssertCheck(result, "Save JPG with %s subsampling on %d threads (%s)",
+                        subsampling, threads, result ? "ok" : SDL_GetError());
+    SDL_DestroyProperties(props);
+    if (!result) {
+        SDL_CloseIO(dest);
+        return NULL;
+    }
+    SDL_SeekIO(dest, 0, SDL_IO_SEEK_SET);
+    return dest;
+}
+#endif
+
+static int SDLCALL
+TestSaveJPGThreads(void *arg)
+{
+#if defined(SAVE_JPG) && SAVE_JPG && defined(LOAD_JPG) && USING_LIBJPEG
+    static const struct
+    {
+        const char *subsampling;
+        int mcu_size;
+    } cases[] = {
+        { "4:4:4", 8 },
+        { "4:2:0", 16 },
+    };
+    SDL_Surface *reference;
+    int i;
+    (void)arg;
+
+    /* Tall enough for several strips of 8 MCU rows, with a partial MCU row at the bottom */
+    reference = CreateJPGTestSurface(300, 300);
+    if (!SDLTest_AssertCheck(reference != NULL, "Creating reference should succeed (%s)", SDL_GetError())) {
+        return TEST_ABORTED;
+    }
+
+    for (i = 0; i < (int)SDL_arraysize(cases); i++) {
+        const int mcus_per_row = (reference->w + cases[i].mcu_size - 1) / cases[i].mcu_size;
+        const int mcu_rows = (reference->h + cases[i].mcu_size - 1) / cases[i].mcu_size;
+        SDL_IOStream *parallel = SaveJPGToMemory(reference, cases[i].subsampling, 4, 0);
+        SDL_IOStream *serial = SaveJPGToMemory(reference, cases[i].subsampling, 1, mcus_per_row);
+
+        if (parallel) {
+            const Uint8 *data = (const Uint8 *)SDL_GetPointerProperty(SDL_GetIOProperties(parallel), SDL_PROP_IOSTREAM_DYNAMIC_MEMORY_POINTER, NULL);
+            size_t size = (size_t)SDL_GetIOSize(parallel);
+            size_t pos = 2;
+            int height = -1, restarts = 0;
+            bool in_order = true;
+
+            /* Find the height in the frame header, then check the restart markers in the scan */
+            while (data && pos + 4 <= size && data[pos] == 0xFF) {
+                Uint8 marker = data[pos + 1];
+                size_t length = ((size_t)data[pos + 2] << 8) | data[pos + 3];
+
+                if (marker == 0xC0 && pos + 7 <= size) {
+                    height = (data[pos + 5] << 8) | data[pos + 6];
+                }
+                pos += 2 + length;
+                if (marker == 0xDA) {
+                    break;
+                }
+            }
+            for (; data && pos + 1 < size; pos++) {
+                if (data[pos] == 0xFF && data[pos + 1] >= 0xD0 && data[pos + 1] <= 0xD7) {
+                    if (data[pos + 1] != 0xD0 + (restarts % 8)) {
+                        in_order = false;
+                    }
+                    restarts++;
+                }
+            }
+            SDLTest_AssertCheck(height == reference->h, "Frame header should have the full height %d, got %d", reference->h, height);
+            SDLTest_AssertCheck(restarts == mcu_rows - 1 && in_order,
+                                "Expected %d restart markers in order RST0-RST7, got %d%s",
+                                mcu_rows - 1, restarts, in_order ? "" : " out of order");
+        }
+
+        if (parallel && serial) {
+            SDL_Surface *surface = IMG_Load_IO(parallel, false);
+            SDL_Surface *expected = IMG_Load_IO(serial, false);
+
+            SDLTest_AssertCheck(surface != NULL && expected != NULL, "Load saved JPGs (%s)",
+                                (surface && expected) ? "ok" : SDL_GetError());
+            if (surface && expected) {
+                int diff = SDLTest_CompareSurfaces(surface, expected, 0);
+
+                SDLTest_AssertCheck(diff == 0, "JPG saved on several threads should decode like one saved with a restart every MCU row (%d)", diff);
+            }
+            SDL_DestroySurface(surface);
+            SDL_DestroySurface(expected);
+        }
+        if (parallel) {
+            SDL_CloseIO(parallel);
+        }
+        if (serial) {
+            SDL_CloseIO(serial);
+        }
+    }
+
+    SDL_DestroySurface(reference);
+    return TEST_COMPLETED;
+#else
+    (void)arg;
+    return TEST_SKIPPED;
+#endif
+}
+
+static int SDLCALL
+TestLoadJPGThreads(void *arg)
+{
+#if defined(SAVE_JPG) && SAVE_JPG && defined(LOAD_JPG) && USING_LIBJPEG
+    static const struct
+    {
+        const char *subsampling;
+        int restart_interval;
+    } cases[] = {
+        { "4:4:4", 40 },    /* a restart at the start of every MCU row */
+        { "4:2:0", 20 },    /* a restart at the start of every MCU row */
+        { "4:2:0", 7 },     /* a restart at the start of every 7th MCU row */
+    };
+    SDL_Surface *reference;
+    int i;
+    (void)arg;
+
+    reference = CreateJPGTestSurface(320, 480);
+    if (!SDLTest_AssertCheck(reference != NULL, "Creating reference should succeed (%s)", SDL_GetError())) {
+        return TEST_ABORTED;
+    }
+
+    for (i = 0; i < (int)SDL_arraysize(cases); i++) {
+        SDL_IOStream *src = SaveJPGToMemory(reference, cases[i].subsampling, 1, cases[i].restart_interval);
+        SDL_PropertiesID props;
+        SDL_Surface *surface, *expected;
+
+        if (!src) {
+            continue;
+        }
+        expected = IMG_Load_IO(src, false);
+        SDLTest_AssertCheck(expected != NULL, "Load JPG on one thread (%s)", expected ? "ok" : SDL_GetError());
+
+        SDL_SeekIO(src, 0, SDL_IO_SEEK_SET);
+        props = SDL_CreateProperties();
+        SDL_SetPointerProperty(props, IMG_PROP_LOAD_IOSTREAM_POINTER, src);
+        SDL_SetNumberProperty(props, IMG_PROP_LOAD_THREAD_COUNT_NUMBER, 4);
+        SDLTest_AssertPass("About to call IMG_LoadWithProperties(<%s, restart interval %d, 4 threads>)",
+                           cases[i].subsampling, cases[i].restart_interval);
+        surface = IMG_LoadWithProperties(props);
+        SDLTest_AssertCheck(surface != NULL, "Load JPG on several threads (%s)", surface ? "ok" : SDL_GetError());
+        SDL_DestroyProperties(props);
+
+        if (surface && expected) {
+            int diff = SDLTest_CompareSurfaces(surface, expected, 0);
+
+            SDLTest_AssertCheck(diff == 0, "JPG loaded on several threads should match one loaded on a single thread (%d)", diff);
+        }
+        SDL_DestroySurface(surface);
+        SDL_DestroySurface(expected);
+        SDL_CloseIO(src);
+    }
+
+    SDL_DestroySurface(reference);
+    return TEST_COMPLETED;
+#else
+    (void)arg;
+    return TEST_SKIPPED;
+#endif
+}
+
+#ifdef SDL_IMAGE_LIBPNG
+/* An 8x8 greyscale PNG with a tRNS chunk making grey level 64 transparent */
+static const Uint8 grey_trns_png[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x08,
+    0x08, 0x00, 0x00, 0x00, 0x00, 0xe1, 0x64, 0xe1, 0x57, 0x00, 0x00, 0x00,
+    0x02, 0x74, 0x52, 0x4e, 0x53, 0x00, 0x40, 0x00, 0x4f, 0x8c, 0xa8, 0x00,
+    0x00, 0x00, 0x17, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x63, 0x60, 0x70,
+    0x68, 0xf8, 0x8f, 0x82, 0x19, 0x60, 0x6c, 0x06, 0x98, 0x18, 0x03, 0x11,
+    0x6a, 0x00, 0xee, 0x35, 0x1b, 0xf1, 0x8d, 0x2f, 0xe0, 0xee, 0x00, 0x00,
+    0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+};
+
+/* An 8x8 greyscale PNG with alpha using six grey and alpha combinations */
+static const Uint8 grey_alpha_png[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x08,
+    0x08, 0x04, 0x00, 0x00, 0x00, 0x6e, 0x06, 0x76, 0x00, 0x00, 0x00, 0x00,
+    0x29, 0x49, 0x44, 0x41, 0x54, 0x78, 0xda, 0x63, 0x60, 0xf8, 0x0f, 0x85,
+    0x0d, 0x50, 0xc8, 0xf0, 0x3f, 0xe5, 0xff, 0x09, 0xa0, 0x40, 0x4a, 0xc3,
+    0x09, 0x20, 0x37, 0x05, 0x24, 0x70, 0x02, 0x28, 0x04, 0x24, 0x41, 0x1c,
+    0x90, 0x20, 0x2d, 0xb4, 0x00, 0x00, 0x70, 0xa4, 0x3e, 0x55, 0xe5, 0xf1,
+    0x1c, 0xaf, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42,
+    0x60, 0x82,
+};
+
+/* Count the pixels that differ in any channel, whatever the surface formats */
+static int
+CountDifferentPixels(SDL_Surface *surface, SDL_Surface *reference)
+{
+    SDL_Surface *a = SDL_ConvertSurface(surface, SDL_PIXELFORMAT_RGBA32);
+    SDL_Surface *b = SDL_ConvertSurface(reference, SDL_PIXELFORMAT_RGBA32);
+    int x, y, count = 0;
+
+    if (!a || !b || a->w != b->w || a->h != b->h) {
+        count = -1;
+    } else {
+        for (y = 0; y < b->h; y++) {
+            const Uint32 *pa = (const Uint32 *)((const Uint8 *)a->pixels + y * a->pitch);
+            const Uint32 *pb = (const Uint32 *)((const Uint8 *)b->pixels + y * b->pitch);
+
+            for (x = 0; x < b->w; x++) {
+                if (pa[x] != pb[x]) {
+                    count++;
+                }
+            }
+        }
+    }
+    SDL_DestroySurface(a);
+    SDL_DestroySurface(b);
+    return count;
+}
+
+/* Load a PNG from memory with a boolean load property set */
+static SDL_Surface *
+LoadPNGWithBoolean(const Uint8 *data, size_t size, const char *name, bool value)
+{
+    SDL_PropertiesID props = SDL_CreateProperties();
+    SDL_Surface *surface;
+
+    SDL_SetPointerProperty(props, IMG_PROP_LOAD_IOSTREAM_POINTER, SDL_IOFromConstMem(data, size));
+    SDL_SetBooleanProperty(props, IMG_PROP_LOAD_IOSTREAM_AUTOCLOSE_BOOLEAN, true);
+    SDL_SetBooleanProperty(props, name, value);
+    surface = IMG_LoadWithProperties(props);
+    SDL_DestroyProperties(props);
+    return surface;
+}
+#endif
+
+#if defined(SAVE_PNG) && SAVE_PNG && defined(SDL_IMAGE_LIBPNG)
+/* Create an RGBA image with more colors than fit in a palette and varying alpha */
+static SDL_Surface *
+CreatePNGTestSurface(int w, int h)
+{
+    SDL_Surface *surface = SDL_CreateSurface(w, h, SDL_PIXELFORMAT_RGBA32);
+    int x, y;
+
+    if (!surface) {
+        return NULL;
+    }
+    for (y = 0; y < h; y++) {
+        Uint8 *pixel = (Uint8 *)surface->pixels + y * surface->pitch;
+
+        for (x = 0; x < w; x++) {
+            pixel[0] = (Uint8)(x * 3 + y);
+            pixel[1] = (Uint8)((y * 5) ^ x);
+            pixel[2] = (Uint8)((x * y) >> 4);
+            pixel[3] = (Uint8)(255 - ((x + y) & 0x7F));
+            pixel += 4;
+        }
+    }
+    return surface;
+}
+
+/* Save a PNG with the given properties to memory and check that it loads back unchanged.
+ * This returns the color type and bit depth of the saved image as (color_type << 8) | bit_depth,
+ * or -1 if it couldn't be saved.
+ */
+static int
+CheckPNGRoundTrip(SDL_Surface *reference, SDL_PropertiesID props, const char *description)
+{
+    SDL_IOStream *dest = SDL_IOFromDynamicMem();
+    SDL_Surface *surface;
+    bool result;
+    int header = -1;
+
+    SDL_SetPointerProperty(props, IMG_PROP_SAVE_IOSTREAM_POINTER, dest);
+    SDLTest_AssertPass("About to call IMG_SavePNGWithProperties(<%s>)", description);
+    result = IMG_SavePNGWithProperties(reference, props);
+    SDLTest_AssertCheck(result, "Save PNG with %s (%s)", description, result ? "ok" : SDL_GetError());
+    if (result) {
+        const Uint8 *data = (const Uint8 *)SDL_GetPointerProperty(SDL_GetIOProperties(dest), SDL_PROP_IOSTREAM_DYNAMIC_MEMORY_POINTER, NULL);
+
+        /* The bit depth and color type follow the signature, chunk header, width and height */
+        if (data && SDL_GetIOSize(dest) > 25) {
+            header = (data[25] << 8) | data[24];
+        }
+
+        SDL_SeekIO(dest, 0, SDL_IO_SEEK_SET);
+        surface = IMG_Load_IO(dest, false);
+        SDLTest_AssertCheck(surface != NULL, "Load PNG saved with %s (%s)", description, surface ? "ok" : SDL_GetError());
+        if (surface) {
+            int diff = CountDifferentPixels(surface, reference);
+
+            SDLTest_AssertCheck(diff == 0, "PNG saved with %s should load unchanged (%d pixels differ)", description, diff);
+            SDL_DestroySurface(surface);
+        }
+    }
+    SDL_SetPointerProperty(props, IMG_PROP_SAVE_IOSTREAM_POINTER, NULL);
+    SDL_CloseIO(dest);
+    return header;
+}
+#endif
+
+static int SDLCALL
+TestSavePNGThreads(void *arg)
+{
+#if defined(SAVE_PNG) && SAVE_PNG && defined(SDL_IMAGE_LIBPNG)
+    /* One level for each compression level in the zlib header */
+    static const int levels[] = { 0, 1, 4, 6, 9 };
+    SDL_Surface *reference;
+    int i;
+    (void)arg;
+
+    /* Large enough to be split into several blocks */
+    reference = CreatePNGTestSurface(512, 384);
+    if (!SDLTest_AssertCheck(reference != NULL, "Creating reference should succeed (%s)", SDL_GetError())) {
+        return TEST_ABORTED;
+    }
+
+    for (i = 0; i < (int)SDL_arraysize(levels); i++) {
+        SDL_PropertiesID props = SDL_CreateProperties();
+        char description[64];
+
+        SDL_snprintf(description, sizeof(description), "4 threads at level %d", levels[i]);
+        SDL_SetNumberProperty(props, IMG_PROP_SAVE_PNG_COMPRESSION_LEVEL_NUMBER, levels[i]);
+        SDL_SetNumberProperty(props, IMG_PROP_SAVE_THREAD_COUNT_NUMBER, 4);
+        CheckPNGRoundTrip(reference, props, description);
+        SDL_DestroyProperties(props);
+    }
+
+    SDL_DestroySurface(reference);
+    return TEST_COMPLETED;
+#else
+    (void)arg;
+    return TEST_SKIPPED;
+#endif
+}
+
+static int SDLCALL
+TestSavePNGFilters(void *arg)
+{
+#if defined(SAVE_PNG) && SAVE_PNG && defined(SDL_IMAGE_LIBPNG)
+    static const char *filters[] = { "none", "sub", "up", "average", "paeth", "adaptive", "sub,paeth" };
+    static const char *strategies[] = { "default", "filtered", "huffman", "rle", "fixed" };
+    static const struct
+    {
+        const char *property;
+        const char *value;
+    } bad_options[] = {
+        { IMG_PROP_SAVE_PNG_FILTER_STRING, "bogus" },
+        { IMG_PROP_SAVE_PNG_FILTER_STRING, "sub,bogus" },
+        { IMG_PROP_SAVE_PNG_STRATEGY_STRING, "bogus" },
+    };
+    SDL_Surface *reference;
+    int i;
+    (void)arg;
+
+    reference = CreatePNGTestSurface(64, 64);
+    if (!SDLTest_AssertCheck(reference != NULL, "Creating reference should succeed (%s)", SDL_GetError())) {
+        return TEST_ABORTED;
+    }
+
+    for (i = 0; i < (int)SDL_arraysize(bad_options); i++) {
+        SDL_IOStream *dest = SDL_IOFromDynamicMem();
+        SDL_PropertiesID props = SDL_CreateProperties();
+        bool result;
+
+        SDL_SetPointerProperty(props, IMG_PROP_SAVE_IOSTREAM_POINTER, dest);
+        SDL_SetStringProperty(props, bad_options[i].property, bad_options[i].value);
+        SDLTest_AssertPass("About to call IMG_SavePNGWithProperties(<%s \"%s\">)", bad_options[i].property, bad_options[i].value);
+        result = IMG_SavePNGWithProperties(reference, props);
+        SDLTest_AssertCheck(!result, "Saving PNG with %s \"%s\" should fail", bad_options[i].property, bad_options[i].value);
+        SDL_DestroyProperties(props);
+        SDL_CloseIO(dest);
+    }
+
+    for (i = 0; i < (int)SDL_arraysize(filters); i++) {
+        SDL_PropertiesID props = SDL_CreateProperties();
+        char description[64];
+
+        SDL_snprintf(description, sizeof(description), "filter \"%s\"", filters[i]);
+        SDL_SetStringProperty(props, IMG_PROP_SAVE_PNG_FILTER_STRING, filters[i]);
+        CheckPNGRoundTrip(reference, props, description);
+        SDL_DestroyProperties(props);
+    }
+
+    for (i = 0; i < (int)SDL_arraysize(strategies); i++) {
+        SDL_PropertiesID props = SDL_CreateProperties();
+        char description[64];
+
+        SDL_snprintf(description, sizeof(description), "strategy \"%s\"", strategies[i]);
+        SDL_SetStringProperty(props, IMG_PROP_SAVE_PNG_STRATEGY_STRING, strategies[i]);
+        CheckPNGRoundTrip(reference, props, description);
+        SDL_DestroyProperties(props);
+    }
+
+    SDL_DestroySurface(reference);
+    return TEST_COMPLETED;
+#else
+    (void)arg;
+    return TEST_SKIPPED;
+#endif
+}
+
+static int SDLCALL
+TestSavePNGReduceColors(void *arg)
+{
+#if defined(SAVE_PNG) && SAVE_PNG && defined(SDL_IMAGE_LIBPNG)
+    static const struct
+    {
+        const char *name;
+        int color_type;
+        int bit_depth;
+    } cases[] = {
+        { "16 colors with alpha", 3, 4 },
+        { "200 opaque colors", 3, 8 },
+        { "opaque grey", 0, 8 },
+        { "grey with alpha", 4, 8 },
+        { "opaque color", 2, 8 },
+        { "color with alpha", 6, 8 },
+    };
+    int i;
+    (void)arg;
+
+    for (i = 0; i < (int)SDL_arraysize(cases); i++) {
+        SDL_Surface *reference = SDL_CreateSurface(64, 64, SDL_PIXELFORMAT_RGBA32);
+        SDL_PropertiesID props;
+        int header, x, y;
+
+        if (!SDLTest_AssertCheck(reference != NULL, "Creating reference should succeed (%s)", SDL_GetError())) {
+            return TEST_ABORTED;
+        }
+        for (y = 0; y < reference->h; y++) {
+            Uint8 *pixel = (Uint8 *)reference->pixels + y * reference->pitch;
+
+            for (x = 0; x < reference->w; x++) {
+                int k;
+
+                switch (i) {
+                case 0:
+                    k = (x / 4 + y / 4) % 16;
+                    pixel[0] = (Uint8)(k * 16);
+                    pixel[1] = (Uint8)(255 - k * 16);
+                    pixel[2] = (Uint8)(k * 7);
+                    pixel[3] = (k < 4) ? 128 : 255;
+                    break;
+                case 1:
+                    k = (x + y * 64) % 200;
+                    pixel[0] = (Uint8)k;
+                    pixel[1] = (Uint8)(k * 3);
+                    pixel[2] = (Uint8)(255 - k);
+                    pixel[3] = 255;
+                    break;
+                case 2:
+                    pixel[0] = pixel[1] = pixel[2] = (Uint8)(x + y * 64);
+                    pixel[3] = 255;
+                    break;
+                case 3:
+                    pixel[0] = pixel[1] = pixel[2] = (Uint8)(x * 4);
+                    pixel[3] = (Uint8)(y * 4);
+                    break;
+                case 4:
+                    pixel[0] = (Uint8)(x * 4);
+                    pixel[1] = (Uint8)(y * 4);
+                    pixel[2] = (Uint8)(x ^ y);
+                    pixel[3] = 255;
+                    break;
+                default:
+                    pixel[0] = (Uint8)(x * 4);
+                    pixel[1] = (Uint8)(y * 4);
+                    pixel[2] = (Uint8)(x ^ y);
+                    pixel[3] = (Uint8)(255 - x);
+                    break;
+                }
+                pixel += 4;
+            }
+        }
+
+        props = SDL_CreateProperties();
+        SDL_SetBooleanProperty(props, IMG_PROP_SAVE_PNG_REDUCE_COLORS_BOOLEAN, true);
+        header = CheckPNGRoundTrip(reference, props, cases[i].name);
+        SDLTest_AssertCheck(header == ((cases[i].color_type << 8) | cases[i].bit_depth),
+                            "Expected %s to be saved with color type %d at %d bits, got %d at %d bits",
+                            cases[i].name, cases[i].color_type, cases[i].bit_depth, header >> 8, header & 0xFF);
+        SDL_DestroyProperties(props);
+        SDL_DestroySurface(reference);
+    }
+
+    /* Indexed images keep 8 bits per pixel unless colors are reduced */
+    {
+        SDL_Surface *reference = SDL_CreateSurface(16, 16, SDL_PIXELFORMAT_INDEX8);
+        SDL_Palette *palette = SDL_CreatePalette(4);
+        SDL_PropertiesID props;
+        int header, x, y;
+
+        if (!SDLTest_AssertCheck(reference != NULL && palette != NULL, "Creating indexed reference should succeed (%s)", SDL_GetError())) {
+            SDL_DestroyPalette(palette);
+            SDL_DestroySurface(reference);
+            return TEST_ABORTED;
+        }
+        for (i = 0; i < palette->ncolors; i++) {
+            SDL_Color color = { (Uint8)(i * 80), (Uint8)(255 - i * 80), (Uint8)(i * 30), 255 };
+
+            SDL_SetPaletteColors(palette, &color, i, 1);
+        }
+        SDL_SetSurfacePalette(reference, palette);
+        SDL_DestroyPalette(palette);
+        for (y = 0; y < reference->h; y++) {
+            Uint8 *pixel = (Uint8 *)reference->pixels + y * reference->pitch;
+
+            for (x = 0; x < reference->w; x++) {
+                pixel[x] = (Uint8)((x + y) % 4);
+            }
+        }
+
+        props = SDL_CreateProperties();
+        header = CheckPNGRoundTrip(reference, props, "a 4 color palette");
+        SDLTest_AssertCheck(header == ((3 << 8) | 8), "Expected an indexed image to be saved at 8 bits, got %d at %d bits",
+                            header >> 8, header & 0xFF);
+        SDL_DestroyProperties(props);
+        SDL_DestroySurface(reference);
+    }
+
+    return TEST_COMPLETED;
+#else
+    (void)arg;
+    return TEST_SKIPPED;
+#endif
+}
+
+static int SDLCALL
+TestLoadPNGCompact(void *arg)
+{
+#ifdef SDL_IMAGE_LIBPNG
+    SDL_Surface *surface;
+    SDL_Surface *expanded;
+    (void)arg;
+
+    SDLTest_AssertPass("About to load greyscale PNG with tRNS and IMG_PROP_LOAD_COMPACT_BOOLEAN");
+    surface = LoadPNGWithBoolean(grey_trns_png, sizeof(grey_trns_png), IMG_PROP_LOAD_COMPACT_BOOLEAN, true);
+    SDLTest_AssertCheck(surface != NULL, "Load compact greyscale PNG (%s)", surface ? "ok" : SDL_GetError());
+    if (surface) {
+        Uint32 key = 0;
+
+        SDLTest_AssertCheck(surface->format == SDL_PIXELFORMAT_INDEX8,
+                            "Expected SDL_PIXELFORMAT_INDEX8, got %s", SDL_GetPixelFormatName(surface->format));
+        SDLTest_AssertCheck(SDL_GetSurfaceColorKey(surface, &key) && key == 64,
+                            "Expected color key 64, got %s %" SDL_PRIu32, SDL_SurfaceHasColorKey(surface) ? "key" : "no key", key);
+        SDL_DestroySurface(surface);
+    }
+
+    SDLTest_AssertPass("About to load greyscale PNG with alpha and IMG_PROP_LOAD_COMPACT_BOOLEAN");
+    surface = LoadPNGWithBoolean(grey_alpha_png, sizeof(grey_alpha_png), IMG_PROP_LOAD_COMPACT_BOOLEAN, true);
+    expanded = LoadPNGWithBoolean(grey_alpha_png, sizeof(grey_alpha_png), IMG_PROP_LOAD_COMPACT_BOOLEAN, false);
+    SDLTest_AssertCheck(surface != NULL && expanded != NULL, "Load greyscale PNG with alpha (%s)",
+                        (surface && expanded) ? "ok" : SDL_GetError());
+    if (surface && expanded) {
+        SDL_Palette *palette = SDL_GetSurfacePalette(surface);
+        SDL_BlendMode blend = SDL_BLENDMODE_NONE;
+        bool translucent = false;
+        int i, diff;
+
+        SDLTest_AssertCheck(surface->format == SDL_PIXELFORMAT_INDEX8,
+                            "Expected SDL_PIXELFORMAT_INDEX8, got %s", SDL_GetPixelFormatName(surface->format));
+        SDLTest_AssertCheck(expanded->format == SDL_PIXELFORMAT_RGBA32,
+                            "Expected SDL_PIXELFORMAT_RGBA32 without compact, got %s", SDL_GetPixelFormatName(expanded->format));
+        for (i = 0; palette && i < palette->ncolors; i++) {
+            if (palette->colors[i].a != SDL_ALPHA_OPAQUE) {
+                translucent = true;
+            }
+        }
+        SDLTest_AssertCheck(translucent, "Palette should have a translucent color");
+        SDL_GetSurfaceBlendMode(surface, &blend);
+        SDLTest_AssertCheck(blend == SDL_BLENDMODE_BLEND, "Compact surface should blend");
+        diff = CountDifferentPixels(surface, expanded);
+        SDLTest_AssertCheck(diff == 0, "Compact and expanded images should match (%d pixels differ)", diff);
+    }
+    SDL_DestroySurface(surface);
+    SDL_DestroySurface(expanded);
+
+    return TEST_COMPLETED;
+#else
+    (void)arg;
+    return TEST_SKIPPED;
+#endif
+}
+
+static int SDLCALL
+TestLoadPNGTrusted(void *arg)
+{
+#ifdef SDL_IMAGE_LIBPNG
+    /* The offset of the last byte of the IDAT chunk CRC */
+    const size_t crc_offset = 81;
+    Uint8 corrupt_png[sizeof(grey_trns_png)];
+    SDL_Surface *surface, *expected;
+    int diff;
+    (void)arg;
+
+    SDL_memcpy(corrupt_png, grey_trns_png, sizeof(corrupt_png));
+    corrupt_png[crc_offset] ^= 0xFF;
+
+    SDLTest_AssertPass("About to load PNG with a bad IDAT CRC");
+    surface = LoadPNGWithBoolean(corrupt_png, sizeof(corrupt_png), IMG_PROP_LOAD_TRUSTED_INPUT_BOOLEAN, false);
+    SDLTest_AssertCheck(surface == NULL, "Loading a PNG with a bad CRC should fail by default");
+    SDL_DestroySurface(surface);
+
+    SDLTest_AssertPass("About to load PNG with a bad IDAT CRC and IMG_PROP_LOAD_TRUSTED_INPUT_BOOLEAN");
+    surface = LoadPNGWithBoolean(corrupt_png, sizeof(corrupt_png), IMG_PROP_LOAD_TRUSTED_INPUT_BOOLEAN, true);
+    expected = LoadPNGWithBoolean(grey_trns_png, sizeof(grey_trns_png), IMG_PROP_LOAD_TRUSTED_INPUT_BOOLEAN, false);
+    SDLTest_AssertCheck(surface != NULL, "Loading a PNG with a bad CRC should succeed when trusted (%s)",
+                        surface ? "ok" : SDL_GetError());
+    SDLTest_AssertCheck(expected != NULL, "Load intact PNG (%s)", expected ? "ok" : SDL_GetError());
+    if (surface && expected) {
+        diff = CountDifferentPixels(surface, expected);
+        SDLTest_AssertCheck(diff == 0, "Trusted and intact images should match (%d pixels differ)", diff);
+    }
+    SDL_DestroySurface(surface);
+    SDL_DestroySurface(expected);
+
+    return TEST_COMPLETED;
+#else
+    (void)arg;
+    return TEST_SKIPPED;
+#endif
+}
+
+static int SDLCALL
+TestLoadScaledAlpha(void *arg)
+{
+#ifdef SDL_IMAGE_LIBPNG
+    SDL_Surface *surface = NULL, *expected = NULL;
+    SDL_BlendMode blend = SDL_BLENDMODE_NONE;
+    int i, diff;
+    (void)arg;
+
+    /* A color keyed image should reduce like the same image with alpha */
+    for (i = 0; i < 2; i++) {
+        SDL_PropertiesID props = SDL_CreateProperties();
+
+        SDL_SetPointerProperty(props, IMG_PROP_LOAD_IOSTREAM_POINTER, SDL_IOFromConstMem(grey_trns_png, sizeof(grey_trns_png)));
+        SDL_SetBooleanProperty(props, IMG_PROP_LOAD_IOSTREAM_AUTOCLOSE_BOOLEAN, true);
+        SDL_SetBooleanProperty(props, IMG_PROP_LOAD_COMPACT_BOOLEAN, (i == 0));
+        SDL_SetNumberProperty(props, IMG_PROP_LOAD_MAX_WIDTH_NUMBER, 3);
+        SDL_SetNumberProperty(props, IMG_PROP_LOAD_MAX_HEIGHT_NUMBER, 3);
+        SDLTest_AssertPass("About to load greyscale PNG with tRNS scaled to 3x3%s", (i == 0) ? " with a color key" : "");
+        if (i == 0) {
+            surface = IMG_LoadWithProperties(props);
+        } else {
+            expected = IMG_LoadWithProperties(props);
+        }
+        SDL_DestroyProperties(props);
+    }
+    SDLTest_AssertCheck(surface != NULL && expected != NULL, "Load scaled PNGs (%s)",
+                        (surface && expected) ? "ok" : SDL_GetError());
+    if (surface && expected) {
+        SDLTest_AssertCheck(!SDL_SurfaceHasColorKey(surface) && SDL_ISPIXELFORMAT_ALPHA(surface->format),
+                            "Scaled color keyed image should have alpha, got %s", SDL_GetPixelFormatName(surface->format));
+        SDL_GetSurfaceBlendMode(surface, &blend);
+        SDLTest_AssertCheck(blend == SDL_BLENDMODE_BLEND, "Scaled color keyed image should blend");
+        diff = CountDifferentPixels(surface, expected);
+        SDLTest_AssertCheck(diff == 0, "Scaled color keyed and alpha images should match (%d pixels differ)", diff);
+    }
+    SDL_DestroySurface(surface);
+    SDL_DestroySurface(expected);
+
+#if defined(SAVE_PNG) && SAVE_PNG
+    /* Opaque red next to transparent green should reduce to translucent red */
+    surface = SDL_CreateSurface(4, 2, SDL_PIXELFORMAT_RGBA32);
+    if (SDLTest_AssertCheck(surface != NULL, "Creating reference should succeed (%s)", SDL_GetError())) {
+        SDL_IOStream *dest = SDL_IOFromDynamicMem();
+        SDL_Surface *reduced = NULL;
+        int x, y;
+
+        for (y = 0; y < surface->h; y++) {
+            Uint32 *pixel = (Uint32 *)((Uint8 *)surface->pixels + y * surface->pitch);
+
+            for (x = 0; x < surface->w; x++) {
+                pixel[x] = (x % 2) ? SDL_MapSurfaceRGBA(surface, 0, 255, 0, 0) : SDL_MapSurfaceRGBA(surface, 255, 0, 0, 255);
+            }
+        }
+        if (IMG_SavePNG_IO(surface, dest, false) && SDL_SeekIO(dest, 0, SDL_IO_SEEK_SET) == 0) {
+            SDLTest_AssertPass("About to call IMG_LoadScaled_IO(<src>, false, 2, 1)");
+            reduced = IMG_LoadScaled_IO(dest, false, 2, 1);
+        }
+        SDLTest_AssertCheck(reduced != NULL, "Load scaled RGBA PNG (%s)", reduced ? "ok" : SDL_GetError());
+        if (reduced) {
+            Uint8 r = 0, g = 0, b = 0, a = 0;
+
+            SDL_ReadSurfacePixel(reduced, 0, 0, &r, &g, &b, &a);
+            SDLTest_AssertCheck(r == 255 && g == 0 && b == 0 && a == 128,
+                                "Expected transparent pixels not to bleed into the average, got %d,%d,%d,%d", r, g, b, a);
+            SDL_DestroySurface(reduced);
+        }
+        SDL_CloseIO(dest);
+        SDL_DestroySurface(surface);
+    }
+#endif
+
+    return TEST_COMPLETED;
+#else
+    (void)arg;
+    return TEST_SKIPPED;
+#endif
+}
+
+#if (defined(SAVE_PNG) && SAVE_PNG && defined(SDL_IMAGE_LIBPNG)) || USING_LIBTIFF
+/* Count the pixels of an oriented image that differ from an upright one moved to where the EXIF orientation puts them */
+static int
+CountOrientedDifferences(SDL_Surface *oriented, SDL_Surface *upright, int orientation)
+{
+    const int bpp = SDL_BYTESPERPIXEL(upright->format);
+    const int w = upright->w;
+    const int h = upright->h;
+    int x, y, count = 0;
+
+    if (oriented->format != upright->format ||
+        oriented->w != ((orientation >= 5) ? h : w) ||
+        oriented->h != ((orientation >= 5) ? w : h)) {
+        return -1;
+    }
+    for (y = 0; y < h; y++) {
+        for (x = 0; x < w; x++) {
+            int dx, dy;
+
+            switch (orientation) {
+            case 2: dx = w - 1 - x; dy = y; break;
+            case 3: dx = w - 1 - x; dy = h - 1 - y; break;
+            case 4: dx = x; dy = h - 1 - y; break;
+            case 5: dx = y; dy = x; break;
+            case 6: dx = h - 1 - y; dy = x; break;
+            case 7: dx = h - 1 - y; dy = w - 1 - x; break;
+            case 8: dx = y; dy = w - 1 - x; break;
+            default: dx = x; dy = y; break;
+            }
+            if (SDL_memcmp((const Uint8 *)upright->pixels + y * upright->pitch + x * bpp,
+                           (const Uint8 *)oriented->pixels + dy * oriented->pitch + dx * bpp, bpp) != 0) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+#endif
+
+#if defined(SAVE_PNG) && SAVE_PNG && defined(SDL_IMAGE_LIBPNG)
+static Uint32
+PNGChunkCRC(const Uint8 *data, size_t size)
+{
+    Uint32 crc = 0xFFFFFFFF;
+    size_t i;
+    int bit;
+
+    for (i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+        }
+    }
+    return ~crc;
+}
+
+/* Copy a PNG with an XMP tiff:Orientation chunk added after the image header */
+static Uint8 *
+CreatePNGWithOrientation(const Uint8 *png, size_t size, int orientation, size_t *new_size)
+{
+    char xmp[256];
+    Uint8 *data;
+    Uint8 *chunk;
+    size_t length;
+    Uint32 value;
+    int i;
+
+    /* iTXt: the keyword, no compression, and empty language and translated keyword */
+    length = 17 + 5 + (size_t)SDL_snprintf(xmp, sizeof(xmp),
+        "<x:xmpmeta xmlns:x=\"adobe:ns:meta/\"><rdf:RDF xmlns:rdf=\"http://www.w3.org/1999/02/22-rdf-syntax-ns#\">"
+        "<rdf:Description xmlns:tiff=\"http://ns.adobe.com/tiff/1.0/\" tiff:Orientation=\"%d\"/></rdf:RDF></x:xmpmeta>",
+        orientation);
+    *new_size = size + 12 + length;
+    data = (Uint8 *)SDL_malloc(*new_size);
+    if (!data) {
+        return NULL;
+    }
+
+    /* The signature and the image header chunk come first */
+    SDL_memcpy(data, png, 33);
+    chunk = &data[33];
+    for (i = 0; i < 4; i++) {
+        chunk[i] = (Uint8)(length >> (24 - i * 8));
+    }
+    SDL_memcpy(&chunk[4], "iTXt", 4);
+    SDL_memcpy(&chunk[8], "XML:com.adobe.xmp\0\0\0\0\0", 22);
+    SDL_memcpy(&chunk[30], xmp, length - 22);
+    value = PNGChunkCRC(&chunk[4], 4 + length);
+    for (i = 0; i < 4; i++) {
+        chunk[8 + length + i] = (Uint8)(value >> (24 - i * 8));
+    }
+    SDL_memcpy(&chunk[12 + length], &png[33], size - 33);
+    return data;
+}
+#endif
+
+#if USING_LIBTIFF
+static void
+PutLE16(Uint8 *data, Uint32 value)
+{
+    data[0] = (Uint8)value;
+    data[1] = (Uint8)(value >> 8);
+}
+
+static void
+PutLE32(Uint8 *data, Uint32 value)
+{
+    PutLE16(data, value);
+    PutLE16(&data[2], value >> 16);
+}
+
+/* Create an uncompressed RGB TIFF with an orientation tag, stored in strips of a few rows */
+static Uint8 *
+CreateOrientedTIFF(int w, int h, int rows_per_strip, int orientation, size_t *size)
+{
+    static const Uint16 tags[] = { 256, 257, 258, 259, 262, 273, 274, 277, 278, 279, 284 };
+    const int strips = (h + rows_per_strip - 1) / rows_per_strip;
+    const size_t pixels = (size_t)w * h * 3;
+    const size_t ifd = 8 + pixels;
+    const size_t arrays = ifd + 2 + SDL_arraysize(tags) * 12 + 4;
+    Uint8 *data;
+    Uint8 *entry;
+    int x, y, i;
+
+    *size = arrays + 8 + strips * 8;
+    data = (Uint8 *)SDL_calloc(1, *size);
+    if (!data) {
+        return NULL;
+    }
+    SDL_memcpy(data, "II\x2a\0", 4);
+    PutLE32(&data[4], (Uint32)ifd);
+    for (y = 0; y < h; y++) {
+        Uint8 *pixel = &data[8 + (size_t)y * w * 3];
+
+        for (x = 0; x < w; x++, pixel += 3) {
+            pixel[0] = (Uint8)(x * 5 + y);
+            pixel[1] = (Uint8)(y * 3);
+            pixel[2] = (Uint8)(x ^ y);
+        }
+    }
+
+    /* Bits per sample, then the strip offsets and byte counts */
+    PutLE16(&data[arrays], 8);
+    PutLE16(&data[arrays + 2], 8);
+    PutLE16(&data[arrays + 4], 8);
+    for (i = 0; i < strips; i++) {
+        const int rows = SDL_min(rows_per_strip, h - i * rows_per_strip);
+
+        PutLE32(&data[arrays + 8 + i * 4], (Uint32)(8 + (size_t)i * rows_per_strip * w * 3));
+        PutLE32(&data[arrays + 8 + strips * 4 + i * 4], (Uint32)(rows * w * 3));
+    }
+
+    PutLE16(&data[ifd], (Uint32)SDL_arraysize(tags));
+    for (i = 0; i < (int)SDL_arraysize(tags); i++) {
+        Uint32 value;
+        Uint32 count = 1;
+        bool is_long = false;
+
+        switch (tags[i]) {
+        case 256: value = (Uint32)w; break;
+        case 257: value = (Uint32)h; break;
+        case 258: value = (Uint32)arrays; count = 3; break;
+        case 259: value = 1; break; /* no compression */
+        case 262: value = 2; break; /* RGB */
+        case 273: value = (Uint32)(arrays + 8); count = (Uint32)strips; is_long = true; break;
+        case 274: value = (Uint32)orientation; break;
+        case 277: value = 3; break;
+        case 278: value = (Uint32)rows_per_strip; break;
+        case 279: value = (Uint32)(arrays + 8 + strips * 4); count = (Uint32)strips; is_long = true; break;
+        default: value = 1; break; /* contiguous samples */
+        }
+        entry = &data[ifd + 2 + i * 12];
+        PutLE16(entry, tags[i]);
+        PutLE16(&entry[2], is_long ? 4 : 3);
+        PutLE32(&entry[4], count);
+        if (is_long || count > 1) {
+            PutLE32(&entry[8], value);
+        } else {
+            PutLE16(&entry[8], value);
+        }
+    }
+    return data;
+}
+#endif
+
+static int SDLCALL
+TestLoadOrientation(void *arg)
+{
+#if (defined(SAVE_PNG) && SAVE_PNG && defined(SDL_IMAGE_LIBPNG)) || USING_LIBTIFF
+    /* Non-square sizes that aren't multiples of the transpose blocks or tiles */
+    static const struct {
+        int w;
+        int h;
+    } sizes[] = {
+        { 45, 37 },
+        { 13, 70 },
+    };
+    SDL_Surface *upright;
+    SDL_Surface *oriented;
+    int i, orientation, diff;
+    (void)arg;
+
+#if defined(SAVE_PNG) && SAVE_PNG && defined(SDL_IMAGE_LIBPNG)
+    for (i = 0; i < (int)SDL_arraysize(sizes) * 2; i++) {
+        /* RGBA images go through the 32-bit transpose, and indexed images the 8-bit one */
+        const bool indexed = (i % 2) != 0;
+        const int w = sizes[i / 2].w;
+        const int h = sizes[i / 2].h;
+        SDL_Surface *surface = CreatePNGTestSurface(w, h);
+        SDL_IOStream *dest = SDL_IOFromDynamicMem();
+        const Uint8 *png = NULL;
+        size_t size = 0;
+
+        if (surface && indexed) {
+            SDL_Palette *palette = SDL_CreatePalette(256);
+            SDL_Surface *converted = NULL;
+            int c;
+
+            if (palette) {
+                for (c = 0; c < palette->ncolors; c++) {
+                    palette->colors[c].r = (Uint8)c;
+                    palette->colors[c].g = (Uint8)(255 - c);
+                    palette->colors[c].b = (Uint8)(c * 7);
+                    palette->colors[c].a = 255;
+                }
+                converted = SDL_ConvertSurfaceAndColorspace(surface, SDL_PIXELFORMAT_INDEX8, palette, SDL_COLORSPACE_SRGB, 0);
+                SDL_DestroyPalette(palette);
+            }
+            SDL_DestroySurface(surface);
+            surface = converted;
+        }
+        if (surface && IMG_SavePNG_IO(surface, dest, false)) {
+            png = (const Uint8 *)SDL_GetPointerProperty(SDL_GetIOProperties(dest), SDL_PROP_IOSTREAM_DYNAMIC_MEMORY_POINTER, NULL);
+            size = (size_t)SDL_GetIOSize(dest);
+        }
+        SDL_DestroySurface(surface);
+        if (!SDLTest_AssertCheck(png != NULL && size > 33, "Saving %dx%d %s PNG should succeed (%s)",
+                                 w, h, indexed ? "indexed" : "RGBA", SDL_GetError())) {
+            SDL_CloseIO(dest);
+            return TEST_ABORTED;
+        }
+
+        upright = IMG_Load_IO(SDL_IOFromConstMem(png, size), true);
+        SDLTest_AssertCheck(upright != NULL, "Load upright PNG (%s)", upright ? "ok" : SDL_GetError());
+        for (orientation = 1; upright && orientation <= 8; orientation++) {
+            size_t tagged_size;
+            Uint8 *tagged = CreatePNGWithOrientation(png, size, orientation, &tagged_size);
+
+            if (!tagged) {
+                continue;
+            }
+            SDLTest_AssertPass("About to load %dx%d %s PNG with orientation %d", w, h, indexed ? "indexed" : "RGBA", orientation);
+            oriented = IMG_Load_IO(SDL_IOFromConstMem(tagged, tagged_size), true);
+            SDLTest_AssertCheck(oriented != NULL, "Load oriented PNG (%s)", oriented ? "ok" : SDL_GetError());
+            if (oriented) {
+                diff = CountOrientedDifferences(oriented, upright, orientation);
+                SDLTest_AssertCheck(diff == 0, "PNG with orientation %d should match the reference (%d pixels differ)", orientation, diff);
+                SDL_DestroySurface(oriented);
+            }
+            SDL_free(tagged);
+        }
+        SDL_DestroySurface(upright);
+        SDL_CloseIO(dest);
+    }
+#endif
+
+#if USING_LIBTIFF
+    for (i = 0; i < (int)SDL_arraysize(sizes); i++) {
+        const int w = sizes[i].w;
+        const int h = sizes[i].h;
+        size_t size;
+        Uint8 *tiff = CreateOrientedTIFF(w, h, 6, 1, &size);
+
+        if (!SDLTest_AssertCheck(tiff != NULL, "Creating %dx%d TIFF should succeed", w, h)) {
+            return TEST_ABORTED;
+        }
+        upright = IMG_Load_IO(SDL_IOFromConstMem(tiff, size), true);
+        SDL_free(tiff);
+        SDLTest_AssertCheck(upright != NULL, "Load upright TIFF (%s)", upright ? "ok" : SDL_GetError());
+        for (orientation = 1; upright && orientation <= 8; orientation++) {
+            tiff = CreateOrientedTIFF(w, h, 6, orientation, &size);
+            if (!tiff) {
+                continue;
+            }
+            SDLTest_AssertPass("About to load %dx%d TIFF with orientation %d", w, h, orientation);
+            oriented = IMG_Load_IO(SDL_IOFromConstMem(tiff, size), true);
+            SDLTest_AssertCheck(oriented != NULL, "Load oriented TIFF (%s)", oriented ? "ok" : SDL_GetError());
+            if (oriented) {
+                diff = CountOrientedDifferences(oriented, upright, orientation);
+                SDLTest_AssertCheck(diff == 0, "TIFF with orientation %d should match the reference (%d pixels differ)", orientation, diff);
+                SDL_DestroySurface(oriented);
+            }
+            SDL_free(tiff);
+        }
+        SDL_DestroySurface(upright);
+    }
+#endif
+
+    return TEST_COMPLETED;
+#else
+    (void)arg;
+    return TEST_SKIPPED;
+#endif
+}
+
+#ifdef LOAD_GIF
+/* Pack an LZW code into a GIF data stream, least significant bit first */
+static void
+PutGIFCode(Uint8 *packed, size_t *bitpos, int code, int code_size)
+{
+    int bit;
+
+    for (bit = 0; bit < code_size; bit++, (*bitpos)++) {
+        if (code & (1 << bit)) {
+            packed[*bitpos / 8] |= (Uint8)(1 << (*bitpos % 8));
+        }
+    }
+}
+
+/* Create a GIF of 8-bit pixels, with a palette that maps index i to (i, 255 - i, i * 7).
+ * The encoder never clears its code table, so once the table is full the rest of the
+ * image is coded with the 4096 entries already defined, as a decoder must allow.
+ */
+static Uint8 *
+CreateLZWGIF(const Uint8 *pixels, int w, int h, bool interlace, bool *table_filled, size_t *size)
+{
+    static const int pass_start[4] = { 0, 4, 2, 1 };
+    static const int pass_step[4] = { 8, 8, 4, 2 };
+    const int clear_code = 256;
+    const int end_code = 257;
+    Uint16 *children;
+    Uint8 *packed;
+    Uint8 *data = NULL;
+    size_t bitpos = 0, packed_size, offset, i;
+    int next_code = end_code + 1;
+    int code_size = 9;
+    int prefix = -1;
+    int pass, y, x;
+
+    children = (Uint16 *)SDL_calloc(4096 * 256, sizeof(*children));
+    packed = (Uint8 *)SDL_calloc((size_t)w * h * 2 + 8, 1);
+    if (!children || !packed) {
+        goto done;
+    }
+
+    PutGIFCode(packed, &bitpos, clear_code, code_size);
+    for (pass = 0; pass < (interlace ? 4 : 1); pass++) {
+        for (y = interlace ? pass_start[pass] : 0; y < h; y += interlace ? pass_step[pass] : 1) {
+            for (x = 0; x < w; x++) {
+                const Uint8 c = pixels[y * w + x];
+
+                if (prefix < 0) {
+                    prefix = c;
+                } else if (children[prefix * 256 + c]) {
+                    prefix = children[prefix * 256 + c];
+                } else {
+                    PutGIFCode(packed, &bitpos, prefix, code_size);
+                    if (next_code < 4096) {
+                        children[prefix * 256 + c] = (Uint16)next_code++;
+                        if (next_code > (1 << code_size) && code_size < 12) {
+                            ++code_size;
+                        }
+                    }
+                    prefix = c;
+                }
+            }
+        }
+    }
+    PutGIFCode(packed, &bitpos, prefix, code_size);
+    PutGIFCode(packed, &bitpos, end_code, code_size);
+    packed_size = (bitpos + 7) / 8;
+    *table_filled = (next_code == 4096);
+
+    /* The header, global color table, image descriptor, code size, sub-blocks and trailer */
+    *size = 13 + 768 + 10 + 1 + packed_size + (packed_size + 254) / 255 + 1 + 1;
+    data = (Uint8 *)SDL_malloc(*size);
+    if (!data) {
+        goto done;
+    }
+    SDL_memcpy(data, "GIF89a", 6);
+    data[6] = (Uint8)w;
+    data[7] = (Uint8)(w >> 8);
+    data[8] = (Uint8)h;
+    data[9] = (Uint8)(h >> 8);
+    data[10] = 0xF7;
+    data[11] = 0;
+    data[12] = 0;
+    for (i = 0; i < 256; i++) {
+        data[13 + i * 3] = (Uint8)i;
+        data[13 + i * 3 + 1] = (Uint8)(255 - i);
+        data[13 + i * 3 + 2] = (Uint8)(i * 7);
+    }
+    offset = 13 + 768;
+    data[offset++] = 0x2C;
+    SDL_memset(&data[offset], 0, 4);
+    SDL_memcpy(&data[offset + 4], &data[6], 4);
+    data[offset + 8] = interlace ? 0x40 : 0x00;
+    offset += 9;
+    data[offset++] = 8;
+    for (i = 0; i < packed_size; i += 255) {
+        const size_t count = SDL_min(255, packed_size - i);
+
+        data[offset++] = (Uint8)count;
+        SDL_memcpy(&data[offset], &packed[i], count);
+        offset += count;
+    }
+    data[offset++] = 0;
+    data[offset++] = 0x3B;
+
+done:
+    SDL_free(children);
+    SDL_free(packed);
+    return data;
+}
+#endif
+
+static int SDLCALL
+TestLoadGIFLZW(void *arg)
+{
+#ifdef LOAD_GIF
+    /* Odd sizes, so the interlaced passes end on partial groups of rows */
+    const int w = 157;
+    const int h = 101;
+    Uint8 *pixels;
+    Uint32 seed = 1;
+    int i, x, y;
+    (void)arg;
+
+    pixels = (Uint8 *)SDL_malloc((size_t)w * h);
+    if (!SDLTest_AssertCheck(pixels != NULL, "Allocating pixels should succeed")) {
+        return TEST_ABORTED;
+    }
+    /* Noise fills the code table, and solid rows give long strings that wrap onto the next row */
+    for (y = 0; y < h; y++) {
+        for (x = 0; x < w; x++) {
+            seed = seed * 1103515245 + 12345;
+            pixels[y * w + x] = ((y % 7) == 3) ? (Uint8)y : (Uint8)(seed >> 16);
+        }
+    }
+
+    for (i = 0; i < 2; i++) {
+        const bool interlace = (i == 1);
+        bool table_filled = false;
+        size_t size = 0;
+        Uint8 *gif = CreateLZWGIF(pixels, w, h, interlace, &table_filled, &size);
+        SDL_Surface *surface;
+
+        if (!SDLTest_AssertCheck(gif != NULL, "Creating GIF should succeed")) {
+            SDL_free(pixels);
+            return TEST_ABORTED;
+        }
+        SDLTest_AssertCheck(table_filled, "The LZW code table should reach 4096 entries");
+
+        SDLTest_AssertPass("About to load %s GIF", interlace ? "interlaced" : "progressive");
+        surface = IMG_Load_IO(SDL_IOFromConstMem(gif, size), true);
+        SDLTest_AssertCheck(surface != NULL, "Load GIF (%s)", surface ? "ok" : SDL_GetError());
+        if (surface) {
+            int diff = 0;
+
+            SDLTest_AssertCheck(surface->w == w && surface->h == h, "Expected %dx%d, got %dx%d", w, h, surface->w, surface->h);
+            for (y = 0; y < SDL_min(h, surface->h); y++) {
+                for (x = 0; x < SDL_min(w, surface->w); x++) {
+                    const Uint8 index = pixels[y * w + x];
+                    Uint8 r = 0, g = 0, b = 0, a = 0;
+
+                    SDL_ReadSurfacePixel(surface, x, y, &r, &g, &b, &a);
+                    if (r != index || g != 255 - index || b != ((index * 7) & 0xFF)) {
+                        diff++;
+                    }
+                }
+            }
+            SDLTest_AssertCheck(diff == 0, "Decoded %s GIF should match (%d pixels differ)", interlace ? "interlaced" : "progressive", diff);
+            SDL_DestroySurface(surface);
+        }
+        SDL_free(gif);
+    }
+
+    SDL_free(pixels);
+    return TEST_COMPLETED;
+#else
+    (void)arg;
+    return TEST_SKIPPED;
+#endif
+}
+
+static const SDLTest_TestCaseReference formatsTestCase = {
+    TestFormats, "Images", "Load and save various image formats", TEST_ENABLED
+};
+
+static const SDLTest_TestCaseReference batchTestCase = {
+    TestBatch, "Batch", "Load images in parallel with IMG_LoadBatch()", TEST_ENABLED
+};
+
+static const SDLTest_TestCaseReference detectShortReadsTestCase = {
+    TestDetectShortReads, "DetectShortReads", "Detect image formats from streams that return short reads", TEST_ENABLED
+};
+
+static const SDLTest_TestCaseReference imageInfoTruncatedXVTestCase = {
+    TestImageInfoTruncatedXV, "ImageInfoTruncatedXV", "Probe an XV header that runs past the detection window", TEST_ENABLED
+};
+
+static const SDLTest_TestCaseReference imageInfoFramesTestCase = {
+    TestImageInfoFrames, "ImageInfoFrames", "Count the frames of animations and multi-page images", TEST_ENABLED
+};
+
+static const SDLTest_TestCaseReference loadMapFileTestCase = {
+    TestLoadMapFile, "LoadMapFile", "Load files with and without mapping them into memory", TEST_ENABLED
+};
+
+static const SDLTest_TestCaseReference asyncTestCase = {
+    TestAsync, "Async", "Load images on a background thread with IMG_LoadAsync()", TEST_ENABLED
+};
+
+static const SDLTest_TestCaseReference saveJPGTestCase = {
+    TestSaveJPGWithProperties, "SaveJPG", "Save JPEG images with IMG_SaveJPGWithProperties()", TEST_ENABLED
+};
+
+static const SDLTest_TestCaseReference saveJPGThreadsTestCase = {
+    TestSaveJPGThreads, "SaveJPGThreads", "Save baseline JPEG images in strips on several threads", TEST_ENABLED
+};
+
+static const SDLTest_TestCaseReference loadJPGThreadsTestCase = {
+    TestLoadJPGThreads, "LoadJPGThreads", "Load baseline JPEG images with restart markers on several threads", TEST_ENABLED
+};
+
+static const SDLTest_TestCaseReference savePNGThreadsTestCase = {
+    TestSavePNGThreads, "SavePNGThreads", "Save large PNG images on several threads", TEST_ENABLED
+};
+
+static const SDLTest_TestCaseReference savePNGFiltersTestCase = {
+    TestSavePNGFilters, "SavePNGFilters", "Save PNG images with each filter and compression strategy", TEST_ENABLED
+};
+
+static const SDLTest_TestCaseReference savePNGReduceColorsTestCase = {
+    TestSavePNGReduceColors, "SavePNGReduceColors", "Save PNG images with IMG_PROP_SAVE_PNG_REDUCE_COLORS_BOOLEAN", TEST_ENABLED
+};
+
+static const SDLTest_TestCaseReference loadPNGCompactTestCase = {
+    TestLoadPNGCompact, "LoadPNGCompact", "Load PNG images with IMG_PROP_LOAD_COMPACT_BOOLEAN", TEST_ENABLED
+};
+
+static const SDLTest_TestCaseReference loadScaledAlphaTestCase = {
+    TestLoadScaledAlpha, "LoadScaledAlpha", "Load color keyed and translucent images scaled down", TEST_ENABLED
+};
+
+static const SDLTest_TestCaseReference loadPNGTrustedTestCase = {
+    TestLoadPNGTrusted, "LoadPNGTrusted", "Load PNG images with IMG_PROP_LOAD_TRUSTED_INPUT_BOOLEAN", TEST_ENABLED
+};
+
+static const SDLTest_TestCaseReference loadOrientationTestCase = {
+    TestLoadOrientation, "LoadOrientation", "Orient PNG and TIFF images while they are decoded", TEST_ENABLED
+};
+
+static const SDLTest_TestCaseReference loadGIFLZWTestCase = {
+    TestLoadGIFLZW, "LoadGIFLZW", "Decode interlaced GIFs and GIFs that fill the LZW code table", TEST_ENABLED
 };
 
 static const SDLTest_TestCaseReference *testCases[] =  {
     &formatsTestCase,
+    &batchTestCase,
+    &detectShortReadsTestCase,
+    &imageInfoTruncatedXVTestCase,
+    &imageInfoFramesTestCase,
+    &loadMapFileTestCase,
+    &asyncTestCase,
+    &saveJPGTestCase,
+    &saveJPGThreadsTestCase,
+    &loadJPGThreadsTestCase,
+    &savePNGThreadsTestCase,
+    &savePNGFiltersTestCase,
+    &savePNGReduceColorsTestCase,
+    &loadPNGCompactTestCase,
+    &loadPNGTrustedTestCase,
+    &loadScaledAlphaTestCase,
+    &loadOrientationTestCase,
+    &loadGIFLZWTestCase,
     NULL
 };
 static SDLTest_TestSuiteReference testSuite = {